@@ -809,6 +809,7 @@ class AnimationManager:
         """Main animation loop running in separate thread"""
         inline_show = getattr(self.controller, "inline_show", False)
         pending_present = None
+        last_generate_duration = 0.0
 
         # One presentation may overlap generation of the next frame. We resolve
         # it before the animation can rotate back to the same one of its two
@@ -824,13 +825,25 @@ class AnimationManager:
                     if not self.current_animation:
                         break
 
-                    time_elapsed = loop_start - self.start_time
+                    frame_start = loop_start
+                    if getattr(self.controller, "credit_flow", False):
+                        # Each frame is rendered for a receiver display slot,
+                        # which is only known once the previous frame is sent.
+                        if pending_present is not None:
+                            completed = pending_present
+                            pending_present = None
+                            send_duration, show_duration = completed.result()
+                        self.controller.wait_for_display_slot(lead_s=last_generate_duration)
+                        frame_start = time.perf_counter()
+
+                    time_elapsed = frame_start - self.start_time
                     gen_start = time.perf_counter()
                     rendered = self.current_animation.generate_frame(time_elapsed, self.frame_count)
                     changed = rendered.changed if isinstance(rendered, RenderedFrame) else True
                     dirty_ranges = rendered.dirty_ranges if isinstance(rendered, RenderedFrame) else None
                     frame = self._normalize_frame(rendered)
                     generate_duration = time.perf_counter() - gen_start
+                    last_generate_duration = generate_duration
 
                     with self.frame_data_lock:
                         self.current_frame_data = frame
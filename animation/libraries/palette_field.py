@@ -29,6 +29,13 @@ class AnimatedPaletteField:
         self.width = max(1, int(width))
         self.height = max(1, int(height))
         self.palette = palette
+        self._effect_scales = {
+            "x_scale": x_scale,
+            "y_scale": y_scale,
+            "radial_scale": radial_scale,
+            "radial_y_scale": radial_y_scale,
+            "center_y": center_y,
+        }
 
         grid_y, grid_x = np.indices((self.height, self.width), dtype=np.float32)
         radial = np.hypot(
@@ -42,6 +49,12 @@ class AnimatedPaletteField:
         self._indices = np.empty((self.height, self.width), dtype=np.uint16)
         self._layer = np.empty((self.height, self.width, 3), dtype=np.uint8)
 
+    def receiver_effect(self, ticks_per_second: float = 100.0) -> dict:
+        """Keyword arguments for ``set_effect('palette-field', **kwargs)`` that
+        have receivers render this field; upload ``self.palette`` with
+        ``set_effect_palette`` first."""
+        return {"ticks_per_second": ticks_per_second, **self._effect_scales}
+
     def render(
         self,
         time_elapsed: float,
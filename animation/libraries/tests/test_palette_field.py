@@ -34,6 +34,14 @@ class AnimatedPaletteFieldTests(unittest.TestCase):
         with self.assertRaises(ValueError):
             field.render(0.0, out=np.empty((5, 3, 3), dtype=np.float32))
 
+    def test_receiver_effect_carries_the_field_scales(self):
+        field = AnimatedPaletteField(3, 5, self.palette, x_scale=9.0, center_y=0.5)
+        params = field.receiver_effect(ticks_per_second=50.0)
+        self.assertEqual(params["ticks_per_second"], 50.0)
+        self.assertEqual(params["x_scale"], 9.0)
+        self.assertEqual(params["y_scale"], 3.7)
+        self.assertEqual(params["center_y"], 0.5)
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -22,3 +22,18 @@ def total_leds(strips: int = DEFAULT_STRIP_COUNT,
                leds_per_strip: int = DEFAULT_LEDS_PER_STRIP) -> int:
     """Compute total LED count for a layout."""
     return strips * leds_per_strip
+
+
+def serpentine_layout(strips: int = DEFAULT_STRIP_COUNT,
+                      leds_per_strip: int = DEFAULT_LEDS_PER_STRIP) -> list:
+    """Layout map for strips wired back and forth, every other one reversed.
+
+    Entry ``strip * leds_per_strip + led`` is the logical pixel that physical
+    LED shows, as LEDController.upload_layout() takes it.
+    """
+    layout = []
+    for strip in range(strips):
+        start = strip * leds_per_strip
+        leds = range(leds_per_strip)
+        layout.extend(start + (leds_per_strip - 1 - led if strip % 2 else led) for led in leds)
+    return layout
@@ -5,6 +5,7 @@ Controls multiple ESP32 devices via SPI with different CS pins
 """
 
 import os
+import time
 from concurrent.futures import ThreadPoolExecutor
 from typing import List, Tuple, Optional
 
@@ -28,7 +29,8 @@ class MultiDeviceLEDController:
                  leds_per_strip: int = DEFAULT_LEDS_PER_STRIP,
                  debug: bool = False,
                  parallel: bool = True,
-                 device_map: Optional[List[DeviceMapEntry]] = None):
+                 device_map: Optional[List[DeviceMapEntry]] = None,
+                 stripe_map: Optional[List[Optional[DeviceMapEntry]]] = None):
         """
         Initialize multi-device LED controller
         
@@ -42,6 +44,8 @@ class MultiDeviceLEDController:
             debug: Enable debug output
             parallel: Send data to devices in parallel using threads
             device_map: Optional list of (bus, device) tuples for each device
+            stripe_map: Optional (bus, device) of each device's second SPI
+                link (DUAL_SPI=1 firmware), or None for devices without one
         """
         self.num_devices = num_devices
         self.strips_per_device = strips_per_device
@@ -55,6 +59,11 @@ class MultiDeviceLEDController:
         self.total_leds = self.strip_count * leds_per_strip
         self.leds_per_device = strips_per_device * leds_per_strip
         self._logical_frames_sent = 0
+        self._latch_mode = 'off'
+        self._latches_sent = 0
+        # Microseconds from the start of the last latch broadcast to each
+        # device's CMD_LATCH transfer returning.
+        self._latch_send_offsets_us: List[float] = []
         
         # For compatibility with animation system
         self.inline_show = True
@@ -87,9 +96,13 @@ class MultiDeviceLEDController:
         
         # Initialize individual device controllers
         self.devices: List[LEDController] = []
+        stripe_map = list(stripe_map or [])
         for device_index, (device_bus, device_id) in enumerate(self.device_map):
             if self.debug:
                 print(f"\nInitializing Device {device_index} on /dev/spidev{device_bus}.{device_id}")
+            stripe_link = stripe_map[device_index] if device_index < len(stripe_map) else None
+            if stripe_link is not None:
+                print(f"[LEDGRID] dev{device_index} stripes frames onto spidev{stripe_link[0]}.{stripe_link[1]}")
             
             device = LEDController(
                 bus=device_bus,
@@ -99,6 +112,7 @@ class MultiDeviceLEDController:
                 strips=strips_per_device,
                 leds_per_strip=leds_per_strip,
                 debug=debug,
+                stripe_link=stripe_link,
             )
             self.devices.append(device)
         
@@ -199,6 +213,8 @@ class MultiDeviceLEDController:
             for device_id, device_colors in enumerate(device_frames):
                 self._send_to_device(device_id, device_colors)
         self._logical_frames_sent += 1
+        if self._latch_mode == 'command':
+            self.latch()
 
     def set_frame(self, colors, dirty_ranges=None):
         """Present a frame, using partial board updates when ranges are known."""
@@ -240,6 +256,8 @@ class MultiDeviceLEDController:
             for device_ids in self._devices_by_bus.values():
                 self._send_bus_partial(device_ids, device_frames, device_ranges)
         self._logical_frames_sent += 1
+        if self._latch_mode == 'command':
+            self.latch()
     
     def set_pixel(self, pixel: int, r: int, g: int, b: int):
         """Set a single pixel color"""
@@ -263,6 +281,165 @@ class MultiDeviceLEDController:
         for device in self.devices:
             device.set_brightness(brightness)
     
+    def set_transition(self, duration_ms: int, easing: str = 'linear'):
+        """Set on-device keyframe interpolation on all devices"""
+        for device in self.devices:
+            device.set_transition(duration_ms, easing)
+
+    def set_color_correction(self, gamma: float = 1.0,
+                             gains: Tuple[float, float, float] = (1.0, 1.0, 1.0)):
+        """Apply the same gamma and white balance on every device"""
+        for device in self.devices:
+            device.set_color_correction(gamma, gains)
+    
+    def set_latch_mode(self, mode: str):
+        """Stage frames on every device and start them together.
+
+        In 'command' mode each frame is followed by a CMD_LATCH broadcast; in
+        'gpio' mode frames wait for an edge on the receivers' shared latch
+        pin, driven by external wiring.
+        """
+        for device in self.devices:
+            device.set_latch_mode(mode)
+        self._latch_mode = mode
+
+    def set_pacing(self, fps: int, jitter_frames: int = 2):
+        """Pace presentation on every device; each runs its own timer."""
+        for device in self.devices:
+            device.set_pacing(fps, jitter_frames)
+        self._latch_mode = 'off'
+
+    def set_effect(self, kind: str, **params):
+        """Render one effect across the wall, each device drawing its slice.
+
+        Parameters are as for LEDController.set_effect(); the wall width and
+        each device's first column are filled in from the device map.
+        """
+        wall_width = self.num_devices * self.strips_per_device
+        for index, device in enumerate(self.devices):
+            device.set_effect(kind, wall_width=wall_width,
+                              x_origin=index * self.strips_per_device, **params)
+
+    def set_effect_palette(self, palette):
+        """Upload the same effect palette to every device"""
+        for device in self.devices:
+            device.set_effect_palette(palette)
+
+    def set_palette(self, palette):
+        """Upload the same indexed-frame palette to every device"""
+        for device in self.devices:
+            device.set_palette(palette)
+
+    def upload_layout(self, layout, version: Optional[int] = None):
+        """Store the same layout map, in device pixels, on every device"""
+        return [device.upload_layout(layout, version) for device in self.devices]
+
+    def layout_matches(self, version: int) -> bool:
+        """True when every device reports layout map ``version`` as stored"""
+        return all(device.layout_matches(version) for device in self.devices)
+
+    def stop_effect(self):
+        """Stop the effect on every device"""
+        for device in self.devices:
+            device.stop_effect()
+
+    def upload_clip(self, frames, durations_ms, first_index: int = 0):
+        """Store a clip of full-wall frames, each device keeping its slice."""
+        device_frames = [[] for _ in self.devices]
+        for frame in frames:
+            for device_id, colors in enumerate(self._split_frame(frame)):
+                device_frames[device_id].append(colors)
+        for device, clip in zip(self.devices, device_frames):
+            device.upload_clip(clip, durations_ms, first_index)
+        return len(device_frames[0]) if device_frames else 0
+
+    def play_clip(self, first: int = 0, count: Optional[int] = None, loops: int = 0):
+        """Start the clip on every device. Each device times its frames on its
+        own clock, so long loops can drift apart by a frame."""
+        for device in self.devices:
+            device.play_clip(first, count, loops)
+
+    def stop_clip(self):
+        """Stop clip playback on every device"""
+        for device in self.devices:
+            device.stop_clip()
+
+    def set_power_budget(self, total_ma: int = 0, strip_ma: int = 0,
+                         channel_ma: Optional[Tuple[float, float, float]] = None,
+                         idle_ma: Optional[float] = None):
+        """Give every device the same per-receiver current budget"""
+        for device in self.devices:
+            device.set_power_budget(total_ma, strip_ma, channel_ma, idle_ma)
+
+    def set_chunked_frames(self, enabled: bool = True):
+        """Send full frames with a CRC per strip to every device that supports
+        them, so a bit error costs one strip resend rather than the frame"""
+        for device in self.devices:
+            device.set_chunked_frames(enabled)
+
+    def recover_chunked_frames(self) -> int:
+        """Resend strips each device reports missing; returns how many"""
+        return sum(device.recover_chunked_frame() for device in self.devices)
+
+    def set_credit_flow(self, enabled: bool = True):
+        """Pace frames on every device to its display credits"""
+        for device in self.devices:
+            device.set_credit_flow(enabled)
+
+    @property
+    def credit_flow(self) -> bool:
+        return any(getattr(device, 'credit_flow', False) for device in self.devices)
+
+    def wait_for_display_slot(self, lead_s: float = 0.0, timeout: float = 0.25) -> bool:
+        """Wait until every device has a display slot for the next frame.
+        The wall frame goes to all of them, so the latest slot decides."""
+        deadline = time.perf_counter() + timeout
+        ready = True
+        for device in self.devices:
+            remaining = max(0.0, deadline - time.perf_counter())
+            ready = device.wait_for_display_slot(lead_s, remaining) and ready
+        return ready
+
+    def set_spi_capture(self, path: Optional[str]):
+        """Record each device's SPI transfers, device N's to ``path.N``;
+        None stops. Each receiver replays its own capture."""
+        for index, device in enumerate(self.devices):
+            device.set_spi_capture(None if path is None else f"{path}.{index}")
+
+    def set_flight_recorder(self, enabled: bool):
+        """Record, or freeze the recording of, displayed frames on every device"""
+        for device in self.devices:
+            device.set_flight_recorder(enabled)
+
+    def enable_latency_histograms(self, enabled: bool = True):
+        """Collect receiver latency histograms on every device"""
+        for device in self.devices:
+            device.enable_latency_histograms(enabled)
+
+    def reset_latency_histograms(self):
+        """Clear receiver latency histograms on every device"""
+        for device in self.devices:
+            device.reset_latency_histograms()
+
+    def latch(self):
+        """Broadcast CMD_LATCH to every device back to back.
+
+        The latch is sent sequentially rather than through the bus executor:
+        thread hand-off costs more than a three-byte transfer, and the send
+        offsets are what the skew estimate in get_stats() is built on.
+        """
+        offsets = []
+        started = time.perf_counter()
+        for device_id, device in enumerate(self.devices):
+            try:
+                device.latch()
+            except Exception as exc:
+                if self.debug:
+                    print(f"✗ Error latching device {device_id}: {exc}")
+            offsets.append((time.perf_counter() - started) * 1_000_000.0)
+        self._latch_send_offsets_us = offsets
+        self._latches_sent += 1
+
     def show(self):
         """Update LED display on all devices"""
         if not self.inline_show:
@@ -322,11 +499,17 @@ class MultiDeviceLEDController:
         receiver_status_misses = 0
         receiver_last_encode_us = 0
         receiver_last_show_us = 0
+        receiver_latches = 0
+        receiver_latch_misses = 0
+        receiver_frames_late = 0
+        receiver_queue_drops = 0
+        receiver_end_to_end_p99_us = None
+        latch_arrivals_us = []
         last_frame_ms = 0.0
         weighted_avg_total = 0.0
         weighted_avg_frames = 0
 
-        for device in self.devices:
+        for device_id, device in enumerate(self.devices):
             stats = {}
             if hasattr(device, "get_stats"):
                 stats = device.get_stats()
@@ -362,6 +545,22 @@ class MultiDeviceLEDController:
                 int(stats.get('receiver_last_show_us', 0) or 0),
             )
 
+            receiver_latches = max(receiver_latches, int(stats.get('receiver_latches', 0) or 0))
+            receiver_latch_misses += int(stats.get('receiver_latch_misses', 0) or 0)
+            receiver_frames_late += int(stats.get('receiver_frames_late', 0) or 0)
+            receiver_queue_drops += int(stats.get('receiver_queue_drops', 0) or 0)
+            end_to_end = (stats.get('receiver_latency_histograms') or {}).get('end-to-end')
+            if end_to_end and end_to_end.get('p99_us') is not None:
+                receiver_end_to_end_p99_us = max(
+                    receiver_end_to_end_p99_us or 0, end_to_end['p99_us'])
+            if stats.get('receiver_latches') and device_id < len(self._latch_send_offsets_us):
+                # When the latch reached this receiver plus how long it took
+                # to start the staged transfer.
+                latch_arrivals_us.append(
+                    self._latch_send_offsets_us[device_id]
+                    + int(stats.get('receiver_last_latch_us', 0) or 0)
+                )
+
             last_frame_ms = max(last_frame_ms, float(stats.get('last_frame_duration_ms', 0.0) or 0.0))
             avg_ms = float(stats.get('avg_frame_duration_ms', 0.0) or 0.0)
             if frames > 0:
@@ -369,6 +568,12 @@ class MultiDeviceLEDController:
                 weighted_avg_frames += frames
 
         avg_frame_ms = weighted_avg_total / weighted_avg_frames if weighted_avg_frames else 0.0
+        # Receiver status arrives with the next frame, so this pairs the last
+        # broadcast's send offsets with each receiver's previous latch time;
+        # the offsets barely move between broadcasts.
+        latch_skew_us = None
+        if len(latch_arrivals_us) > 1:
+            latch_skew_us = max(latch_arrivals_us) - min(latch_arrivals_us)
 
         return {
             'devices': device_stats,
@@ -404,6 +609,15 @@ class MultiDeviceLEDController:
                 'receiver_status_misses': receiver_status_misses,
                 'receiver_last_encode_us': receiver_last_encode_us,
                 'receiver_last_show_us': receiver_last_show_us,
+                'latch_mode': self._latch_mode,
+                'latches_sent': self._latches_sent,
+                'receiver_latches': receiver_latches,
+                'receiver_latch_misses': receiver_latch_misses,
+                'latch_skew_us': latch_skew_us,
+                'receiver_frames_late': receiver_frames_late,
+                'receiver_queue_drops': receiver_queue_drops,
+                # Worst device; see histogram_percentile() for the bucket bound.
+                'receiver_end_to_end_p99_us': receiver_end_to_end_p99_us,
                 'last_frame_duration_ms': last_frame_ms,
                 'avg_frame_duration_ms': avg_frame_ms,
                 'spi_speed_hz': device_stats[0].get('spi_speed_hz') if device_stats else None,
@@ -8,8 +8,12 @@ import time
 import colorsys
 import argparse
 import binascii
+import itertools
+import operator
 import spidev
 import sys
+import threading
+from concurrent.futures import ThreadPoolExecutor
 
 import numpy as np
 
@@ -32,8 +36,76 @@ RECEIVER_STATUS_MAGIC = (ord('L'), ord('G'), ord('S'), ord('1'))
 RECEIVER_STATUS_MAGIC_V2 = (ord('L'), ord('G'), ord('S'), ord('2'))
 RECEIVER_STATUS_BYTES = 29
 RECEIVER_STATUS_BYTES_V2 = 64
+# Transfers of at least this many bytes also carry the frame-latch telemetry.
+RECEIVER_STATUS_BYTES_V2_LATCH = 80
+# ... and from this many, the paced-display counters.
+RECEIVER_STATUS_BYTES_V2_PACING = 92
+# ... and from this many, the selected latency histogram.
+RECEIVER_STATUS_BYTES_V2_HISTOGRAM = 180
+# ... and from this many, the chunked frame still being gathered.
+RECEIVER_STATUS_BYTES_V2_CHUNKS = 192
+# ... and from this many, display credits and the next display slot.
+RECEIVER_STATUS_BYTES_V2_CREDITS = 208
+# Paged status (LGS3): a 16-byte header followed by the page chosen with
+# CMD_SELECT_STATUS_PAGE. Page 0 is the LGS2 block above.
+RECEIVER_STATUS_MAGIC_V3 = (ord('L'), ord('G'), ord('S'), ord('3'))
+RECEIVER_STATUS_V3_HEADER_BYTES = 16
+STATUS_PAGES = ('v2', 'core', 'histograms', 'memory', 'config', 'transport', 'links', 'clips',
+                'power')
+STATUS_PAGE_BYTES = (RECEIVER_STATUS_BYTES_V2_CREDITS, 100, 608, 56, 36, 160, 92, 832, 112)
+# Per-link entries on the links page.
+STATUS_LINKS = 2
+# Per-slot entries on the transport page, whatever the receiver's ring depth.
+STATUS_TRANSPORT_SLOTS = 16
+STATUS_PAGE_TRUNCATED = 0x01
 MAX_PIXELS_SET_ALL = (MAX_SPI_TRANSFER - 1 - CRC_BYTES) // 3
 MAX_PIXELS_PER_RANGE = min(255, (MAX_SPI_TRANSFER - 4 - CRC_BYTES) // 3)
+# Status byte 7 advertises optional receiver commands.
+RECEIVER_CAPABILITY_BATCH = 0x01
+RECEIVER_CAPABILITY_COMPRESSED_FRAMES = 0x02
+RECEIVER_CAPABILITY_KEYFRAME_TRANSITIONS = 0x04
+RECEIVER_CAPABILITY_COLOR_CORRECTION = 0x08
+RECEIVER_CAPABILITY_FRAME_LATCH = 0x10
+RECEIVER_CAPABILITY_PACED_DISPLAY = 0x20
+RECEIVER_CAPABILITY_STATUS_PAGES = 0x40
+RECEIVER_CAPABILITY_EFFECTS = 0x80
+# Status flag set by the receiver after it has ignored an XOR-delta frame.
+RECEIVER_FLAG_DELTA_REJECTED = 0x04
+BATCH_PIXEL_OP_BYTES = 6
+BATCH_RANGE_HEADER_BYTES = 5
+MAX_PIXELS_PER_BATCH_RANGE = 0xFFFF
+FRAME_TOKEN_RUN_FLAG = 0x80
+FRAME_TOKEN_MAX_PIXELS = 128
+# Deltas chain off the previous frame, so resynchronise periodically even
+# when no CRC error or rejected delta has been reported.
+COMPRESSED_KEYFRAME_INTERVAL = 60
+# Short packets cannot carry the 64-byte status, so compressed frames are
+# zero-padded up to it to keep receiver telemetry flowing.
+MIN_STATUS_PAYLOAD = RECEIVER_STATUS_BYTES_V2 - CRC_BYTES
+MIN_LATCH_STATUS_PAYLOAD = RECEIVER_STATUS_BYTES_V2_LATCH - CRC_BYTES
+MIN_PACING_STATUS_PAYLOAD = RECEIVER_STATUS_BYTES_V2_PACING - CRC_BYTES
+MIN_CREDIT_STATUS_PAYLOAD = RECEIVER_STATUS_BYTES_V2_CREDITS - CRC_BYTES
+# Credit flow maps receiver esp_timer microseconds onto perf_counter(). The
+# offset follows the freshest snapshots seen and may creep up this fast, in
+# ppm, to follow a receiver clock running slow.
+RECEIVER_CLOCK_DRIFT_PPM = 100
+# Slack between a frame landing on the receiver and the slot it is for, on
+# top of the receiver's own CRC and copy time.
+DISPLAY_SLOT_MARGIN_S = 0.0005
+# How often wait_for_display_slot() reads status while it has none newer than
+# the last frame sent.
+CREDIT_POLL_INTERVAL_S = 0.0005
+# The receiver's jitter buffer is its three mailbox slots.
+MAX_JITTER_FRAMES = 3
+MAX_PACED_FPS = 1000
+# Receiver latency stages in SELECT_HISTOGRAM order. Bucket 0 counts 0 us and
+# bucket b counts [2^(b-1), 2^b) us; the last bucket is open-ended.
+LATENCY_STAGES = ('spi-receive', 'crc', 'copy', 'mailbox-wait', 'encode', 'dma', 'end-to-end')
+NO_LATENCY_HISTOGRAM = 0xFF
+# Frames between SELECT_HISTOGRAM rotations; the selection takes effect a
+# couple of transfers later because status is prepared when a transfer is
+# queued.
+HISTOGRAM_ROTATE_FRAMES = 30
 
 GLOBAL_OPTS_WITH_VALUE = {"--bus", "--device", "--spi-speed", "--mode", "--brightness", "--strips", "--leds-per-strip"}
 GLOBAL_BOOL_OPTS = {"--debug"}
@@ -94,21 +166,200 @@ CMD_CLEAR = 0x04
 CMD_SET_RANGE = 0x05
 CMD_SET_ALL = 0x06
 CMD_CONFIG = 0x07
+CMD_BATCH = 0x08
+CMD_SET_ALL_RLE = 0x09
+CMD_SET_ALL_DELTA = 0x0A
+CMD_SET_TRANSITION = 0x0B
+CMD_SET_COLOR_CURVE = 0x0C
+CMD_SET_LATCH = 0x0D
+CMD_LATCH = 0x0E
+CMD_SET_PACING = 0x0F
+CMD_SELECT_HISTOGRAM = 0x10
+CMD_RESET_HISTOGRAMS = 0x11
+CMD_SELECT_STATUS_PAGE = 0x12
+CMD_SET_EFFECT = 0x13
+CMD_SET_EFFECT_PALETTE = 0x14
+CMD_SET_PALETTE = 0x15
+CMD_SET_ALL_INDEXED = 0x16
+CMD_SET_ALL_PART = 0x17
+CMD_CLIP_FRAME = 0x18
+CMD_CLIP_PLAY = 0x19
+CMD_SET_RECORDER = 0x1A
+CMD_READ_RECORDER = 0x1B
+CMD_SET_POWER_BUDGET = 0x1C
+CMD_SET_ALL_CHUNKED = 0x1D
+CMD_SET_LAYOUT = 0x1E
+CMD_COMMIT_LAYOUT = 0x1F
 CMD_PING = 0xFF
 
+TRANSITION_EASINGS = {'linear': 0, 'ease-in-out': 1}
+# 'command' starts staged frames on CMD_LATCH, 'gpio' on a rising edge of the
+# receivers' shared latch pin.
+LATCH_MODES = {'off': 0, 'command': 1, 'gpio': 2}
+# Receiver-rendered effects; see LEDController.set_effect().
+EFFECT_KINDS = ('off', 'palette-field', 'plasma', 'gradient')
+EFFECT_PALETTE_BYTES = 256 * 3
+# Palette for CMD_SET_ALL_INDEXED frames, which carry one index per pixel.
+INDEXED_PALETTE_BYTES = 256 * 3
+# Config status page byte 37; status byte 7 has no capability bits left.
+RECEIVER_FRAME_FORMAT_INDEXED = 0x01
+RECEIVER_FRAME_FORMAT_STRIPED = 0x02
+RECEIVER_FRAME_FORMAT_CLIPS = 0x04
+# CMD_SET_ALL_PART header after the command byte: u16 sequence, first strip,
+# strip count.
+FRAME_PART_HEADER_BYTES = 4
+# CMD_CLIP_FRAME: frame index, duration ms and first pixel, all u16.
+CLIP_FRAME_HEADER_BYTES = 7
+MAX_PIXELS_PER_CLIP_SLICE = (MAX_SPI_TRANSFER - CLIP_FRAME_HEADER_BYTES - CRC_BYTES) // 3
+MAX_CLIP_FRAME_MS = 0xFFFF
+CLIP_STATES = ('idle', 'playing', 'recording')
+CLIP_READBACK_VALID = 0x01
+CLIP_READBACK_INDEXED = 0x02
+RECEIVER_FRAME_FORMAT_POWER_LIMIT = 0x08
+# CMD_SET_POWER_BUDGET limits are u16 mA; the optional draw model is the R, G
+# and B draw of one LED at full output and its idle draw, as u16 uA.
+MAX_POWER_BUDGET_MA = 0xFFFF
+MAX_POWER_MODEL_UA = 0xFFFF
+POWER_STATUS_STRIPS = 16
+RECEIVER_FRAME_FORMAT_CHUNKED = 0x10
+# CMD_SET_ALL_CHUNKED header after the command byte: u16 sequence, u16 mask of
+# the strips carried and a CRC-16 of those four bytes. Each strip's RGB bytes
+# follow with their own CRC-16, and the packet has no CRC of its own.
+FRAME_CHUNK_HEADER_BYTES = 6
+RECEIVER_FRAME_FORMAT_LAYOUT = 0x20
+# Layout maps give, for each physical pixel, the logical pixel it shows as a
+# u16, or LAYOUT_UNMAPPED to keep it dark. CMD_SET_LAYOUT carries a u16 first
+# entry and the entries; CMD_COMMIT_LAYOUT the u32 version, strip count, u16
+# LEDs per strip and the CRC-16 of every entry.
+LAYOUT_UNMAPPED = 0xFFFF
+MAX_LAYOUT_ENTRIES_PER_SLICE = (MAX_SPI_TRANSFER - 3 - CRC_BYTES) // 2
+LAYOUT_STATES = ('none', 'active', 'inactive')
+COLOR_CHANNEL_MASKS = (0x01, 0x02, 0x04)
+ALL_COLOR_CHANNELS = 0x07
+ALL_LANES = 0xFF
+# Receivers built with LANES=16 drive up to 16 strips and take a two-byte
+# lane mask for colour curves.
+MAX_RECEIVER_STRIPS = 16
+ALL_WIDE_LANES = 0xFFFF
+# SPI captures for the firmware's receiver_sim: this magic, then per transfer
+# a u32 start time in microseconds since the capture began (wrapping), the
+# link (0 primary, 1 stripe), a u32 length and the bytes sent.
+SPI_CAPTURE_MAGIC = b"LGSPICAP"
+SPI_CAPTURE_LINK_PRIMARY = 0
+SPI_CAPTURE_LINK_STRIPE = 1
+
+
+def histogram_percentile(buckets, fraction):
+    """Upper bound in microseconds of the bucket holding ``fraction`` of the
+    samples, or None for an empty histogram or the open-ended last bucket."""
+    total = sum(buckets)
+    if total == 0:
+        return None
+    threshold = fraction * total
+    seen = 0
+    for bucket, count in enumerate(buckets):
+        seen += count
+        if seen >= threshold:
+            if bucket == len(buckets) - 1:
+                return None
+            return (1 << bucket) - 1
+    return None
+
+
+def build_color_curve(gamma=1.0, gain=1.0):
+    """256-entry output curve: ``255 * gain * (v / 255) ** gamma``, clipped."""
+    return bytes(
+        max(0, min(255, int(round(255.0 * gain * ((v / 255.0) ** gamma)))))
+        for v in range(256)
+    )
+
+
+def _u32_delta(a, b):
+    """``a - b`` for u32 receiver times that may have wrapped."""
+    return ((a - b + 0x80000000) & 0xFFFFFFFF) - 0x80000000
+
+
+def _color_bytes(colors, start, end):
+    """Return RGB bytes for colors[start:end] from an ndarray or tuple list."""
+    if isinstance(colors, np.ndarray):
+        arr = colors[start:end]
+        if arr.dtype != np.uint8:
+            arr = np.clip(arr, 0, 255).astype(np.uint8)
+        return arr.tobytes()
+    data = bytearray()
+    for r, g, b in colors[start:end]:
+        data.extend((int(r) & 0xFF, int(g) & 0xFF, int(b) & 0xFF))
+    return data
+
+
+def _append_literal_tokens(tokens, rgb, start, end):
+    while start < end:
+        count = min(FRAME_TOKEN_MAX_PIXELS, end - start)
+        tokens.append(count - 1)
+        tokens += rgb[start * 3:(start + count) * 3]
+        start += count
+
+
+def _encode_frame_tokens(rgb, limit=None):
+    """Encode RGB bytes as the receiver's run/literal pixel tokens.
+
+    Returns None once the encoding grows past ``limit`` bytes, so frames
+    that do not compress are abandoned early.
+    """
+    pixels = list(zip(rgb[0::3], rgb[1::3], rgb[2::3]))
+    if limit is not None:
+        # Counting pixel changes runs at C speed; frames that are mostly
+        # distinct pixels cannot win, so skip the per-run Python loop.
+        changes = sum(map(operator.ne, pixels, itertools.islice(pixels, 1, None)))
+        if changes * 4 > len(pixels) * 3:
+            return None
+    tokens = bytearray()
+    position = 0
+    literal_start = 0
+    for pixel, group in itertools.groupby(pixels):
+        count = sum(1 for _ in group)
+        if count >= 2:
+            _append_literal_tokens(tokens, rgb, literal_start, position)
+            remaining = count
+            while remaining:
+                run = min(FRAME_TOKEN_MAX_PIXELS, remaining)
+                tokens.append(FRAME_TOKEN_RUN_FLAG | (run - 1))
+                tokens.extend(pixel)
+                remaining -= run
+            literal_start = position + count
+        position += count
+        if limit is not None and len(tokens) > limit:
+            return None
+    _append_literal_tokens(tokens, rgb, literal_start, position)
+    if limit is not None and len(tokens) > limit:
+        return None
+    return tokens
+
 
 class LEDController:
     """Control LED strips via SPI"""
     
     def __init__(self, bus=SPI_BUS, device=SPI_DEVICE, speed=SPI_SPEED, mode=SPI_MODE,
                  strips=DEFAULT_NUM_STRIPS, leds_per_strip=DEFAULT_LED_PER_STRIP,
-                 debug=False):
+                 debug=False, stripe_link=None):
         self.debug = debug
         self.bus = bus
         self.device = device
         self.spi = spidev.SpiDev()
         self.spi.open(bus, device)
         self.spi.max_speed_hz = speed
+        # Optional (bus, device) wired to the receiver's second SPI link
+        # (DUAL_SPI=1 firmware). Full frames are then striped across both.
+        self.stripe_spi = None
+        self._stripe_executor = None
+        if stripe_link is not None:
+            self.stripe_spi = spidev.SpiDev()
+            self.stripe_spi.open(*stripe_link)
+            self.stripe_spi.max_speed_hz = speed
+            self.stripe_spi.mode = mode
+            self.stripe_spi.bits_per_word = 8
+            self._stripe_executor = ThreadPoolExecutor(
+                max_workers=1, thread_name_prefix="led-spi-stripe")
         try:
             self.spi.mode = mode
         except OSError as exc:
@@ -137,6 +388,8 @@ class LEDController:
         self._total_frame_duration = 0.0
         self._receiver_status_seen = False
         self._receiver_status_version = 0
+        self._receiver_capabilities = 0
+        self._receiver_flags = 0
         self._receiver_status_responses = 0
         self._receiver_status_misses = 0
         self._receiver_packets = 0
@@ -158,7 +411,65 @@ class LEDController:
         self._receiver_last_encode_us = 0
         self._receiver_last_accepted_sequence = 0
         self._receiver_last_displayed_sequence = 0
+        self._receiver_latch_mode = 0
+        self._receiver_last_latch_us = 0
+        self._receiver_latches = 0
+        self._receiver_latch_misses = 0
+        self._receiver_last_latch_sequence = 0
+        self._latch_command = None
+        self._receiver_paced_fps = 0
+        self._receiver_pacing_depth = 0
+        self._receiver_frames_late = 0
+        self._receiver_queue_drops = 0
+        self._pacing_command = None
+        # Latest histogram seen for each stage, filled as rotation moves the
+        # receiver's selection across stages.
+        self._receiver_latency_histograms = {}
+        self._latency_histogram_rotation = False
+        self._latency_histogram_stage = 0
+        self._status_page = 0
+        self._receiver_status_generation = None
+        self._receiver_truncated_pages = 0
+        self._receiver_memory = None
+        self._receiver_config = None
+        self._receiver_transport = None
+        self._receiver_links = None
+        self._receiver_clips = None
+        self._clip_command = None
+        self._clip_frames = 0
+        self._recorder_enabled = False
+        self._receiver_power = None
+        self._power_command = None
+        self._stripe_sequence = 0
+        self._striped_frames_sent = 0
+        self._stripe_bytes_sent = 0
+        self._chunked_frames = False
+        self._chunk_sequence = 0
+        self._chunk_frame = None
+        self._receiver_chunks = None
+        self._chunked_frames_sent = 0
+        self._chunks_resent = 0
+        self._receiver_credits = None
+        self._receiver_clock_offset = None
+        self._receiver_clock_seen = 0.0
+        self._credit_flow = False
+        # perf_counter() times frames finished sending, newest last.
+        self._credit_sends = []
+        self._credit_waits = 0
+        self._credit_wait_s = 0.0
+        self._credit_polls = 0
+        self._effect_command = None
+        self._effect_palette_command = None
         self._frame_packet = bytearray(1 + self.total_leds * 3 + CRC_BYTES)
+        self._compressed_base = None
+        self._compressed_tag = 0
+        self._compressed_crc_errors = 0
+        self._frames_since_keyframe = 0
+        self._compressed_frames_sent = 0
+        self._transition_command = None
+        # Ordered by (lane mask, channel mask) so a later upload for the same
+        # lanes replaces the earlier one when replayed after a reboot.
+        self._color_curve_commands = {}
         
         if self.debug:
             print("SPI Controller initialized")
@@ -193,9 +504,14 @@ class LEDController:
         crc = _crc16_ccitt(memoryview(buf)[:payload_length])
         buf[payload_length] = (crc >> 8) & 0xFF
         buf[payload_length + 1] = crc & 0xFF
-        self._bytes_sent += len(buf)
         self._crc_bytes_sent += CRC_BYTES
+        return self._xfer_raw(buf)
+
+    def _xfer_raw(self, buf):
+        """Transfer a packet that already carries its checksums."""
+        self._bytes_sent += len(buf)
         self._spi_transfers += 1
+        self._capture_transfer(SPI_CAPTURE_LINK_PRIMARY, buf)
         try:
             response = self.spi.xfer2(buf)
             self._update_receiver_status(response)
@@ -222,7 +538,15 @@ class LEDController:
         # SPI is full duplex, so the response can only be as long as the
         # command. Short control/configuration transfers cannot carry either
         # status structure and therefore are not telemetry misses.
-        if response is None or len(response) < RECEIVER_STATUS_BYTES:
+        if response is None or len(response) < RECEIVER_STATUS_V3_HEADER_BYTES:
+            return
+        magic = tuple(int(response[index]) for index in range(4))
+        if magic == RECEIVER_STATUS_MAGIC_V3:
+            # Pages carry their own length, so any transfer covering the
+            # header is a valid snapshot.
+            self._parse_status_page(response)
+            return
+        if len(response) < RECEIVER_STATUS_BYTES:
             return
         if len(response) < RECEIVER_STATUS_BYTES_V2 and getattr(
             self, '_receiver_status_version', 0
@@ -231,12 +555,13 @@ class LEDController:
             # atomic status snapshot. Do not interpret a truncated prefix.
             return
 
-        magic = tuple(int(response[index]) for index in range(4))
         if magic == RECEIVER_STATUS_MAGIC_V2 and len(response) >= RECEIVER_STATUS_BYTES_V2:
             self._receiver_status_seen = True
             self._receiver_status_version = int(response[4])
+            self._receiver_flags = int(response[5])
             self._receiver_status_responses = getattr(self, '_receiver_status_responses', 0) + 1
             self._receiver_active_strips = int(response[6])
+            self._receiver_capabilities = int(response[7])
             self._receiver_leds_per_strip = self._response_u16(response, 8)
             self._receiver_queued_transactions = self._response_u16(response, 10)
             self._receiver_packets = self._response_u32(response, 12)
@@ -255,6 +580,35 @@ class LEDController:
             self._receiver_last_accepted_sequence = self._response_u32(response, 52)
             self._receiver_last_displayed_sequence = self._response_u32(response, 56)
             self._receiver_display_errors = self._response_u32(response, 60)
+            if len(response) >= RECEIVER_STATUS_BYTES_V2_LATCH:
+                self._receiver_latch_mode = int(response[64])
+                self._receiver_last_latch_us = self._response_u16(response, 66)
+                self._receiver_latches = self._response_u32(response, 68)
+                self._receiver_latch_misses = self._response_u32(response, 72)
+                self._receiver_last_latch_sequence = self._response_u32(response, 76)
+            if len(response) >= RECEIVER_STATUS_BYTES_V2_PACING:
+                self._receiver_paced_fps = self._response_u16(response, 80)
+                self._receiver_pacing_depth = int(response[82])
+                self._receiver_frames_late = self._response_u32(response, 84)
+                self._receiver_queue_drops = self._response_u32(response, 88)
+            if len(response) >= RECEIVER_STATUS_BYTES_V2_HISTOGRAM:
+                self._parse_latency_histogram(response)
+            if len(response) >= RECEIVER_STATUS_BYTES_V2_CHUNKS:
+                self._receiver_chunks = {
+                    'sequence': self._response_u16(response, 180),
+                    'missing_strips': self._response_u16(response, 182),
+                    'chunk_crc_errors': self._response_u32(response, 184),
+                    'frames_recovered': self._response_u32(response, 188),
+                }
+            if len(response) >= RECEIVER_STATUS_BYTES_V2_CREDITS:
+                self._receiver_credits = {
+                    'credits': int(response[192]),
+                    'room': int(response[193]),
+                    'snapshot_us': self._response_u32(response, 196),
+                    'next_slot_us': self._response_u32(response, 200),
+                    'slot_interval_us': self._response_u32(response, 204),
+                }
+                self._track_receiver_clock(self._receiver_credits['snapshot_us'])
             return
 
         if magic != RECEIVER_STATUS_MAGIC:
@@ -264,6 +618,7 @@ class LEDController:
 
         self._receiver_status_seen = True
         self._receiver_status_version = 1
+        self._receiver_capabilities = 0
         self._receiver_status_responses = getattr(self, '_receiver_status_responses', 0) + 1
         self._receiver_packets = self._response_u32(response, 4)
         self._receiver_crc_errors = self._response_u32(response, 8)
@@ -275,6 +630,227 @@ class LEDController:
         self._receiver_active_strips = int(response[26])
         self._receiver_leds_per_strip = self._response_u16(response, 27)
 
+    def _parse_latency_histogram(self, response):
+        stage = int(response[92])
+        if stage >= len(LATENCY_STAGES):
+            return
+        count = min(int(response[93]), (RECEIVER_STATUS_BYTES_V2_HISTOGRAM - 100) // 4)
+        self._store_latency_histogram(stage, response, 96, count)
+
+    def _store_latency_histogram(self, stage, response, offset, count):
+        """Summarise a u32 max followed by ``count`` u32 buckets."""
+        buckets = [self._response_u32(response, offset + 4 + index * 4) for index in range(count)]
+        self._receiver_latency_histograms[LATENCY_STAGES[stage]] = {
+            'max_us': self._response_u32(response, offset),
+            'samples': sum(buckets),
+            'p50_us': histogram_percentile(buckets, 0.5),
+            'p99_us': histogram_percentile(buckets, 0.99),
+            'buckets': buckets,
+        }
+
+    def _parse_status_page(self, response):
+        page = int(response[5])
+        payload = self._response_u16(response, 12)
+        self._receiver_status_seen = True
+        self._receiver_status_responses = getattr(self, '_receiver_status_responses', 0) + 1
+        self._receiver_status_generation = self._response_u32(response, 8)
+        self._receiver_capabilities = int(response[14])
+        self._receiver_flags = int(response[15])
+        if (
+            response[7] & STATUS_PAGE_TRUNCATED
+            or page == 0
+            or page >= len(STATUS_PAGES)
+            or len(response) < RECEIVER_STATUS_V3_HEADER_BYTES + payload
+            or RECEIVER_STATUS_V3_HEADER_BYTES + payload < STATUS_PAGE_BYTES[page]
+        ):
+            # The transfer was too short for the page, or the page is newer
+            # than this driver; the header alone is still a valid snapshot.
+            self._receiver_truncated_pages = getattr(self, '_receiver_truncated_pages', 0) + 1
+            return
+
+        name = STATUS_PAGES[page]
+        if name == 'core':
+            self._receiver_leds_per_strip = self._response_u16(response, 16)
+            self._receiver_queued_transactions = self._response_u16(response, 18)
+            self._receiver_packets = self._response_u32(response, 20)
+            self._receiver_crc_errors = self._response_u32(response, 24)
+            self._receiver_crc_ok_packets = self._response_u32(response, 28)
+            self._receiver_frames_accepted = self._response_u32(response, 32)
+            self._receiver_frames_displayed = self._response_u32(response, 36)
+            self._receiver_frames_rendered = self._receiver_frames_displayed
+            self._receiver_frames_superseded = self._response_u32(response, 40)
+            self._receiver_publish_drops = self._response_u32(response, 44)
+            self._receiver_spi_queue_errors = self._response_u32(response, 48)
+            self._receiver_display_errors = self._response_u32(response, 52)
+            self._receiver_last_accepted_sequence = self._response_u32(response, 56)
+            self._receiver_last_displayed_sequence = self._response_u32(response, 60)
+            self._receiver_last_crc_us = self._response_u16(response, 64)
+            self._receiver_last_copy_us = self._response_u16(response, 66)
+            self._receiver_last_encode_us = self._response_u16(response, 68)
+            self._receiver_last_show_us = self._response_u16(response, 70)
+            self._receiver_active_strips = int(response[72])
+            self._receiver_latch_mode = int(response[73])
+            self._receiver_last_latch_us = self._response_u16(response, 74)
+            self._receiver_latches = self._response_u32(response, 76)
+            self._receiver_latch_misses = self._response_u32(response, 80)
+            self._receiver_last_latch_sequence = self._response_u32(response, 84)
+            self._receiver_paced_fps = self._response_u16(response, 88)
+            self._receiver_pacing_depth = int(response[90])
+            self._receiver_frames_late = self._response_u32(response, 92)
+            self._receiver_queue_drops = self._response_u32(response, 96)
+        elif name == 'histograms':
+            stages = min(int(response[16]), len(LATENCY_STAGES))
+            count = int(response[17])
+            stride = 4 + count * 4
+            if len(response) < 20 + stages * stride:
+                return
+            for stage in range(stages):
+                self._store_latency_histogram(stage, response, 20 + stage * stride, count)
+        elif name == 'memory':
+            self._receiver_memory = {
+                'led_capacity': self._response_u16(response, 16),
+                'mailbox_tier': int(response[18]),
+                'history_tier': int(response[19]),
+                'zero_copy_mailbox': bool(response[20]),
+                'rgb_bytes': self._response_u32(response, 24),
+                'spi_buffer_bytes': self._response_u32(response, 28),
+                'led_dma_bytes': self._response_u32(response, 32),
+                'free_internal': self._response_u32(response, 36),
+                'min_free_internal': self._response_u32(response, 40),
+                'largest_internal_block': self._response_u32(response, 44),
+                'free_psram': self._response_u32(response, 48),
+                'largest_psram_block': self._response_u32(response, 52),
+            }
+        elif name == 'config':
+            self._receiver_config = {
+                'active_strips': int(response[16]),
+                'max_lanes': int(response[17]),
+                'leds_per_strip': self._response_u16(response, 18),
+                'led_capacity': self._response_u16(response, 20),
+                'brightness': int(response[22]),
+                'transition_easing': int(response[23]),
+                'transition_ms': self._response_u16(response, 24),
+                'latch_mode': int(response[26]),
+                'pacing_depth': int(response[27]),
+                'paced_fps': self._response_u16(response, 28),
+                'crc_engine': int(response[30]),
+                'encoder_kernel': int(response[31]),
+                'display_mode': int(response[32]),
+                'histogram_stage': int(response[33]),
+                'status_refresh_us': self._response_u16(response, 34),
+            }
+            # Receivers with effects append them, and frame formats, to the 36-byte page.
+            if len(response) >= 44 and RECEIVER_STATUS_V3_HEADER_BYTES + payload >= 44:
+                self._receiver_config['effect'] = EFFECT_KINDS[response[36]] \
+                    if response[36] < len(EFFECT_KINDS) else int(response[36])
+                self._receiver_config['frame_formats'] = int(response[37])
+                self._receiver_config['effect_ticks_per_second'] = self._response_u16(response, 38)
+                self._receiver_config['effect_frames'] = self._response_u32(response, 40)
+            # Receivers that can share the encode across cores report it after those.
+            if len(response) >= 48 and RECEIVER_STATUS_V3_HEADER_BYTES + payload >= 48:
+                self._receiver_config['encode_cores'] = int(response[44])
+                self._receiver_config['encode_helper_share'] = int(response[45])
+            # Receivers that remap frames report the stored layout map last.
+            if len(response) >= 56 and RECEIVER_STATUS_V3_HEADER_BYTES + payload >= 56:
+                self._receiver_config['layout_state'] = LAYOUT_STATES[response[46]] \
+                    if response[46] < len(LAYOUT_STATES) else int(response[46])
+                self._receiver_config['layout_version'] = self._response_u32(response, 48)
+                self._receiver_config['layout_crc'] = self._response_u16(response, 52)
+                self._receiver_config['layout_rejected'] = self._response_u16(response, 54)
+        elif name == 'transport':
+            depth = min(int(response[16]), STATUS_TRANSPORT_SLOTS)
+            self._receiver_transport = {
+                'ring_depth': int(response[16]),
+                'max_backlog': int(response[17]),
+                'task_core': int(response[18]),
+                'task_priority': int(response[19]),
+                'ring_drained': self._response_u32(response, 20),
+                'spi_queue_errors': self._response_u32(response, 24),
+                'packets': self._response_u32(response, 28),
+                'slots': [
+                    {
+                        'completions': self._response_u32(response, 32 + slot * 8),
+                        'max_service_us': self._response_u16(response, 36 + slot * 8),
+                        'requeue_failures': self._response_u16(response, 38 + slot * 8),
+                    }
+                    for slot in range(depth)
+                ],
+            }
+        elif name == 'links':
+            self._parse_links_page(response)
+        elif name == 'clips':
+            self._parse_clips_page(response)
+        elif name == 'power':
+            self._parse_power_page(response)
+
+    def _parse_links_page(self, response):
+        count = min(int(response[16]), STATUS_LINKS)
+        self._receiver_links = {
+            'link_count': int(response[16]),
+            'parts': self._response_u32(response, 20),
+            'frames_assembled': self._response_u32(response, 24),
+            'frames_abandoned': self._response_u32(response, 28),
+            'stale_parts': self._response_u32(response, 32),
+            'rejected_parts': self._response_u32(response, 36),
+            'last_assembled_sequence': self._response_u16(response, 40),
+            'links': [
+                {
+                    'packets': self._response_u32(response, entry),
+                    'crc_ok_packets': self._response_u32(response, entry + 4),
+                    'crc_errors': self._response_u32(response, entry + 8),
+                    'spi_queue_errors': self._response_u32(response, entry + 12),
+                    'ring_drained': self._response_u32(response, entry + 16),
+                    'host': int(response[entry + 20]),
+                    'max_backlog': int(response[entry + 21]),
+                    'queued_transactions': int(response[entry + 22]),
+                    'has_miso': bool(response[entry + 23]),
+                }
+                for entry in (44 + link * 24 for link in range(count))
+            ],
+        }
+
+    def _parse_clips_page(self, response):
+        state = int(response[18])
+        flags = int(response[19])
+        readback_bytes = self._response_u16(response, 60)
+        self._receiver_clips = {
+            'capacity': self._response_u16(response, 16),
+            'state': CLIP_STATES[state] if state < len(CLIP_STATES) else state,
+            'frame_bytes': self._response_u32(response, 20),
+            'first': self._response_u16(response, 24),
+            'count': self._response_u16(response, 26),
+            'current': self._response_u16(response, 28),
+            'loops': self._response_u16(response, 30),
+            'frames_played': self._response_u32(response, 32),
+            'loops_done': self._response_u16(response, 36),
+            'recorded': self._response_u16(response, 38),
+            'frames_recorded': self._response_u32(response, 40),
+            'rejected': self._response_u16(response, 44),
+            'readback_back': self._response_u16(response, 46),
+            'readback_valid': bool(flags & CLIP_READBACK_VALID),
+            'readback_indexed': bool(flags & CLIP_READBACK_INDEXED),
+            'readback_sequence': self._response_u32(response, 48),
+            'readback_shown_us': self._response_u32(response, 52),
+            'readback_offset': self._response_u32(response, 56),
+            'readback': bytes(bytearray(response[64:64 + readback_bytes])),
+        }
+
+    def _parse_power_page(self, response):
+        strips = min(int(response[30]), POWER_STATUS_STRIPS)
+        self._receiver_power = {
+            'budget_total_ma': self._response_u16(response, 16),
+            'budget_strip_ma': self._response_u16(response, 18),
+            'channel_ua': tuple(self._response_u16(response, 20 + i * 2) for i in range(3)),
+            'idle_ua': self._response_u16(response, 26),
+            'requested_brightness': int(response[28]),
+            'applied_brightness': int(response[29]),
+            'busiest_strip': int(response[31]),
+            'demand_ma': self._response_u32(response, 32),
+            'total_ma': self._response_u32(response, 36),
+            'limited_frames': self._response_u32(response, 40),
+            'strip_ma': [self._response_u32(response, 48 + i * 4) for i in range(strips)],
+        }
+
     def _refresh_configuration(self, force=False):
         now = time.time()
         
@@ -291,6 +867,26 @@ class LEDController:
                 1 if self.debug else 0,
             ]
             self._xfer(cfg)
+            self._compressed_base = None
+            # A rebooted receiver also forgets its transition setting.
+            if getattr(self, '_transition_command', None) is not None:
+                self._xfer(self._transition_command)
+            for command in getattr(self, '_color_curve_commands', {}).values():
+                self._xfer(command)
+            if getattr(self, '_power_command', None) is not None:
+                self._xfer(self._power_command)
+            if getattr(self, '_latch_command', None) is not None:
+                self._xfer(self._latch_command)
+            if getattr(self, '_pacing_command', None) is not None:
+                self._xfer(self._pacing_command)
+            if getattr(self, '_status_page', 0):
+                self._xfer([CMD_SELECT_STATUS_PAGE, self._status_page])
+            if getattr(self, '_palette_command', None) is not None:
+                self._xfer(self._palette_command)
+            if getattr(self, '_effect_palette_command', None) is not None:
+                self._xfer(self._effect_palette_command)
+            if getattr(self, '_effect_command', None) is not None:
+                self._xfer(self._effect_command)
             self._last_config_refresh = now
             self._last_sent_config = current_config
             if self.debug:
@@ -320,6 +916,9 @@ class LEDController:
             int(b) & 0xFF
         ]
         self._xfer(data)
+        self._compressed_base = None
+        self._effect_command = None
+        self._clip_command = None
     
     def set_brightness(self, brightness):
         """Set global brightness (0-255)"""
@@ -331,6 +930,814 @@ class LEDController:
         if self.debug:
             print(f"✓ Brightness set ({level})")
     
+    def supports_keyframe_transitions(self):
+        """True once the receiver has advertised on-device interpolation."""
+        return bool(
+            getattr(self, '_receiver_capabilities', 0) & RECEIVER_CAPABILITY_KEYFRAME_TRANSITIONS
+        )
+
+    def set_transition(self, duration_ms, easing='linear'):
+        """Have the receiver interpolate to each following frame.
+
+        Frames published after this become keyframes that the receiver blends
+        towards over ``duration_ms`` at its full refresh rate; 0 cuts straight
+        to each frame. Receivers without the capability ignore the command.
+        """
+        duration = max(0, min(0xFFFF, int(duration_ms)))
+        code = TRANSITION_EASINGS[easing]
+        self._refresh_configuration()
+        self._transition_command = [CMD_SET_TRANSITION, (duration >> 8) & 0xFF, duration & 0xFF, code]
+        self._xfer(self._transition_command)
+        if self.debug:
+            print(f"✓ Transition set ({duration} ms, {easing})")
+
+    def supports_color_correction(self):
+        """True once the receiver has advertised per-lane colour curves."""
+        return bool(
+            getattr(self, '_receiver_capabilities', 0) & RECEIVER_CAPABILITY_COLOR_CORRECTION
+        )
+
+    def set_color_curve(self, curve, channels=ALL_COLOR_CHANNELS, strips=None):
+        """Upload one 256-entry output curve for some channels and strips.
+
+        ``channels`` is a mask (0x01 red, 0x02 green, 0x04 blue) and ``strips``
+        an iterable of strip indices, or None for every strip. The receiver
+        applies the curve after brightness from the next displayed frame.
+        """
+        curve = bytes(curve)
+        if len(curve) != 256:
+            raise ValueError("colour curve must have 256 entries")
+        channel_mask = int(channels) & ALL_COLOR_CHANNELS
+        wide = self.strip_count > 8
+        if strips is None:
+            lane_mask = ALL_WIDE_LANES if wide else ALL_LANES
+        else:
+            lane_mask = 0
+            for strip in strips:
+                if 0 <= strip < min(self.strip_count, MAX_RECEIVER_STRIPS):
+                    lane_mask |= 1 << strip
+        if channel_mask == 0 or lane_mask == 0:
+            return
+        self._refresh_configuration()
+        if wide:
+            mask_bytes = [(lane_mask >> 8) & 0xFF, lane_mask & 0xFF]
+        else:
+            mask_bytes = [lane_mask]
+        command = [CMD_SET_COLOR_CURVE] + mask_bytes + [channel_mask] + list(curve)
+        key = (lane_mask, channel_mask)
+        if lane_mask in (ALL_LANES, ALL_WIDE_LANES) and channel_mask == ALL_COLOR_CHANNELS:
+            self._color_curve_commands.clear()
+        self._color_curve_commands.pop(key, None)
+        self._color_curve_commands[key] = command
+        self._xfer(command)
+
+    def set_color_correction(self, gamma=1.0, gains=(1.0, 1.0, 1.0), strips=None):
+        """Apply gamma and per-channel white-balance gains on the receiver."""
+        curves = [build_color_curve(gamma, gain) for gain in gains]
+        if curves[0] == curves[1] == curves[2]:
+            self.set_color_curve(curves[0], ALL_COLOR_CHANNELS, strips)
+        else:
+            for mask, curve in zip(COLOR_CHANNEL_MASKS, curves):
+                self.set_color_curve(curve, mask, strips)
+        if self.debug:
+            print(f"✓ Colour correction set (gamma={gamma}, gains={tuple(gains)})")
+
+    def supports_power_limit(self):
+        """True once the config status page has advertised the power limiter."""
+        config = getattr(self, '_receiver_config', None) or {}
+        return bool(config.get('frame_formats', 0) & RECEIVER_FRAME_FORMAT_POWER_LIMIT)
+
+    def set_power_budget(self, total_ma=0, strip_ma=0, channel_ma=None, idle_ma=None):
+        """Have the receiver keep each frame's estimated draw within budget.
+
+        The receiver prices every frame it encodes, after colour curves, and
+        lowers the brightness of frames that would draw more than
+        ``total_ma`` in all or ``strip_ma`` on any one strip; 0 turns that
+        limit off. ``channel_ma`` (R, G, B at full output) and ``idle_ma``
+        replace the receiver's per-LED draw model. The estimate is reported
+        on the 'power' status page either way.
+        """
+        total = max(0, min(MAX_POWER_BUDGET_MA, int(total_ma)))
+        strip = max(0, min(MAX_POWER_BUDGET_MA, int(strip_ma)))
+        command = [CMD_SET_POWER_BUDGET, (total >> 8) & 0xFF, total & 0xFF,
+                   (strip >> 8) & 0xFF, strip & 0xFF]
+        if channel_ma is not None or idle_ma is not None:
+            if channel_ma is None or idle_ma is None:
+                raise ValueError("channel_ma and idle_ma are set together")
+            if len(channel_ma) != 3:
+                raise ValueError("channel_ma needs red, green and blue draw")
+            for milliamps in tuple(channel_ma) + (idle_ma,):
+                microamps = max(0, min(MAX_POWER_MODEL_UA, int(round(float(milliamps) * 1000))))
+                command.extend([(microamps >> 8) & 0xFF, microamps & 0xFF])
+        self._refresh_configuration()
+        self._power_command = command
+        self._xfer(command)
+        if self.debug:
+            print(f"✓ Power budget set ({total} mA total, {strip} mA per strip)")
+
+    def supports_frame_latch(self):
+        """True once the receiver has advertised stage-then-latch display."""
+        return bool(
+            getattr(self, '_receiver_capabilities', 0) & RECEIVER_CAPABILITY_FRAME_LATCH
+        )
+
+    def set_latch_mode(self, mode):
+        """Stage frames on the receiver until a latch starts them.
+
+        In 'command' mode each shown frame waits for ``latch()``; in 'gpio'
+        mode it waits for the receiver's latch pin. 'off' shows frames as
+        they arrive, including any frame still staged.
+        """
+        code = LATCH_MODES[mode]
+        self._refresh_configuration()
+        self._latch_command = None if code == 0 else [CMD_SET_LATCH, code]
+        # The receiver drops pacing when the latch mode is set.
+        self._pacing_command = None
+        self._xfer([CMD_SET_LATCH, code])
+        if self.debug:
+            print(f"✓ Latch mode set ({mode})")
+
+    @property
+    def latch_enabled(self):
+        return getattr(self, '_latch_command', None) is not None
+
+    def latch(self):
+        """Start the staged frame. Kept to a single short transfer so a
+        broadcast over several receivers completes as close together as the
+        bus allows."""
+        self._xfer([CMD_LATCH])
+
+    def supports_paced_display(self):
+        """True once the receiver has advertised timer-paced presentation."""
+        return bool(
+            getattr(self, '_receiver_capabilities', 0) & RECEIVER_CAPABILITY_PACED_DISPLAY
+        )
+
+    def set_pacing(self, fps, jitter_frames=2):
+        """Have the receiver present frames in order at a fixed rate.
+
+        The receiver buffers ``jitter_frames`` frames before its timer starts
+        showing one per tick, so host and SPI jitter no longer reaches the
+        wall. Send at about ``fps``: faster overflows the buffer (queue
+        drops), slower runs it dry (late frames). 0 turns pacing off.
+        """
+        rate = max(0, min(MAX_PACED_FPS, int(fps)))
+        depth = max(1, min(MAX_JITTER_FRAMES, int(jitter_frames)))
+        self._refresh_configuration()
+        command = [CMD_SET_PACING, (rate >> 8) & 0xFF, rate & 0xFF, depth]
+        self._pacing_command = command if rate else None
+        self._latch_command = None
+        self._xfer(command)
+        if self.debug:
+            print(f"✓ Pacing set ({rate} fps, {depth} frame jitter buffer)")
+
+    def set_spi_capture(self, path):
+        """Record every SPI transfer to ``path`` for the receiver simulator
+        (firmware/esp32 ``receiver_sim`` environment), or stop with None.
+
+        Each transfer is stored with its start time and link, so a replay
+        reproduces the host's pacing as well as its packets.
+        """
+        capture = getattr(self, '_spi_capture', None)
+        if capture is not None:
+            with self._spi_capture_lock:
+                capture.close()
+            self._spi_capture = None
+        if path is None:
+            return
+        capture = open(path, 'wb')
+        capture.write(SPI_CAPTURE_MAGIC)
+        self._spi_capture_lock = threading.Lock()
+        self._spi_capture_started = time.perf_counter()
+        self._spi_capture = capture
+
+    def _capture_transfer(self, link, buf):
+        capture = getattr(self, '_spi_capture', None)
+        if capture is None:
+            return
+        elapsed_us = int((time.perf_counter() - self._spi_capture_started) * 1e6)
+        header = ((elapsed_us & 0xFFFFFFFF).to_bytes(4, 'big') + bytes([link]) +
+                  len(buf).to_bytes(4, 'big'))
+        # Stripe transfers run on their own thread, so records are written whole.
+        with self._spi_capture_lock:
+            capture.write(header)
+            capture.write(bytes(buf))
+
+    def supports_display_credits(self):
+        """True once status has carried the receiver's display credits."""
+        return getattr(self, '_receiver_credits', None) is not None
+
+    def set_credit_flow(self, enabled=True):
+        """Pace frames to the receiver's display instead of sending flat out.
+
+        The receiver reports how many frames its display can take before one
+        it has not shown is replaced, and when it will next take one. With
+        credit flow on, callers wait_for_display_slot() before rendering each
+        frame, and short frames are padded so their replies carry the
+        credits. Credits are part of the 'v2' status page only.
+        """
+        self._credit_flow = bool(enabled)
+        self._credit_sends = []
+
+    @property
+    def credit_flow(self):
+        return getattr(self, '_credit_flow', False)
+
+    def wait_for_display_slot(self, lead_s=0.0, timeout=0.25):
+        """Block until it is time to render and send the next frame.
+
+        Returns True once a frame started now, taking ``lead_s`` to render
+        and as long to send as the last one, would land just before the
+        receiver's next free display slot: late enough that the frame it
+        would replace has been shown, early enough to be the one taken.
+        While status predates the frames already sent, it is read again
+        with padded PINGs. Returns False without credits or after
+        ``timeout`` seconds; the caller may send anyway.
+        """
+        started = time.perf_counter()
+        deadline = started + timeout
+        lead = lead_s + getattr(self, '_last_frame_duration', 0.0) + DISPLAY_SLOT_MARGIN_S
+        ready = False
+        polled = False
+        while True:
+            now = time.perf_counter()
+            slot = self._display_slot(now)
+            if slot is not None:
+                landing, outstanding = slot
+                begin = landing - lead
+                if begin > now:
+                    if now >= deadline:
+                        break
+                    time.sleep(min(begin, deadline) - now)
+                    polled = False
+                    continue
+                if not outstanding:
+                    ready = True
+                    break
+            if now >= deadline:
+                break
+            if polled:
+                time.sleep(CREDIT_POLL_INTERVAL_S)
+            self._poll_status()
+            polled = True
+        self._credit_waits = getattr(self, '_credit_waits', 0) + 1
+        self._credit_wait_s = getattr(self, '_credit_wait_s', 0.0) + time.perf_counter() - started
+        return ready
+
+    def _display_slot(self, now):
+        """(perf_counter() time the next frame should land by, frames sent
+        since the status was taken), or None without credits."""
+        credits = getattr(self, '_receiver_credits', None)
+        if credits is None or getattr(self, '_receiver_clock_offset', None) is None:
+            return None
+        # A frame is in a snapshot once the receiver has had time to take it in.
+        settle = (getattr(self, '_receiver_last_crc_us', 0)
+                  + getattr(self, '_receiver_last_copy_us', 0)) / 1e6
+        snapshot = self._receiver_time(credits['snapshot_us'], now)
+        sends = [sent for sent in getattr(self, '_credit_sends', []) if sent + settle > snapshot]
+        self._credit_sends = sends
+        room = max(1, credits['room'])
+        queued = room - credits['credits'] + len(sends)
+        # Each frame ahead of this one beyond the room costs the display a slot.
+        slots_ahead = max(0, queued - room + 1)
+        landing = self._receiver_time(credits['next_slot_us'], now) \
+            + slots_ahead * credits['slot_interval_us'] / 1e6
+        return landing, len(sends)
+
+    def _spend_display_credit(self):
+        sends = getattr(self, '_credit_sends', None)
+        if sends is None:
+            sends = self._credit_sends = []
+        sends.append(time.perf_counter())
+        del sends[:-16]
+
+    def _poll_status(self):
+        """Read status with a PING padded to the credit tail."""
+        self._credit_polls = getattr(self, '_credit_polls', 0) + 1
+        self._xfer(bytearray([CMD_PING]) + bytes(MIN_CREDIT_STATUS_PAYLOAD - 1))
+
+    def _track_receiver_clock(self, snapshot_us):
+        """Fold a snapshot's receiver time into the clock offset estimate.
+
+        Status is taken before the transfer that carries it, so the smallest
+        host-minus-receiver difference seen is the closest to the truth.
+        """
+        now = time.perf_counter()
+        sample = (int(now * 1e6) - snapshot_us) & 0xFFFFFFFF
+        offset = getattr(self, '_receiver_clock_offset', None)
+        if offset is not None:
+            creep = int((now - self._receiver_clock_seen) * RECEIVER_CLOCK_DRIFT_PPM)
+            offset = (offset + creep) & 0xFFFFFFFF
+            if _u32_delta(sample, offset) > 0:
+                sample = offset
+        self._receiver_clock_offset = sample
+        self._receiver_clock_seen = now
+
+    def _receiver_time(self, receiver_us, now):
+        """perf_counter() time of receiver time ``receiver_us``."""
+        host_us = (receiver_us + self._receiver_clock_offset) & 0xFFFFFFFF
+        return now + _u32_delta(host_us, int(now * 1e6) & 0xFFFFFFFF) / 1e6
+
+    def select_latency_histogram(self, stage):
+        """Append one stage's histogram to receiver status; None stops it."""
+        code = NO_LATENCY_HISTOGRAM if stage is None else LATENCY_STAGES.index(stage)
+        self._xfer([CMD_SELECT_HISTOGRAM, code])
+
+    def reset_latency_histograms(self):
+        """Clear the receiver's histograms and the copies read so far."""
+        self._xfer([CMD_RESET_HISTOGRAMS])
+        self._receiver_latency_histograms = {}
+
+    def supports_status_pages(self):
+        """True once the receiver has advertised paged (LGS3) status."""
+        return bool(
+            getattr(self, '_receiver_capabilities', 0) & RECEIVER_CAPABILITY_STATUS_PAGES
+        )
+
+    def select_status_page(self, page):
+        """Have later transfers return ``page`` (a STATUS_PAGES name) instead
+        of the LGS2 block. Compressed frames are padded to the page's size;
+        other transfers shorter than the page return just its header."""
+        code = STATUS_PAGES.index(page)
+        self._status_page = code
+        self._xfer([CMD_SELECT_STATUS_PAGE, code])
+
+    def supports_effects(self):
+        """True once the receiver has advertised on-device effects."""
+        return bool(
+            getattr(self, '_receiver_capabilities', 0) & RECEIVER_CAPABILITY_EFFECTS
+        )
+
+    def set_effect(self, kind, *, ticks_per_second=100.0, wall_width=0, x_origin=0,
+                   x_scale=13.0, y_scale=3.7, radial_scale=17.0,
+                   radial_y_scale=0.22, center_y=0.52):
+        """Have the receiver render ``kind`` (an EFFECT_KINDS name) itself.
+
+        Parameters follow AnimatedPaletteField. ``wall_width`` and
+        ``x_origin`` place this receiver's strips within a wider wall so
+        several receivers draw one field; 0 width means this receiver alone.
+        Calling again with the same kind only changes its parameters, without
+        restarting the animation. Any frame sent afterwards stops the effect.
+        """
+        code = EFFECT_KINDS.index(kind)
+        self._refresh_configuration()
+        if code == 0:
+            self.stop_effect()
+            return
+
+        def fixed(value, scale=256):
+            return max(0, min(0xFFFF, int(round(value * scale))))
+
+        fields = (
+            max(0, min(0xFFFF, int(round(ticks_per_second)))),
+            max(0, min(0xFFFF, int(wall_width))),
+            max(0, min(0xFFFF, int(x_origin))),
+            fixed(x_scale),
+            fixed(y_scale),
+            fixed(radial_scale),
+            fixed(radial_y_scale),
+            fixed(center_y, 65536),
+        )
+        command = [CMD_SET_EFFECT, code]
+        for value in fields:
+            command += [(value >> 8) & 0xFF, value & 0xFF]
+        self._effect_command = command
+        self._clip_command = None
+        self._xfer(command)
+        if self.debug:
+            print(f"✓ Effect set ({kind})")
+
+    def set_effect_palette(self, palette):
+        """Upload the 256-entry RGB palette every effect indexes."""
+        data = bytes(bytearray(int(channel) & 0xFF for entry in palette for channel in entry)) \
+            if not isinstance(palette, (bytes, bytearray)) else bytes(palette)
+        if len(data) != EFFECT_PALETTE_BYTES:
+            raise ValueError("effect palette must have 256 RGB entries")
+        self._refresh_configuration()
+        self._effect_palette_command = [CMD_SET_EFFECT_PALETTE] + list(data)
+        self._xfer(self._effect_palette_command)
+
+    def supports_striped_frames(self):
+        """True when a second SPI link is open and the receiver has not said
+        it lacks one. Until the config page is seen the wiring is trusted."""
+        if getattr(self, 'stripe_spi', None) is None or self.strip_count < 2:
+            return False
+        lane_bytes = self.leds_per_strip * 3
+        part_bytes = 1 + FRAME_PART_HEADER_BYTES + (self.strip_count + 1) // 2 * lane_bytes
+        if part_bytes + CRC_BYTES > MAX_SPI_TRANSFER:
+            return False
+        config = getattr(self, '_receiver_config', None)
+        if config is None or 'frame_formats' not in config:
+            return True
+        return bool(config['frame_formats'] & RECEIVER_FRAME_FORMAT_STRIPED)
+
+    def _frame_part_packet(self, rgb, first_strip, strip_count):
+        lane_bytes = self.leds_per_strip * 3
+        packet = bytearray([
+            CMD_SET_ALL_PART,
+            (self._stripe_sequence >> 8) & 0xFF,
+            self._stripe_sequence & 0xFF,
+            first_strip,
+            strip_count,
+        ])
+        packet += rgb[first_strip * lane_bytes:(first_strip + strip_count) * lane_bytes]
+        packet += bytes(CRC_BYTES)
+        return packet
+
+    def _xfer_stripe(self, buf):
+        crc = _crc16_ccitt(memoryview(buf)[:len(buf) - CRC_BYTES])
+        buf[-2] = (crc >> 8) & 0xFF
+        buf[-1] = crc & 0xFF
+        self._capture_transfer(SPI_CAPTURE_LINK_STRIPE, buf)
+        # The second link has no MISO, so its response carries no status.
+        self.stripe_spi.xfer2(buf)
+        self._stripe_bytes_sent += len(buf)
+
+    def _send_striped_frame(self, rgb):
+        """Send the first half of the strips on the primary link and the rest
+        on the stripe link at the same time. The receiver publishes the frame
+        once both parts of one sequence have arrived with valid CRCs."""
+        self._stripe_sequence = (self._stripe_sequence + 1) & 0xFFFF
+        split = (self.strip_count + 1) // 2
+        primary = self._frame_part_packet(rgb, 0, split)
+        second = self._stripe_executor.submit(
+            self._xfer_stripe, self._frame_part_packet(rgb, split, self.strip_count - split))
+        try:
+            self._xfer_packet(primary, len(primary) - CRC_BYTES)
+        finally:
+            try:
+                second.result()
+            except Exception:
+                self._errors += 1
+                raise
+        # Deltas chain off frames the receiver assembled without a tag.
+        self._compressed_base = None
+        self._striped_frames_sent += 1
+
+    def set_chunked_frames(self, enabled=True):
+        """Send full frames with a CRC per strip (CMD_SET_ALL_CHUNKED) where
+        the receiver supports them.
+
+        A bit error then costs one strip instead of the frame: the receiver
+        keeps the strips that check out and reports the rest missing, and
+        recover_chunked_frame(), or sending the same frame again, resends
+        only those. This lets the SPI clock run where CRC errors are rare but
+        not absent.
+        """
+        self._chunked_frames = bool(enabled)
+
+    def supports_chunked_frames(self):
+        """True once the config status page has advertised chunked frames and
+        a whole frame fits one transfer."""
+        config = getattr(self, '_receiver_config', None) or {}
+        if not config.get('frame_formats', 0) & RECEIVER_FRAME_FORMAT_CHUNKED:
+            return False
+        if self.strip_count > MAX_RECEIVER_STRIPS:
+            return False
+        chunk_bytes = self.leds_per_strip * 3 + CRC_BYTES
+        return 1 + FRAME_CHUNK_HEADER_BYTES + self.strip_count * chunk_bytes <= MAX_SPI_TRANSFER
+
+    def _chunked_packet(self, rgb, strips):
+        lane_bytes = self.leds_per_strip * 3
+        header = bytes([
+            (self._chunk_sequence >> 8) & 0xFF,
+            self._chunk_sequence & 0xFF,
+            (strips >> 8) & 0xFF,
+            strips & 0xFF,
+        ])
+        crc = _crc16_ccitt(header)
+        packet = bytearray([CMD_SET_ALL_CHUNKED]) + header + bytes([crc >> 8, crc & 0xFF])
+        for strip in range(self.strip_count):
+            if strips & (1 << strip):
+                chunk = rgb[strip * lane_bytes:(strip + 1) * lane_bytes]
+                crc = _crc16_ccitt(chunk)
+                packet += chunk
+                packet += bytes([crc >> 8, crc & 0xFF])
+        # Resends can be short; pad them so the reply still reaches the
+        # chunk tail, or the selected page.
+        page = getattr(self, '_status_page', 0)
+        min_bytes = STATUS_PAGE_BYTES[page]
+        if len(packet) < min_bytes:
+            packet.extend(bytes(min_bytes - len(packet)))
+        return packet
+
+    def _missing_chunks(self):
+        """Strips the receiver reported missing from the last chunked frame."""
+        chunks = getattr(self, '_receiver_chunks', None)
+        if self._chunk_frame is None or chunks is None:
+            return 0
+        if chunks['sequence'] != self._chunk_sequence:
+            return 0
+        return chunks['missing_strips'] & ((1 << self.strip_count) - 1)
+
+    def recover_chunked_frame(self):
+        """Resend the strips of the last chunked frame that the receiver has
+        reported missing. Returns how many strips were resent.
+
+        The report travels in the status the receiver returns with later
+        transfers, so a host that has stopped sending frames calls this until
+        it returns 0.
+        """
+        missing = self._missing_chunks()
+        if missing:
+            self._xfer_raw(self._chunked_packet(self._chunk_frame, missing))
+            resent = bin(missing).count('1')
+            self._chunks_resent += resent
+            return resent
+        return 0
+
+    def _send_chunked_frame(self, rgb):
+        """Send a frame as CRC-checked strips. The same frame again resends
+        just the strips still missing from it rather than every strip."""
+        rgb = bytes(rgb)
+        if rgb == self._chunk_frame and self.recover_chunked_frame():
+            return
+        self._chunk_sequence = (self._chunk_sequence + 1) & 0xFFFF
+        self._chunk_frame = rgb
+        self._xfer_raw(self._chunked_packet(rgb, (1 << self.strip_count) - 1))
+        # Deltas chain off frames the receiver assembled without a tag.
+        self._compressed_base = None
+        self._chunked_frames_sent += 1
+
+    def supports_layout(self):
+        """True once the config status page has advertised layout maps."""
+        config = getattr(self, '_receiver_config', None) or {}
+        return bool(config.get('frame_formats', 0) & RECEIVER_FRAME_FORMAT_LAYOUT)
+
+    def layout_matches(self, version):
+        """True when the receiver last reported map ``version`` as stored,
+        whether or not it fits the current geometry."""
+        config = getattr(self, '_receiver_config', None) or {}
+        return config.get('layout_state') in ('active', 'inactive') and \
+            config.get('layout_version') == version
+
+    def upload_layout(self, layout, version=None):
+        """Store a layout map on the receiver, so frames can be sent in
+        logical order and are remapped onto the strips as they are encoded.
+
+        ``layout`` has one entry per physical pixel, strip by strip: the
+        logical pixel it shows, or None or LAYOUT_UNMAPPED to keep it dark.
+        The receiver keeps the map across reboots under ``version``, which
+        defaults to a hash of the map; pass a version of your own to check
+        it with layout_matches() first. The map applies while the geometry
+        matches this controller's. The receiver refuses a second map until
+        it has applied the first, which it does on its next frame. Returns
+        the version sent.
+        """
+        total_pixels = self.total_leds
+        entries = [LAYOUT_UNMAPPED if entry is None else int(entry) for entry in layout]
+        if len(entries) != total_pixels:
+            raise ValueError("layout needs one entry per pixel")
+        if total_pixels >= LAYOUT_UNMAPPED:
+            raise ValueError("layout maps cover at most 65534 pixels")
+        if any(entry != LAYOUT_UNMAPPED and not 0 <= entry < total_pixels for entry in entries):
+            raise ValueError("layout entry out of range")
+        data = bytearray()
+        for entry in entries:
+            data.extend(((entry >> 8) & 0xFF, entry & 0xFF))
+        if version is None:
+            version = binascii.crc32(data, self.strip_count) or 1
+        if not 0 < version <= 0xFFFFFFFF:
+            raise ValueError("layout version must be a nonzero u32")
+        self._refresh_configuration()
+        for start in range(0, total_pixels, MAX_LAYOUT_ENTRIES_PER_SLICE):
+            count = min(MAX_LAYOUT_ENTRIES_PER_SLICE, total_pixels - start)
+            packet = bytearray([CMD_SET_LAYOUT, (start >> 8) & 0xFF, start & 0xFF])
+            packet += data[start * 2:(start + count) * 2]
+            self._xfer(packet)
+        self._commit_layout(version, _crc16_ccitt(bytes(data)))
+        return version
+
+    def clear_layout(self):
+        """Drop the receiver's layout map; frames are shown as sent again."""
+        self._refresh_configuration()
+        self._commit_layout(0, 0)
+
+    def _commit_layout(self, version, crc):
+        strips, leds = (self.strip_count, self.leds_per_strip) if version else (0, 0)
+        self._xfer([
+            CMD_COMMIT_LAYOUT,
+            (version >> 24) & 0xFF, (version >> 16) & 0xFF,
+            (version >> 8) & 0xFF, version & 0xFF,
+            strips, (leds >> 8) & 0xFF, leds & 0xFF,
+            (crc >> 8) & 0xFF, crc & 0xFF,
+        ])
+
+    def supports_indexed_frames(self):
+        """True once the config status page has advertised indexed frames."""
+        config = getattr(self, '_receiver_config', None) or {}
+        return bool(config.get('frame_formats', 0) & RECEIVER_FRAME_FORMAT_INDEXED)
+
+    def set_palette(self, palette):
+        """Upload the 256-entry RGB palette that set_indexed_frame() indexes.
+
+        The receiver applies it from the next frame it displays.
+        """
+        data = bytes(bytearray(int(channel) & 0xFF for entry in palette for channel in entry)) \
+            if not isinstance(palette, (bytes, bytearray)) else bytes(palette)
+        if len(data) != INDEXED_PALETTE_BYTES:
+            raise ValueError("palette must have 256 RGB entries")
+        self._refresh_configuration()
+        self._palette_command = [CMD_SET_PALETTE] + list(data)
+        self._xfer(self._palette_command)
+
+    def set_indexed_frame(self, indices):
+        """Send a full frame as one palette index per pixel, a third of the
+        bytes of set_all_pixels(). Short frames are padded with index 0.
+        """
+        self._refresh_configuration()
+        self._effect_command = None
+        self._clip_command = None
+        total_pixels = self.total_leds
+        if total_pixels + 1 + CRC_BYTES > MAX_SPI_TRANSFER:
+            raise ValueError("indexed frame does not fit one SPI transfer")
+        start_time = time.perf_counter()
+        data = bytes(bytearray(int(index) & 0xFF for index in indices[:total_pixels])) \
+            if not isinstance(indices, (bytes, bytearray)) else bytes(indices[:total_pixels])
+        packet = bytearray([CMD_SET_ALL_INDEXED]) + data
+        packet.extend(bytes(1 + total_pixels - len(packet)))
+        self._xfer(packet)
+        # Compressed deltas chain off RGB frames the receiver no longer holds.
+        self._compressed_base = None
+        duration = time.perf_counter() - start_time
+        self._frames_sent += 1
+        self._last_frame_duration = duration
+        self._total_frame_duration += duration
+        self._rotate_latency_histogram()
+        self._spend_display_credit()
+
+    def supports_clips(self):
+        """True once the config status page has advertised a clip store."""
+        config = getattr(self, '_receiver_config', None) or {}
+        return bool(config.get('frame_formats', 0) & RECEIVER_FRAME_FORMAT_CLIPS)
+
+    def upload_clip(self, frames, durations_ms, first_index=0):
+        """Store ``frames`` in the receiver's clip store from ``first_index``
+        on, to be looped by play_clip() without further SPI traffic.
+
+        Frames are (r, g, b) lists, uint8 arrays or raw RGB bytes.
+        ``durations_ms`` is one duration for every frame or one per frame.
+        Playback is stopped first, since the receiver refuses uploads while a
+        clip plays. Frames too large for one transfer are sent as slices.
+        A receiver without PSRAM refuses every frame; the clips status page
+        counts refusals. Returns the number of frames sent.
+        """
+        frames = list(frames)
+        if isinstance(durations_ms, (int, float)):
+            durations = [durations_ms] * len(frames)
+        else:
+            durations = list(durations_ms)
+        if len(durations) != len(frames):
+            raise ValueError("need one duration per frame")
+        if first_index < 0 or first_index + len(frames) > 0xFFFF:
+            raise ValueError("clip frame index out of range")
+        self._refresh_configuration()
+        if self.clip_playing:
+            self.stop_clip()
+        self._recorder_enabled = False
+        total_pixels = self.total_leds
+        for offset, (frame, duration) in enumerate(zip(frames, durations)):
+            index = first_index + offset
+            duration = max(1, min(MAX_CLIP_FRAME_MS, int(round(duration))))
+            if isinstance(frame, (bytes, bytearray)):
+                rgb = bytearray(frame[:total_pixels * 3])
+            else:
+                rgb = bytearray(_color_bytes(frame, 0, total_pixels))
+            rgb.extend(bytes(total_pixels * 3 - len(rgb)))
+            for start in range(0, total_pixels, MAX_PIXELS_PER_CLIP_SLICE):
+                count = min(MAX_PIXELS_PER_CLIP_SLICE, total_pixels - start)
+                packet = bytearray([
+                    CMD_CLIP_FRAME,
+                    (index >> 8) & 0xFF, index & 0xFF,
+                    (duration >> 8) & 0xFF, duration & 0xFF,
+                    (start >> 8) & 0xFF, start & 0xFF,
+                ])
+                packet += rgb[start * 3:(start + count) * 3]
+                self._xfer(packet)
+        self._clip_frames = max(getattr(self, '_clip_frames', 0), first_index + len(frames))
+        return len(frames)
+
+    def play_clip(self, first=0, count=None, loops=0):
+        """Loop stored frames ``first`` to ``first + count - 1`` on the
+        receiver, ``loops`` times or forever for 0. ``count`` defaults to every
+        frame uploaded from ``first`` on. Any frame sent afterwards stops it.
+        """
+        if count is None:
+            count = getattr(self, '_clip_frames', 0) - first
+        if count <= 0:
+            raise ValueError("no clip frames to play")
+        self._refresh_configuration()
+        command = [
+            CMD_CLIP_PLAY,
+            (first >> 8) & 0xFF, first & 0xFF,
+            (count >> 8) & 0xFF, count & 0xFF,
+            (loops >> 8) & 0xFF, loops & 0xFF,
+        ]
+        self._clip_command = command
+        self._effect_command = None
+        self._xfer(command)
+
+    def stop_clip(self):
+        """Stop clip playback, leaving the current frame shown."""
+        self._clip_command = None
+        self._xfer([CMD_CLIP_PLAY, 0, 0, 0, 0])
+
+    @property
+    def clip_playing(self):
+        return getattr(self, '_clip_command', None) is not None
+
+    def set_flight_recorder(self, enabled):
+        """Record every frame the receiver puts up into its clip store, which
+        discards any uploaded clip, or freeze the recording for
+        read_recorded_frame()."""
+        self._refresh_configuration()
+        if enabled:
+            self._clip_command = None
+            self._clip_frames = 0
+        self._recorder_enabled = bool(enabled)
+        self._xfer([CMD_SET_RECORDER, 1 if enabled else 0])
+
+    def read_recorded_frame(self, back=0, timeout=0.5):
+        """Read the recorded frame ``back`` frames before the newest.
+
+        Freezes the recorder, then reads the frame a clips-page slice at a
+        time by repeating the request in transfers long enough for the page.
+        Returns a dict with the frame's sequence, shown_us, indexed flag and
+        raw bytes (RGB, or one palette index per pixel when indexed), or None
+        when the recorder holds no such frame. Raises TimeoutError if the
+        receiver does not answer within ``timeout`` seconds.
+        """
+        if getattr(self, '_recorder_enabled', False):
+            self.set_flight_recorder(False)
+        previous_page = STATUS_PAGES[self._status_page]
+        if previous_page != 'clips':
+            self.select_status_page('clips')
+        padding = STATUS_PAGE_BYTES[STATUS_PAGES.index('clips')] - CRC_BYTES
+        data = bytearray()
+        pixel_bytes = 3
+        deadline = time.monotonic() + timeout
+        frame = None
+        try:
+            while True:
+                first_pixel = len(data) // pixel_bytes
+                request = bytearray(padding)
+                request[0:5] = bytes([
+                    CMD_READ_RECORDER,
+                    (back >> 8) & 0xFF, back & 0xFF,
+                    (first_pixel >> 8) & 0xFF, first_pixel & 0xFF,
+                ])
+                self._xfer(request)
+                clips = self._receiver_clips
+                # The first response to a new request can predate it.
+                if clips is not None and clips['readback_back'] == back and (
+                        not clips['readback_valid']
+                        or clips['readback_offset'] == len(data)):
+                    if not clips['readback_valid']:
+                        return None
+                    if frame is None:
+                        pixel_bytes = 1 if clips['readback_indexed'] else 3
+                        frame = {
+                            'sequence': clips['readback_sequence'],
+                            'shown_us': clips['readback_shown_us'],
+                            'indexed': clips['readback_indexed'],
+                        }
+                    data += clips['readback']
+                    if len(data) >= self.total_leds * pixel_bytes or not clips['readback']:
+                        frame['data'] = bytes(data[:self.total_leds * pixel_bytes])
+                        return frame
+                    continue
+                if time.monotonic() > deadline:
+                    raise TimeoutError("receiver did not return the recorded frame")
+                time.sleep(0.002)
+        finally:
+            if previous_page != 'clips':
+                self.select_status_page(previous_page)
+
+    def stop_effect(self):
+        """Stop the receiver's effect, leaving its last frame shown."""
+        self._effect_command = None
+        self._xfer([CMD_SET_EFFECT, 0])
+
+    @property
+    def effect_running(self):
+        return getattr(self, '_effect_command', None) is not None
+
+    def enable_latency_histograms(self, enabled=True):
+        """Rotate the selected stage every HISTOGRAM_ROTATE_FRAMES frames so
+        get_stats() gradually covers every stage without extra transfers
+        beyond the two-byte selection."""
+        self._latency_histogram_rotation = bool(enabled)
+        self._latency_histogram_stage = 0
+        self.select_latency_histogram(LATENCY_STAGES[0] if enabled else None)
+
+    def _rotate_latency_histogram(self):
+        if not getattr(self, '_latency_histogram_rotation', False):
+            return
+        if self._frames_sent % HISTOGRAM_ROTATE_FRAMES:
+            return
+        self._latency_histogram_stage = (self._latency_histogram_stage + 1) % len(LATENCY_STAGES)
+        self.select_latency_histogram(LATENCY_STAGES[self._latency_histogram_stage])
+
     def show(self):
         """Update the LED display"""
         self._refresh_configuration()
@@ -340,6 +1747,9 @@ class LEDController:
         """Clear all LEDs"""
         self._refresh_configuration()
         self._xfer([CMD_CLEAR])
+        self._compressed_base = None
+        self._effect_command = None
+        self._clip_command = None
     
     def set_range(self, start_pixel, colors):
         """
@@ -373,20 +1783,142 @@ class LEDController:
                 data.extend([int(r) & 0xFF, int(g) & 0xFF, int(b) & 0xFF])
         
         self._xfer(data)
+        self._compressed_base = None
+        self._effect_command = None
+        self._clip_command = None
+
+    def supports_batch(self):
+        """True once the receiver has advertised the batch command."""
+        return bool(getattr(self, '_receiver_capabilities', 0) & RECEIVER_CAPABILITY_BATCH)
+
+    def supports_compressed_frames(self):
+        """True once the receiver has advertised RLE and XOR-delta frames."""
+        return bool(
+            getattr(self, '_receiver_capabilities', 0) & RECEIVER_CAPABILITY_COMPRESSED_FRAMES
+        )
+
+    def _delta_base_valid(self, rgb):
+        base = self._compressed_base
+        return (
+            base is not None
+            and len(base) == len(rgb)
+            and self._frames_since_keyframe < COMPRESSED_KEYFRAME_INTERVAL
+            and self._receiver_crc_errors == self._compressed_crc_errors
+            and not self._receiver_flags & RECEIVER_FLAG_DELTA_REJECTED
+        )
+
+    def _send_compressed_frame(self, rgb):
+        """Send ``rgb`` as an XOR delta or RLE keyframe when that is smaller.
+
+        Returns False when neither beats a raw SET_ALL; the caller then sends
+        the raw frame, which also ends the receiver's delta chain.
+        """
+        if not self.supports_compressed_frames():
+            return False
+        raw_payload = min(1 + len(rgb), MAX_SPI_TRANSFER - CRC_BYTES)
+        tag = self._compressed_tag % 255 + 1
+        keyframe = not self._delta_base_valid(rgb)
+        if keyframe:
+            header = bytes((CMD_SET_ALL_RLE, tag))
+            tokens = _encode_frame_tokens(rgb, raw_payload - len(header) - 2)
+        else:
+            delta = (
+                int.from_bytes(rgb, 'big') ^ int.from_bytes(self._compressed_base, 'big')
+            ).to_bytes(len(rgb), 'big')
+            header = bytes((CMD_SET_ALL_DELTA, self._compressed_tag, tag))
+            tokens = _encode_frame_tokens(delta, raw_payload - len(header) - 2)
+        if tokens is None:
+            self._compressed_base = None
+            return False
+
+        packet = bytearray(header)
+        packet += len(tokens).to_bytes(2, 'big')
+        packet += tokens
+        min_payload = MIN_STATUS_PAYLOAD
+        if self.credit_flow:
+            min_payload = MIN_CREDIT_STATUS_PAYLOAD
+        elif getattr(self, '_pacing_command', None) is not None:
+            min_payload = MIN_PACING_STATUS_PAYLOAD
+        elif self.latch_enabled:
+            min_payload = MIN_LATCH_STATUS_PAYLOAD
+        page = getattr(self, '_status_page', 0)
+        if page:
+            min_payload = max(min_payload, STATUS_PAGE_BYTES[page] - CRC_BYTES)
+        if len(packet) < min_payload:
+            packet.extend(bytes(min_payload - len(packet)))
+        self._xfer(packet)
+        self._compressed_tag = tag
+        self._compressed_base = bytes(rgb)
+        self._compressed_frames_sent += 1
+        if keyframe:
+            self._frames_since_keyframe = 0
+            self._compressed_crc_errors = self._receiver_crc_errors
+            self._receiver_flags &= ~RECEIVER_FLAG_DELTA_REJECTED
+        else:
+            self._frames_since_keyframe += 1
+        return True
+
+    def _send_partial_batches(self, colors, dirty_ranges):
+        """Pack dirty ranges into as few CMD_BATCH packets as possible.
+
+        Packets never exceed a full SET_ALL packet, which the receiver's SPI
+        buffers are sized for. The final packet ends with a show op so the
+        receiver publishes every range as one frame.
+        """
+        payload_limit = min(MAX_SPI_TRANSFER, 1 + self.total_leds * 3 + CRC_BYTES) - CRC_BYTES
+        packet = bytearray([CMD_BATCH])
+        for start, end in dirty_ranges:
+            start = max(0, int(start))
+            end = min(self.total_leds, int(end))
+            while start < end:
+                # Keep one byte free for the trailing show op.
+                room = payload_limit - len(packet) - 1
+                count = min(
+                    end - start,
+                    MAX_PIXELS_PER_BATCH_RANGE,
+                    max(0, room - BATCH_RANGE_HEADER_BYTES) // 3,
+                )
+                if count >= 2:
+                    packet.extend((
+                        CMD_SET_RANGE,
+                        (start >> 8) & 0xFF,
+                        start & 0xFF,
+                        (count >> 8) & 0xFF,
+                        count & 0xFF,
+                    ))
+                elif room >= BATCH_PIXEL_OP_BYTES:
+                    count = 1
+                    packet.extend((CMD_SET_PIXEL, (start >> 8) & 0xFF, start & 0xFF))
+                else:
+                    self._xfer(packet)
+                    packet = bytearray([CMD_BATCH])
+                    continue
+                packet.extend(_color_bytes(colors, start, start + count))
+                start += count
+        packet.append(CMD_SHOW)
+        self._xfer(packet)
+        self._compressed_base = None
 
     def set_partial_frame(self, colors, dirty_ranges):
         """Apply changed half-open pixel ranges and latch one partial frame."""
         start_time = time.perf_counter()
         success = False
+        # The receiver drops its effect on any pixel write.
+        self._effect_command = None
+        self._clip_command = None
         try:
-            for start, end in dirty_ranges:
-                start = max(0, int(start))
-                end = min(self.total_leds, int(end))
-                while start < end:
-                    chunk_end = min(end, start + MAX_PIXELS_PER_RANGE)
-                    self.set_range(start, colors[start:chunk_end])
-                    start = chunk_end
-            self.show()
+            if self.supports_batch():
+                self._refresh_configuration()
+                self._send_partial_batches(colors, dirty_ranges)
+            else:
+                for start, end in dirty_ranges:
+                    start = max(0, int(start))
+                    end = min(self.total_leds, int(end))
+                    while start < end:
+                        chunk_end = min(end, start + MAX_PIXELS_PER_RANGE)
+                        self.set_range(start, colors[start:chunk_end])
+                        start = chunk_end
+                self.show()
             success = True
         finally:
             if success:
@@ -394,6 +1926,8 @@ class LEDController:
                 self._frames_sent += 1
                 self._last_frame_duration = duration
                 self._total_frame_duration += duration
+                self._rotate_latency_histogram()
+                self._spend_display_credit()
 
     def configure(self):
         self.total_leds = self.strip_count * self.leds_per_strip
@@ -410,6 +1944,8 @@ class LEDController:
         Accepts a list of (r,g,b) tuples or a numpy uint8 array of shape (N,3).
         """
         self._refresh_configuration()
+        self._effect_command = None
+        self._clip_command = None
         start_time = time.perf_counter()
 
         total_pixels = self.total_leds
@@ -429,7 +1965,21 @@ class LEDController:
 
         success = False
         try:
-            if total_pixels <= MAX_PIXELS_SET_ALL:
+            chunked = getattr(self, '_chunked_frames', False) and self.supports_chunked_frames()
+            if chunked or self.supports_striped_frames():
+                if rgb_bytes is None:
+                    rgb_bytes = bytearray(total_pixels * 3)
+                    idx = 0
+                    for r, g, b in colors[:total_pixels]:
+                        rgb_bytes[idx] = int(r) & 0xFF
+                        rgb_bytes[idx + 1] = int(g) & 0xFF
+                        rgb_bytes[idx + 2] = int(b) & 0xFF
+                        idx += 3
+                if chunked:
+                    self._send_chunked_frame(rgb_bytes)
+                else:
+                    self._send_striped_frame(rgb_bytes)
+            elif total_pixels <= MAX_PIXELS_SET_ALL:
                 payload_length = 1 + total_pixels * 3
                 buf = self._frame_packet
                 buf[0] = CMD_SET_ALL
@@ -442,9 +1992,16 @@ class LEDController:
                         buf[idx + 1] = int(g) & 0xFF
                         buf[idx + 2] = int(b) & 0xFF
                         idx += 3
-                self._xfer_packet(buf, payload_length)
+                if not self._send_compressed_frame(memoryview(buf)[1:payload_length]):
+                    self._xfer_packet(buf, payload_length)
                 if SPI_INTER_FRAME_DELAY > 0:
                     time.sleep(SPI_INTER_FRAME_DELAY)
+            elif rgb_bytes is not None and self._send_compressed_frame(memoryview(rgb_bytes)):
+                # Frames too large for one SET_ALL, such as a 16-lane receiver's,
+                # can still fit one packet once compressed.
+                pass
+            elif self.supports_batch():
+                self._send_partial_batches(arr if is_ndarray else colors, [(0, total_pixels)])
             else:
                 start = 0
                 while start < total_pixels:
@@ -475,9 +2032,17 @@ class LEDController:
                 self._frames_sent += 1
                 self._last_frame_duration = duration
                 self._total_frame_duration += duration
+                self._rotate_latency_histogram()
+                self._spend_display_credit()
     
     def close(self):
         """Close SPI connection"""
+        self.set_spi_capture(None)
+        if getattr(self, '_stripe_executor', None) is not None:
+            self._stripe_executor.shutdown(wait=True)
+            self._stripe_executor = None
+        if getattr(self, 'stripe_spi', None) is not None:
+            self.stripe_spi.close()
         self.spi.close()
 
     def get_stats(self):
@@ -498,6 +2063,8 @@ class LEDController:
             'errors': self._errors,
             'receiver_status_seen': self._receiver_status_seen,
             'receiver_status_version': self._receiver_status_version,
+            'receiver_capabilities': self._receiver_capabilities,
+            'compressed_frames_sent': self._compressed_frames_sent,
             'receiver_status_responses': self._receiver_status_responses,
             'receiver_status_misses': self._receiver_status_misses,
             'receiver_packets': self._receiver_packets,
@@ -517,6 +2084,37 @@ class LEDController:
             'receiver_last_show_us': self._receiver_last_show_us,
             'receiver_last_accepted_sequence': self._receiver_last_accepted_sequence,
             'receiver_last_displayed_sequence': self._receiver_last_displayed_sequence,
+            'receiver_latch_mode': self._receiver_latch_mode,
+            'receiver_last_latch_us': self._receiver_last_latch_us,
+            'receiver_latches': self._receiver_latches,
+            'receiver_latch_misses': self._receiver_latch_misses,
+            'receiver_last_latch_sequence': self._receiver_last_latch_sequence,
+            'receiver_paced_fps': self._receiver_paced_fps,
+            'receiver_pacing_depth': self._receiver_pacing_depth,
+            'receiver_frames_late': self._receiver_frames_late,
+            'receiver_queue_drops': self._receiver_queue_drops,
+            'receiver_latency_histograms': dict(self._receiver_latency_histograms),
+            'receiver_status_page': STATUS_PAGES[self._status_page],
+            'receiver_status_generation': self._receiver_status_generation,
+            'receiver_truncated_pages': self._receiver_truncated_pages,
+            'receiver_memory': self._receiver_memory,
+            'receiver_config': self._receiver_config,
+            'receiver_transport': self._receiver_transport,
+            'receiver_links': self._receiver_links,
+            'striped_frames_sent': self._striped_frames_sent,
+            'stripe_bytes_sent': self._stripe_bytes_sent,
+            'chunked_frames_sent': self._chunked_frames_sent,
+            'chunks_resent': self._chunks_resent,
+            'receiver_chunks': self._receiver_chunks,
+            'credit_flow': self._credit_flow,
+            'credit_waits': self._credit_waits,
+            'credit_wait_ms': self._credit_wait_s * 1000.0,
+            'credit_polls': self._credit_polls,
+            'receiver_credits': self._receiver_credits,
+            'effect_running': self.effect_running,
+            'receiver_clips': self._receiver_clips,
+            'receiver_power': self._receiver_power,
+            'clip_playing': self.clip_playing,
             'receiver_active_strips': self._receiver_active_strips,
             'receiver_leds_per_strip': self._receiver_leds_per_strip,
         }
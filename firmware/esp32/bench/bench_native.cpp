@@ -0,0 +1,25 @@
+#include <chrono>
+#include <cstdio>
+
+#include "pipeline_bench.hpp"
+
+namespace {
+
+std::uint32_t now_ns() {
+  return static_cast<std::uint32_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+void write_line(const char* line) { std::puts(line); }
+
+}  // namespace
+
+int main() {
+  ledgrid::BenchmarkClock clock{};
+  clock.now = now_ns;
+  clock.ns_per_tick = 1.0;
+  ledgrid::run_pipeline_benchmarks(clock, write_line, "native");
+  return 0;
+}
@@ -0,0 +1,25 @@
+#include <Arduino.h>
+
+#include "esp_cpu.h"
+#include "pipeline_bench.hpp"
+
+namespace {
+
+std::uint32_t now_cycles() { return esp_cpu_get_cycle_count(); }
+
+void write_line(const char* line) { Serial.println(line); }
+
+}  // namespace
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  ledgrid::BenchmarkClock clock{};
+  clock.now = now_cycles;
+  clock.ns_per_tick = 1e3 / static_cast<double>(getCpuFrequencyMhz());
+  clock.ticks_are_cycles = true;
+  ledgrid::run_pipeline_benchmarks(clock, write_line, "esp32-s3");
+  Serial.println("{\"suite\":\"ledgrid-pipeline\",\"done\":true}");
+}
+
+void loop() { delay(1000); }
@@ -0,0 +1,247 @@
+#include "pipeline_bench.hpp"
+
+#include <cstdio>
+#include <vector>
+
+#include "ledgrid/crc16.hpp"
+#include "ledgrid/frame_mailbox.hpp"
+#include "ledgrid/power_budget.hpp"
+#include "ledgrid/ws2812_encoder.hpp"
+
+namespace ledgrid {
+namespace {
+
+#if LEDGRID_MAX_LANES > 8
+constexpr std::uint8_t kStripCounts[] = {1, 4, 8, 16};
+#else
+constexpr std::uint8_t kStripCounts[] = {1, 4, 8};
+#endif
+constexpr std::uint16_t kLedCounts[] = {60, 140, 300, 600};
+// Full scale skips the brightness multiply; the others exercise it.
+constexpr std::uint8_t kBrightnessValues[] = {255, 128, 50};
+constexpr Crc16Engine kCrcEngines[] = {
+    Crc16Engine::Nibble, Crc16Engine::Slice8, Crc16Engine::Rom};
+
+// Each batch grows until it takes this long; the fastest of kBatches counts.
+constexpr double kMinBatchNs = 20e6;
+constexpr int kBatches = 5;
+constexpr std::uint32_t kMaxIterations = 1U << 20;
+
+// Keeps results observable so the timed calls are not optimised away.
+volatile std::uint32_t benchmark_sink = 0;
+
+struct Measurement {
+  std::uint32_t iterations = 0;
+  double ticks_per_op = 0;
+};
+
+template <typename Operation>
+Measurement measure(const BenchmarkClock& clock, Operation&& operation) {
+  operation();
+  std::uint32_t iterations = 1;
+  while (true) {
+    const std::uint32_t started = clock.now();
+    for (std::uint32_t i = 0; i < iterations; ++i) operation();
+    const std::uint32_t elapsed = clock.now() - started;
+    if (elapsed * clock.ns_per_tick >= kMinBatchNs || iterations >= kMaxIterations) {
+      break;
+    }
+    iterations *= 2;
+  }
+
+  Measurement best{iterations, 0};
+  for (int batch = 0; batch < kBatches; ++batch) {
+    const std::uint32_t started = clock.now();
+    for (std::uint32_t i = 0; i < iterations; ++i) operation();
+    const double per_op =
+        static_cast<double>(clock.now() - started) / iterations;
+    if (batch == 0 || per_op < best.ticks_per_op) best.ticks_per_op = per_op;
+  }
+  return best;
+}
+
+class Reporter {
+ public:
+  Reporter(const BenchmarkClock& clock, BenchmarkWriter writer, const char* platform)
+      : clock_(clock), writer_(writer), platform_(platform) {}
+
+  // `dimensions` is a preformatted, comma-led list of extra JSON fields.
+  void report(const char* name, const char* dimensions, const Measurement& result) {
+    char line[256];
+    int length = std::snprintf(
+        line, sizeof(line),
+        "{\"suite\":\"ledgrid-pipeline\",\"platform\":\"%s\",\"case\":\"%s\"%s,"
+        "\"iterations\":%u,\"ns_per_op\":%.1f",
+        platform_, name, dimensions, static_cast<unsigned>(result.iterations),
+        result.ticks_per_op * clock_.ns_per_tick);
+    if (clock_.ticks_are_cycles && length > 0 &&
+        static_cast<std::size_t>(length) < sizeof(line)) {
+      length += std::snprintf(line + length, sizeof(line) - length,
+                              ",\"cycles_per_op\":%.1f", result.ticks_per_op);
+    }
+    if (length > 0 && static_cast<std::size_t>(length) + 1 < sizeof(line)) {
+      line[length] = '}';
+      line[length + 1] = '\0';
+      writer_(line);
+    }
+  }
+
+  const BenchmarkClock& clock() const { return clock_; }
+
+ private:
+  const BenchmarkClock& clock_;
+  BenchmarkWriter writer_;
+  const char* platform_;
+};
+
+void bench_encoder(Reporter& reporter) {
+  for (const std::uint8_t strips : kStripCounts) {
+    for (const std::uint16_t leds : kLedCounts) {
+      const std::size_t rgb_bytes = static_cast<std::size_t>(strips) * leds * 3U;
+      const std::size_t encoded_bytes = parallel_encoded_size(strips, leds);
+      std::vector<std::uint8_t> rgb(rgb_bytes);
+      std::vector<std::uint8_t> encoded(encoded_bytes);
+      for (std::size_t i = 0; i < rgb_bytes; ++i) {
+        rgb[i] = static_cast<std::uint8_t>(i * 37U + 11U);
+      }
+      char dimensions[64];
+
+      std::snprintf(dimensions, sizeof(dimensions), ",\"strips\":%u,\"leds\":%u",
+                    strips, leds);
+      reporter.report("initialize-waveform", dimensions,
+                      measure(reporter.clock(), [&] {
+                        benchmark_sink = benchmark_sink +
+                            initialize_parallel_grb_waveform(
+                                strips, leds, encoded.data(), encoded.size());
+                      }));
+
+      initialize_parallel_grb_waveform(strips, leds, encoded.data(), encoded.size());
+      for (const std::uint8_t brightness : kBrightnessValues) {
+        std::snprintf(dimensions, sizeof(dimensions),
+                      ",\"strips\":%u,\"leds\":%u,\"brightness\":%u", strips, leds,
+                      brightness);
+        reporter.report("encode-pixels", dimensions, measure(reporter.clock(), [&] {
+          benchmark_sink = benchmark_sink +
+              encode_parallel_grb_pixels(rgb.data(), rgb.size(), strips, leds,
+                                         brightness, encoded.data(), encoded.size())
+                  .bytes_written;
+        }));
+      }
+
+      // The display path: uniform-curve kernels for RGB and indexed frames.
+      std::vector<std::uint8_t> indices(static_cast<std::size_t>(strips) * leds);
+      std::vector<std::uint8_t> palette(kPaletteBytes);
+      for (std::size_t i = 0; i < indices.size(); ++i) {
+        indices[i] = static_cast<std::uint8_t>(i * 61U + 5U);
+      }
+      for (std::size_t i = 0; i < palette.size(); ++i) {
+        palette[i] = static_cast<std::uint8_t>(i * 37U + 11U);
+      }
+      std::vector<UniformExpandTableStorage> storage(1);
+      auto tables = storage[0].tables();
+      std::vector<PaletteExpandRow> rows(1);
+      build_uniform_expand_table(nullptr, 128, &tables);
+      build_palette_expand_rows(nullptr, true, palette.data(), 128, strips, rows.data());
+      const auto kernels = select_parallel_encode_kernels(strips, true);
+      std::snprintf(dimensions, sizeof(dimensions), ",\"strips\":%u,\"leds\":%u",
+                    strips, leds);
+      reporter.report("encode-kernel", dimensions, measure(reporter.clock(), [&] {
+        benchmark_sink = benchmark_sink +
+            encode_parallel_grb_kernel_span(
+                kernels, tables, nullptr, rgb.data(), rgb.size(), strips, leds,
+                kBlendWeightMax, 0, leds, encoded.data(), encoded.size())
+                .bytes_written;
+      }));
+      reporter.report("encode-indexed", dimensions, measure(reporter.clock(), [&] {
+        benchmark_sink = benchmark_sink +
+            encode_parallel_grb_indexed_span(
+                kernels, rows.data(), indices.data(), indices.size(), strips, leds,
+                0, leds, encoded.data(), encoded.size())
+                .bytes_written;
+      }));
+      // The pass the driver adds ahead of each encode for the power limiter.
+      const PowerModel model{};
+      const PowerBudget budget{};
+      ChannelTotals totals{};
+      reporter.report("power-estimate", dimensions, measure(reporter.clock(), [&] {
+        total_rgb_channels(nullptr, rgb.data(), rgb.size(), strips, leds, &totals);
+        benchmark_sink = benchmark_sink + limit_power(model, budget, totals, 128).total_ma;
+      }));
+    }
+  }
+}
+
+void bench_crc(Reporter& reporter) {
+  for (const Crc16Engine engine : kCrcEngines) {
+    if (!crc16_engine_available(engine)) continue;
+    char name[32];
+    std::snprintf(name, sizeof(name), "crc16-%s", crc16_engine_name(engine));
+    for (const std::uint8_t strips : kStripCounts) {
+      for (const std::uint16_t leds : kLedCounts) {
+        // The checksum covers a SET_ALL packet: command byte plus pixels.
+        std::vector<std::uint8_t> packet(1U + static_cast<std::size_t>(strips) * leds * 3U);
+        for (std::size_t i = 0; i < packet.size(); ++i) {
+          packet[i] = static_cast<std::uint8_t>(i * 13U + 5U);
+        }
+        char dimensions[64];
+        std::snprintf(dimensions, sizeof(dimensions),
+                      ",\"strips\":%u,\"leds\":%u,\"bytes\":%u", strips, leds,
+                      static_cast<unsigned>(packet.size()));
+        reporter.report(name, dimensions, measure(reporter.clock(), [&] {
+          benchmark_sink = benchmark_sink +
+              crc16_ccitt(engine, packet.data(), packet.size());
+        }));
+      }
+    }
+  }
+}
+
+// One publish and one display of a frame: the per-frame mailbox traffic
+// between the SPI and display tasks, without the critical sections around it.
+void bench_mailbox(Reporter& reporter) {
+  for (const bool ordered : {false, true}) {
+    LatestFrameMailbox mailbox;
+    mailbox.set_ordered(ordered);
+    FrameMetadata metadata{};
+    std::uint32_t sequence = 0;
+    reporter.report(ordered ? "mailbox-ordered-cycle" : "mailbox-latest-cycle", "",
+                    measure(reporter.clock(), [&] {
+                      const int slot = mailbox.begin_write();
+                      metadata.sequence = ++sequence;
+                      mailbox.commit_write(slot, metadata);
+                      FrameMetadata read{};
+                      mailbox.finish_read(mailbox.begin_read(&read));
+                      mailbox.mark_displayed();
+                      benchmark_sink = benchmark_sink + read.sequence;
+                    }));
+
+    // A burst that overflows the slots: supersedes (latest) or drops (ordered).
+    reporter.report(ordered ? "mailbox-ordered-overflow" : "mailbox-latest-overflow",
+                    "", measure(reporter.clock(), [&] {
+                      for (std::size_t i = 0; i <= kFrameMailboxSlots; ++i) {
+                        const int slot = mailbox.begin_write();
+                        metadata.sequence = ++sequence;
+                        mailbox.commit_write(slot, metadata);
+                      }
+                      FrameMetadata read{};
+                      int read_slot;
+                      while ((read_slot = mailbox.begin_read(&read)) >= 0) {
+                        mailbox.finish_read(read_slot);
+                        mailbox.mark_displayed();
+                      }
+                      benchmark_sink = benchmark_sink + read.sequence;
+                    }));
+  }
+}
+
+}  // namespace
+
+void run_pipeline_benchmarks(
+    const BenchmarkClock& clock, BenchmarkWriter writer, const char* platform) {
+  Reporter reporter(clock, writer, platform);
+  bench_encoder(reporter);
+  bench_crc(reporter);
+  bench_mailbox(reporter);
+}
+
+}  // namespace ledgrid
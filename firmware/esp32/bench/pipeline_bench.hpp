@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ledgrid {
+
+// Tick source for the benchmarks. Batches stay well under a second, so a
+// wrapping 32-bit counter (nanoseconds natively, CPU cycles on target) is
+// enough; `ns_per_tick` converts it.
+struct BenchmarkClock {
+  std::uint32_t (*now)() = nullptr;
+  double ns_per_tick = 1.0;
+  // Reported as cycles_per_op as well when the ticks are CPU cycles.
+  bool ticks_are_cycles = false;
+};
+
+// Receives one JSON object per line.
+using BenchmarkWriter = void (*)(const char* line);
+
+// Times the encoder, CRC engines and frame mailbox over a matrix of strip
+// counts, LEDs per strip and brightness values. Each case prints the fastest
+// of several batches as {"suite", "platform", "case", ..., "ns_per_op"}; see
+// tools/benchmarks/firmware_microbench.py for comparison against a baseline.
+void run_pipeline_benchmarks(
+    const BenchmarkClock& clock, BenchmarkWriter writer, const char* platform);
+
+}  // namespace ledgrid
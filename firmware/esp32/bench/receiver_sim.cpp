@@ -0,0 +1,639 @@
+#include "receiver_sim.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <memory>
+
+#include "ledgrid/crc16.hpp"
+#include "ledgrid/protocol.hpp"
+#include "ledgrid/receiver_core.hpp"
+#include "ledgrid/ws2812_encoder.hpp"
+
+namespace ledgrid {
+namespace {
+
+constexpr std::uint64_t kNoEvent = UINT64_MAX;
+constexpr Crc16Engine kSimCrcEngine = Crc16Engine::Slice8;
+
+std::uint64_t host_ns() {
+  return static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+std::uint32_t read_u32(const std::uint8_t* bytes) {
+  return (static_cast<std::uint32_t>(bytes[0]) << 24) |
+         (static_cast<std::uint32_t>(bytes[1]) << 16) |
+         (static_cast<std::uint32_t>(bytes[2]) << 8) | bytes[3];
+}
+
+// Virtual time for one core's step at a time: the step starts where the
+// event loop puts it and advances by host time spent, times cpu_scale.
+class SimClock final : public ReceiverClock {
+ public:
+  explicit SimClock(double cpu_scale) : cpu_scale_(cpu_scale) { begin_step(0); }
+
+  void begin_step(std::uint64_t at_ns) {
+    step_ns_ = at_ns;
+    step_started_ = host_ns();
+  }
+
+  // Returns the step's end on the virtual clock.
+  std::uint64_t end_step() {
+    const std::uint64_t end = now_ns();
+    step_ns_ = end;
+    step_started_ = host_ns();
+    return end;
+  }
+
+  std::uint64_t now_ns() const {
+    if (cpu_scale_ <= 0) return step_ns_;
+    return step_ns_ + static_cast<std::uint64_t>(
+                          static_cast<double>(host_ns() - step_started_) * cpu_scale_);
+  }
+
+  std::uint32_t now_us() override { return static_cast<std::uint32_t>(now_ns() / 1000U); }
+
+  double cpu_scale() const { return cpu_scale_; }
+
+ private:
+  double cpu_scale_ = 1.0;
+  std::uint64_t step_ns_ = 0;
+  std::uint64_t step_started_ = 0;
+};
+
+// ParallelLedDriver's pipelined mode: two waveform buffers, a frame encoded
+// into the idle one while the other transmits, and the same skip of frames
+// the newest buffer already holds. Transfers run back to back at the WS2812
+// sample rate.
+class SimulatedDisplay final : public FrameDisplay {
+ public:
+  SimulatedDisplay(SimClock& clock, std::uint8_t strip_count, std::uint16_t led_capacity)
+      : clock_(clock), palette_rows_(1) {
+    capacity_ = parallel_encoded_size(strip_count, led_capacity);
+    for (auto& buffer : buffers_) buffer.assign(capacity_, 0);
+  }
+
+  void set_palette(const std::uint8_t* palette) {
+    palette_ = palette;
+    ++palette_generation_;
+  }
+
+  bool can_submit() const override {
+    const std::uint64_t now = clock_.now_ns();
+    std::size_t in_flight = 0;
+    for (const Transfer& transfer : transfers_) {
+      if (transfer.end_ns > now) ++in_flight;
+    }
+    return in_flight < 2;
+  }
+
+  SubmitResult submit(const std::uint8_t* pixels,
+                      std::size_t bytes,
+                      std::uint8_t strip_count,
+                      std::uint16_t leds_per_strip,
+                      std::uint8_t brightness,
+                      std::uint32_t sequence,
+                      PixelSpan dirty_columns,
+                      const FrameBlend* blend,
+                      PixelFormat format) override {
+    if (blend != nullptr) return SubmitResult::Failed;
+    const bool indexed = format == PixelFormat::Indexed;
+    if (indexed && palette_ == nullptr) return SubmitResult::Failed;
+    const Contents wanted{true, strip_count, leds_per_strip, brightness,
+                          indexed ? palette_generation_ : 0U};
+    for (auto& stale : stale_columns_) stale.include(dirty_columns);
+
+    const std::uint8_t index = next_buffer_;
+    const std::uint8_t newest = index ^ 1U;
+    if (stale_columns_[newest].empty() && contents_[newest] == wanted) {
+      last_encode_us_ = 0;
+      return SubmitResult::Unchanged;
+    }
+    if (!can_submit()) return SubmitResult::Failed;
+
+    PixelSpan span = stale_columns_[index];
+    std::uint8_t* output = buffers_[index].data();
+    const std::uint64_t encode_started = host_ns();
+    bool prepared = true;
+    if (!(contents_[index] == wanted)) {
+      span = PixelSpan::all();
+      if (contents_[index].strip_count != strip_count ||
+          contents_[index].leds_per_strip != leds_per_strip || !contents_[index].valid) {
+        prepared = initialize_parallel_grb_waveform(
+            strip_count, leds_per_strip, output, capacity_);
+      }
+    }
+    span = span.clamped(leds_per_strip);
+    if (kernels_.strip_count != strip_count) {
+      kernels_ = select_parallel_encode_kernels(strip_count, true);
+    }
+    EncodeResult encoded{};
+    if (prepared && indexed) {
+      if (rows_brightness_ != brightness || rows_generation_ != palette_generation_) {
+        build_palette_expand_rows(
+            nullptr, true, palette_, brightness, strip_count, palette_rows_.data());
+        rows_brightness_ = brightness;
+        rows_generation_ = palette_generation_;
+      }
+      encoded = encode_parallel_grb_indexed_span(
+          kernels_, palette_rows_.data(), pixels, bytes, strip_count, leds_per_strip,
+          span.begin, span.end, output, capacity_);
+    } else if (prepared) {
+      if (!tables_valid_ || tables_brightness_ != brightness) {
+        build_uniform_expand_table(nullptr, brightness, &tables_);
+        tables_brightness_ = brightness;
+        tables_valid_ = true;
+      }
+      encoded = encode_parallel_grb_kernel_span(
+          kernels_, tables_, nullptr, pixels, bytes, strip_count, leds_per_strip,
+          kBlendWeightMax, span.begin, span.end, output, capacity_);
+    }
+    const std::uint64_t encode_ns = host_ns() - encode_started;
+    encode_host_ns_ += encode_ns;
+    ++encodes_;
+    last_encode_us_ = static_cast<std::uint16_t>(std::min<double>(
+        UINT16_MAX, static_cast<double>(encode_ns) * clock_.cpu_scale() / 1000.0));
+    if (!encoded.ok) {
+      contents_[index].valid = false;
+      return SubmitResult::Failed;
+    }
+    contents_[index] = wanted;
+    stale_columns_[index].clear();
+    next_buffer_ = newest;
+
+    const std::uint64_t now = clock_.now_ns();
+    const std::uint64_t start =
+        transfers_.empty() ? now : std::max(now, transfers_.back().end_ns);
+    const std::uint64_t samples = ws2812_encoded_size(leds_per_strip);
+    transfers_.push_back(
+        {sequence, start, start + samples * 1000000000ULL / kWs2812SampleRateHz});
+    return SubmitResult::Queued;
+  }
+
+  bool take_completion(TransferCompletion* completion) override {
+    if (transfers_.empty() || transfers_.front().end_ns > clock_.now_ns()) return false;
+    const Transfer& transfer = transfers_.front();
+    completion->sequence = transfer.sequence;
+    completion->started_us = static_cast<std::uint32_t>(transfer.start_ns / 1000U);
+    completion->completed_us = static_cast<std::uint32_t>(transfer.end_ns / 1000U);
+    last_end_ns_ = transfer.end_ns;
+    transfers_.pop_front();
+    return true;
+  }
+
+  std::uint16_t last_encode_us() const override { return last_encode_us_; }
+
+  std::uint64_t next_completion_ns() const {
+    return transfers_.empty() ? kNoEvent : transfers_.front().end_ns;
+  }
+  std::uint64_t last_end_ns() const { return last_end_ns_; }
+  std::size_t encodes() const { return encodes_; }
+  std::uint64_t encode_host_ns() const { return encode_host_ns_; }
+
+ private:
+  struct Contents {
+    bool valid = false;
+    std::uint8_t strip_count = 0;
+    std::uint16_t leds_per_strip = 0;
+    std::uint8_t brightness = 0;
+    std::uint32_t palette = 0;
+
+    bool operator==(const Contents& other) const {
+      return valid && other.valid && strip_count == other.strip_count &&
+             leds_per_strip == other.leds_per_strip &&
+             brightness == other.brightness && palette == other.palette;
+    }
+  };
+
+  struct Transfer {
+    std::uint32_t sequence = 0;
+    std::uint64_t start_ns = 0;
+    std::uint64_t end_ns = 0;
+  };
+
+  SimClock& clock_;
+  std::size_t capacity_ = 0;
+  std::vector<std::uint8_t> buffers_[2];
+  PixelSpan stale_columns_[2] = {PixelSpan::all(), PixelSpan::all()};
+  Contents contents_[2];
+  std::uint8_t next_buffer_ = 0;
+  std::deque<Transfer> transfers_;
+
+  ParallelEncodeKernels kernels_;
+  std::unique_ptr<UniformExpandTableStorage> tables_storage_{
+      new UniformExpandTableStorage()};
+  ParallelExpandTables tables_ = tables_storage_->tables();
+  bool tables_valid_ = false;
+  std::uint8_t tables_brightness_ = 0;
+  const std::uint8_t* palette_ = nullptr;
+  std::uint32_t palette_generation_ = 1;
+  std::vector<PaletteExpandRow> palette_rows_;
+  int rows_brightness_ = -1;
+  std::uint32_t rows_generation_ = 0;
+
+  std::uint16_t last_encode_us_ = 0;
+  std::uint64_t last_end_ns_ = 0;
+  std::size_t encodes_ = 0;
+  std::uint64_t encode_host_ns_ = 0;
+};
+
+// The SPI slave rings: each link has ring_depth receive transactions armed,
+// and a transfer that completes with none armed is lost, as on the device.
+class ReplayTransport final : public PacketTransport {
+ public:
+  ReplayTransport(SimClock& clock,
+                  const ReceiverSimConfig& config,
+                  const std::vector<SimPacket>& packets,
+                  std::size_t buffer_bytes)
+      : clock_(clock),
+        packets_(packets),
+        ring_depth_(std::max<std::size_t>(config.ring_depth, 1)),
+        buffer_bytes_(buffer_bytes) {
+    arrivals_.reserve(packets.size());
+    std::uint64_t link_free[2] = {0, 0};
+    const std::uint64_t first = packets.empty() ? 0 : packets.front().start_ns;
+    const double scale = config.rate_scale > 0 ? config.rate_scale : 1.0;
+    for (std::size_t i = 0; i < packets.size(); ++i) {
+      const SimPacket& packet = packets[i];
+      const std::uint64_t started =
+          config.packets_per_s > 0
+              ? static_cast<std::uint64_t>(static_cast<double>(i) * 1e9 /
+                                           config.packets_per_s)
+              : static_cast<std::uint64_t>(
+                    static_cast<double>(packet.start_ns - first) / scale);
+      std::uint64_t& link = link_free[packet.link != 0 ? 1 : 0];
+      const std::uint64_t wire_ns =
+          static_cast<std::uint64_t>(packet.bytes.size()) * 8U * 1000000000ULL /
+          std::max<std::uint32_t>(config.spi_hz, 1);
+      link = std::max(started, link) + wire_ns;
+      arrivals_.push_back(link);
+    }
+    // The two links complete independently, so arrivals interleave.
+    order_.resize(packets.size());
+    for (std::size_t i = 0; i < order_.size(); ++i) order_[i] = i;
+    std::stable_sort(order_.begin(), order_.end(), [this](std::size_t a, std::size_t b) {
+      return arrivals_[a] < arrivals_[b];
+    });
+  }
+
+  bool receive(ReceivedPacket* packet) override {
+    admit(clock_.now_ns());
+    if (pending_.empty()) return false;
+    const std::size_t index = pending_.front();
+    pending_.pop_front();
+    --pending_per_link_[link_of(index)];
+
+    std::uint8_t* buffer = take_buffer();
+    const std::vector<std::uint8_t>& bytes = packets_[index].bytes;
+    std::memcpy(buffer, bytes.data(), std::min(bytes.size(), buffer_bytes_));
+    packet->data = buffer;
+    packet->bytes = std::min(bytes.size(), buffer_bytes_);
+    packet->received_us = static_cast<std::uint32_t>(arrivals_[index] / 1000U);
+    return true;
+  }
+
+  void finish(std::uint8_t* buffer, bool /*valid*/) override { free_.push_back(buffer); }
+
+  // When the receive side next has work: now for packets already waiting.
+  std::uint64_t next_arrival_ns() const {
+    if (!pending_.empty()) return 0;
+    return next_ < order_.size() ? arrivals_[order_[next_]] : kNoEvent;
+  }
+  std::size_t overruns() const { return overruns_; }
+
+ private:
+  std::size_t link_of(std::size_t index) const {
+    return packets_[index].link != 0 ? 1U : 0U;
+  }
+
+  void admit(std::uint64_t now) {
+    while (next_ < order_.size() && arrivals_[order_[next_]] <= now) {
+      const std::size_t index = order_[next_++];
+      std::size_t& waiting = pending_per_link_[link_of(index)];
+      if (waiting >= ring_depth_) {
+        ++overruns_;
+        continue;
+      }
+      ++waiting;
+      pending_.push_back(index);
+    }
+  }
+
+  std::uint8_t* take_buffer() {
+    if (free_.empty()) {
+      storage_.emplace_back(buffer_bytes_, 0);
+      return storage_.back().data();
+    }
+    std::uint8_t* buffer = free_.back();
+    free_.pop_back();
+    return buffer;
+  }
+
+  SimClock& clock_;
+  const std::vector<SimPacket>& packets_;
+  std::size_t ring_depth_;
+  std::size_t buffer_bytes_;
+  std::vector<std::uint64_t> arrivals_;
+  std::vector<std::size_t> order_;
+  std::size_t next_ = 0;
+  std::deque<std::size_t> pending_;
+  std::size_t pending_per_link_[2] = {0, 0};
+  std::size_t overruns_ = 0;
+  std::deque<std::vector<std::uint8_t>> storage_;
+  std::vector<std::uint8_t*> free_;
+};
+
+// What the firmware around the core does, reduced to what shapes throughput:
+// CONFIG within the frame capacity and the display's palette. Everything
+// else is counted and ignored.
+class SimHooks final : public ReceiverHooks {
+ public:
+  SimHooks(SimClock& clock,
+           SimulatedDisplay& display,
+           const ReceiverSimConfig& config,
+           std::size_t buffer_bytes)
+      : clock_(clock), display_(display), config_(config), buffer_bytes_(buffer_bytes) {}
+
+  void attach(ReceiverCore* receiver) { receiver_ = receiver; }
+
+  void run_command(std::uint8_t* data, std::size_t length) override {
+    if (data[0] == kCmdConfig && length >= 4 && length <= 5) {
+      const std::uint8_t strips = data[1];
+      const std::uint16_t leds = (static_cast<std::uint16_t>(data[2]) << 8) | data[3];
+      if (strips == config_.strip_count && leds != 0 && leds <= config_.led_capacity &&
+          leds != receiver_->leds_per_strip()) {
+        receiver_->set_geometry(strips, leds);
+      }
+      return;
+    }
+    ++other_commands_;
+  }
+
+  void frame_published() override {
+    published_ns_ = clock_.now_ns();
+    if (notified_ns_ == kNoEvent) notified_ns_ = published_ns_;
+  }
+
+  void palette_changed(const std::uint8_t* palette) override {
+    display_.set_palette(palette);
+  }
+
+  std::uint8_t* allocate_packet_buffer() override {
+    assembly_.assign(buffer_bytes_, 0);
+    return assembly_.data();
+  }
+
+  // When the display task was last woken for a new frame, or kNoEvent.
+  std::uint64_t notified_ns() const { return notified_ns_; }
+  void clear_notification() { notified_ns_ = kNoEvent; }
+  std::uint64_t published_ns() const { return published_ns_; }
+  std::size_t other_commands() const { return other_commands_; }
+
+ private:
+  SimClock& clock_;
+  SimulatedDisplay& display_;
+  const ReceiverSimConfig& config_;
+  std::size_t buffer_bytes_;
+  ReceiverCore* receiver_ = nullptr;
+  std::vector<std::uint8_t> assembly_;
+  std::uint64_t notified_ns_ = kNoEvent;
+  std::uint64_t published_ns_ = 0;
+  std::size_t other_commands_ = 0;
+};
+
+std::uint32_t bucket_upper_us(std::size_t bucket) {
+  return bucket == 0 ? 0U : (1U << bucket) - 1U;
+}
+
+ReceiverSimStageLatency summarize(const LatencySnapshot& snapshot) {
+  ReceiverSimStageLatency latency;
+  latency.max_us = snapshot.max_us;
+  std::uint64_t total = 0;
+  for (std::uint32_t count : snapshot.buckets) total += count;
+  if (total == 0) return latency;
+  std::uint64_t seen = 0;
+  bool have_p50 = false;
+  for (std::size_t bucket = 0; bucket < kLatencyBuckets; ++bucket) {
+    seen += snapshot.buckets[bucket];
+    const std::uint32_t upper =
+        std::min(bucket_upper_us(bucket), snapshot.max_us);
+    if (!have_p50 && seen * 2U >= total) {
+      latency.p50_us = upper;
+      have_p50 = true;
+    }
+    if (seen * 100U >= total * 99U) {
+      latency.p99_us = upper;
+      break;
+    }
+  }
+  return latency;
+}
+
+}  // namespace
+
+bool load_spi_capture(const std::string& path, std::vector<SimPacket>* packets) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) return false;
+  const std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(file)),
+                                       std::istreambuf_iterator<char>());
+  if (data.size() < kSpiCaptureMagicBytes ||
+      std::memcmp(data.data(), kSpiCaptureMagic, kSpiCaptureMagicBytes) != 0) {
+    return false;
+  }
+  packets->clear();
+  std::size_t offset = kSpiCaptureMagicBytes;
+  std::uint64_t wraps = 0;
+  std::uint32_t previous_us = 0;
+  constexpr std::size_t kRecordHeaderBytes = 9;
+  while (offset < data.size()) {
+    if (data.size() - offset < kRecordHeaderBytes) return false;
+    const std::uint32_t start_us = read_u32(&data[offset]);
+    const std::uint8_t link = data[offset + 4];
+    const std::uint32_t length = read_u32(&data[offset + 5]);
+    offset += kRecordHeaderBytes;
+    if (data.size() - offset < length) return false;
+    if (start_us < previous_us) wraps += 1ULL << 32;
+    previous_us = start_us;
+
+    SimPacket packet;
+    packet.start_ns = (wraps + start_us) * 1000U;
+    packet.link = link;
+    packet.bytes.assign(data.begin() + offset, data.begin() + offset + length);
+    packets->push_back(std::move(packet));
+    offset += length;
+  }
+  return true;
+}
+
+std::vector<SimPacket> synthesize_frames(const ReceiverSimConfig& config,
+                                         std::size_t frame_count) {
+  const std::size_t pixels =
+      static_cast<std::size_t>(config.strip_count) * config.leds_per_strip;
+  std::vector<SimPacket> packets(frame_count);
+  for (std::size_t frame = 0; frame < frame_count; ++frame) {
+    std::vector<std::uint8_t>& bytes = packets[frame].bytes;
+    bytes.resize(kFramePixelOffset + pixels * 3U + kPacketCrcBytes);
+    bytes[0] = kCmdSetAll;
+    for (std::size_t pixel = 0; pixel < pixels; ++pixel) {
+      const std::size_t column = pixel % config.leds_per_strip;
+      std::uint8_t* rgb = &bytes[kFramePixelOffset + pixel * 3U];
+      rgb[0] = static_cast<std::uint8_t>(column * 4U + frame);
+      rgb[1] = static_cast<std::uint8_t>(pixel + frame * 3U);
+      rgb[2] = static_cast<std::uint8_t>(255U - rgb[0]);
+    }
+    const std::size_t payload = bytes.size() - kPacketCrcBytes;
+    const std::uint16_t crc = crc16_ccitt(kSimCrcEngine, bytes.data(), payload);
+    bytes[payload] = static_cast<std::uint8_t>(crc >> 8);
+    bytes[payload + 1] = static_cast<std::uint8_t>(crc);
+  }
+  return packets;
+}
+
+double ReceiverSimResult::packets_per_s() const {
+  return duration_ns != 0 ? packets * 1e9 / static_cast<double>(duration_ns) : 0;
+}
+
+double ReceiverSimResult::displayed_fps() const {
+  return duration_ns != 0 ? frames.displayed * 1e9 / static_cast<double>(duration_ns)
+                          : 0;
+}
+
+ReceiverSimResult run_receiver_sim(const ReceiverSimConfig& config,
+                                   const std::vector<SimPacket>& packets) {
+  const std::size_t frame_bytes =
+      static_cast<std::size_t>(config.strip_count) * config.led_capacity * 3U;
+  std::size_t buffer_bytes = kFramePixelOffset + frame_bytes + kPacketCrcBytes;
+  for (const SimPacket& packet : packets) {
+    buffer_bytes = std::max(buffer_bytes, packet.bytes.size());
+  }
+
+  std::vector<std::uint8_t> working(frame_bytes, 0);
+  std::vector<std::uint8_t> mailbox[kFrameMailboxSlots];
+  ReceiverBuffers buffers;
+  buffers.zero_copy_mailbox = config.zero_copy_mailbox;
+  buffers.working_frame = working.data();
+  buffers.frame_bytes = frame_bytes;
+  for (std::size_t slot = 0; slot < kFrameMailboxSlots; ++slot) {
+    mailbox[slot].assign(
+        config.zero_copy_mailbox ? buffer_bytes : kFramePixelOffset + frame_bytes, 0);
+    buffers.mailbox[slot] = mailbox[slot].data();
+  }
+
+  SimClock clock(config.cpu_scale);
+  SimulatedDisplay display(clock, config.strip_count, config.led_capacity);
+  SimHooks hooks(clock, display, config, buffer_bytes);
+  ReceiverCore receiver(clock, display, hooks);
+  hooks.attach(&receiver);
+  ReplayTransport transport(clock, config, packets, buffer_bytes);
+
+  clock.begin_step(0);
+  receiver.begin(buffers, config.strip_count,
+                 std::min(config.leds_per_strip, config.led_capacity), kSimCrcEngine);
+  receiver.publish_working_frame();
+
+  ReceiverSimResult result;
+  result.packets = packets.size();
+  // Each side runs on its own core and is busy until its last step ends.
+  std::uint64_t receive_free = 0;
+  std::uint64_t display_free = 0;
+  while (true) {
+    const std::uint64_t arrival = transport.next_arrival_ns();
+    const std::uint64_t receive_at =
+        arrival == kNoEvent ? kNoEvent : std::max(receive_free, arrival);
+    const std::uint64_t wake = std::min(hooks.notified_ns(), display.next_completion_ns());
+    const std::uint64_t display_at =
+        wake == kNoEvent ? kNoEvent : std::max(display_free, wake);
+    if (receive_at == kNoEvent && display_at == kNoEvent) break;
+
+    if (receive_at <= display_at) {
+      clock.begin_step(receive_at);
+      const std::uint64_t started = host_ns();
+      result.handled += receiver.service_transport(transport);
+      result.receive_ns += host_ns() - started;
+      receive_free = clock.end_step();
+    } else {
+      // Steps run one after another, so a receive step that began earlier may
+      // have published past display_at; the display cannot take a frame
+      // before it exists.
+      clock.begin_step(std::max(display_at, hooks.published_ns()));
+      hooks.clear_notification();
+      const std::uint64_t started = host_ns();
+      receiver.service_display();
+      result.display_ns += host_ns() - started;
+      display_free = clock.end_step();
+    }
+  }
+
+  result.ring_overruns = transport.overruns();
+  result.crc_errors = receiver.crc_errors();
+  result.display_errors = receiver.display_errors();
+  result.frames = receiver.mailbox().counters();
+  result.other_commands = hooks.other_commands();
+  result.encodes = display.encodes();
+  result.encode_ns = display.encode_host_ns();
+  result.duration_ns = std::max({receive_free, display_free, display.last_end_ns()});
+  for (std::size_t stage = 0; stage < kLatencyStageCount; ++stage) {
+    result.stages[stage] = summarize(
+        receiver.histogram(static_cast<LatencyStage>(stage)).snapshot());
+  }
+  return result;
+}
+
+std::string format_receiver_sim_result(const char* name,
+                                       const ReceiverSimConfig& config,
+                                       const ReceiverSimResult& result) {
+  char line[1536];
+  int length = std::snprintf(
+      line, sizeof(line),
+      "{\"suite\":\"ledgrid-receiver-sim\",\"platform\":\"native\",\"case\":\"%s\","
+      "\"strips\":%u,\"leds\":%u,\"zero_copy\":%s,\"cpu_scale\":%.2f,"
+      "\"packets\":%zu,\"handled\":%zu,\"ring_overruns\":%zu,\"crc_errors\":%u,"
+      "\"display_errors\":%u,\"other_commands\":%zu,\"accepted\":%u,"
+      "\"displayed\":%u,\"superseded\":%u,\"publish_drops\":%u,"
+      "\"duration_s\":%.4f,\"packets_per_s\":%.1f,\"displayed_fps\":%.1f,"
+      "\"receive_ns_per_packet\":%.1f,\"encode_ns_per_frame\":%.1f",
+      name, static_cast<unsigned>(config.strip_count),
+      static_cast<unsigned>(config.leds_per_strip),
+      config.zero_copy_mailbox ? "true" : "false", config.cpu_scale, result.packets,
+      result.handled, result.ring_overruns, static_cast<unsigned>(result.crc_errors),
+      static_cast<unsigned>(result.display_errors), result.other_commands,
+      static_cast<unsigned>(result.frames.accepted),
+      static_cast<unsigned>(result.frames.displayed),
+      static_cast<unsigned>(result.frames.superseded),
+      static_cast<unsigned>(result.frames.publish_drops),
+      static_cast<double>(result.duration_ns) / 1e9, result.packets_per_s(),
+      result.displayed_fps(),
+      result.handled != 0 ? static_cast<double>(result.receive_ns) / result.handled : 0.0,
+      result.encodes != 0 ? static_cast<double>(result.encode_ns) / result.encodes : 0.0);
+  for (std::size_t stage = 0; stage < kLatencyStageCount && length > 0 &&
+                              static_cast<std::size_t>(length) < sizeof(line);
+       ++stage) {
+    char key[32];
+    std::snprintf(key, sizeof(key), "%s",
+                  latency_stage_name(static_cast<LatencyStage>(stage)));
+    for (char* c = key; *c != '\0'; ++c) {
+      if (*c == '-') *c = '_';
+    }
+    const ReceiverSimStageLatency& latency = result.stages[stage];
+    length += std::snprintf(
+        line + length, sizeof(line) - length,
+        ",\"%s_p50_us\":%u,\"%s_p99_us\":%u,\"%s_max_us\":%u", key,
+        static_cast<unsigned>(latency.p50_us), key,
+        static_cast<unsigned>(latency.p99_us), key,
+        static_cast<unsigned>(latency.max_us));
+  }
+  if (length > 0 && static_cast<std::size_t>(length) + 1U < sizeof(line)) {
+    line[length] = '}';
+    line[length + 1] = '\0';
+  }
+  return line;
+}
+
+}  // namespace ledgrid
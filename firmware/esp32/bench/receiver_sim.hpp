@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ledgrid/frame_mailbox.hpp"
+#include "ledgrid/latency_histogram.hpp"
+#include "ledgrid/ws2812_encoder.hpp"
+
+namespace ledgrid {
+
+// One SPI transfer as the host started it: capture time, link and the bytes
+// clocked out, CRC included.
+struct SimPacket {
+  std::uint64_t start_ns = 0;
+  std::uint8_t link = 0;
+  std::vector<std::uint8_t> bytes;
+};
+
+// Captures written by the host's --capture-spi: the magic "LGSPICAP", then
+// one record per transfer of start time in microseconds since the capture
+// began (u32, wraps), link (u8), length (u32) and the bytes, big-endian like
+// the wire protocol. False if the file is missing or malformed.
+constexpr char kSpiCaptureMagic[] = "LGSPICAP";
+constexpr std::size_t kSpiCaptureMagicBytes = 8;
+bool load_spi_capture(const std::string& path, std::vector<SimPacket>* packets);
+
+struct ReceiverSimConfig {
+  std::uint8_t strip_count = kMaxParallelStrips;
+  std::uint16_t leds_per_strip = 138;
+  // Frame capacity, as CONFIG may grow the geometry in a capture.
+  std::uint16_t led_capacity = 600;
+  bool zero_copy_mailbox = true;
+  // Receive transactions armed per link; see LEDGRID_SPI_QUEUE_DEPTH.
+  std::size_t ring_depth = 4;
+  // Clock rate each transfer takes to clock out, at least.
+  std::uint32_t spi_hz = 20000000;
+  // Replays the capture this many times faster, or starts one transfer every
+  // 1 / packets_per_s seconds when that is set.
+  double rate_scale = 1.0;
+  double packets_per_s = 0;
+  // Virtual time charged per nanosecond the core spends on the host, so the
+  // receiver's own cost shapes the run. Zero makes a run deterministic.
+  double cpu_scale = 1.0;
+};
+
+// SET_ALL frames of a scrolling gradient, every pixel changing each frame.
+// All start at once, so the link paces them unless packets_per_s is set.
+std::vector<SimPacket> synthesize_frames(const ReceiverSimConfig& config,
+                                         std::size_t frame_count);
+
+struct ReceiverSimStageLatency {
+  // Upper bounds of the histogram buckets holding each percentile.
+  std::uint32_t p50_us = 0;
+  std::uint32_t p99_us = 0;
+  std::uint32_t max_us = 0;
+};
+
+struct ReceiverSimResult {
+  std::size_t packets = 0;
+  std::size_t handled = 0;
+  // Transfers that completed with no receive transaction armed.
+  std::size_t ring_overruns = 0;
+  std::uint32_t crc_errors = 0;
+  std::uint32_t display_errors = 0;
+  // Commands the simulator leaves to firmware it does not model.
+  std::size_t other_commands = 0;
+  FrameMailboxCounters frames{};
+  std::size_t encodes = 0;
+  std::uint64_t duration_ns = 0;
+  // Host time spent in the core's receive and display sides and in encoding.
+  std::uint64_t receive_ns = 0;
+  std::uint64_t display_ns = 0;
+  std::uint64_t encode_ns = 0;
+  ReceiverSimStageLatency stages[kLatencyStageCount];
+
+  double packets_per_s() const;
+  double displayed_fps() const;
+};
+
+// Replays `packets` through the receiver core, a modelled SPI ring per link
+// and a modelled pipelined display with two DMA buffers on a virtual clock.
+// Transfers take their bytes * 8 / spi_hz on the wire and frames
+// leds_per_strip * 30 us plus the reset; the receive and display sides run
+// on separate cores as on the device.
+ReceiverSimResult run_receiver_sim(const ReceiverSimConfig& config,
+                                   const std::vector<SimPacket>& packets);
+
+// One JSON object, {"suite":"ledgrid-receiver-sim","case":...}, for
+// tools/benchmarks/receiver_sim.py.
+std::string format_receiver_sim_result(const char* name,
+                                       const ReceiverSimConfig& config,
+                                       const ReceiverSimResult& result);
+
+}  // namespace ledgrid
@@ -0,0 +1,87 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "receiver_sim.hpp"
+
+namespace {
+
+void usage() {
+  std::fprintf(stderr,
+               "usage: receiver_sim [--capture PATH] [--strips N] [--leds N]\n"
+               "  [--frames N] [--packets-per-s N] [--rate-scale X] [--spi-hz N]\n"
+               "  [--ring-depth N] [--cpu-scale X] [--copy-mailbox] [--label NAME]\n");
+}
+
+}  // namespace
+
+// Replays a host capture, or synthetic full frames, through the receiver
+// core and prints one JSON result line.
+int main(int argc, char** argv) {
+  ledgrid::ReceiverSimConfig config;
+  std::string capture;
+  std::string label;
+  std::size_t frames = 600;
+  for (int i = 1; i < argc; ++i) {
+    const char* flag = argv[i];
+    if (std::strcmp(flag, "--copy-mailbox") == 0) {
+      config.zero_copy_mailbox = false;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      usage();
+      return 2;
+    }
+    const char* value = argv[++i];
+    if (std::strcmp(flag, "--capture") == 0) {
+      capture = value;
+    } else if (std::strcmp(flag, "--strips") == 0) {
+      config.strip_count = static_cast<std::uint8_t>(std::atoi(value));
+    } else if (std::strcmp(flag, "--leds") == 0) {
+      config.leds_per_strip = static_cast<std::uint16_t>(std::atoi(value));
+    } else if (std::strcmp(flag, "--frames") == 0) {
+      frames = static_cast<std::size_t>(std::atol(value));
+    } else if (std::strcmp(flag, "--packets-per-s") == 0) {
+      config.packets_per_s = std::atof(value);
+    } else if (std::strcmp(flag, "--rate-scale") == 0) {
+      config.rate_scale = std::atof(value);
+    } else if (std::strcmp(flag, "--spi-hz") == 0) {
+      config.spi_hz = static_cast<std::uint32_t>(std::atol(value));
+    } else if (std::strcmp(flag, "--ring-depth") == 0) {
+      config.ring_depth = static_cast<std::size_t>(std::atol(value));
+    } else if (std::strcmp(flag, "--cpu-scale") == 0) {
+      config.cpu_scale = std::atof(value);
+    } else if (std::strcmp(flag, "--label") == 0) {
+      label = value;
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (config.strip_count == 0 || config.strip_count > ledgrid::kMaxParallelStrips ||
+      config.leds_per_strip == 0) {
+    usage();
+    return 2;
+  }
+  if (config.leds_per_strip > config.led_capacity) {
+    config.led_capacity = config.leds_per_strip;
+  }
+
+  std::vector<ledgrid::SimPacket> packets;
+  if (capture.empty()) {
+    packets = ledgrid::synthesize_frames(config, frames);
+    if (label.empty()) label = "synthetic-set-all";
+  } else {
+    if (!ledgrid::load_spi_capture(capture, &packets)) {
+      std::fprintf(stderr, "receiver_sim: cannot read capture %s\n", capture.c_str());
+      return 1;
+    }
+    if (label.empty()) label = "capture";
+  }
+
+  const ledgrid::ReceiverSimResult result = ledgrid::run_receiver_sim(config, packets);
+  std::puts(ledgrid::format_receiver_sim_result(label.c_str(), config, result).c_str());
+  return 0;
+}
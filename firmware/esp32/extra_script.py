@@ -6,3 +6,47 @@ if os.environ.get("RAINBOW") == "1":
 
 if os.environ.get("DEBUG") == "1":
     env.Append(CPPDEFINES=[("DEBUG_LOGGING", 1)])
+
+if os.environ.get("SERIAL_DISPLAY") == "1":
+    env.Append(CPPDEFINES=[("LEDGRID_PIPELINED_DISPLAY", 0)])
+
+if os.environ.get("STREAM") == "1":
+    env.Append(CPPDEFINES=[("LEDGRID_STREAMING_DISPLAY", 1)])
+
+lanes = os.environ.get("LANES", "")
+if lanes:
+    if lanes not in ("8", "16"):
+        raise ValueError("LANES must be 8 or 16")
+    env.Append(CPPDEFINES=[("LEDGRID_MAX_LANES", int(lanes))])
+
+spi_queue = os.environ.get("SPI_QUEUE", "")
+if spi_queue:
+    if not spi_queue.isdigit() or not 2 <= int(spi_queue) <= 16:
+        raise ValueError("SPI_QUEUE must be 2..16")
+    env.Append(CPPDEFINES=[("LEDGRID_SPI_QUEUE_DEPTH", int(spi_queue))])
+
+if os.environ.get("DUAL_SPI") == "1":
+    env.Append(CPPDEFINES=[("LEDGRID_DUAL_SPI", 1)])
+
+if os.environ.get("DUAL_CORE_ENCODE") == "1":
+    env.Append(CPPDEFINES=[("LEDGRID_DUAL_CORE_ENCODE", 1)])
+
+clip_kb = os.environ.get("CLIP_KB", "")
+if clip_kb:
+    if not clip_kb.isdigit():
+        raise ValueError("CLIP_KB must be a size in KiB")
+    env.Append(CPPDEFINES=[("LEDGRID_CLIP_STORE_KB", int(clip_kb))])
+
+crc_engines = {"nibble": "Nibble", "slice8": "Slice8", "rom": "Rom"}
+crc_engine = os.environ.get("CRC", "").lower()
+if crc_engine:
+    if crc_engine not in crc_engines:
+        raise ValueError(f"CRC must be one of {', '.join(crc_engines)}")
+    env.Append(CPPDEFINES=[("LEDGRID_CRC_ENGINE", crc_engines[crc_engine])])
+
+encoder_kernels = {"table": "Table", "transpose": "Transpose"}
+encoder_kernel = os.environ.get("ENCODER", "").lower()
+if encoder_kernel:
+    if encoder_kernel not in encoder_kernels:
+        raise ValueError(f"ENCODER must be one of {', '.join(encoder_kernels)}")
+    env.Append(CPPDEFINES=[("LEDGRID_ENCODER_KERNEL", encoder_kernels[encoder_kernel])])
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ledgrid {
+
+// Heads every clip store entry; the pixels follow it.
+struct ClipFrameHeader {
+  // Recorder entries: the displayed sequence and when it was put up.
+  std::uint32_t sequence = 0;
+  std::uint32_t shown_us = 0;
+  // Pixel bytes held; 0 marks an empty entry.
+  std::uint32_t byte_count = 0;
+  // Clip entries: how long the frame stays up, in milliseconds.
+  std::uint16_t duration_ms = 0;
+  std::uint8_t flags = 0;
+  std::uint8_t reserved = 0;
+};
+static_assert(sizeof(ClipFrameHeader) == 16, "clip entries assume a 16-byte header");
+
+// The entry holds one palette index per pixel rather than RGB.
+constexpr std::uint8_t kClipFrameIndexed = 0x01;
+
+enum class ClipStoreMode : std::uint8_t {
+  // Entries are clip frames uploaded by the host.
+  Clips,
+  // Entries are a ring of the most recently displayed frames.
+  Recorder,
+};
+
+// Frame-sized entries over caller-owned storage, usually PSRAM. The same
+// entries either hold uploaded clip frames or act as a flight recorder of
+// displayed frames; switching between the two forgets every entry. Frames
+// are stored as the display consumes them, so a clip frame can be handed to
+// the display pipeline in place.
+class ClipStore {
+ public:
+  void attach(std::uint8_t* storage, std::size_t bytes);
+  // Lays the storage out for frames of up to `frame_bytes` and forgets every
+  // entry, returning to clip mode.
+  void configure(std::size_t frame_bytes);
+
+  std::uint16_t capacity() const { return capacity_; }
+  std::size_t frame_bytes() const { return frame_bytes_; }
+  ClipStoreMode mode() const { return mode_; }
+
+  // Copies `length` bytes at byte `offset` into clip frame `index`. A write
+  // at offset 0 starts the frame: the rest of it is cleared and its duration
+  // set, so a frame sent in several slices never shows an older frame's
+  // tail. A recording is discarded first. False when out of bounds.
+  bool write_frame(
+      std::uint16_t index,
+      std::uint16_t duration_ms,
+      std::size_t offset,
+      const std::uint8_t* data,
+      std::size_t length);
+
+  // Clip frame `index`, or nullptr when it is empty or the store records.
+  const ClipFrameHeader* frame(std::uint16_t index) const;
+  const std::uint8_t* pixels(std::uint16_t index) const;
+  // True when frames first..first+count-1 are all present.
+  bool holds_clip(std::uint16_t first, std::uint16_t count) const;
+  // True when `pixels` points into the storage.
+  bool contains(const void* pixels) const;
+
+  // Discards every entry and switches to recording.
+  void start_recording();
+  // Appends a displayed frame, overwriting the oldest once full. Frames
+  // larger than an entry are skipped; returns false for those.
+  bool record(
+      const std::uint8_t* pixels,
+      std::size_t bytes,
+      std::uint32_t sequence,
+      std::uint32_t shown_us,
+      bool indexed);
+  std::uint16_t recorded() const { return mode_ == ClipStoreMode::Recorder ? recorded_ : 0; }
+  // The recorded frame `back` frames before the newest, or nullptr.
+  const ClipFrameHeader* recorded_frame(std::uint16_t back) const;
+  const std::uint8_t* recorded_pixels(std::uint16_t back) const;
+
+ private:
+  std::uint8_t* entry(std::uint16_t index) const;
+  ClipFrameHeader* header(std::uint16_t index) const;
+  void clear_entries(ClipStoreMode mode);
+  int recorded_index(std::uint16_t back) const;
+
+  std::uint8_t* storage_ = nullptr;
+  std::size_t storage_bytes_ = 0;
+  std::size_t frame_bytes_ = 0;
+  std::size_t stride_ = 0;
+  std::uint16_t capacity_ = 0;
+  ClipStoreMode mode_ = ClipStoreMode::Clips;
+  // Recorder ring: the entry written next and the entries holding frames.
+  std::uint16_t head_ = 0;
+  std::uint16_t recorded_ = 0;
+};
+
+struct ClipPlayback {
+  std::uint16_t first = 0;
+  std::uint16_t count = 0;
+  // Times through the clip before stopping on its last frame; 0 loops forever.
+  std::uint16_t loops = 0;
+  std::uint16_t current = 0;
+  std::uint16_t loops_done = 0;
+  std::uint32_t frames_played = 0;
+};
+
+// Steps through a clip by each frame's own duration. Due times accumulate
+// from the start, so publishing late does not stretch the loop; a stall
+// longer than a frame restarts the cadence instead of replaying a burst.
+class ClipPlayer {
+ public:
+  // False, leaving playback as it was, unless the store holds every frame.
+  bool start(
+      const ClipStore& store,
+      std::uint16_t first,
+      std::uint16_t count,
+      std::uint16_t loops,
+      std::uint32_t now_us);
+  void stop() { playing_ = false; }
+  bool playing() const { return playing_; }
+
+  // True once playback.current is due to be shown.
+  bool due(std::uint32_t now_us) const;
+  // Microseconds until the current frame is due; 0 when already due.
+  std::uint32_t wait_us(std::uint32_t now_us) const;
+  // Moves on after the current frame has been published. Stops after the
+  // last frame of the final loop, which then stays up.
+  void advance(const ClipStore& store, std::uint32_t now_us);
+
+  const ClipPlayback& playback() const { return playback_; }
+
+ private:
+  ClipPlayback playback_{};
+  std::uint32_t due_us_ = 0;
+  bool playing_ = false;
+};
+
+}  // namespace ledgrid
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ledgrid {
+
+// CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF, no reflection,
+// no final XOR). Every SPI command is followed by this checksum, big-endian.
+enum class Crc16Engine : std::uint8_t {
+  // Reference implementation: two 16-entry table steps per byte.
+  Nibble,
+  // Eight bytes per step through eight 256-entry tables held in DRAM.
+  Slice8,
+  // ESP32-S3 ROM crc16_be(); only available on target builds.
+  Rom,
+};
+
+const char* crc16_engine_name(Crc16Engine engine);
+bool crc16_engine_available(Crc16Engine engine);
+
+std::uint16_t crc16_ccitt_nibble(const std::uint8_t* data, std::size_t length);
+std::uint16_t crc16_ccitt_slice8(const std::uint8_t* data, std::size_t length);
+
+// Falls back to the reference engine when `engine` is not available.
+std::uint16_t crc16_ccitt(
+    Crc16Engine engine, const std::uint8_t* data, std::size_t length);
+
+}  // namespace ledgrid
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ledgrid {
+
+// Procedural effects rendered on the receiver from a few parameters, so the
+// host sends a SET_EFFECT instead of a frame per tick. Every effect is a
+// 256-entry palette indexed by a per-pixel phase and one animation tick.
+enum class EffectKind : std::uint8_t {
+  Off = 0,
+  // AnimatedPaletteField: linear and radial interference, scrolled by the tick.
+  PaletteField = 1,
+  // Three sine terms over x, y and radius, each drifting with the tick.
+  Plasma = 2,
+  // The linear terms only.
+  Gradient = 3,
+};
+
+constexpr std::uint8_t kEffectKindCount = 4;
+constexpr std::size_t kEffectPaletteBytes = 256 * 3;
+// SET_EFFECT payload after the command byte: kind, then eight u16 fields.
+constexpr std::size_t kEffectParamBytes = 17;
+
+// Coordinates are wall columns (strips) and rows (LEDs along a strip), so
+// receivers that each drive a slice of the wall render one continuous field.
+struct EffectParams {
+  EffectKind kind = EffectKind::Off;
+  // Palette steps per second; the frame only changes when the tick does.
+  std::uint16_t ticks_per_second = 100;
+  // Strips across the whole wall, or 0 for this receiver's strip count.
+  std::uint16_t wall_width = 0;
+  // Wall column of this receiver's strip 0.
+  std::uint16_t x_origin = 0;
+  // Phase per column, row and unit of radius, 8.8 fixed point.
+  std::uint16_t x_scale = 13 * 256;
+  std::uint16_t y_scale = 947;
+  std::uint16_t radial_scale = 17 * 256;
+  // Squashes rows before the radius is taken, 8.8 fixed point.
+  std::uint16_t radial_y_scale = 56;
+  // Radial centre as a fraction of the strip length, 0.16 fixed point.
+  std::uint16_t center_y = 34079;
+};
+
+// Big-endian fields in EffectParams order. A lone kind byte is accepted for
+// Off. Returns false, leaving `params` untouched, for unknown kinds or a
+// payload of any other length.
+bool parse_effect_params(
+    const std::uint8_t* payload, std::size_t length, EffectParams* params);
+
+// Fills `phase` (strip_count * leds_per_strip bytes, lane-major) with the
+// static part of each pixel's palette index. Rebuilt only when the
+// parameters or geometry change; rendering a frame is then integer-only.
+void build_effect_phase(
+    const EffectParams& params,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint8_t* phase);
+
+// Unwrapped animation tick `elapsed_ms` after the effect started.
+std::uint32_t effect_tick(const EffectParams& params, std::uint32_t elapsed_ms);
+
+// Renders one lane-major RGB frame at `tick` from a phase table built for the
+// same parameters and geometry.
+void render_effect(
+    const EffectParams& params,
+    const std::uint8_t* phase,
+    const std::uint8_t* palette,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint32_t tick,
+    std::uint8_t* rgb);
+
+// 0..255 over a full turn of `angle`, centred on 128.
+std::uint8_t sin8(std::uint8_t angle);
+
+}  // namespace ledgrid
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ledgrid/crc16.hpp"
+
+namespace ledgrid {
+
+// SET_ALL_PART splits one frame by strips so its parts can travel over
+// separate SPI links at once. Frames are lane-major, so a part is one
+// contiguous byte range: after the command byte come a u16 frame sequence,
+// the first strip and the strip count, then those strips' RGB bytes.
+constexpr std::size_t kFramePartHeaderBytes = 4;
+// Strips a part mask can track.
+constexpr std::uint8_t kMaxFramePartStrips = 16;
+
+// SET_ALL_CHUNKED gives every strip its own CRC-16 so one flipped bit costs
+// a strip rather than the frame, and the host can resend just the strips the
+// receiver still lacks. After the command byte come a u16 frame sequence, a
+// u16 mask of the strips carried and a CRC-16 of those four bytes; then, in
+// strip order, each strip's RGB bytes followed by their CRC-16. There is no
+// CRC over the whole packet, and bytes past the last strip are padding.
+constexpr std::size_t kFrameChunkHeaderBytes = 6;
+constexpr std::size_t kFrameChunkCrcBytes = 2;
+
+// Bytes a full SET_ALL_CHUNKED frame adds to its RGB bytes and command byte.
+constexpr std::size_t frame_chunk_overhead(std::uint8_t strip_count) {
+  return kFrameChunkHeaderBytes + static_cast<std::size_t>(strip_count) * kFrameChunkCrcBytes;
+}
+
+struct FramePart {
+  std::uint16_t sequence = 0;
+  std::uint8_t first_strip = 0;
+  std::uint8_t strip_count = 0;
+  const std::uint8_t* rgb = nullptr;
+  std::size_t rgb_bytes = 0;
+};
+
+// Parses a SET_ALL_PART payload after the command byte. Returns false,
+// leaving `part` untouched, for an empty part, strips beyond `strip_count`,
+// or pixel bytes that are not exactly those strips at `leds_per_strip`.
+bool parse_frame_part(
+    const std::uint8_t* payload,
+    std::size_t length,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    FramePart* part);
+
+struct FrameChunkHeader {
+  std::uint16_t sequence = 0;
+  std::uint16_t strips = 0;
+};
+
+// True when a SET_ALL_CHUNKED payload, after the command byte, is long
+// enough for a header and the header matches its CRC.
+bool frame_chunk_header_intact(
+    Crc16Engine engine, const std::uint8_t* payload, std::size_t length);
+
+// Checks a SET_ALL_CHUNKED header after the command byte: its CRC, a strip
+// mask that is not empty and lies within `strip_count`, and room for those
+// strips at `leds_per_strip`. Returns false, leaving `header` untouched,
+// otherwise.
+bool parse_frame_chunk_header(
+    Crc16Engine engine,
+    const std::uint8_t* payload,
+    std::size_t length,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    FrameChunkHeader* header);
+
+enum class FrameAssembly : std::uint8_t {
+  // Malformed, or outside the configured geometry.
+  Rejected,
+  // Belongs to a frame already completed or abandoned.
+  Stale,
+  // Stored; other strips of the frame are still missing.
+  Pending,
+  // Every strip of the frame has arrived.
+  Complete,
+};
+
+struct FrameAssemblyCounters {
+  std::uint32_t parts = 0;
+  std::uint32_t frames = 0;
+  // Incomplete frames dropped because a newer sequence started.
+  std::uint32_t abandoned = 0;
+  std::uint32_t stale = 0;
+  std::uint32_t rejected = 0;
+  // SET_ALL_CHUNKED strips dropped for a bad CRC, and frames completed after
+  // one of their strips had been dropped.
+  std::uint32_t chunk_crc_errors = 0;
+  std::uint32_t frames_recovered = 0;
+  std::uint16_t last_sequence = 0;
+};
+
+// Gathers the parts of one frame at a time into a caller-owned lane-major RGB
+// buffer. A part with a newer sequence abandons the frame in progress; parts
+// of older sequences, compared modulo 2^16, are dropped so a late part can
+// never tear a newer frame. Each part has passed its own packet CRC, and each
+// chunked strip its own, so a complete frame is exactly what the host sent.
+class FrameAssembler {
+ public:
+  // Copies the part's strips into `rgb` (strip_count * leds_per_strip * 3
+  // bytes). Complete once every strip below `strip_count` has arrived for
+  // one sequence; the caller then publishes `rgb`.
+  FrameAssembly add(
+      const std::uint8_t* payload,
+      std::size_t length,
+      std::uint8_t strip_count,
+      std::uint16_t leds_per_strip,
+      std::uint8_t* rgb);
+
+  // Copies the strips of a SET_ALL_CHUNKED payload whose CRCs match, and
+  // skips the rest; missing() then names the strips to resend under the same
+  // sequence. Rejected only for a bad header.
+  FrameAssembly add_chunked(
+      Crc16Engine engine,
+      const std::uint8_t* payload,
+      std::size_t length,
+      std::uint8_t strip_count,
+      std::uint16_t leds_per_strip,
+      std::uint8_t* rgb);
+
+  // Forgets the frame in progress, for example after a geometry change. The
+  // next part starts a frame whatever its sequence.
+  void reset();
+
+  bool in_progress() const { return received_ != 0; }
+  // The frame being gathered and the strips it still lacks; no strips once it
+  // is complete or before any part has arrived.
+  std::uint16_t sequence() const { return sequence_; }
+  std::uint32_t missing() const;
+  const FrameAssemblyCounters& counters() const { return counters_; }
+
+ private:
+  // False, counting the part stale, when `sequence` belongs to a frame
+  // already completed or abandoned; starts a frame when it is newer.
+  bool begin(std::uint16_t sequence, std::uint8_t strip_count);
+  FrameAssembly store(
+      const FramePart& part,
+      std::uint8_t strip_count,
+      std::uint16_t leds_per_strip,
+      std::uint8_t* rgb);
+
+  FrameAssemblyCounters counters_{};
+  std::uint16_t sequence_ = 0;
+  // Strips of sequence_ received so far, and chunked strips of it dropped.
+  std::uint32_t received_ = 0;
+  std::uint32_t failed_ = 0;
+  std::uint8_t strip_count_ = 0;
+  bool started_ = false;
+  bool completed_ = false;
+};
+
+}  // namespace ledgrid
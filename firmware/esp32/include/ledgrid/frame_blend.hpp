@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ledgrid/pixel_span.hpp"
+
+namespace ledgrid {
+
+enum class TransitionEasing : std::uint8_t {
+  Linear = 0,
+  EaseInOut = 1,
+};
+
+// Blend weight (0..kBlendWeightMax) after `elapsed_us` of a transition lasting
+// `duration_us`. Unknown easings fall back to linear.
+std::uint16_t transition_weight(
+    std::uint32_t elapsed_us,
+    std::uint32_t duration_us,
+    TransitionEasing easing);
+
+// Writes the per-channel blend of `from` and `to` at `weight`, using the same
+// rounding as encode_parallel_grb_blend_span(). `output` may alias `from`.
+void blend_frames(
+    const std::uint8_t* from,
+    const std::uint8_t* to,
+    std::size_t bytes,
+    std::uint16_t weight,
+    std::uint8_t* output);
+
+// Columns in which any lane of two lane-major frames differs; RGB by default,
+// or one palette index per pixel with `bytes_per_pixel` 1.
+PixelSpan changed_columns(
+    const std::uint8_t* a,
+    const std::uint8_t* b,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::size_t bytes_per_pixel = 3);
+
+// Writes the RGB frame a palette-indexed frame stands for. Only needed when
+// RGB commands edit an indexed frame; the encoder reads indices directly.
+void expand_indexed_frame(
+    const std::uint8_t* indices,
+    std::size_t pixels,
+    const std::uint8_t* palette,
+    std::uint8_t* rgb);
+
+}  // namespace ledgrid
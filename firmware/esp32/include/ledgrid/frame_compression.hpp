@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ledgrid/pixel_span.hpp"
+
+namespace ledgrid {
+
+// Compressed frames are a stream of pixel tokens covering the frame exactly:
+//   0x00-0x7F  literal: (header + 1) pixels, three RGB bytes each, follow;
+//   0x80-0xFF  run: (header & 0x7F) + 1 copies of the one RGB pixel that follows.
+// RLE frames carry pixels directly. XOR-delta frames carry the XOR against
+// the previous frame, so unchanged regions become zero runs.
+constexpr std::uint8_t kFrameTokenRunFlag = 0x80;
+constexpr std::size_t kFrameTokenMaxPixels = 128;
+
+// Pixel `rgb` pointers reference the token stream; a run repeats one pixel.
+struct FrameToken {
+  std::size_t first_pixel = 0;
+  std::size_t pixel_count = 0;
+  const std::uint8_t* rgb = nullptr;
+  bool run = false;
+};
+
+// Calls visit(const FrameToken&) for each token in order. Returns false on a
+// truncated stream or one that does not cover exactly `pixel_count` pixels;
+// tokens before the fault have already been visited, so callers that need
+// all-or-nothing behaviour validate first.
+template <typename Visitor>
+bool visit_frame_tokens(
+    const std::uint8_t* input,
+    std::size_t input_bytes,
+    std::size_t pixel_count,
+    Visitor&& visit) {
+  if (input == nullptr) return false;
+  std::size_t offset = 0;
+  FrameToken token{};
+  while (offset < input_bytes) {
+    const std::uint8_t header = input[offset++];
+    token.run = (header & kFrameTokenRunFlag) != 0;
+    token.pixel_count = static_cast<std::size_t>(header & ~kFrameTokenRunFlag) + 1U;
+    const std::size_t payload = token.run ? 3U : token.pixel_count * 3U;
+    if (input_bytes - offset < payload ||
+        pixel_count - token.first_pixel < token.pixel_count) {
+      return false;
+    }
+    token.rgb = input + offset;
+    visit(static_cast<const FrameToken&>(token));
+    offset += payload;
+    token.first_pixel += token.pixel_count;
+  }
+  return token.first_pixel == pixel_count;
+}
+
+bool validate_frame_tokens(
+    const std::uint8_t* input, std::size_t input_bytes, std::size_t pixel_count);
+
+// Both decoders validate before writing, so `frame` is untouched on failure.
+// On success the columns of every token that changed a pixel are folded into
+// `changed` (may be null), using `columns` LEDs per lane.
+bool decode_rle_frame(
+    const std::uint8_t* input,
+    std::size_t input_bytes,
+    std::uint8_t* frame,
+    std::size_t pixel_count,
+    std::uint16_t columns,
+    PixelSpan* changed);
+
+bool apply_xor_delta_frame(
+    const std::uint8_t* input,
+    std::size_t input_bytes,
+    std::uint8_t* frame,
+    std::size_t pixel_count,
+    std::uint16_t columns,
+    PixelSpan* changed);
+
+}  // namespace ledgrid
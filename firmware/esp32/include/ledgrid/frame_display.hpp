@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ledgrid/pixel_span.hpp"
+
+namespace ledgrid {
+
+enum class SubmitResult : std::uint8_t {
+  Failed,
+  Queued,
+  // The frame matches what the newest queued buffer already transmits, so no
+  // encode or DMA was needed.
+  Unchanged,
+};
+
+// Interpolates from an earlier frame while encoding; see
+// encode_parallel_grb_blend_span().
+struct FrameBlend {
+  const std::uint8_t* from = nullptr;
+  std::uint16_t weight = 0;
+};
+
+// What a submitted frame's bytes hold.
+enum class PixelFormat : std::uint8_t {
+  Rgb,
+  // One index per pixel into the palette given to set_palette().
+  Indexed,
+};
+
+struct TransferCompletion {
+  std::uint32_t sequence = 0;
+  std::uint32_t started_us = 0;
+  std::uint32_t completed_us = 0;
+};
+
+// The part of a display the receiver core drives: pipelined submits and the
+// completions they produce. ParallelLedDriver provides it on the device; see
+// its submit() for what the arguments mean. The native simulator has its own.
+class FrameDisplay {
+ public:
+  virtual bool can_submit() const = 0;
+  virtual SubmitResult submit(
+      const std::uint8_t* pixels,
+      std::size_t bytes,
+      std::uint8_t strip_count,
+      std::uint16_t leds_per_strip,
+      std::uint8_t brightness,
+      std::uint32_t sequence,
+      PixelSpan dirty_columns,
+      const FrameBlend* blend,
+      PixelFormat format) = 0;
+  virtual bool take_completion(TransferCompletion* completion) = 0;
+  virtual std::uint16_t last_encode_us() const = 0;
+
+ protected:
+  ~FrameDisplay() = default;
+};
+
+}  // namespace ledgrid
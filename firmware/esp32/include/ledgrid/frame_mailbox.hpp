@@ -1,8 +1,11 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 
+#include "ledgrid/pixel_span.hpp"
+
 namespace ledgrid {
 
 constexpr std::size_t kFrameMailboxSlots = 3;
@@ -13,6 +16,25 @@ struct FrameMetadata {
   std::uint16_t leds_per_strip = 0;
   std::uint8_t strip_count = 0;
   std::uint8_t brightness = 0;
+  // Columns changed relative to the previously published frame. begin_read()
+  // replaces this with the union over every frame since the previous read, so
+  // superseded frames never lose their changes.
+  PixelSpan dirty_columns = PixelSpan::all();
+  // When non-zero the display interpolates to this frame over that many
+  // milliseconds with the given TransitionEasing instead of cutting to it.
+  std::uint16_t transition_ms = 0;
+  std::uint8_t easing = 0;
+  // The frame holds one palette index per pixel rather than RGB, and
+  // byte_count counts indices.
+  bool indexed = false;
+  // Chip-select release of the packet that completed the frame, and the
+  // moment it was published; both esp_timer microseconds.
+  std::uint32_t received_us = 0;
+  std::uint32_t published_us = 0;
+  // Set when the frame is shown in place from storage outside the mailbox,
+  // such as a clip store frame; the slot's own buffer is then unused. The
+  // pixels must stay unchanged until the slot is released.
+  const std::uint8_t* pixels = nullptr;
 };
 
 struct FrameMailboxCounters {
@@ -20,107 +42,297 @@ struct FrameMailboxCounters {
   std::uint32_t displayed = 0;
   std::uint32_t superseded = 0;
   std::uint32_t publish_drops = 0;
+  // Ordered mode only: the oldest queued frame discarded to make room.
+  std::uint32_t queue_drops = 0;
 };
 
+// Latest-frame-wins by default: a read takes the newest frame and supersedes
+// the rest. In ordered mode it is a small FIFO for paced display instead;
+// reads return frames oldest first and a full queue drops its oldest frame.
+//
+// Lock-free for one writer task and one reader task, which may run on
+// different cores. Slot states live in one atomic word that every transition
+// updates with a compare-and-swap; each commit also bumps a generation in
+// that word, so a reader choosing between ready slots never acts on a stale
+// view. A slot's metadata belongs to whichever side holds it in the Writing
+// or Reading state. The writer calls begin_write(), commit_write(),
+// cancel_write() and set_ordered(); the reader calls the read functions,
+// mark_displayed() and mark_superseded(). counters(), ready_count() and
+// state() are safe anywhere.
 class LatestFrameMailbox {
  public:
   enum class SlotState : std::uint8_t { Free, Writing, Ready, Reading };
 
   LatestFrameMailbox() = default;
+  LatestFrameMailbox(const LatestFrameMailbox&) = delete;
+  LatestFrameMailbox& operator=(const LatestFrameMailbox&) = delete;
 
-  int begin_write() {
+  // Switching modes forgets which columns are unread, so the next frame
+  // read is treated as fully dirty.
+  void set_ordered(bool ordered) {
+    ordered_.store(ordered, std::memory_order_release);
+    chain_dirty_ = PixelSpan::all();
+    carry(PixelSpan::all());
+  }
+  bool ordered() const { return ordered_.load(std::memory_order_acquire); }
+
+  std::size_t ready_count() const {
+    const std::uint32_t word = states_.load(std::memory_order_acquire);
+    std::size_t count = 0;
     for (std::size_t i = 0; i < kFrameMailboxSlots; ++i) {
-      if (states_[i] == SlotState::Free) {
-        states_[i] = SlotState::Writing;
-        return static_cast<int>(i);
-      }
+      if (slot_state(word, i) == SlotState::Ready) ++count;
     }
+    return count;
+  }
 
-    // A queued frame has not begun display yet, so replacing it is explicit
-    // latest-frame-wins behavior rather than unexplained loss.
-    int ready = newest_slot(SlotState::Ready);
-    if (ready >= 0) {
-      states_[ready] = SlotState::Writing;
-      ++counters_.superseded;
+  int begin_write() {
+    while (true) {
+      const std::uint32_t word = states_.load(std::memory_order_acquire);
+      const int free = find_slot(word, SlotState::Free);
+      // Only the writer leaves Free, so this cannot be raced.
+      if (free >= 0 && transition(free, SlotState::Free, SlotState::Writing)) {
+        return free;
+      }
+
+      const bool ordered = ordered_.load(std::memory_order_relaxed);
+      const int ready = ordered ? oldest_ready(word) : newest_ready(word);
+      if (ready < 0) {
+        counters_.publish_drops.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+      }
+      // In ordered mode the frame after a dropped one must still cover the
+      // columns it changed. Carrying them before the claim means a reader
+      // that wins the slot instead only sees a wider span.
+      if (ordered) carry(metadata_[ready].dirty_columns);
+      if (!transition(ready, SlotState::Ready, SlotState::Writing)) continue;
+      // A queued frame has not begun display yet, so replacing it is
+      // explicit latest-frame-wins behavior rather than unexplained loss.
+      (ordered ? counters_.queue_drops : counters_.superseded)
+          .fetch_add(1, std::memory_order_relaxed);
       return ready;
     }
-
-    ++counters_.publish_drops;
-    return -1;
   }
 
   bool commit_write(int slot, const FrameMetadata& metadata) {
-    if (!valid_slot(slot) || states_[slot] != SlotState::Writing) return false;
+    if (state(slot) != SlotState::Writing) return false;
+    const std::uint32_t tag = ++next_tag_;
     metadata_[slot] = metadata;
-    states_[slot] = SlotState::Ready;
-    ++counters_.accepted;
+    if (!ordered_.load(std::memory_order_relaxed)) {
+      // Unless the reader has taken the previous frame, this one also
+      // carries its columns, and through it those of every unread frame.
+      // A read racing this check only widens the span.
+      if (read_tag_.load(std::memory_order_acquire) != chain_tag_) {
+        metadata_[slot].dirty_columns.include(chain_dirty_);
+      }
+      chain_dirty_ = metadata_[slot].dirty_columns;
+      chain_tag_ = tag;
+    }
+    tags_[slot].store(tag, std::memory_order_relaxed);
+    transition(slot, SlotState::Writing, SlotState::Ready, kGenerationStep);
+    counters_.accepted.fetch_add(1, std::memory_order_relaxed);
     return true;
   }
 
   void cancel_write(int slot) {
-    if (valid_slot(slot) && states_[slot] == SlotState::Writing) {
-      states_[slot] = SlotState::Free;
-    }
+    transition(slot, SlotState::Writing, SlotState::Free);
   }
 
   int begin_read(FrameMetadata* metadata) {
-    if (newest_slot(SlotState::Reading) >= 0) return -1;
-
-    const int newest = newest_slot(SlotState::Ready);
-    if (newest < 0) return -1;
-
-    for (std::size_t i = 0; i < kFrameMailboxSlots; ++i) {
-      if (static_cast<int>(i) != newest && states_[i] == SlotState::Ready) {
-        states_[i] = SlotState::Free;
-        ++counters_.superseded;
+    const bool ordered = ordered_.load(std::memory_order_acquire);
+    std::uint32_t word = states_.load(std::memory_order_acquire);
+    int slot = -1;
+    std::uint32_t next = 0;
+    std::uint32_t superseded = 0;
+    do {
+      if (find_slot(word, SlotState::Reading) >= 0) return -1;
+      slot = ordered ? oldest_ready(word) : newest_ready(word);
+      if (slot < 0) return -1;
+      next = with_state(word, slot, SlotState::Reading);
+      superseded = 0;
+      for (std::size_t i = 0; !ordered && i < kFrameMailboxSlots; ++i) {
+        if (static_cast<int>(i) != slot && slot_state(word, i) == SlotState::Ready) {
+          next = with_state(next, i, SlotState::Free);
+          ++superseded;
+        }
       }
+    } while (!states_.compare_exchange_weak(
+        word, next, std::memory_order_acq_rel, std::memory_order_acquire));
+    if (superseded > 0) {
+      counters_.superseded.fetch_add(superseded, std::memory_order_relaxed);
     }
 
-    states_[newest] = SlotState::Reading;
-    if (metadata != nullptr) *metadata = metadata_[newest];
-    return newest;
+    read_tag_.store(tags_[slot].load(std::memory_order_relaxed),
+                    std::memory_order_release);
+    reading_dirty_ = metadata_[slot].dirty_columns;
+    reading_dirty_.include(unpack(carried_.exchange(0, std::memory_order_acq_rel)));
+    reading_dirty_.include(cancelled_dirty_);
+    cancelled_dirty_.clear();
+    if (metadata != nullptr) {
+      *metadata = metadata_[slot];
+      metadata->dirty_columns = reading_dirty_;
+    }
+    return slot;
   }
 
   bool finish_read(int slot) {
-    if (!valid_slot(slot) || states_[slot] != SlotState::Reading) return false;
-    states_[slot] = SlotState::Free;
-    ++counters_.displayed;
+    if (!transition(slot, SlotState::Reading, SlotState::Free)) return false;
+    counters_.displayed.fetch_add(1, std::memory_order_relaxed);
     return true;
   }
 
+  // Frees a slot whose pixels have been copied out (for example, encoded into
+  // a DMA buffer) before the frame is shown. The caller reports the eventual
+  // presentation with mark_displayed(), or mark_superseded() if a newer frame
+  // replaced it first, so accounting stays exact.
+  bool release_read(int slot) {
+    return transition(slot, SlotState::Reading, SlotState::Free);
+  }
+
+  void mark_displayed() {
+    counters_.displayed.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void mark_superseded() {
+    counters_.superseded.fetch_add(1, std::memory_order_relaxed);
+  }
+
   bool cancel_read(int slot) {
-    if (!valid_slot(slot) || states_[slot] != SlotState::Reading) return false;
-    states_[slot] = SlotState::Free;
+    if (!transition(slot, SlotState::Reading, SlotState::Free)) return false;
+    // The reader never consumed these changes; hand them to the next read.
+    cancelled_dirty_.include(reading_dirty_);
     return true;
   }
 
   SlotState state(int slot) const {
-    return valid_slot(slot) ? states_[slot] : SlotState::Free;
+    return valid_slot(slot)
+               ? slot_state(states_.load(std::memory_order_acquire), slot)
+               : SlotState::Free;
   }
 
-  const FrameMailboxCounters& counters() const { return counters_; }
+  // Each counter is exact; the set is not one atomic snapshot.
+  FrameMailboxCounters counters() const {
+    FrameMailboxCounters counters;
+    counters.accepted = counters_.accepted.load(std::memory_order_relaxed);
+    counters.displayed = counters_.displayed.load(std::memory_order_relaxed);
+    counters.superseded = counters_.superseded.load(std::memory_order_relaxed);
+    counters.publish_drops = counters_.publish_drops.load(std::memory_order_relaxed);
+    counters.queue_drops = counters_.queue_drops.load(std::memory_order_relaxed);
+    return counters;
+  }
 
  private:
+  // Two bits of SlotState per slot, then the commit generation.
+  static constexpr std::uint32_t kStateBits = 2;
+  static constexpr std::uint32_t kStateMask = (1U << kStateBits) - 1U;
+  static constexpr std::uint32_t kGenerationStep = 1U << 8;
+  static_assert(kFrameMailboxSlots * kStateBits <= 8, "slot states overlap the generation");
+
+  struct AtomicCounters {
+    std::atomic<std::uint32_t> accepted{0};
+    std::atomic<std::uint32_t> displayed{0};
+    std::atomic<std::uint32_t> superseded{0};
+    std::atomic<std::uint32_t> publish_drops{0};
+    std::atomic<std::uint32_t> queue_drops{0};
+  };
+
   static bool valid_slot(int slot) {
     return slot >= 0 && slot < static_cast<int>(kFrameMailboxSlots);
   }
 
-  int newest_slot(SlotState state) const {
+  static SlotState slot_state(std::uint32_t word, std::size_t slot) {
+    return static_cast<SlotState>((word >> (slot * kStateBits)) & kStateMask);
+  }
+
+  static std::uint32_t with_state(std::uint32_t word, std::size_t slot, SlotState state) {
+    const std::uint32_t shift = static_cast<std::uint32_t>(slot) * kStateBits;
+    return (word & ~(kStateMask << shift)) |
+           (static_cast<std::uint32_t>(state) << shift);
+  }
+
+  static int find_slot(std::uint32_t word, SlotState state) {
+    for (std::size_t i = 0; i < kFrameMailboxSlots; ++i) {
+      if (slot_state(word, i) == state) return static_cast<int>(i);
+    }
+    return -1;
+  }
+
+  // Packs a span into one word so the writer and reader can share it.
+  static std::uint32_t pack(const PixelSpan& span) {
+    return span.empty() ? 0U
+                        : (static_cast<std::uint32_t>(span.begin) << 16) | span.end;
+  }
+  static PixelSpan unpack(std::uint32_t packed) {
+    return {static_cast<std::uint16_t>(packed >> 16),
+            static_cast<std::uint16_t>(packed & 0xFFFFU)};
+  }
+
+  // Moves `slot` from `from` to `to`, adding `generation` to the word, and
+  // returns false if the slot was not in `from`.
+  bool transition(int slot, SlotState from, SlotState to, std::uint32_t generation = 0) {
+    if (!valid_slot(slot)) return false;
+    std::uint32_t word = states_.load(std::memory_order_acquire);
+    std::uint32_t next = 0;
+    do {
+      if (slot_state(word, slot) != from) return false;
+      next = with_state(word, slot, to) + generation;
+    } while (!states_.compare_exchange_weak(
+        word, next, std::memory_order_acq_rel, std::memory_order_acquire));
+    return true;
+  }
+
+  // Columns every later read must cover, independent of any one slot.
+  void carry(const PixelSpan& span) {
+    std::uint32_t packed = carried_.load(std::memory_order_relaxed);
+    PixelSpan merged;
+    do {
+      merged = unpack(packed);
+      merged.include(span);
+    } while (!carried_.compare_exchange_weak(
+        packed, pack(merged), std::memory_order_acq_rel, std::memory_order_relaxed));
+  }
+
+  // Tags order commits. The reader only compares tags of slots its state
+  // word shows as Ready, and the generation rejects any commit since.
+  int newest_ready(std::uint32_t word) const { return ready_by_tag(word, true); }
+  int oldest_ready(std::uint32_t word) const { return ready_by_tag(word, false); }
+
+  int ready_by_tag(std::uint32_t word, bool newest) const {
     int result = -1;
-    std::uint32_t sequence = 0;
+    std::uint32_t best = 0;
     for (std::size_t i = 0; i < kFrameMailboxSlots; ++i) {
-      if (states_[i] != state) continue;
-      if (result < 0 || metadata_[i].sequence >= sequence) {
+      if (slot_state(word, i) != SlotState::Ready) continue;
+      const std::uint32_t tag = tags_[i].load(std::memory_order_relaxed);
+      // Wrap-safe: commits in flight are always within a few tags.
+      const auto age = static_cast<std::int32_t>(tag - best);
+      if (result < 0 || (newest ? age > 0 : age < 0)) {
         result = static_cast<int>(i);
-        sequence = metadata_[i].sequence;
+        best = tag;
       }
     }
     return result;
   }
 
-  SlotState states_[kFrameMailboxSlots] = {};
+  std::atomic<std::uint32_t> states_{0};
+  std::atomic<std::uint32_t> tags_[kFrameMailboxSlots] = {};
   FrameMetadata metadata_[kFrameMailboxSlots] = {};
-  FrameMailboxCounters counters_ = {};
+  AtomicCounters counters_;
+  std::atomic<bool> ordered_{false};
+  // Packed PixelSpan: drops and mode switches, taken by the next read.
+  std::atomic<std::uint32_t> carried_{0};
+  // Tag of the frame the reader last took.
+  std::atomic<std::uint32_t> read_tag_{0};
+
+  // Writer only: the newest commit and the columns it covers.
+  std::uint32_t next_tag_ = 0;
+  std::uint32_t chain_tag_ = 0;
+  PixelSpan chain_dirty_ = {};
+
+  // Reader only.
+  PixelSpan reading_dirty_ = {};
+  PixelSpan cancelled_dirty_ = {};
 };
 
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free,
+              "LatestFrameMailbox needs lock-free 32-bit atomics");
+
 }  // namespace ledgrid
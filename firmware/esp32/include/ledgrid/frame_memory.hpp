@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ledgrid {
+
+// Where a receiver buffer lives. SPI and LCD DMA need DMA-capable internal
+// SRAM; frames the CPU rewrites per command stay internal as well. Frames that
+// are only filled by one sequential copy and read back as sequential lane
+// streams tolerate the PSRAM cache.
+enum class MemoryTier : std::uint8_t {
+  InternalDma,
+  Internal,
+  Psram,
+};
+
+const char* memory_tier_name(MemoryTier tier);
+
+// Capacity the receiver boots with until a CONFIG asks for more. Frames up to
+// this size keep every buffer in internal SRAM.
+constexpr std::uint16_t kFactoryLedCapacity = 140;
+// Upper bound on strips x LEDs for any configured capacity.
+constexpr std::size_t kMaxCapacityLeds = 4096;
+constexpr std::size_t kFrameAlignment = 64;
+
+struct FrameMemoryPlan {
+  std::uint16_t leds_per_strip = 0;
+  std::size_t rgb_bytes = 0;
+  // Command byte, pixels and CRC, rounded up to whole cache lines.
+  std::size_t spi_buffer_bytes = 0;
+  MemoryTier mailbox_tier = MemoryTier::InternalDma;
+  MemoryTier history_tier = MemoryTier::Internal;
+  // SPI receive buffers double as mailbox storage and SET_ALL is published by
+  // swapping buffers. PSRAM slots cannot take SPI DMA, so they are filled by
+  // copying instead.
+  bool zero_copy_mailbox = true;
+};
+
+bool led_capacity_valid(std::uint8_t strip_count, std::uint16_t leds_per_strip);
+
+// Lays out frame storage for `leds_per_strip` LEDs on each of `strip_count`
+// strips. Capacities above `internal_leds` move mailbox slots and keyframe
+// history to PSRAM when it is present; otherwise every frame stays internal.
+// Returns a plan with zero sizes for an invalid capacity.
+FrameMemoryPlan plan_frame_memory(
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    bool psram_available,
+    std::uint16_t internal_leds = kFactoryLedCapacity);
+
+}  // namespace ledgrid
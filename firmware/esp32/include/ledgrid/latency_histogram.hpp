@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ledgrid {
+
+// Receive-to-photon pipeline stages. SpiReceive runs from chip-select release
+// to the loop picking the packet up, MailboxWait from publish to the display
+// task taking the frame, and EndToEnd from the release of the packet that
+// completed a frame to its transfer-done interrupt.
+enum class LatencyStage : std::uint8_t {
+  SpiReceive,
+  Crc,
+  Copy,
+  MailboxWait,
+  Encode,
+  Dma,
+  EndToEnd,
+};
+
+constexpr std::size_t kLatencyStageCount = 7;
+// Bucket 0 counts 0 us and bucket b counts [2^(b-1), 2^b) us; the last bucket
+// is open-ended from 262 ms.
+constexpr std::size_t kLatencyBuckets = 20;
+
+const char* latency_stage_name(LatencyStage stage);
+
+inline std::size_t latency_bucket(std::uint32_t us) {
+  if (us == 0) return 0;
+  const std::size_t width = 32U - static_cast<std::size_t>(__builtin_clz(us));
+  return width < kLatencyBuckets ? width : kLatencyBuckets - 1U;
+}
+
+struct LatencySnapshot {
+  std::uint32_t buckets[kLatencyBuckets] = {};
+  std::uint32_t max_us = 0;
+};
+
+// Lock-free so any task can record while another reads. Each counter is
+// consistent on its own; a snapshot taken mid-record may be one sample short
+// in one bucket, which is fine for a distribution.
+class LatencyHistogram {
+ public:
+  void record(std::uint32_t us) {
+    buckets_[latency_bucket(us)].fetch_add(1, std::memory_order_relaxed);
+    std::uint32_t max = max_us_.load(std::memory_order_relaxed);
+    while (us > max &&
+           !max_us_.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+    }
+  }
+
+  LatencySnapshot snapshot() const;
+  void reset();
+
+ private:
+  std::atomic<std::uint32_t> buckets_[kLatencyBuckets] = {};
+  std::atomic<std::uint32_t> max_us_{0};
+};
+
+}  // namespace ledgrid
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ledgrid/crc16.hpp"
+
+namespace ledgrid {
+
+// A layout map lets the host send frames in logical raster order. Entry
+// lane * leds_per_strip + column names the logical pixel that physical pixel
+// shows, or kUnmappedPixel to keep it dark. Maps travel and are stored as
+// big-endian u16 entries; the encoder reads a host-order copy.
+constexpr std::uint16_t kUnmappedPixel = 0xFFFF;
+constexpr std::size_t kLayoutEntryBytes = 2;
+
+// Which map the receiver holds: a host-chosen version, 0 for none, the
+// geometry the map was made for and the CRC-16 of its entry bytes.
+struct LayoutMapInfo {
+  std::uint32_t version = 0;
+  std::uint8_t strip_count = 0;
+  std::uint16_t leds_per_strip = 0;
+  std::uint16_t crc = 0;
+
+  std::size_t pixels() const {
+    return static_cast<std::size_t>(strip_count) * leds_per_strip;
+  }
+};
+
+// version (u32), strip count (u8), LEDs per strip (u16), CRC (u16), as in
+// COMMIT_LAYOUT and the stored copy.
+constexpr std::size_t kLayoutInfoBytes = 9;
+void write_layout_info(const LayoutMapInfo& info, std::uint8_t* output);
+LayoutMapInfo read_layout_info(const std::uint8_t* input);
+
+// True when `entries` holds a whole map for `info`: the CRC matches and every
+// entry names a pixel of the frame or is kUnmappedPixel. Version 0 is never
+// valid; it means no map.
+bool layout_map_valid(
+    Crc16Engine engine,
+    const LayoutMapInfo& info,
+    const std::uint8_t* entries,
+    std::size_t entry_bytes);
+
+// Converts `pixels` big-endian entries to host order. False on an entry out
+// of range, with `layout` partly written.
+bool decode_layout_map(
+    const std::uint8_t* entries, std::size_t pixels, std::uint16_t* layout);
+
+}  // namespace ledgrid
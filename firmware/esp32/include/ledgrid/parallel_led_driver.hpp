@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 
@@ -7,31 +8,159 @@
 #include "esp_lcd_io_i80.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "ledgrid/frame_display.hpp"
+#include "ledgrid/layout_map.hpp"
+#include "ledgrid/pixel_span.hpp"
+#include "ledgrid/power_budget.hpp"
+#include "ledgrid/ws2812_encoder.hpp"
 
 namespace ledgrid {
 
+// How encoded frames reach the LCD DMA.
+enum class DmaBuffering : std::uint8_t {
+  // Two complete encoded frames, so memory grows with strip length.
+  FullFrames,
+  // A small ring of column chunks that a driver task refills while the DMA
+  // drains it. Memory no longer depends on strip length, but only one frame is
+  // in flight and the caller's pixels must stay valid until it completes.
+  Streaming,
+};
+
+// Which cores encode each frame.
+enum class EncodeCores : std::uint8_t {
+  // The staging task, or the refill task when streaming, encodes alone.
+  One,
+  // A helper task on the other core shares the work: slices of each frame's
+  // changed columns, or every other chunk when streaming. Both sides claim
+  // the next slice until none are left, so a helper held up by the SPI work
+  // on its core costs at most the slice it is encoding.
+  Two,
+};
+
 class ParallelLedDriver {
  public:
+  static constexpr std::uint8_t kBufferCount = 2;
+  // 16 columns are 1152 bytes at eight lanes and take 480 us to clock out, so
+  // four chunks leave the refill task well over a millisecond of slack.
+  static constexpr std::uint16_t kStreamChunkColumns = 16;
+  static constexpr std::uint8_t kStreamChunkCount = 4;
+  // A shared encode is cut into at most kMaxEncodeSlices slices of at least
+  // kEncodeSliceColumns columns, so a handoff is small next to its slice.
+  static constexpr std::uint8_t kMaxEncodeSlices = 16;
+  static constexpr std::uint16_t kEncodeSliceColumns = 16;
+
   ParallelLedDriver() = default;
   ~ParallelLedDriver();
 
   bool begin(
       const int* pins,
       std::uint8_t strip_count,
-      std::uint16_t max_leds_per_strip);
+      std::uint16_t max_leds_per_strip,
+      EncoderKernel encoder = EncoderKernel::Table,
+      DmaBuffering buffering = DmaBuffering::FullFrames,
+      EncodeCores cores = EncodeCores::One);
+
+  // Replaces the per-lane colour correction curves. The expansion tables are
+  // rebuilt on the next submit and both buffers are re-encoded in full.
+  void set_color_correction(const ChannelCurves& curves);
 
-  bool submit(
+  // Replaces the palette that indexed frames look up (kPaletteBytes of RGB).
+  // Its expansion rows are built on the next indexed submit; buffers encoded
+  // from the old palette are re-encoded in full.
+  void set_palette(const std::uint8_t* palette);
+
+  // Has frames with the geometry of `info` read in logical order through
+  // `entries`, the map's big-endian entries, and re-encodes both buffers in
+  // full. Frames of any other geometry stay lane-major. Their changed
+  // columns say nothing about physical columns, so every changed frame is
+  // encoded in full. Null entries drop the map; so does a map that does not
+  // decode or fit, returning false. The map is allocated with the first one.
+  bool set_layout(const LayoutMapInfo& info, const std::uint8_t* entries);
+  // Version of the map in use, 0 for none.
+  std::uint32_t layout_version() const { return layout_version_; }
+
+  // Prices every staged frame with `model` and encodes it at a lower
+  // brightness when it would draw more than `budget`. Applies from the next
+  // submit; a zero budget only estimates.
+  void set_power_limit(const PowerModel& model, const PowerBudget& budget);
+
+  // Wakes `task` from the transfer-done ISR with a task notification so a
+  // pipelined caller can sleep until either a new frame or a free buffer.
+  void set_completion_task(TaskHandle_t task) { completion_task_ = task; }
+
+  // Encodes into the idle DMA buffer and queues it behind any transfer that is
+  // still in flight; the LCD driver starts it from the previous done ISR.
+  // `dirty_columns` lists columns changed since the previously submitted
+  // frame. Each buffer re-encodes only what changed since it was last filled.
+  // With `blend`, the buffer holds `blend->from` interpolated towards `rgb`;
+  // callers stepping a blend pass the columns where the two frames differ.
+  // When streaming, the first chunk is encoded here and the rest by the refill
+  // task, so `rgb` and `blend->from` are read until the transfer completes.
+  // An Indexed frame passes its indices as `rgb`, one byte per pixel, and
+  // cannot be blended; it fails until a palette has been set.
+  SubmitResult submit(
       const std::uint8_t* rgb,
       std::size_t rgb_bytes,
       std::uint8_t strip_count,
       std::uint16_t leds_per_strip,
       std::uint8_t brightness,
-      std::uint32_t sequence);
+      std::uint32_t sequence,
+      PixelSpan dirty_columns = PixelSpan::all(),
+      const FrameBlend* blend = nullptr,
+      PixelFormat format = PixelFormat::Rgb);
+
+  // The two halves of submit(): stage() encodes into the idle buffer (or the
+  // first stream chunk) and returns Queued once the frame is ready, without
+  // starting DMA; latch() then queues it, so the latch itself costs only the
+  // LCD driver's queue call. Staging again before the latch replaces the
+  // staged frame. latch() returns false when nothing is staged or the LCD
+  // driver refuses the transfer.
+  SubmitResult stage(
+      const std::uint8_t* rgb,
+      std::size_t rgb_bytes,
+      std::uint8_t strip_count,
+      std::uint16_t leds_per_strip,
+      std::uint8_t brightness,
+      std::uint32_t sequence,
+      PixelSpan dirty_columns = PixelSpan::all(),
+      const FrameBlend* blend = nullptr,
+      PixelFormat format = PixelFormat::Rgb);
+  bool latch();
+  bool has_staged() const { return staged_.pending; }
+
+  // Returns finished transfers in submission order. A buffer is not reused
+  // until its completion has been collected.
+  bool take_completion(TransferCompletion* completion);
 
   bool wait_for_done(TickType_t timeout_ticks);
-  bool in_flight() const { return in_flight_; }
+  bool can_submit() const {
+    return submitted_.load(std::memory_order_acquire) - collected_ <
+           (buffering_ == DmaBuffering::Streaming ? 1U : kBufferCount);
+  }
+  bool in_flight() const {
+    return submitted_.load(std::memory_order_acquire) !=
+           completed_.load(std::memory_order_acquire);
+  }
+  // When the oldest transfer still on the wire should finish, going by the
+  // last one's duration; `now` when none is, or it is already overdue.
+  std::uint32_t transfer_done_us(std::uint32_t now) const;
 
+  // Internal DMA memory held for encoded output: both frames, or the chunk
+  // ring and reset tail when streaming.
+  std::size_t dma_buffer_bytes() const {
+    return buffering_ == DmaBuffering::Streaming
+               ? kStreamChunkCount * chunk_capacity_ + reset_bytes_
+               : kBufferCount * buffer_capacity_;
+  }
+  // Wall time of the last frame's encode, from both cores when shared.
   std::uint16_t last_encode_us() const { return last_encode_us_; }
+  EncodeCores encode_cores() const {
+    return encode_helper_ != nullptr ? EncodeCores::Two : EncodeCores::One;
+  }
+  // Percentage of the last encode's columns the helper took; 0 when it was
+  // busy for the whole encode or there is none.
+  std::uint8_t last_helper_share() const { return last_helper_share_; }
   std::uint16_t last_show_us() const { return last_show_us_; }
   std::uint32_t last_submitted_sequence() const {
     return last_submitted_sequence_;
@@ -39,8 +168,152 @@ class ParallelLedDriver {
   std::uint32_t last_completed_sequence() const {
     return last_completed_sequence_;
   }
+  // Estimate for the most recently staged frame; safe to read from any task.
+  PowerEstimate power_estimate() const;
+  // Stage calls that lowered the requested brightness to stay within budget.
+  std::uint32_t power_limited_frames() const {
+    return power_limited_frames_.load(std::memory_order_relaxed);
+  }
+  // Streamed chunks queued after the bus had already drained mid-frame, or
+  // that could not be queued at all. A long enough gap latches a partial frame.
+  std::uint32_t stream_underruns() const {
+    return stream_underruns_.load(std::memory_order_relaxed);
+  }
 
  private:
+  struct BufferContents {
+    bool valid = false;
+    std::uint8_t strip_count = 0;
+    std::uint16_t leds_per_strip = 0;
+    std::uint8_t brightness = 0;
+    std::uint32_t correction = 0;
+    // Generation of the palette an indexed frame was encoded with; 0 for RGB.
+    std::uint32_t palette = 0;
+
+    bool matches(
+        std::uint8_t strips,
+        std::uint16_t leds,
+        std::uint8_t level,
+        std::uint32_t correction_generation,
+        std::uint32_t palette_generation) const {
+      return valid && strip_count == strips && leds_per_strip == leds &&
+             brightness == level && correction == correction_generation &&
+             palette == palette_generation;
+    }
+  };
+
+  // The frame being streamed. Written by submit() while no frame is in flight
+  // and by the refill task afterwards.
+  struct StreamFrame {
+    const std::uint8_t* rgb = nullptr;
+    std::size_t rgb_bytes = 0;
+    const std::uint8_t* from = nullptr;
+    std::uint16_t weight = 0;
+    PixelFormat format = PixelFormat::Rgb;
+    std::uint8_t strip_count = 0;
+    std::uint16_t leds_per_strip = 0;
+    // Set for frames in logical order.
+    const std::uint16_t* layout = nullptr;
+    std::uint16_t next_column = 0;
+    std::uint16_t next_chunk = 0;
+    std::uint32_t encode_us = 0;
+    std::uint16_t helper_columns = 0;
+  };
+
+  // One shared encode: columns [first, end) of `job_.frame`, into `chunk`
+  // when streaming, else in place in `job_.output`.
+  struct EncodeSlice {
+    std::uint16_t first = 0;
+    std::uint16_t end = 0;
+    std::uint8_t* chunk = nullptr;
+    bool by_helper = false;
+    EncodeResult result = {};
+  };
+
+  // The pixels and destination of the encode in progress; only the pixel
+  // fields of `frame` are read.
+  struct EncodeJob {
+    StreamFrame frame = {};
+    std::uint8_t* output = nullptr;
+    std::size_t output_capacity = 0;
+    EncodeSlice slices[kMaxEncodeSlices] = {};
+  };
+
+  // A frame encoded by stage() and waiting for latch().
+  struct StagedTransfer {
+    bool pending = false;
+    std::uint8_t index = 0;
+    std::size_t bytes = 0;
+    std::uint32_t sequence = 0;
+  };
+
+  SubmitResult stage_stream(
+      const std::uint8_t* rgb,
+      std::size_t rgb_bytes,
+      std::uint8_t strip_count,
+      std::uint16_t leds_per_strip,
+      std::uint8_t brightness,
+      std::uint32_t sequence,
+      PixelSpan dirty_columns,
+      const FrameBlend* blend,
+      PixelFormat format);
+  // Encodes columns [first, end) of the streamed frame into `chunk`.
+  EncodeResult encode_stream_chunk(
+      const StreamFrame& frame,
+      std::uint16_t first,
+      std::uint16_t end,
+      std::uint8_t* chunk);
+  // Encodes and queues chunks until the ring is full, then the reset tail once
+  // the last column is queued.
+  void refill_stream();
+  static void stream_task(void* context);
+
+  // Encodes the first `count` slices of job_, sharing them with the helper
+  // when there is one, and returns once every slice is done. False if any
+  // slice failed.
+  bool run_encode_job(std::uint8_t count);
+  // Claims and encodes slices of the current job until none are left; true if
+  // it encoded any.
+  bool encode_slices(bool helper);
+  EncodeResult encode_slice(const EncodeSlice& slice);
+  static void encode_task(void* context);
+
+  // Prices the frame about to be staged and returns the brightness to encode
+  // it at. The channel totals are kept until a column changes or a blend
+  // starts or ends, so a repeated frame is not re-read.
+  std::uint8_t limit_brightness(
+      const std::uint8_t* rgb,
+      std::size_t rgb_bytes,
+      std::uint8_t strip_count,
+      std::uint16_t leds_per_strip,
+      std::uint8_t brightness,
+      PixelSpan dirty_columns,
+      const FrameBlend* blend,
+      PixelFormat format);
+
+  // Rebuilds the expansion tables if brightness or the curves have changed,
+  // and reselects the kernels if the strip count or table layout has. Indexed
+  // frames also need the palette rows; returns false if there is no palette
+  // or no memory for them.
+  bool reserve_lane_tables();
+  bool prepare_encoder(
+      std::uint8_t strip_count, std::uint8_t brightness, PixelFormat format);
+  // The decoded map for frames of this geometry, or null for lane-major.
+  const std::uint16_t* frame_layout(
+      std::uint8_t strip_count, std::uint16_t leds_per_strip) const {
+    return layout_info_.version != 0 && layout_info_.strip_count == strip_count &&
+                   layout_info_.leds_per_strip == leds_per_strip
+               ? layout_
+               : nullptr;
+  }
+  // 0 for RGB frames, else the palette generation they would be encoded with.
+  std::uint32_t palette_tag(PixelFormat format) const {
+    return format == PixelFormat::Indexed ? palette_generation_ : 0U;
+  }
+
+  // Completion bookkeeping for the frame at the head of the queue.
+  void IRAM_ATTR finish_transfer(std::uint32_t now);
+
   static bool IRAM_ATTR on_transfer_done(
       esp_lcd_panel_io_handle_t panel_io,
       esp_lcd_panel_io_event_data_t* event_data,
@@ -49,11 +322,100 @@ class ParallelLedDriver {
   esp_lcd_i80_bus_handle_t bus_ = nullptr;
   esp_lcd_panel_io_handle_t io_ = nullptr;
   SemaphoreHandle_t done_ = nullptr;
-  std::uint8_t* buffers_[2] = {};
+  TaskHandle_t completion_task_ = nullptr;
+  std::uint8_t* buffers_[kBufferCount] = {};
   std::size_t buffer_capacity_ = 0;
   std::uint8_t next_buffer_ = 0;
-  volatile bool in_flight_ = false;
-  volatile std::uint32_t show_started_us_ = 0;
+  StagedTransfer staged_ = {};
+  DmaBuffering buffering_ = DmaBuffering::FullFrames;
+  std::uint8_t* chunks_[kStreamChunkCount] = {};
+  std::size_t chunk_capacity_ = 0;
+  std::uint8_t* reset_chunk_ = nullptr;
+  std::size_t reset_bytes_ = 0;
+  TaskHandle_t stream_task_ = nullptr;
+  StreamFrame stream_ = {};
+  // The shared encode. `job_next_` is the next slice to claim and rests at
+  // kNoEncodeJob between jobs, so a helper woken late claims nothing;
+  // `job_finished_` counts slices done. The caller polls for the helper's last
+  // slice kEncodeJoinSpins times, then sleeps on `job_done_`, which the helper
+  // gives after each run of slices.
+  static constexpr std::uint32_t kNoEncodeJob = 0x80000000U;
+  static constexpr std::uint32_t kEncodeJoinSpins = 2000;
+  TaskHandle_t encode_helper_ = nullptr;
+  SemaphoreHandle_t job_done_ = nullptr;
+  EncodeJob job_ = {};
+  std::atomic<std::uint8_t> job_count_{0};
+  std::atomic<std::uint32_t> job_next_{kNoEncodeJob};
+  std::atomic<std::uint32_t> job_finished_{0};
+  volatile std::uint8_t last_helper_share_ = 0;
+  std::atomic<bool> stream_active_{false};
+  // Chunk and reset transactions queued (refill side) and finished (ISR side).
+  // The ISR completes the frame when `stream_done_` reaches the end mark, which
+  // is only moved once the reset tail is queued.
+  std::uint32_t stream_queued_ = 0;
+  std::atomic<std::uint32_t> stream_done_{0};
+  volatile std::uint32_t stream_frame_end_ = 0;
+  std::atomic<std::uint32_t> stream_underruns_{0};
+  // Curves and the tables built from them live in internal RAM so the encode
+  // loop never touches flash. Uniform curves, the default, need lane 0's rows
+  // only; every lane's rows are allocated when per-lane curves are first
+  // encoded. Should that fail, every lane is encoded with lane 0's curve
+  // until the next correction change tries again.
+  ChannelCurves* curves_ = nullptr;
+  UniformExpandTableStorage* uniform_tables_ = nullptr;
+  LaneExpandTableStorage* lane_tables_ = nullptr;
+  bool lane_tables_failed_ = false;
+  // A view of whichever storage the tables were last built in.
+  ParallelExpandTables tables_ = {};
+  bool tables_valid_ = false;
+  bool tables_uniform_ = true;
+  bool uniform_curves_ = true;
+  EncoderKernel encoder_ = EncoderKernel::Table;
+  ParallelEncodeKernels kernels_ = {};
+  std::uint8_t tables_brightness_ = 0;
+  std::uint32_t correction_generation_ = 0;
+  // The palette is allocated in begin(), since set_palette() may run while
+  // the caller holds a spinlock, and is unused until the first one is set.
+  // Its expansion rows are allocated with the first indexed frame, so
+  // receivers that never see one pay only for the palette. Rows grow from one
+  // shared row to one per lane when the curves stop being uniform.
+  std::uint8_t* palette_ = nullptr;
+  bool palette_loaded_ = false;
+  PaletteExpandRow* palette_rows_ = nullptr;
+  std::uint8_t palette_row_capacity_ = 0;
+  bool palette_rows_valid_ = false;
+  bool palette_rows_uniform_ = true;
+  std::uint8_t palette_rows_strips_ = 0;
+  std::uint8_t palette_rows_brightness_ = 0;
+  std::uint32_t palette_generation_ = 0;
+  // The decoded layout map, allocated with the first one; layout_info_ stays
+  // zeroed while no map is set.
+  std::uint16_t* layout_ = nullptr;
+  std::size_t layout_capacity_ = 0;
+  LayoutMapInfo layout_info_ = {};
+  volatile std::uint32_t layout_version_ = 0;
+  // Power estimate of the frames being staged. The totals price a blend at
+  // the larger of its two ends; the estimate is copied out under the lock.
+  PowerModel power_model_ = {};
+  PowerBudget power_budget_ = {};
+  ChannelTotals power_totals_ = {};
+  bool power_totals_valid_ = false;
+  bool power_totals_blended_ = false;
+  PixelFormat power_totals_format_ = PixelFormat::Rgb;
+  mutable portMUX_TYPE power_mux_ = portMUX_INITIALIZER_UNLOCKED;
+  PowerEstimate power_estimate_ = {};
+  std::atomic<std::uint32_t> power_limited_frames_{0};
+  // What each buffer currently encodes, and which columns have changed since.
+  BufferContents contents_[kBufferCount] = {};
+  PixelSpan stale_columns_[kBufferCount] = {};
+  // Monotonic transfer counts. Transfer k always uses buffer k % 2, so the
+  // counters double as indexes into the per-buffer bookkeeping below.
+  std::atomic<std::uint32_t> submitted_{0};
+  std::atomic<std::uint32_t> completed_{0};
+  std::uint32_t collected_ = 0;
+  volatile std::uint32_t buffer_sequence_[kBufferCount] = {};
+  volatile std::uint32_t show_started_us_[kBufferCount] = {};
+  volatile std::uint32_t completed_us_[kBufferCount] = {};
   volatile std::uint16_t last_encode_us_ = 0;
   volatile std::uint16_t last_show_us_ = 0;
   volatile std::uint32_t last_submitted_sequence_ = 0;
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+namespace ledgrid {
+
+// Half-open range of pixel columns, i.e. LED positions along a strip. Every
+// lane shares a column in the parallel waveform, so a change on any strip
+// dirties that column for all of them.
+struct PixelSpan {
+  static constexpr std::uint16_t kAllColumns = UINT16_MAX;
+
+  std::uint16_t begin = 0;
+  std::uint16_t end = 0;
+
+  static constexpr PixelSpan all() { return {0, kAllColumns}; }
+
+  bool empty() const { return begin >= end; }
+
+  void include(std::uint16_t first, std::uint16_t last_exclusive) {
+    if (first >= last_exclusive) return;
+    if (empty()) {
+      begin = first;
+      end = last_exclusive;
+      return;
+    }
+    begin = std::min(begin, first);
+    end = std::max(end, last_exclusive);
+  }
+
+  void include(const PixelSpan& other) { include(other.begin, other.end); }
+
+  void clear() { begin = end = 0; }
+
+  PixelSpan clamped(std::uint16_t columns) const {
+    PixelSpan result{begin, std::min(end, columns)};
+    if (result.empty()) result.clear();
+    return result;
+  }
+};
+
+// Cuts `span` into at most `max_slices` consecutive slices of at least
+// `min_columns` columns, the last possibly shorter, so several cores can
+// encode one span. Returns the slice count; an empty span is one empty slice.
+inline std::uint8_t split_columns(
+    const PixelSpan& span,
+    std::uint16_t min_columns,
+    std::uint8_t max_slices,
+    PixelSpan* slices) {
+  if (slices == nullptr || max_slices == 0) return 0;
+  if (span.empty()) {
+    slices[0] = {span.begin, span.begin};
+    return 1;
+  }
+  const std::uint32_t columns = span.end - span.begin;
+  const std::uint32_t width = std::max<std::uint32_t>(
+      std::max<std::uint16_t>(min_columns, 1), (columns + max_slices - 1U) / max_slices);
+  std::uint8_t count = 0;
+  for (std::uint32_t first = span.begin; first < span.end; first += width) {
+    slices[count++] = {static_cast<std::uint16_t>(first),
+                       static_cast<std::uint16_t>(std::min<std::uint32_t>(first + width, span.end))};
+  }
+  return count;
+}
+
+}  // namespace ledgrid
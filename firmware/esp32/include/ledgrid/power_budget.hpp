@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ledgrid/ws2812_encoder.hpp"
+
+namespace ledgrid {
+
+// Current one LED draws: each channel at full output, and the controller's
+// own quiescent draw whatever it shows. Defaults are typical 5 V WS2812B
+// figures.
+struct PowerModel {
+  std::uint16_t channel_ua[3] = {16000, 11000, 15000};
+  std::uint16_t idle_ua = 1000;
+};
+
+// Limits in milliamps; 0 leaves that limit off. The strip limit applies to
+// each strip on its own, for walls fed at every strip.
+struct PowerBudget {
+  std::uint16_t total_ma = 0;
+  std::uint16_t strip_ma = 0;
+};
+
+// Corrected channel values of one frame summed per lane, before brightness.
+// Brightness scales every corrected value linearly, so one set of totals
+// prices the frame at any brightness.
+struct ChannelTotals {
+  std::uint32_t sum[kMaxParallelStrips][3] = {};
+  std::uint8_t strip_count = 0;
+  std::uint16_t leds_per_strip = 0;
+};
+
+// Sums lane-major RGB frames, or indexed frames through `palette`
+// (kPaletteBytes of RGB), through `curves` (null for identity). Frames in
+// logical order pass the decoded `layout` they are encoded with, so each
+// strip is priced by what it shows. False, leaving `totals` untouched, when
+// the frame is shorter than the geometry.
+bool total_rgb_channels(
+    const ChannelCurves* curves,
+    const std::uint8_t* rgb,
+    std::size_t rgb_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    ChannelTotals* totals,
+    const std::uint16_t* layout = nullptr);
+bool total_indexed_channels(
+    const ChannelCurves* curves,
+    const std::uint8_t* indices,
+    std::size_t index_bytes,
+    const std::uint8_t* palette,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    ChannelTotals* totals,
+    const std::uint16_t* layout = nullptr);
+
+// Raises each of `totals`' sums to `other`'s where that is larger, so a blend
+// between two frames is priced at no less than either end.
+void include_channel_totals(const ChannelTotals& other, ChannelTotals* totals);
+
+struct PowerEstimate {
+  std::uint8_t requested_brightness = 0;
+  // What the frame is encoded at: the requested brightness, or less when
+  // that would exceed the budget.
+  std::uint8_t brightness = 0;
+  std::uint8_t strip_count = 0;
+  std::uint8_t busiest_strip = 0;
+  // The whole frame at the requested brightness.
+  std::uint32_t demand_ma = 0;
+  // The whole frame and each strip at the applied brightness.
+  std::uint32_t total_ma = 0;
+  std::uint32_t strip_ma[kMaxParallelStrips] = {};
+
+  bool limited() const { return brightness < requested_brightness; }
+};
+
+// Prices `totals` at `brightness` and lowers the brightness as far as it
+// takes to keep the total and every strip within `budget`. A budget below
+// the idle draw alone yields brightness 0.
+PowerEstimate limit_power(
+    const PowerModel& model,
+    const PowerBudget& budget,
+    const ChannelTotals& totals,
+    std::uint8_t brightness);
+
+}  // namespace ledgrid
@@ -3,14 +3,38 @@
 #include <cstddef>
 #include <cstdint>
 
+#include "ledgrid/latency_histogram.hpp"
+
 namespace ledgrid {
 
 constexpr std::uint8_t kStatusProtocolVersion = 2;
 constexpr std::size_t kStatusBytesV2 = 64;
 
+// Capability bits reported in status byte 7 so hosts can opt into newer
+// commands without breaking older receivers.
+constexpr std::uint8_t kCapabilityBatch = 0x01;
+constexpr std::uint8_t kCapabilityCompressedFrames = 0x02;
+constexpr std::uint8_t kCapabilityKeyframeTransitions = 0x04;
+constexpr std::uint8_t kCapabilityColorCorrection = 0x08;
+constexpr std::uint8_t kCapabilityFrameLatch = 0x10;
+constexpr std::uint8_t kCapabilityPacedDisplay = 0x20;
+constexpr std::uint8_t kCapabilityStatusPages = 0x40;
+constexpr std::uint8_t kCapabilityEffects = 0x80;
+
+// Frame latch telemetry follows the 64-byte block in transfers long enough to
+// carry it. Hosts that read exactly 64 bytes see the unchanged v2 layout.
+constexpr std::size_t kStatusBytesV2Latch = 80;
+constexpr std::size_t kStatusBytesV2Pacing = 92;
+constexpr std::size_t kStatusBytesV2Histogram = 180;
+constexpr std::size_t kStatusBytesV2Chunks = 192;
+constexpr std::size_t kStatusBytesV2Credits = 208;
+// histogram_stage value when no stage is selected.
+constexpr std::uint8_t kNoLatencyHistogram = 0xFF;
+
 struct ReceiverStatusV2 {
   std::uint8_t flags = 0;
   std::uint8_t active_strips = 0;
+  std::uint8_t capabilities = 0;
   std::uint16_t leds_per_strip = 0;
   std::uint16_t queued_transactions = 0;
   std::uint32_t packets = 0;
@@ -28,6 +52,44 @@ struct ReceiverStatusV2 {
   std::uint32_t last_accepted_sequence = 0;
   std::uint32_t last_displayed_sequence = 0;
   std::uint32_t display_errors = 0;
+
+  // Latch tail (bytes 64-79). `last_latch_us` runs from the latch edge or
+  // command to the staged transfer being queued; latch_misses counts latches
+  // that found no staged frame or a transfer still on the wire.
+  std::uint8_t latch_mode = 0;
+  std::uint16_t last_latch_us = 0;
+  std::uint32_t latches = 0;
+  std::uint32_t latch_misses = 0;
+  std::uint32_t last_latch_sequence = 0;
+
+  // Pacing tail (bytes 80-91). A late frame is a presentation tick with no
+  // frame ready; queue drops are frames discarded from a full jitter buffer.
+  std::uint16_t paced_fps = 0;
+  std::uint8_t pacing_depth = 0;
+  std::uint32_t frames_late = 0;
+  std::uint32_t queue_drops = 0;
+
+  // Histogram tail (bytes 92-179): the stage selected with SELECT_HISTOGRAM.
+  std::uint8_t histogram_stage = kNoLatencyHistogram;
+  LatencySnapshot histogram{};
+
+  // Chunk tail (bytes 180-191): the SET_ALL_CHUNKED frame being gathered and
+  // the strips it still lacks, which the host resends under that sequence.
+  std::uint16_t chunk_sequence = 0;
+  std::uint16_t missing_strips = 0;
+  std::uint32_t chunk_crc_errors = 0;
+  std::uint32_t frames_recovered = 0;
+
+  // Credit tail (bytes 192-207). Credits are the frames the display can take
+  // before one it has not shown is replaced, out of `display_room`. Times are
+  // esp_timer microseconds: when this snapshot was taken, when the display
+  // should next take a frame from the mailbox (the snapshot time when it
+  // would take one at once), and the expected spacing of the slots after it.
+  std::uint8_t display_credits = 0;
+  std::uint8_t display_room = 0;
+  std::uint32_t snapshot_us = 0;
+  std::uint32_t next_slot_us = 0;
+  std::uint32_t slot_interval_us = 0;
 };
 
 bool encode_receiver_status_v2(
@@ -35,4 +97,343 @@ bool encode_receiver_status_v2(
     std::uint8_t* output,
     std::size_t output_size);
 
+// Status v3 ("LGS3") splits telemetry into pages chosen with
+// SELECT_STATUS_PAGE. Page 0 is the v2 block, which stays the default. Every
+// v3 page starts with a 16-byte header: magic, version, page, page count,
+// flags, a u32 snapshot generation, the u16 payload length, and the v2
+// capability and status flag bytes.
+enum class StatusPage : std::uint8_t {
+  V2 = 0,
+  Core = 1,
+  Histograms = 2,
+  Memory = 3,
+  Config = 4,
+  Transport = 5,
+  Links = 6,
+  Clips = 7,
+  Power = 8,
+};
+
+constexpr std::uint8_t kStatusProtocolVersion3 = 3;
+constexpr std::uint8_t kStatusPageCount = 9;
+constexpr std::size_t kStatusV3HeaderBytes = 16;
+// Header flag: the transfer was too short for the page, so only the header
+// was written.
+constexpr std::uint8_t kStatusPageTruncated = 0x01;
+
+constexpr std::size_t kStatusCorePageBytes = 100;
+constexpr std::size_t kStatusHistogramPageBytes =
+    20 + kLatencyStageCount * (4 + kLatencyBuckets * 4);
+constexpr std::size_t kStatusMemoryPageBytes = 56;
+constexpr std::size_t kStatusConfigPageBytes = 56;
+// Deepest SPI receive ring the transport page can describe.
+constexpr std::size_t kMaxSpiRingSlots = 16;
+constexpr std::size_t kStatusTransportPageBytes = 32 + kMaxSpiRingSlots * 8;
+// SPI slave links the links page can describe.
+constexpr std::size_t kMaxSpiLinks = 2;
+constexpr std::size_t kStatusLinksPageBytes = 44 + kMaxSpiLinks * 24;
+// Bytes of the frame chosen with READ_RECORDER carried by the clips page.
+constexpr std::size_t kClipReadbackBytes = 768;
+constexpr std::size_t kStatusClipsPageBytes = 64 + kClipReadbackBytes;
+// Strips the power page reports, whatever LEDGRID_MAX_LANES is.
+constexpr std::size_t kMaxPowerStrips = 16;
+constexpr std::size_t kStatusPowerPageBytes = 48 + kMaxPowerStrips * 4;
+
+struct StatusPageHeader {
+  std::uint32_t generation = 0;
+  std::uint8_t capabilities = 0;
+  std::uint8_t flags = 0;
+};
+
+struct ReceiverMemoryStatus {
+  std::uint16_t led_capacity = 0;
+  std::uint8_t mailbox_tier = 0;
+  std::uint8_t history_tier = 0;
+  bool zero_copy_mailbox = false;
+  std::uint32_t rgb_bytes = 0;
+  std::uint32_t spi_buffer_bytes = 0;
+  std::uint32_t led_dma_bytes = 0;
+  std::uint32_t free_internal = 0;
+  std::uint32_t min_free_internal = 0;
+  std::uint32_t largest_internal_block = 0;
+  std::uint32_t free_psram = 0;
+  std::uint32_t largest_psram_block = 0;
+};
+
+// Display modes echoed by the config page.
+constexpr std::uint8_t kDisplaySerial = 0;
+constexpr std::uint8_t kDisplayPipelined = 1;
+constexpr std::uint8_t kDisplayStreaming = 2;
+
+// Config page byte 37: frame formats beyond RGB. Status byte 7 has no bits
+// left, so newer optional commands are advertised here.
+constexpr std::uint8_t kFrameFormatIndexed = 0x01;
+// SET_ALL_PART frames striped across a second SPI link.
+constexpr std::uint8_t kFrameFormatStriped = 0x02;
+// Clip upload and playback, and the flight recorder; needs the PSRAM store.
+constexpr std::uint8_t kFrameFormatClips = 0x04;
+// The per-frame current estimate, SET_POWER_BUDGET and the power page.
+constexpr std::uint8_t kFrameFormatPowerLimit = 0x08;
+// SET_ALL_CHUNKED frames with a CRC per strip, and the v2 chunk tail.
+constexpr std::uint8_t kFrameFormatChunked = 0x10;
+// SET_LAYOUT and COMMIT_LAYOUT, for frames sent in logical raster order.
+constexpr std::uint8_t kFrameFormatLayout = 0x20;
+
+// Config page byte 46: the stored layout map is in use; or it is stored, but
+// made for another geometry or not yet handed to the encoder.
+constexpr std::uint8_t kLayoutNone = 0;
+constexpr std::uint8_t kLayoutActive = 1;
+constexpr std::uint8_t kLayoutInactive = 2;
+
+struct ReceiverConfigStatus {
+  std::uint8_t active_strips = 0;
+  std::uint8_t max_lanes = 0;
+  std::uint16_t leds_per_strip = 0;
+  std::uint16_t led_capacity = 0;
+  std::uint8_t brightness = 0;
+  std::uint8_t transition_easing = 0;
+  std::uint16_t transition_ms = 0;
+  std::uint8_t latch_mode = 0;
+  std::uint8_t pacing_depth = 0;
+  std::uint16_t paced_fps = 0;
+  std::uint8_t crc_engine = 0;
+  std::uint8_t encoder_kernel = 0;
+  std::uint8_t display_mode = 0;
+  std::uint8_t histogram_stage = kNoLatencyHistogram;
+  std::uint16_t status_refresh_us = 0;
+  std::uint8_t effect_kind = 0;
+  std::uint8_t frame_formats = 0;
+  std::uint16_t effect_ticks_per_second = 0;
+  std::uint32_t effect_frames = 0;
+  // Cores sharing each frame's encode, and the percent of the last frame's
+  // columns the helper core encoded.
+  std::uint8_t encode_cores = 1;
+  std::uint8_t encode_helper_share = 0;
+  // The stored layout map, version 0 for none, and whether it is in use.
+  std::uint8_t layout_state = kLayoutNone;
+  std::uint32_t layout_version = 0;
+  std::uint16_t layout_crc = 0;
+  std::uint16_t layout_rejected = 0;
+};
+
+struct SpiSlotStatus {
+  std::uint32_t completions = 0;
+  // Longest wait from the transaction completing to the receive task taking
+  // it, saturated.
+  std::uint16_t max_service_us = 0;
+  // Times the slot fell out of the ring because re-queueing it failed,
+  // saturated; the receive task keeps retrying it.
+  std::uint16_t requeue_failures = 0;
+};
+
+struct ReceiverTransportStatus {
+  std::uint8_t ring_depth = 0;
+  // Most completed transactions ever waiting for the receive task; reaching
+  // ring_depth means no receive buffer was armed.
+  std::uint8_t max_backlog = 0;
+  std::uint8_t task_core = 0;
+  std::uint8_t task_priority = 0;
+  std::uint32_t ring_drained = 0;
+  std::uint32_t spi_queue_errors = 0;
+  std::uint32_t packets = 0;
+  SpiSlotStatus slots[kMaxSpiRingSlots] = {};
+};
+
+// Counters of one SPI slave link, kept apart so a flaky link shows up on its
+// own rather than in the totals.
+struct SpiLinkStatus {
+  std::uint8_t host = 0;
+  std::uint8_t max_backlog = 0;
+  std::uint8_t queued_transactions = 0;
+  bool has_miso = false;
+  std::uint32_t packets = 0;
+  std::uint32_t crc_ok_packets = 0;
+  std::uint32_t crc_errors = 0;
+  std::uint32_t spi_queue_errors = 0;
+  std::uint32_t ring_drained = 0;
+};
+
+struct ReceiverLinksStatus {
+  std::uint8_t link_count = 0;
+  // SET_ALL_PART reassembly; see FrameAssembler.
+  std::uint32_t parts = 0;
+  std::uint32_t frames_assembled = 0;
+  std::uint32_t frames_abandoned = 0;
+  std::uint32_t stale_parts = 0;
+  std::uint32_t rejected_parts = 0;
+  std::uint16_t last_assembled_sequence = 0;
+  SpiLinkStatus links[kMaxSpiLinks] = {};
+};
+
+// Clips page states.
+constexpr std::uint8_t kClipsIdle = 0;
+constexpr std::uint8_t kClipsPlaying = 1;
+constexpr std::uint8_t kClipsRecording = 2;
+// Readback flags.
+constexpr std::uint8_t kClipReadbackValid = 0x01;
+constexpr std::uint8_t kClipReadbackIndexed = 0x02;
+
+struct ReceiverClipStatus {
+  std::uint16_t capacity = 0;
+  std::uint8_t state = kClipsIdle;
+  std::uint32_t frame_bytes = 0;
+  std::uint16_t first = 0;
+  std::uint16_t count = 0;
+  std::uint16_t current = 0;
+  std::uint16_t loops = 0;
+  std::uint16_t loops_done = 0;
+  std::uint32_t frames_played = 0;
+  // Frames the recorder holds, and every frame it has taken since boot.
+  std::uint16_t recorded = 0;
+  std::uint32_t frames_recorded = 0;
+  // Clip and recorder commands refused: bad bounds, missing frames, or the
+  // store busy in the other mode.
+  std::uint16_t rejected = 0;
+  // A slice of the recorded frame chosen with READ_RECORDER, starting at
+  // readback_offset bytes into it; `readback` points at readback_bytes.
+  std::uint16_t readback_back = 0;
+  std::uint8_t readback_flags = 0;
+  std::uint32_t readback_sequence = 0;
+  std::uint32_t readback_shown_us = 0;
+  std::uint32_t readback_offset = 0;
+  std::uint16_t readback_bytes = 0;
+  const std::uint8_t* readback = nullptr;
+};
+
+// The current estimate of the most recently encoded frame, in milliamps.
+struct ReceiverPowerStatus {
+  std::uint16_t budget_total_ma = 0;
+  std::uint16_t budget_strip_ma = 0;
+  std::uint16_t channel_ua[3] = {};
+  std::uint16_t idle_ua = 0;
+  std::uint8_t requested_brightness = 0;
+  std::uint8_t applied_brightness = 0;
+  std::uint8_t strip_count = 0;
+  std::uint8_t busiest_strip = 0;
+  // The frame at the requested brightness, then as encoded.
+  std::uint32_t demand_ma = 0;
+  std::uint32_t total_ma = 0;
+  std::uint32_t limited_frames = 0;
+  std::uint32_t strip_ma[kMaxPowerStrips] = {};
+};
+
+// Each returns the number of bytes written: the whole page, just the header
+// with kStatusPageTruncated when the page does not fit, or 0 when not even
+// the header fits.
+std::size_t encode_status_core_page(
+    const StatusPageHeader& header,
+    const ReceiverStatusV2& status,
+    std::uint8_t* output,
+    std::size_t output_size);
+std::size_t encode_status_histogram_page(
+    const StatusPageHeader& header,
+    const LatencySnapshot (&snapshots)[kLatencyStageCount],
+    std::uint8_t* output,
+    std::size_t output_size);
+std::size_t encode_status_memory_page(
+    const StatusPageHeader& header,
+    const ReceiverMemoryStatus& memory,
+    std::uint8_t* output,
+    std::size_t output_size);
+std::size_t encode_status_config_page(
+    const StatusPageHeader& header,
+    const ReceiverConfigStatus& config,
+    std::uint8_t* output,
+    std::size_t output_size);
+std::size_t encode_status_transport_page(
+    const StatusPageHeader& header,
+    const ReceiverTransportStatus& transport,
+    std::uint8_t* output,
+    std::size_t output_size);
+std::size_t encode_status_links_page(
+    const StatusPageHeader& header,
+    const ReceiverLinksStatus& links,
+    std::uint8_t* output,
+    std::size_t output_size);
+std::size_t encode_status_clips_page(
+    const StatusPageHeader& header,
+    const ReceiverClipStatus& clips,
+    std::uint8_t* output,
+    std::size_t output_size);
+std::size_t encode_status_power_page(
+    const StatusPageHeader& header,
+    const ReceiverPowerStatus& power,
+    std::uint8_t* output,
+    std::size_t output_size);
+
+// Command bytes: the first byte of every SPI packet, ahead of its payload
+// and the CRC-16 over both.
+constexpr std::uint8_t kCmdSetPixel = 0x01;
+constexpr std::uint8_t kCmdSetBrightness = 0x02;
+constexpr std::uint8_t kCmdShow = 0x03;
+constexpr std::uint8_t kCmdClear = 0x04;
+constexpr std::uint8_t kCmdSetRange = 0x05;
+constexpr std::uint8_t kCmdSetAll = 0x06;
+constexpr std::uint8_t kCmdConfig = 0x07;
+constexpr std::uint8_t kCmdBatch = 0x08;
+constexpr std::uint8_t kCmdSetAllRle = 0x09;
+constexpr std::uint8_t kCmdSetAllDelta = 0x0A;
+constexpr std::uint8_t kCmdSetTransition = 0x0B;
+constexpr std::uint8_t kCmdSetColorCurve = 0x0C;
+constexpr std::uint8_t kCmdSetLatch = 0x0D;
+constexpr std::uint8_t kCmdLatch = 0x0E;
+constexpr std::uint8_t kCmdSetPacing = 0x0F;
+constexpr std::uint8_t kCmdSelectHistogram = 0x10;
+constexpr std::uint8_t kCmdResetHistograms = 0x11;
+constexpr std::uint8_t kCmdSelectStatusPage = 0x12;
+constexpr std::uint8_t kCmdSetEffect = 0x13;
+constexpr std::uint8_t kCmdSetEffectPalette = 0x14;
+constexpr std::uint8_t kCmdSetPalette = 0x15;
+constexpr std::uint8_t kCmdSetAllIndexed = 0x16;
+constexpr std::uint8_t kCmdSetAllPart = 0x17;
+constexpr std::uint8_t kCmdClipFrame = 0x18;
+constexpr std::uint8_t kCmdClipPlay = 0x19;
+constexpr std::uint8_t kCmdSetRecorder = 0x1A;
+constexpr std::uint8_t kCmdReadRecorder = 0x1B;
+constexpr std::uint8_t kCmdSetPowerBudget = 0x1C;
+constexpr std::uint8_t kCmdSetAllChunked = 0x1D;
+constexpr std::uint8_t kCmdSetLayout = 0x1E;
+constexpr std::uint8_t kCmdCommitLayout = 0x1F;
+constexpr std::uint8_t kCmdPing = 0xFF;
+
+// Sub-operations of a batch command reuse the top-level opcodes. Pixel
+// indices and range counts are big-endian u16; SHOW may only end a batch.
+constexpr std::uint8_t kBatchSetPixel = 0x01;
+constexpr std::uint8_t kBatchSetBrightness = 0x02;
+constexpr std::uint8_t kBatchShow = 0x03;
+constexpr std::uint8_t kBatchSetRange = 0x05;
+
+struct BatchOp {
+  std::uint8_t opcode = 0;
+  std::uint16_t start = 0;
+  std::uint16_t count = 0;
+  std::uint8_t brightness = 0;
+  const std::uint8_t* rgb = nullptr;
+};
+
+// Walks the sub-operations of a batch payload (the bytes after the command
+// byte), bounds-checking each against the active pixel count. next() returns
+// false at the end of the payload or at the first malformed operation.
+class BatchReader {
+ public:
+  BatchReader(const std::uint8_t* payload, std::size_t length, std::size_t total_leds);
+
+  bool next(BatchOp* op);
+  bool failed() const { return failed_; }
+
+ private:
+  bool fail();
+
+  const std::uint8_t* payload_;
+  std::size_t length_;
+  std::size_t total_leds_;
+  std::size_t offset_ = 0;
+  bool failed_ = false;
+};
+
+// True when every operation is well formed and in bounds, so a batch can be
+// applied all-or-nothing.
+bool validate_command_batch(
+    const std::uint8_t* payload, std::size_t length, std::size_t total_leds);
+
 }  // namespace ledgrid
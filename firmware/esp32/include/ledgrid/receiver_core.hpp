@@ -0,0 +1,302 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "ledgrid/crc16.hpp"
+#include "ledgrid/frame_assembly.hpp"
+#include "ledgrid/frame_display.hpp"
+#include "ledgrid/frame_mailbox.hpp"
+#include "ledgrid/latency_histogram.hpp"
+#include "ledgrid/pixel_span.hpp"
+#include "ledgrid/ws2812_encoder.hpp"
+
+namespace ledgrid {
+
+// Pixels follow the command byte in both SPI packets and mailbox buffers.
+constexpr std::size_t kFramePixelOffset = 1;
+constexpr std::size_t kPacketCrcBytes = 2;
+// Working frame tag of a frame no XOR delta may apply to.
+constexpr std::uint8_t kUntaggedFrame = 0;
+
+// True for commands that write the working frame, which take the wall back
+// from whatever else was drawing it.
+bool command_writes_pixels(std::uint8_t command);
+
+class ReceiverClock {
+ public:
+  // Microseconds on the clock that stamps packets; wraps.
+  virtual std::uint32_t now_us() = 0;
+
+ protected:
+  ~ReceiverClock() = default;
+};
+
+// One packet as it came off the wire, CRC still attached.
+struct ReceivedPacket {
+  std::uint8_t* data = nullptr;
+  std::size_t bytes = 0;
+  // Chip-select release, on the receiver clock.
+  std::uint32_t received_us = 0;
+};
+
+// Where packets come from: the SPI slave rings on the device, a replayed
+// capture in the simulator.
+class PacketTransport {
+ public:
+  // Takes the next completed packet; false when none is waiting.
+  virtual bool receive(ReceivedPacket* packet) = 0;
+  // Hands back a buffer once the packet has been handled: its own, or the
+  // mailbox buffer it was traded for. `valid` says whether it passed its CRC.
+  virtual void finish(std::uint8_t* buffer, bool valid) = 0;
+
+ protected:
+  ~PacketTransport() = default;
+};
+
+// Everything the core leaves to the firmware around it. Receive-side hooks
+// run on the task that handles packets, frame_shown() and frame_released() on
+// the display task.
+class ReceiverHooks {
+ public:
+  // A command the core does not handle; `data` starts with the command byte
+  // and `length` excludes the CRC.
+  virtual void run_command(std::uint8_t* /*data*/, std::size_t /*length*/) {}
+  // Runs before any command for which command_writes_pixels() holds.
+  virtual void before_pixel_write() {}
+  // A frame has been committed to the mailbox for the display.
+  virtual void frame_published() {}
+  // Something status reports has changed.
+  virtual void state_changed() {}
+  // The indexed palette changed; the display should use it from its next
+  // frame.
+  virtual void palette_changed(const std::uint8_t* /*palette*/) {}
+  // The display has taken a frame's pixels, which stay valid for the call.
+  virtual void frame_shown(const std::uint8_t* /*pixels*/,
+                           const FrameMetadata& /*metadata*/) {}
+  // The display has handed back the mailbox slot of a frame it showed.
+  virtual void frame_released() {}
+  // A packet-sized buffer to assemble striped and chunked frames in, or null.
+  virtual std::uint8_t* allocate_packet_buffer() { return nullptr; }
+
+ protected:
+  ~ReceiverHooks() = default;
+};
+
+// Frame storage the core works in, allocated by its owner. With a zero-copy
+// mailbox every mailbox buffer is the size of a transport buffer and trades
+// places with them; otherwise they hold kFramePixelOffset + frame_bytes and
+// packets are copied in. The working frame holds frame_bytes.
+struct ReceiverBuffers {
+  std::uint8_t* mailbox[kFrameMailboxSlots] = {};
+  bool zero_copy_mailbox = false;
+  std::uint8_t* working_frame = nullptr;
+  std::size_t frame_bytes = 0;
+};
+
+// The receiver's frame pipeline without the hardware: packet checks, the
+// frame commands, the working frame and mailbox, and display accounting.
+// One task feeds it packets and publishes frames; one display task takes
+// frames and reports what was shown, through the same lock-free mailbox as
+// before. Counters and histograms may be read from any task.
+class ReceiverCore {
+ public:
+  ReceiverCore(ReceiverClock& clock, FrameDisplay& display, ReceiverHooks& hooks)
+      : clock_(clock), display_(display), hooks_(hooks) {}
+
+  void begin(const ReceiverBuffers& buffers,
+             std::uint8_t strip_count,
+             std::uint16_t leds_per_strip,
+             Crc16Engine crc_engine);
+
+  // --- Receive side ---
+
+  // Handles every packet the transport has waiting; returns how many.
+  std::size_t service_transport(PacketTransport& transport);
+  // Checks one packet's CRC and runs it. Returns the buffer to give back to
+  // the transport; `valid` says whether the packet passed.
+  std::uint8_t* handle_packet(const ReceivedPacket& packet, bool* valid);
+  // Runs a command whose CRC has already been checked; the return value is
+  // as for handle_packet().
+  std::uint8_t* run_command(std::uint8_t* data, std::size_t length);
+
+  bool publish_working_frame();
+  // Publishes pixels held outside the mailbox, such as a clip store frame,
+  // without copying them. They stay in use until external_frames_in_use()
+  // turns false.
+  bool publish_external_frame(const std::uint8_t* pixels);
+  bool external_frames_in_use();
+  // Pixels of the newest frame when they still live outside the working
+  // frame, else null; sync_working_frame() copies them in.
+  const std::uint8_t* adopted_frame() const { return adopted_frame_; }
+  void sync_working_frame();
+  // The working frame for a caller about to redraw all of it.
+  std::uint8_t* begin_full_frame();
+  // Stamps the frames published next, as a packet's chip-select release
+  // would.
+  void set_received_us(std::uint32_t us) { packet_received_us_ = us; }
+  // Clears the wall to black at the new geometry.
+  void set_geometry(std::uint8_t strip_count, std::uint16_t leds_per_strip);
+  void set_indexed_palette(const std::uint8_t* palette);
+
+  std::uint8_t strip_count() const { return strip_count_; }
+  std::uint16_t leds_per_strip() const { return leds_per_strip_; }
+  std::size_t total_leds() const {
+    return static_cast<std::size_t>(strip_count_) * leds_per_strip_;
+  }
+  std::size_t rgb_bytes() const { return total_leds() * 3U; }
+  std::uint8_t brightness() const { return brightness_; }
+  std::uint16_t transition_ms() const { return transition_ms_; }
+  std::uint8_t transition_easing() const { return transition_easing_; }
+  bool delta_rejected() const { return delta_rejected_; }
+  Crc16Engine crc_engine() const { return crc_engine_; }
+  std::uint8_t* mailbox_buffer(std::size_t slot) const { return mailbox_[slot]; }
+
+  LatestFrameMailbox& mailbox() { return mailbox_state_; }
+  const LatestFrameMailbox& mailbox() const { return mailbox_state_; }
+  const FrameAssembler& assembler() const { return assembler_; }
+
+  // --- Display side ---
+
+  // Takes the next mailbox frame for display and notes when it was received.
+  int take_frame(FrameMetadata* metadata);
+  const std::uint8_t* frame_pixels(int slot, const FrameMetadata& metadata) const;
+  // Submits a taken frame with `dirty` as its changed columns.
+  SubmitResult submit_frame(int slot, const FrameMetadata& metadata, PixelSpan dirty);
+  // Releases a taken frame's slot once the display no longer needs its
+  // pixels, or returns it (and its changes) to the mailbox if not `shown`.
+  void finish_frame(int slot, const FrameMetadata& metadata, bool shown);
+  // submit_frame() with the frame's own changes, then finish_frame().
+  SubmitResult present_frame(int slot, const FrameMetadata& metadata);
+  // Fills every free display buffer with the next frame; false on a failed
+  // submit, which counts as a display error.
+  bool service_display();
+  void record_encode(SubmitResult result);
+  void record_displayed(std::uint32_t sequence);
+  void retire_completed_transfers();
+  void note_display_error() { display_errors_.fetch_add(1, std::memory_order_relaxed); }
+
+  // --- Counters, any task ---
+
+  void record_latency(LatencyStage stage, std::uint32_t us) {
+    histograms_[static_cast<std::size_t>(stage)].record(us);
+  }
+  const LatencyHistogram& histogram(LatencyStage stage) const {
+    return histograms_[static_cast<std::size_t>(stage)];
+  }
+  void reset_histograms();
+
+  std::uint32_t packets() const { return packets_.load(std::memory_order_relaxed); }
+  std::uint32_t crc_ok_packets() const {
+    return crc_ok_packets_.load(std::memory_order_relaxed);
+  }
+  std::uint32_t crc_errors() const { return crc_errors_.load(std::memory_order_relaxed); }
+  std::uint32_t display_errors() const {
+    return display_errors_.load(std::memory_order_relaxed);
+  }
+  std::uint16_t last_crc_us() const {
+    return last_crc_us_.load(std::memory_order_relaxed);
+  }
+  std::uint16_t last_copy_us() const {
+    return last_copy_us_.load(std::memory_order_relaxed);
+  }
+  std::uint32_t last_accepted_sequence() const {
+    return last_accepted_sequence_.load(std::memory_order_relaxed);
+  }
+  std::uint32_t last_displayed_sequence() const {
+    return last_displayed_sequence_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // Receipt times of frames taken by the display, looked up by sequence when
+  // their transfer completes.
+  struct FrameReceipt {
+    std::uint32_t sequence = 0;
+    std::uint32_t received_us = 0;
+  };
+  static constexpr std::size_t kFrameReceipts = 4;
+
+  std::uint8_t* mailbox_frame(int slot) const {
+    return mailbox_[slot] + kFramePixelOffset;
+  }
+  void mark_pixels_dirty(std::size_t first_pixel, std::size_t count);
+  bool current_frame_indexed() const {
+    return adopted_frame_ != nullptr && adopted_indexed_;
+  }
+  const std::uint8_t* current_frame() const {
+    return adopted_frame_ != nullptr ? adopted_frame_ : working_frame_;
+  }
+  void mark_changed_columns(const std::uint8_t* next, bool indexed);
+  void replace_working_frame(const std::uint8_t* pixels, bool indexed);
+  int begin_frame_write();
+  void record_copy(std::uint32_t started_us);
+  bool commit_frame(int slot, bool indexed = false, const std::uint8_t* pixels = nullptr);
+  std::uint8_t* publish_received_frame(std::uint8_t* packet, bool indexed);
+  void apply_command_batch(const std::uint8_t* payload, std::size_t length);
+  std::uint32_t now() { return clock_.now_us(); }
+
+  ReceiverClock& clock_;
+  FrameDisplay& display_;
+  ReceiverHooks& hooks_;
+
+  std::uint8_t* mailbox_[kFrameMailboxSlots] = {};
+  bool zero_copy_mailbox_ = false;
+  std::size_t frame_bytes_ = 0;
+  Crc16Engine crc_engine_ = Crc16Engine::Nibble;
+  // Lock-free: the receive side is its only writer and the display side its
+  // only reader.
+  LatestFrameMailbox mailbox_state_;
+  // SET_ALL_PART frames are gathered here, laid out like a SET_ALL packet so
+  // a complete frame publishes like one. Allocated with the first part.
+  std::uint8_t* assembly_buffer_ = nullptr;
+  FrameAssembler assembler_;
+
+  std::uint8_t* working_frame_ = nullptr;
+  // Columns touched since the working frame was last published.
+  PixelSpan working_dirty_ = PixelSpan::all();
+  // Set after a zero-copy SET_ALL: the newest pixels live in this buffer and
+  // are copied into the working frame only when a command needs them.
+  const std::uint8_t* adopted_frame_ = nullptr;
+  // The adopted frame holds one palette index per pixel; syncing expands it
+  // through indexed_palette_.
+  bool adopted_indexed_ = false;
+  std::uint8_t indexed_palette_[kPaletteBytes] = {};
+  // Host-chosen tag of the working frame, set by compressed frames. An XOR
+  // delta only applies on top of the exact frame it was computed against;
+  // any other pixel write clears the tag so a stale delta is ignored until a
+  // keyframe.
+  std::uint8_t working_frame_tag_ = kUntaggedFrame;
+  // Reported in status so the host re-sends a keyframe instead of waiting out
+  // its keyframe interval; cleared by the next RLE frame.
+  bool delta_rejected_ = false;
+  // Slots published with external pixels, a bit per slot.
+  static_assert(kFrameMailboxSlots <= 8, "external_slots_ has a bit per slot");
+  std::uint8_t external_slots_ = 0;
+
+  std::uint8_t strip_count_ = 0;
+  std::uint16_t leds_per_strip_ = 0;
+  std::uint8_t brightness_ = 50;
+  // Applied to every frame published after SET_TRANSITION; zero cuts directly.
+  std::uint16_t transition_ms_ = 0;
+  std::uint8_t transition_easing_ = 0;
+  std::uint32_t next_sequence_ = 1;
+  // Release time of the packet being processed; tags the frames it publishes.
+  std::uint32_t packet_received_us_ = 0;
+
+  // Only the display side touches these.
+  FrameReceipt frame_receipts_[kFrameReceipts];
+  std::size_t next_frame_receipt_ = 0;
+
+  LatencyHistogram histograms_[kLatencyStageCount];
+  std::atomic<std::uint32_t> packets_{0};
+  std::atomic<std::uint32_t> crc_ok_packets_{0};
+  std::atomic<std::uint32_t> crc_errors_{0};
+  std::atomic<std::uint32_t> display_errors_{0};
+  std::atomic<std::uint16_t> last_crc_us_{0};
+  std::atomic<std::uint16_t> last_copy_us_{0};
+  std::atomic<std::uint32_t> last_accepted_sequence_{0};
+  std::atomic<std::uint32_t> last_displayed_sequence_{0};
+};
+
+}  // namespace ledgrid
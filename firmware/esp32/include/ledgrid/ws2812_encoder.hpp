@@ -1,13 +1,89 @@
 #pragma once
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
 
+// Lanes compiled into the encoder tables and the receiver buffers. 16 needs a
+// 16-bit LCD/I80 bus and doubles the DMA buffer size.
+#ifndef LEDGRID_MAX_LANES
+#define LEDGRID_MAX_LANES 8
+#endif
+
 namespace ledgrid {
 
 constexpr std::uint32_t kWs2812SampleRateHz = 2400000;
 constexpr std::uint16_t kWs2812ResetUs = 300;
-constexpr std::uint8_t kMaxParallelStrips = 8;
+constexpr std::uint8_t kMaxParallelStrips = LEDGRID_MAX_LANES;
+// Each byte of a sample drives eight lanes. Up to eight strips use one-byte
+// samples; more use two-byte little-endian samples with lanes 8-15 in the
+// second byte.
+constexpr std::uint8_t kLanesPerSampleByte = 8;
+static_assert(kMaxParallelStrips == 8 || kMaxParallelStrips == 16,
+              "the LCD/I80 bus is 8 or 16 bits wide");
+// Blend weights run from 0 (all `from`) to kBlendWeightMax (all `to`).
+constexpr std::uint16_t kBlendWeightMax = 256;
+
+// Correction curves (gamma, white balance, ...) applied to each RGB channel of
+// each lane before brightness. Indexed [lane][0=R, 1=G, 2=B][value].
+struct ChannelCurves {
+  std::array<std::array<std::uint8_t, 256>, 3> curve[kMaxParallelStrips];
+};
+
+using LaneExpandBits = std::uint64_t[3][256];
+using LaneExpandValues = std::uint8_t[3][256];
+
+// Expanded sample bits for each lane, channel and input value with curves
+// and brightness already applied and the bits shifted onto their lane within
+// its sample byte, so the hot loop is one lookup and OR per lane. A view of
+// rows held in an ExpandTableStorage; build once per change.
+struct ParallelExpandTables {
+  LaneExpandBits* bits = nullptr;
+  // The corrected and scaled channel bytes themselves, for kernels that
+  // transpose lane bytes rather than OR expanded bits.
+  LaneExpandValues* values = nullptr;
+};
+
+template <std::size_t Lanes>
+struct ExpandTableStorage {
+  LaneExpandBits bits[Lanes];
+  LaneExpandValues values[Lanes];
+
+  ParallelExpandTables tables() { return {bits, values}; }
+};
+
+// Every lane's rows, which per-lane curves need: 54 KB per eight lanes.
+using LaneExpandTableStorage = ExpandTableStorage<kMaxParallelStrips>;
+// Lane 0's rows alone, about 7 KB: all that build_uniform_expand_table() and
+// the kernels selected for uniform tables touch.
+using UniformExpandTableStorage = ExpandTableStorage<1>;
+
+// Frames may also arrive as one index per pixel into a 256-entry RGB palette.
+constexpr std::size_t kPaletteEntries = 256;
+constexpr std::size_t kPaletteBytes = kPaletteEntries * 3;
+
+// Expanded sample bits for every palette entry, indexed
+// [row][0=R, 1=G, 2=B][entry], with curves and brightness applied to the
+// entry's colour. An indexed pixel is then one lookup per lane and channel,
+// with no detour through RGB bytes. Kernels selected for uniform tables read
+// only row 0 and shift it onto each lane; otherwise row k is lane k, already
+// shifted. 6 KB per row.
+using PaletteExpandRow = std::array<std::array<std::uint64_t, kPaletteEntries>, 3>;
+
+enum class EncoderKernel : std::uint8_t {
+  // Reference: one 64-bit expansion lookup per lane, eight strided byte stores.
+  Table,
+  // Branch-free 8x8 bit transpose of the lane bytes, then six aligned 32-bit
+  // stores per channel and sample byte. Needs a 4-byte aligned output buffer.
+  Transpose,
+};
+
+const char* encoder_kernel_name(EncoderKernel kernel);
+
+// Sample byte j of the result holds bit (7 - j) of every lane byte, lane k in
+// bit k, where lane k is byte k of `lanes`. This is what the Table kernel's
+// expansion lookups and ORs produce for each eight-lane sample byte.
+std::uint64_t transpose_lane_bits(std::uint64_t lanes);
 
 struct EncodeResult {
   bool ok = false;
@@ -18,11 +94,23 @@ std::size_t ws2812_reset_samples(
     std::uint16_t reset_us = kWs2812ResetUs,
     std::uint32_t sample_rate_hz = kWs2812SampleRateHz);
 
+// Size of a waveform with one-byte samples, i.e. up to eight strips.
 std::size_t ws2812_encoded_size(
     std::uint16_t leds_per_strip,
     std::uint16_t reset_us = kWs2812ResetUs,
     std::uint32_t sample_rate_hz = kWs2812SampleRateHz);
 
+// 1 for up to eight strips, 2 for up to sixteen; 0 if out of range.
+std::uint8_t ws2812_sample_bytes(std::uint8_t strip_count);
+
+// Size of a waveform for `strip_count` lanes; the bus width, and so the
+// buffer, doubles past eight strips.
+std::size_t parallel_encoded_size(
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t reset_us = kWs2812ResetUs,
+    std::uint32_t sample_rate_hz = kWs2812SampleRateHz);
+
 bool initialize_parallel_grb_waveform(
     std::uint8_t strip_count,
     std::uint16_t leds_per_strip,
@@ -44,6 +132,297 @@ EncodeResult encode_parallel_grb_pixels(
     std::uint16_t reset_us = kWs2812ResetUs,
     std::uint32_t sample_rate_hz = kWs2812SampleRateHz);
 
+// Re-encodes only pixel columns [first_pixel, end_pixel) of a buffer that
+// already holds an encoding of the same geometry. Columns outside the span
+// keep whatever an earlier call wrote. The result still covers the full frame.
+EncodeResult encode_parallel_grb_pixel_span(
+    const std::uint8_t* rgb,
+    std::size_t rgb_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint8_t brightness,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* output,
+    std::size_t output_capacity,
+    std::uint16_t reset_us = kWs2812ResetUs,
+    std::uint32_t sample_rate_hz = kWs2812SampleRateHz);
+
+// Same as encode_parallel_grb_pixel_span() for the per-channel blend
+// from + (to - from) * weight / 256, computed inside the encode pass so no
+// intermediate frame is written.
+EncodeResult encode_parallel_grb_blend_span(
+    const std::uint8_t* from,
+    const std::uint8_t* to,
+    std::size_t rgb_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint8_t brightness,
+    std::uint16_t weight,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* output,
+    std::size_t output_capacity,
+    std::uint16_t reset_us = kWs2812ResetUs,
+    std::uint32_t sample_rate_hz = kWs2812SampleRateHz);
+
+void set_identity_curves(ChannelCurves* curves);
+
+// `curves` may be null for identity correction. `tables` must view a
+// LaneExpandTableStorage, as must those passed to the table encoders below.
+void build_parallel_expand_tables(
+    const ChannelCurves* curves,
+    std::uint8_t brightness,
+    ParallelExpandTables* tables);
+
+// Span and blend encoders driven by prebuilt tables instead of a brightness;
+// otherwise identical to the functions above.
+EncodeResult encode_parallel_grb_table_span(
+    const ParallelExpandTables& tables,
+    const std::uint8_t* rgb,
+    std::size_t rgb_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* output,
+    std::size_t output_capacity,
+    std::uint16_t reset_us = kWs2812ResetUs,
+    std::uint32_t sample_rate_hz = kWs2812SampleRateHz);
+
+EncodeResult encode_parallel_grb_table_blend_span(
+    const ParallelExpandTables& tables,
+    const std::uint8_t* from,
+    const std::uint8_t* to,
+    std::size_t rgb_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t weight,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* output,
+    std::size_t output_capacity,
+    std::uint16_t reset_us = kWs2812ResetUs,
+    std::uint32_t sample_rate_hz = kWs2812SampleRateHz);
+
+// True when every lane and channel shares one curve. Tables for such curves
+// only need their lane-0 red row; see build_uniform_expand_table().
+bool curves_are_uniform(const ChannelCurves& curves);
+
+// Fills only tables->bits[0][0] from `curve` (null for identity). Kernels
+// selected for uniform tables shift that row onto each lane themselves, so a
+// brightness change rebuilds 2 KB instead of the whole table.
+void build_uniform_expand_table(
+    const std::array<std::uint8_t, 256>* curve,
+    std::uint8_t brightness,
+    ParallelExpandTables* tables);
+
+// Span kernel compiled for one strip count and table layout. Arguments are not
+// validated; call through encode_parallel_grb_kernel_span(). `output` points at
+// the first encoded column, not the frame start. `from` and `weight` are only
+// read by blend kernels.
+using ParallelSpanKernel = void (*)(
+    const ParallelExpandTables& tables,
+    const std::uint8_t* from,
+    const std::uint8_t* to,
+    std::uint16_t weight,
+    std::uint16_t leds_per_strip,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* output);
+
+// Span kernel for palette-indexed frames, one index byte per pixel in
+// lane-major order. Same contract as ParallelSpanKernel.
+using IndexedSpanKernel = void (*)(
+    const PaletteExpandRow* rows,
+    const std::uint8_t* indices,
+    std::uint16_t leds_per_strip,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* output);
+
+struct ParallelEncodeKernels {
+  ParallelSpanKernel span = nullptr;
+  ParallelSpanKernel blend = nullptr;
+  // Always a lookup kernel: a transpose would need the corrected channel
+  // bytes, which is the unpack an indexed frame avoids.
+  IndexedSpanKernel indexed = nullptr;
+  std::uint8_t strip_count = 0;
+  bool uniform_tables = false;
+  EncoderKernel kind = EncoderKernel::Table;
+};
+
+// Picks the kernels for a geometry. Callers select once per configuration
+// change rather than per frame; an unsupported strip count yields null kernels.
+ParallelEncodeKernels select_parallel_encode_kernels(
+    std::uint8_t strip_count,
+    bool uniform_tables,
+    EncoderKernel kind = EncoderKernel::Table);
+
+// Validated entry point for the selected kernels. A null `from` encodes `rgb`
+// directly; otherwise `from` is blended towards `rgb` by `weight`. Output is
+// byte-identical to the table span and table blend encoders.
+EncodeResult encode_parallel_grb_kernel_span(
+    const ParallelEncodeKernels& kernels,
+    const ParallelExpandTables& tables,
+    const std::uint8_t* from,
+    const std::uint8_t* rgb,
+    std::size_t rgb_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t weight,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* output,
+    std::size_t output_capacity,
+    std::uint16_t reset_us = kWs2812ResetUs,
+    std::uint32_t sample_rate_hz = kWs2812SampleRateHz);
+
+// Encodes columns [first_pixel, end_pixel) into `chunk`, which holds only
+// those columns and no reset tail. Prepare it once with
+// initialize_parallel_grb_waveform(strip_count, end_pixel - first_pixel,
+// chunk, capacity, 0); consecutive chunks sent back to back reproduce the
+// full-frame waveform. An empty span is rejected since it cannot be queued.
+EncodeResult encode_parallel_grb_kernel_chunk(
+    const ParallelEncodeKernels& kernels,
+    const ParallelExpandTables& tables,
+    const std::uint8_t* from,
+    const std::uint8_t* rgb,
+    std::size_t rgb_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t weight,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* chunk,
+    std::size_t chunk_capacity);
+
+// Rows build_palette_expand_rows() fills for a layout: one for uniform
+// tables, else one per strip.
+std::uint8_t palette_expand_rows(std::uint8_t strip_count, bool uniform_tables);
+
+// `palette` holds kPaletteBytes of RGB; `curves` may be null for identity.
+// With `uniform_tables` only lane 0's curves are read.
+void build_palette_expand_rows(
+    const ChannelCurves* curves,
+    bool uniform_tables,
+    const std::uint8_t* palette,
+    std::uint8_t brightness,
+    std::uint8_t strip_count,
+    PaletteExpandRow* rows);
+
+// Indexed counterparts of the kernel span and chunk encoders. `rows` must be
+// built for the layout the kernels were selected with. The output matches
+// encoding the palette-expanded RGB frame with tables built from the same
+// curves and brightness.
+EncodeResult encode_parallel_grb_indexed_span(
+    const ParallelEncodeKernels& kernels,
+    const PaletteExpandRow* rows,
+    const std::uint8_t* indices,
+    std::size_t index_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* output,
+    std::size_t output_capacity,
+    std::uint16_t reset_us = kWs2812ResetUs,
+    std::uint32_t sample_rate_hz = kWs2812SampleRateHz);
+
+EncodeResult encode_parallel_grb_indexed_chunk(
+    const ParallelEncodeKernels& kernels,
+    const PaletteExpandRow* rows,
+    const std::uint8_t* indices,
+    std::size_t index_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* chunk,
+    std::size_t chunk_capacity);
+
+// Span and chunk encoders for frames in logical order, remapped onto the
+// strips by `layout` (see layout_map.hpp) as each lane's byte is gathered,
+// so the remap needs no pass of its own. `layout` holds strip_count *
+// leds_per_strip host-order entries, already checked with
+// decode_layout_map(). These run the generic lookup loop rather than the
+// unrolled kernels, with the tables or rows the kernels were selected for;
+// the output matches encoding the remapped frame, unmapped pixels black.
+EncodeResult encode_parallel_grb_mapped_span(
+    const ParallelEncodeKernels& kernels,
+    const ParallelExpandTables& tables,
+    const std::uint16_t* layout,
+    const std::uint8_t* from,
+    const std::uint8_t* rgb,
+    std::size_t rgb_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t weight,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* output,
+    std::size_t output_capacity,
+    std::uint16_t reset_us = kWs2812ResetUs,
+    std::uint32_t sample_rate_hz = kWs2812SampleRateHz);
+
+EncodeResult encode_parallel_grb_mapped_chunk(
+    const ParallelEncodeKernels& kernels,
+    const ParallelExpandTables& tables,
+    const std::uint16_t* layout,
+    const std::uint8_t* from,
+    const std::uint8_t* rgb,
+    std::size_t rgb_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t weight,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* chunk,
+    std::size_t chunk_capacity);
+
+EncodeResult encode_parallel_grb_mapped_indexed_span(
+    const ParallelEncodeKernels& kernels,
+    const PaletteExpandRow* rows,
+    const std::uint16_t* layout,
+    const std::uint8_t* indices,
+    std::size_t index_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* output,
+    std::size_t output_capacity,
+    std::uint16_t reset_us = kWs2812ResetUs,
+    std::uint32_t sample_rate_hz = kWs2812SampleRateHz);
+
+EncodeResult encode_parallel_grb_mapped_indexed_chunk(
+    const ParallelEncodeKernels& kernels,
+    const PaletteExpandRow* rows,
+    const std::uint16_t* layout,
+    const std::uint8_t* indices,
+    std::size_t index_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* chunk,
+    std::size_t chunk_capacity);
+
+// Brightness-only reference for indexed frames, like
+// encode_parallel_grb_pixels(). It looks each channel up in `palette` as it
+// goes, so the display path uses the prebuilt rows instead.
+EncodeResult encode_parallel_grb_indexed_pixels(
+    const std::uint8_t* indices,
+    std::size_t index_bytes,
+    const std::uint8_t* palette,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint8_t brightness,
+    std::uint8_t* output,
+    std::size_t output_capacity,
+    std::uint16_t reset_us = kWs2812ResetUs,
+    std::uint32_t sample_rate_hz = kWs2812SampleRateHz);
+
 // Convenience full encoder for callers that do not retain an initialized
 // output buffer. The receiver's display path uses the split functions above.
 EncodeResult encode_parallel_grb(
@@ -0,0 +1,180 @@
+#include "ledgrid/clip_store.hpp"
+
+#include <cstring>
+
+namespace ledgrid {
+
+namespace {
+
+constexpr std::size_t kEntryAlignment = sizeof(ClipFrameHeader);
+
+}  // namespace
+
+void ClipStore::attach(std::uint8_t* storage, std::size_t bytes) {
+  storage_ = storage;
+  storage_bytes_ = storage != nullptr ? bytes : 0;
+  configure(frame_bytes_);
+}
+
+void ClipStore::configure(std::size_t frame_bytes) {
+  frame_bytes_ = frame_bytes;
+  stride_ = sizeof(ClipFrameHeader) +
+            (frame_bytes + kEntryAlignment - 1U) / kEntryAlignment * kEntryAlignment;
+  const std::size_t entries = frame_bytes == 0 ? 0 : storage_bytes_ / stride_;
+  capacity_ = static_cast<std::uint16_t>(entries > UINT16_MAX ? UINT16_MAX : entries);
+  clear_entries(ClipStoreMode::Clips);
+}
+
+std::uint8_t* ClipStore::entry(std::uint16_t index) const {
+  return storage_ + static_cast<std::size_t>(index) * stride_;
+}
+
+ClipFrameHeader* ClipStore::header(std::uint16_t index) const {
+  return reinterpret_cast<ClipFrameHeader*>(entry(index));
+}
+
+void ClipStore::clear_entries(ClipStoreMode mode) {
+  for (std::uint16_t i = 0; i < capacity_; ++i) *header(i) = ClipFrameHeader{};
+  mode_ = mode;
+  head_ = 0;
+  recorded_ = 0;
+}
+
+bool ClipStore::write_frame(
+    std::uint16_t index,
+    std::uint16_t duration_ms,
+    std::size_t offset,
+    const std::uint8_t* data,
+    std::size_t length) {
+  if (index >= capacity_ || data == nullptr || offset > frame_bytes_ ||
+      length > frame_bytes_ - offset) {
+    return false;
+  }
+  if (mode_ != ClipStoreMode::Clips) clear_entries(ClipStoreMode::Clips);
+  ClipFrameHeader* frame = header(index);
+  std::uint8_t* pixels = entry(index) + sizeof(ClipFrameHeader);
+  if (offset == 0) {
+    std::memset(pixels + length, 0, frame_bytes_ - length);
+    *frame = ClipFrameHeader{};
+    frame->duration_ms = duration_ms;
+    frame->byte_count = static_cast<std::uint32_t>(frame_bytes_);
+  } else if (frame->byte_count == 0) {
+    // A later slice of a frame whose start never arrived.
+    return false;
+  }
+  std::memcpy(pixels + offset, data, length);
+  return true;
+}
+
+const ClipFrameHeader* ClipStore::frame(std::uint16_t index) const {
+  if (mode_ != ClipStoreMode::Clips || index >= capacity_) return nullptr;
+  const ClipFrameHeader* frame = header(index);
+  return frame->byte_count != 0 ? frame : nullptr;
+}
+
+const std::uint8_t* ClipStore::pixels(std::uint16_t index) const {
+  return frame(index) != nullptr ? entry(index) + sizeof(ClipFrameHeader) : nullptr;
+}
+
+bool ClipStore::holds_clip(std::uint16_t first, std::uint16_t count) const {
+  if (count == 0 || static_cast<std::size_t>(first) + count > capacity_) return false;
+  for (std::uint16_t i = 0; i < count; ++i) {
+    if (frame(static_cast<std::uint16_t>(first + i)) == nullptr) return false;
+  }
+  return true;
+}
+
+bool ClipStore::contains(const void* pixels) const {
+  const auto* byte = static_cast<const std::uint8_t*>(pixels);
+  return storage_ != nullptr && byte >= storage_ && byte < storage_ + storage_bytes_;
+}
+
+void ClipStore::start_recording() { clear_entries(ClipStoreMode::Recorder); }
+
+bool ClipStore::record(
+    const std::uint8_t* pixels,
+    std::size_t bytes,
+    std::uint32_t sequence,
+    std::uint32_t shown_us,
+    bool indexed) {
+  if (mode_ != ClipStoreMode::Recorder || capacity_ == 0 || pixels == nullptr ||
+      bytes == 0 || bytes > frame_bytes_) {
+    return false;
+  }
+  ClipFrameHeader* frame = header(head_);
+  frame->sequence = sequence;
+  frame->shown_us = shown_us;
+  frame->byte_count = static_cast<std::uint32_t>(bytes);
+  frame->duration_ms = 0;
+  frame->flags = indexed ? kClipFrameIndexed : 0U;
+  std::memcpy(entry(head_) + sizeof(ClipFrameHeader), pixels, bytes);
+  head_ = static_cast<std::uint16_t>((head_ + 1U) % capacity_);
+  if (recorded_ < capacity_) ++recorded_;
+  return true;
+}
+
+int ClipStore::recorded_index(std::uint16_t back) const {
+  if (back >= recorded()) return -1;
+  return static_cast<int>((head_ + capacity_ - 1U - back) % capacity_);
+}
+
+const ClipFrameHeader* ClipStore::recorded_frame(std::uint16_t back) const {
+  const int index = recorded_index(back);
+  return index < 0 ? nullptr : header(static_cast<std::uint16_t>(index));
+}
+
+const std::uint8_t* ClipStore::recorded_pixels(std::uint16_t back) const {
+  const int index = recorded_index(back);
+  return index < 0 ? nullptr
+                   : entry(static_cast<std::uint16_t>(index)) + sizeof(ClipFrameHeader);
+}
+
+bool ClipPlayer::start(
+    const ClipStore& store,
+    std::uint16_t first,
+    std::uint16_t count,
+    std::uint16_t loops,
+    std::uint32_t now_us) {
+  if (!store.holds_clip(first, count)) return false;
+  playback_ = ClipPlayback{};
+  playback_.first = first;
+  playback_.count = count;
+  playback_.loops = loops;
+  playback_.current = first;
+  due_us_ = now_us;
+  playing_ = true;
+  return true;
+}
+
+bool ClipPlayer::due(std::uint32_t now_us) const {
+  return playing_ && static_cast<std::int32_t>(now_us - due_us_) >= 0;
+}
+
+std::uint32_t ClipPlayer::wait_us(std::uint32_t now_us) const {
+  if (!playing_ || due(now_us)) return 0;
+  return due_us_ - now_us;
+}
+
+void ClipPlayer::advance(const ClipStore& store, std::uint32_t now_us) {
+  if (!playing_) return;
+  const ClipFrameHeader* shown = store.frame(playback_.current);
+  const std::uint32_t duration_us =
+      static_cast<std::uint32_t>(shown != nullptr && shown->duration_ms > 0
+                                      ? shown->duration_ms
+                                      : 1U) *
+      1000U;
+  due_us_ += duration_us;
+  if (static_cast<std::int32_t>(now_us - due_us_) >= static_cast<std::int32_t>(duration_us)) {
+    due_us_ = now_us + duration_us;
+  }
+  ++playback_.frames_played;
+  if (++playback_.current < playback_.first + playback_.count) return;
+  playback_.current = playback_.first;
+  ++playback_.loops_done;
+  if (playback_.loops != 0 && playback_.loops_done >= playback_.loops) {
+    playback_.current = static_cast<std::uint16_t>(playback_.first + playback_.count - 1U);
+    playing_ = false;
+  }
+}
+
+}  // namespace ledgrid
@@ -0,0 +1,128 @@
+#include "ledgrid/crc16.hpp"
+
+#include <array>
+
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#include "esp_rom_crc.h"
+#define LEDGRID_CRC_TABLE_ATTR DRAM_ATTR
+#else
+#define LEDGRID_CRC_TABLE_ATTR
+#endif
+
+namespace ledgrid {
+namespace {
+
+constexpr std::uint16_t kPolynomial = 0x1021;
+constexpr std::uint16_t kInitialValue = 0xFFFF;
+
+constexpr std::uint16_t kCrc16NibbleTable[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+};
+
+using SliceTables = std::array<std::array<std::uint16_t, 256>, 8>;
+
+// tables[k][v] is the CRC contribution of byte v followed by k zero bytes, so
+// eight input bytes fold into the CRC with eight independent lookups.
+constexpr SliceTables make_slice_tables() {
+  SliceTables tables{};
+  for (std::size_t value = 0; value < 256; ++value) {
+    std::uint16_t crc = static_cast<std::uint16_t>(value << 8);
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = static_cast<std::uint16_t>(
+          (crc & 0x8000U) != 0 ? (crc << 1) ^ kPolynomial : crc << 1);
+    }
+    tables[0][value] = crc;
+  }
+  for (std::size_t slice = 1; slice < tables.size(); ++slice) {
+    for (std::size_t value = 0; value < 256; ++value) {
+      const std::uint16_t previous = tables[slice - 1][value];
+      tables[slice][value] = static_cast<std::uint16_t>(
+          (previous << 8) ^ tables[0][previous >> 8]);
+    }
+  }
+  return tables;
+}
+
+// Flash-resident tables would cost a cache miss per lookup on the receive
+// path, so the 4 KB of slice tables live in internal DRAM on target.
+LEDGRID_CRC_TABLE_ATTR constexpr SliceTables kSliceTables =
+    make_slice_tables();
+
+}  // namespace
+
+const char* crc16_engine_name(Crc16Engine engine) {
+  switch (engine) {
+    case Crc16Engine::Nibble:
+      return "nibble";
+    case Crc16Engine::Slice8:
+      return "slice8";
+    case Crc16Engine::Rom:
+      return "rom";
+  }
+  return "unknown";
+}
+
+bool crc16_engine_available(Crc16Engine engine) {
+#ifdef ESP_PLATFORM
+  (void)engine;
+  return true;
+#else
+  return engine != Crc16Engine::Rom;
+#endif
+}
+
+std::uint16_t crc16_ccitt_nibble(const std::uint8_t* data, std::size_t length) {
+  std::uint16_t crc = kInitialValue;
+  for (std::size_t i = 0; i < length; ++i) {
+    crc ^= static_cast<std::uint16_t>(data[i]) << 8;
+    crc = static_cast<std::uint16_t>(
+        (crc << 4) ^ kCrc16NibbleTable[crc >> 12]);
+    crc = static_cast<std::uint16_t>(
+        (crc << 4) ^ kCrc16NibbleTable[crc >> 12]);
+  }
+  return crc;
+}
+
+std::uint16_t crc16_ccitt_slice8(const std::uint8_t* data, std::size_t length) {
+  const auto& t = kSliceTables;
+  std::uint16_t crc = kInitialValue;
+  while (length >= 8) {
+    crc = static_cast<std::uint16_t>(
+        t[7][data[0] ^ (crc >> 8)] ^ t[6][data[1] ^ (crc & 0xFFU)] ^
+        t[5][data[2]] ^ t[4][data[3]] ^ t[3][data[4]] ^ t[2][data[5]] ^
+        t[1][data[6]] ^ t[0][data[7]]);
+    data += 8;
+    length -= 8;
+  }
+  while (length-- > 0) {
+    crc = static_cast<std::uint16_t>(
+        (crc << 8) ^ t[0][(crc >> 8) ^ *data++]);
+  }
+  return crc;
+}
+
+std::uint16_t crc16_ccitt(
+    Crc16Engine engine, const std::uint8_t* data, std::size_t length) {
+  switch (engine) {
+    case Crc16Engine::Slice8:
+      return crc16_ccitt_slice8(data, length);
+    case Crc16Engine::Rom:
+#ifdef ESP_PLATFORM
+      // The ROM routine complements its input and output, so passing ~0xFFFF
+      // and complementing the result yields CCITT-FALSE.
+      return static_cast<std::uint16_t>(~esp_rom_crc16_be(
+          static_cast<std::uint16_t>(~kInitialValue),
+          data,
+          static_cast<std::uint32_t>(length)));
+#else
+      break;
+#endif
+    case Crc16Engine::Nibble:
+      break;
+  }
+  return crc16_ccitt_nibble(data, length);
+}
+
+}  // namespace ledgrid
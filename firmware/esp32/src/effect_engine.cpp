@@ -0,0 +1,153 @@
+#include "ledgrid/effect_engine.hpp"
+
+#include <cmath>
+#include <cstring>
+
+namespace ledgrid {
+
+namespace {
+
+// First quarter of a sine turn, 0..64 of 256, scaled to 128..255.
+constexpr std::uint8_t kQuarterSine[65] = {
+    128, 131, 134, 137, 140, 143, 146, 149, 152, 155, 158, 162, 165,
+    167, 170, 173, 176, 179, 182, 185, 188, 190, 193, 196, 198, 201,
+    203, 206, 208, 211, 213, 215, 218, 220, 222, 224, 226, 228, 230,
+    232, 234, 235, 237, 238, 240, 241, 243, 244, 245, 246, 248, 249,
+    250, 250, 251, 252, 253, 253, 254, 254, 254, 255, 255, 255, 255,
+};
+
+std::uint16_t read_u16(const std::uint8_t* input) {
+  return static_cast<std::uint16_t>((input[0] << 8) | input[1]);
+}
+
+float fixed_8_8(std::uint16_t value) { return static_cast<float>(value) / 256.0F; }
+
+// Phase in 0..255, wrapped like AnimatedPaletteField's np.remainder followed
+// by truncation.
+std::uint8_t wrap_phase(float phase) {
+  const float wrapped = std::fmod(phase, 256.0F);
+  return static_cast<std::uint8_t>(
+      static_cast<int>(wrapped < 0.0F ? wrapped + 256.0F : wrapped) & 0xFF);
+}
+
+}  // namespace
+
+std::uint8_t sin8(std::uint8_t angle) {
+  const std::uint8_t half = angle & 0x7F;
+  const std::uint8_t rising = half <= 64 ? kQuarterSine[half] : kQuarterSine[128 - half];
+  return angle < 128 ? rising : static_cast<std::uint8_t>(255 - rising);
+}
+
+bool parse_effect_params(
+    const std::uint8_t* payload, std::size_t length, EffectParams* params) {
+  if (payload == nullptr || params == nullptr || length == 0) return false;
+  if (payload[0] >= kEffectKindCount) return false;
+  const auto kind = static_cast<EffectKind>(payload[0]);
+  if (length == 1) {
+    if (kind != EffectKind::Off) return false;
+    params->kind = kind;
+    return true;
+  }
+  if (length != kEffectParamBytes) return false;
+  EffectParams parsed{};
+  parsed.kind = kind;
+  std::uint16_t* const fields[] = {
+      &parsed.ticks_per_second, &parsed.wall_width,     &parsed.x_origin,
+      &parsed.x_scale,          &parsed.y_scale,        &parsed.radial_scale,
+      &parsed.radial_y_scale,   &parsed.center_y,
+  };
+  for (std::size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); ++i) {
+    *fields[i] = read_u16(payload + 1 + i * 2);
+  }
+  *params = parsed;
+  return true;
+}
+
+void build_effect_phase(
+    const EffectParams& params,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint8_t* phase) {
+  if (phase == nullptr) return;
+  const float width =
+      static_cast<float>(params.wall_width != 0 ? params.wall_width : strip_count);
+  const float center_x = width * 0.5F;
+  const float center_y =
+      static_cast<float>(leds_per_strip) * static_cast<float>(params.center_y) / 65536.0F;
+  const float x_scale = fixed_8_8(params.x_scale);
+  const float y_scale = fixed_8_8(params.y_scale);
+  const float radial_scale = fixed_8_8(params.radial_scale);
+  const float radial_y_scale = fixed_8_8(params.radial_y_scale);
+
+  for (std::uint8_t strip = 0; strip < strip_count; ++strip) {
+    const float x = static_cast<float>(params.x_origin + strip);
+    std::uint8_t* lane = phase + static_cast<std::size_t>(strip) * leds_per_strip;
+    for (std::uint16_t led = 0; led < leds_per_strip; ++led) {
+      const float y = static_cast<float>(led);
+      const float radial =
+          std::hypot(x - center_x, (y - center_y) * radial_y_scale) * radial_scale;
+      switch (params.kind) {
+        case EffectKind::PaletteField:
+          lane[led] = wrap_phase(x * x_scale + y * y_scale + radial);
+          break;
+        case EffectKind::Gradient:
+          lane[led] = wrap_phase(x * x_scale + y * y_scale);
+          break;
+        case EffectKind::Plasma:
+          // The linear terms are separate sines, taken while rendering.
+          lane[led] = wrap_phase(radial);
+          break;
+        case EffectKind::Off:
+          lane[led] = 0;
+          break;
+      }
+    }
+  }
+}
+
+std::uint32_t effect_tick(const EffectParams& params, std::uint32_t elapsed_ms) {
+  return static_cast<std::uint32_t>(
+      static_cast<std::uint64_t>(elapsed_ms) * params.ticks_per_second / 1000U);
+}
+
+void render_effect(
+    const EffectParams& params,
+    const std::uint8_t* phase,
+    const std::uint8_t* palette,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint32_t tick,
+    std::uint8_t* rgb) {
+  if (phase == nullptr || palette == nullptr || rgb == nullptr) return;
+  const std::size_t pixels = static_cast<std::size_t>(strip_count) * leds_per_strip;
+  const auto t = static_cast<std::uint8_t>(tick);
+  if (params.kind == EffectKind::Off) {
+    std::memset(rgb, 0, pixels * 3U);
+    return;
+  }
+  if (params.kind != EffectKind::Plasma) {
+    for (std::size_t i = 0; i < pixels; ++i) {
+      const std::uint8_t index = static_cast<std::uint8_t>(phase[i] + t);
+      std::memcpy(rgb + i * 3U, palette + index * 3U, 3);
+    }
+    return;
+  }
+
+  for (std::uint8_t strip = 0; strip < strip_count; ++strip) {
+    const std::uint32_t x = params.x_origin + strip;
+    const std::uint8_t column = sin8(static_cast<std::uint8_t>(
+        ((x * params.x_scale) >> 8) + t));
+    const std::size_t first = static_cast<std::size_t>(strip) * leds_per_strip;
+    for (std::uint16_t led = 0; led < leds_per_strip; ++led) {
+      const std::uint8_t row = sin8(static_cast<std::uint8_t>(
+          ((static_cast<std::uint32_t>(led) * params.y_scale) >> 8) - t));
+      const std::uint8_t ring =
+          sin8(static_cast<std::uint8_t>(phase[first + led] + 2U * t));
+      const std::uint8_t index =
+          static_cast<std::uint8_t>((column + row + ring) / 3U);
+      std::memcpy(rgb + (first + led) * 3U, palette + index * 3U, 3);
+    }
+  }
+}
+
+}  // namespace ledgrid
@@ -0,0 +1,174 @@
+#include "ledgrid/frame_assembly.hpp"
+
+#include <cstring>
+
+namespace ledgrid {
+
+bool parse_frame_part(
+    const std::uint8_t* payload,
+    std::size_t length,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    FramePart* part) {
+  if (payload == nullptr || part == nullptr || length < kFramePartHeaderBytes) {
+    return false;
+  }
+  FramePart parsed{};
+  parsed.sequence = static_cast<std::uint16_t>((payload[0] << 8) | payload[1]);
+  parsed.first_strip = payload[2];
+  parsed.strip_count = payload[3];
+  if (parsed.strip_count == 0 || strip_count > kMaxFramePartStrips ||
+      parsed.first_strip + parsed.strip_count > strip_count) {
+    return false;
+  }
+  parsed.rgb = payload + kFramePartHeaderBytes;
+  parsed.rgb_bytes = length - kFramePartHeaderBytes;
+  if (parsed.rgb_bytes !=
+      static_cast<std::size_t>(parsed.strip_count) * leds_per_strip * 3U) {
+    return false;
+  }
+  *part = parsed;
+  return true;
+}
+
+bool frame_chunk_header_intact(
+    Crc16Engine engine, const std::uint8_t* payload, std::size_t length) {
+  if (payload == nullptr || length < kFrameChunkHeaderBytes) return false;
+  const auto received_crc = static_cast<std::uint16_t>((payload[4] << 8) | payload[5]);
+  return crc16_ccitt(engine, payload, 4) == received_crc;
+}
+
+bool parse_frame_chunk_header(
+    Crc16Engine engine,
+    const std::uint8_t* payload,
+    std::size_t length,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    FrameChunkHeader* header) {
+  if (header == nullptr || strip_count > kMaxFramePartStrips ||
+      !frame_chunk_header_intact(engine, payload, length)) {
+    return false;
+  }
+  FrameChunkHeader parsed{};
+  parsed.sequence = static_cast<std::uint16_t>((payload[0] << 8) | payload[1]);
+  parsed.strips = static_cast<std::uint16_t>((payload[2] << 8) | payload[3]);
+  if (parsed.strips == 0 || (parsed.strips >> strip_count) != 0) return false;
+
+  std::size_t strips = 0;
+  for (std::uint16_t mask = parsed.strips; mask != 0; mask &= mask - 1U) ++strips;
+  const std::size_t strip_bytes =
+      static_cast<std::size_t>(leds_per_strip) * 3U + kFrameChunkCrcBytes;
+  if (length - kFrameChunkHeaderBytes < strips * strip_bytes) return false;
+  *header = parsed;
+  return true;
+}
+
+FrameAssembly FrameAssembler::add(
+    const std::uint8_t* payload,
+    std::size_t length,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint8_t* rgb) {
+  FramePart part{};
+  if (rgb == nullptr ||
+      !parse_frame_part(payload, length, strip_count, leds_per_strip, &part)) {
+    ++counters_.rejected;
+    return FrameAssembly::Rejected;
+  }
+  if (!begin(part.sequence, strip_count)) return FrameAssembly::Stale;
+  return store(part, strip_count, leds_per_strip, rgb);
+}
+
+FrameAssembly FrameAssembler::add_chunked(
+    Crc16Engine engine,
+    const std::uint8_t* payload,
+    std::size_t length,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint8_t* rgb) {
+  FrameChunkHeader header{};
+  if (rgb == nullptr || !parse_frame_chunk_header(engine, payload, length, strip_count,
+                                                  leds_per_strip, &header)) {
+    ++counters_.rejected;
+    return FrameAssembly::Rejected;
+  }
+  if (!begin(header.sequence, strip_count)) return FrameAssembly::Stale;
+
+  const std::size_t rgb_bytes = static_cast<std::size_t>(leds_per_strip) * 3U;
+  const std::uint8_t* chunk = payload + kFrameChunkHeaderBytes;
+  for (std::uint8_t strip = 0; strip < strip_count; ++strip) {
+    if ((header.strips & (1U << strip)) == 0) continue;
+    const auto received_crc = static_cast<std::uint16_t>(
+        (chunk[rgb_bytes] << 8) | chunk[rgb_bytes + 1U]);
+    if (crc16_ccitt(engine, chunk, rgb_bytes) != received_crc) {
+      ++counters_.chunk_crc_errors;
+      failed_ |= 1UL << strip;
+    } else {
+      FramePart part{};
+      part.sequence = header.sequence;
+      part.first_strip = strip;
+      part.strip_count = 1;
+      part.rgb = chunk;
+      part.rgb_bytes = rgb_bytes;
+      if (store(part, strip_count, leds_per_strip, rgb) == FrameAssembly::Complete) {
+        return FrameAssembly::Complete;
+      }
+    }
+    chunk += rgb_bytes + kFrameChunkCrcBytes;
+  }
+  return FrameAssembly::Pending;
+}
+
+std::uint32_t FrameAssembler::missing() const {
+  if (!started_ || completed_) return 0;
+  return ((1UL << strip_count_) - 1UL) & ~received_;
+}
+
+bool FrameAssembler::begin(std::uint16_t sequence, std::uint8_t strip_count) {
+  const auto ahead = static_cast<std::int16_t>(sequence - sequence_);
+  if (started_ && (ahead < 0 || (ahead == 0 && completed_))) {
+    ++counters_.stale;
+    return false;
+  }
+  if (!started_ || ahead > 0) {
+    if (received_ != 0) ++counters_.abandoned;
+    sequence_ = sequence;
+    received_ = 0;
+    failed_ = 0;
+    completed_ = false;
+    started_ = true;
+  }
+  strip_count_ = strip_count;
+  return true;
+}
+
+FrameAssembly FrameAssembler::store(
+    const FramePart& part,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint8_t* rgb) {
+  std::memcpy(
+      rgb + static_cast<std::size_t>(part.first_strip) * leds_per_strip * 3U,
+      part.rgb, part.rgb_bytes);
+  received_ |= ((1UL << part.strip_count) - 1UL) << part.first_strip;
+  ++counters_.parts;
+  if (received_ != (1UL << strip_count) - 1UL) return FrameAssembly::Pending;
+
+  if (failed_ != 0) ++counters_.frames_recovered;
+  received_ = 0;
+  failed_ = 0;
+  completed_ = true;
+  ++counters_.frames;
+  counters_.last_sequence = sequence_;
+  return FrameAssembly::Complete;
+}
+
+void FrameAssembler::reset() {
+  if (received_ != 0) ++counters_.abandoned;
+  received_ = 0;
+  failed_ = 0;
+  completed_ = false;
+  started_ = false;
+}
+
+}  // namespace ledgrid
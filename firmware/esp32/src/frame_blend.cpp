@@ -0,0 +1,73 @@
+#include "ledgrid/frame_blend.hpp"
+
+#include <cstring>
+
+#include "ledgrid/ws2812_encoder.hpp"
+
+namespace ledgrid {
+
+std::uint16_t transition_weight(
+    std::uint32_t elapsed_us,
+    std::uint32_t duration_us,
+    TransitionEasing easing) {
+  if (duration_us == 0 || elapsed_us >= duration_us) return kBlendWeightMax;
+  const std::uint32_t t = static_cast<std::uint32_t>(
+      static_cast<std::uint64_t>(elapsed_us) * kBlendWeightMax / duration_us);
+  if (easing != TransitionEasing::EaseInOut) return static_cast<std::uint16_t>(t);
+  // Smoothstep t^2 (3 - 2t) with t scaled to 0..256.
+  return static_cast<std::uint16_t>(
+      t * t * (3U * kBlendWeightMax - 2U * t) / (kBlendWeightMax * kBlendWeightMax));
+}
+
+void blend_frames(
+    const std::uint8_t* from,
+    const std::uint8_t* to,
+    std::size_t bytes,
+    std::uint16_t weight,
+    std::uint8_t* output) {
+  if (from == nullptr || to == nullptr || output == nullptr) return;
+  const int w = weight > kBlendWeightMax ? kBlendWeightMax : weight;
+  for (std::size_t i = 0; i < bytes; ++i) {
+    const int start = from[i];
+    output[i] = static_cast<std::uint8_t>(
+        start + (((static_cast<int>(to[i]) - start) * w) >> 8));
+  }
+}
+
+PixelSpan changed_columns(
+    const std::uint8_t* a,
+    const std::uint8_t* b,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::size_t bytes_per_pixel) {
+  PixelSpan changed{};
+  if (a == nullptr || b == nullptr || bytes_per_pixel == 0) return changed;
+  const std::size_t lane_bytes =
+      static_cast<std::size_t>(leds_per_strip) * bytes_per_pixel;
+  for (std::uint8_t strip = 0; strip < strip_count; ++strip) {
+    const std::uint8_t* left = a + strip * lane_bytes;
+    const std::uint8_t* right = b + strip * lane_bytes;
+    std::size_t first = 0;
+    while (first < lane_bytes && left[first] == right[first]) ++first;
+    if (first == lane_bytes) continue;
+    std::size_t last = lane_bytes;
+    while (left[last - 1U] == right[last - 1U]) --last;
+    changed.include(
+        static_cast<std::uint16_t>(first / bytes_per_pixel),
+        static_cast<std::uint16_t>((last + bytes_per_pixel - 1U) / bytes_per_pixel));
+  }
+  return changed;
+}
+
+void expand_indexed_frame(
+    const std::uint8_t* indices,
+    std::size_t pixels,
+    const std::uint8_t* palette,
+    std::uint8_t* rgb) {
+  if (indices == nullptr || palette == nullptr || rgb == nullptr) return;
+  for (std::size_t i = 0; i < pixels; ++i) {
+    std::memcpy(rgb + i * 3U, palette + indices[i] * 3U, 3);
+  }
+}
+
+}  // namespace ledgrid
@@ -0,0 +1,119 @@
+#include "ledgrid/frame_compression.hpp"
+
+#include <cstring>
+
+namespace ledgrid {
+namespace {
+
+void include_pixels(
+    PixelSpan* changed,
+    std::uint16_t columns,
+    std::size_t first_pixel,
+    std::size_t count) {
+  if (changed == nullptr || columns == 0 || count == 0) return;
+  const std::size_t column = first_pixel % columns;
+  if (column + count > columns) {
+    changed->include(0, columns);
+    return;
+  }
+  changed->include(
+      static_cast<std::uint16_t>(column),
+      static_cast<std::uint16_t>(column + count));
+}
+
+// Writes a run token and reports whether any pixel differed.
+bool fill_run(std::uint8_t* output, const std::uint8_t* rgb, std::size_t pixels) {
+  const std::uint8_t r = rgb[0];
+  const std::uint8_t g = rgb[1];
+  const std::uint8_t b = rgb[2];
+  std::uint8_t differs = 0;
+  for (std::size_t i = 0; i < pixels; ++i) {
+    differs |= static_cast<std::uint8_t>((output[0] ^ r) | (output[1] ^ g) | (output[2] ^ b));
+    output[0] = r;
+    output[1] = g;
+    output[2] = b;
+    output += 3;
+  }
+  return differs != 0;
+}
+
+// XORs a token's bytes into the frame and reports whether any were non-zero.
+bool xor_bytes(std::uint8_t* output, const std::uint8_t* input, std::size_t bytes) {
+  std::uint32_t any = 0;
+  std::size_t i = 0;
+  for (; i + sizeof(std::uint32_t) <= bytes; i += sizeof(std::uint32_t)) {
+    std::uint32_t current;
+    std::uint32_t delta;
+    std::memcpy(&current, output + i, sizeof(current));
+    std::memcpy(&delta, input + i, sizeof(delta));
+    any |= delta;
+    current ^= delta;
+    std::memcpy(output + i, &current, sizeof(current));
+  }
+  for (; i < bytes; ++i) {
+    any |= input[i];
+    output[i] ^= input[i];
+  }
+  return any != 0;
+}
+
+}  // namespace
+
+bool validate_frame_tokens(
+    const std::uint8_t* input, std::size_t input_bytes, std::size_t pixel_count) {
+  return visit_frame_tokens(input, input_bytes, pixel_count, [](const FrameToken&) {});
+}
+
+bool decode_rle_frame(
+    const std::uint8_t* input,
+    std::size_t input_bytes,
+    std::uint8_t* frame,
+    std::size_t pixel_count,
+    std::uint16_t columns,
+    PixelSpan* changed) {
+  if (frame == nullptr || !validate_frame_tokens(input, input_bytes, pixel_count)) {
+    return false;
+  }
+  return visit_frame_tokens(input, input_bytes, pixel_count, [&](const FrameToken& token) {
+    std::uint8_t* output = frame + token.first_pixel * 3U;
+    bool differs = false;
+    if (token.run) {
+      differs = fill_run(output, token.rgb, token.pixel_count);
+    } else {
+      const std::size_t bytes = token.pixel_count * 3U;
+      differs = std::memcmp(output, token.rgb, bytes) != 0;
+      if (differs) std::memcpy(output, token.rgb, bytes);
+    }
+    if (differs) include_pixels(changed, columns, token.first_pixel, token.pixel_count);
+  });
+}
+
+bool apply_xor_delta_frame(
+    const std::uint8_t* input,
+    std::size_t input_bytes,
+    std::uint8_t* frame,
+    std::size_t pixel_count,
+    std::uint16_t columns,
+    PixelSpan* changed) {
+  if (frame == nullptr || !validate_frame_tokens(input, input_bytes, pixel_count)) {
+    return false;
+  }
+  return visit_frame_tokens(input, input_bytes, pixel_count, [&](const FrameToken& token) {
+    std::uint8_t* output = frame + token.first_pixel * 3U;
+    bool differs = false;
+    if (!token.run) {
+      differs = xor_bytes(output, token.rgb, token.pixel_count * 3U);
+    } else if ((token.rgb[0] | token.rgb[1] | token.rgb[2]) != 0) {
+      differs = true;
+      for (std::size_t i = 0; i < token.pixel_count; ++i) {
+        output[0] ^= token.rgb[0];
+        output[1] ^= token.rgb[1];
+        output[2] ^= token.rgb[2];
+        output += 3;
+      }
+    }
+    if (differs) include_pixels(changed, columns, token.first_pixel, token.pixel_count);
+  });
+}
+
+}  // namespace ledgrid
@@ -0,0 +1,53 @@
+#include "ledgrid/frame_memory.hpp"
+
+#include <algorithm>
+
+#include "ledgrid/frame_assembly.hpp"
+#include "ledgrid/ws2812_encoder.hpp"
+
+namespace ledgrid {
+
+const char* memory_tier_name(MemoryTier tier) {
+  switch (tier) {
+    case MemoryTier::InternalDma:
+      return "internal-dma";
+    case MemoryTier::Internal:
+      return "internal";
+    case MemoryTier::Psram:
+      return "psram";
+  }
+  return "unknown";
+}
+
+bool led_capacity_valid(std::uint8_t strip_count, std::uint16_t leds_per_strip) {
+  return strip_count != 0 && strip_count <= kMaxParallelStrips &&
+         leds_per_strip != 0 &&
+         static_cast<std::size_t>(strip_count) * leds_per_strip <= kMaxCapacityLeds;
+}
+
+FrameMemoryPlan plan_frame_memory(
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    bool psram_available,
+    std::uint16_t internal_leds) {
+  FrameMemoryPlan plan;
+  if (!led_capacity_valid(strip_count, leds_per_strip)) return plan;
+
+  constexpr std::size_t kCommandBytes = 1;
+  constexpr std::size_t kCrcBytes = 2;
+  plan.leds_per_strip = leds_per_strip;
+  plan.rgb_bytes = static_cast<std::size_t>(strip_count) * leds_per_strip * 3U;
+  // A chunked frame carries a CRC per strip instead of one per packet.
+  const std::size_t trailer = std::max(kCrcBytes, frame_chunk_overhead(strip_count));
+  plan.spi_buffer_bytes =
+      (kCommandBytes + plan.rgb_bytes + trailer + kFrameAlignment - 1U) /
+      kFrameAlignment * kFrameAlignment;
+  if (psram_available && leds_per_strip > internal_leds) {
+    plan.mailbox_tier = MemoryTier::Psram;
+    plan.history_tier = MemoryTier::Psram;
+    plan.zero_copy_mailbox = false;
+  }
+  return plan;
+}
+
+}  // namespace ledgrid
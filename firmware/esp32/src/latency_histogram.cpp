@@ -0,0 +1,39 @@
+#include "ledgrid/latency_histogram.hpp"
+
+namespace ledgrid {
+
+const char* latency_stage_name(LatencyStage stage) {
+  switch (stage) {
+    case LatencyStage::SpiReceive:
+      return "spi-receive";
+    case LatencyStage::Crc:
+      return "crc";
+    case LatencyStage::Copy:
+      return "copy";
+    case LatencyStage::MailboxWait:
+      return "mailbox-wait";
+    case LatencyStage::Encode:
+      return "encode";
+    case LatencyStage::Dma:
+      return "dma";
+    case LatencyStage::EndToEnd:
+      return "end-to-end";
+  }
+  return "unknown";
+}
+
+LatencySnapshot LatencyHistogram::snapshot() const {
+  LatencySnapshot result;
+  for (std::size_t i = 0; i < kLatencyBuckets; ++i) {
+    result.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+  }
+  result.max_us = max_us_.load(std::memory_order_relaxed);
+  return result;
+}
+
+void LatencyHistogram::reset() {
+  for (auto& bucket : buckets_) bucket.store(0, std::memory_order_relaxed);
+  max_us_.store(0, std::memory_order_relaxed);
+}
+
+}  // namespace ledgrid
@@ -0,0 +1,72 @@
+#include "ledgrid/layout_map.hpp"
+
+namespace ledgrid {
+
+namespace {
+
+std::uint16_t entry_at(const std::uint8_t* entries, std::size_t pixel) {
+  const std::uint8_t* entry = entries + pixel * kLayoutEntryBytes;
+  return static_cast<std::uint16_t>((entry[0] << 8) | entry[1]);
+}
+
+bool entry_in_range(std::uint16_t entry, std::size_t pixels) {
+  return entry == kUnmappedPixel || entry < pixels;
+}
+
+}  // namespace
+
+void write_layout_info(const LayoutMapInfo& info, std::uint8_t* output) {
+  if (output == nullptr) return;
+  output[0] = static_cast<std::uint8_t>(info.version >> 24);
+  output[1] = static_cast<std::uint8_t>(info.version >> 16);
+  output[2] = static_cast<std::uint8_t>(info.version >> 8);
+  output[3] = static_cast<std::uint8_t>(info.version);
+  output[4] = info.strip_count;
+  output[5] = static_cast<std::uint8_t>(info.leds_per_strip >> 8);
+  output[6] = static_cast<std::uint8_t>(info.leds_per_strip);
+  output[7] = static_cast<std::uint8_t>(info.crc >> 8);
+  output[8] = static_cast<std::uint8_t>(info.crc);
+}
+
+LayoutMapInfo read_layout_info(const std::uint8_t* input) {
+  LayoutMapInfo info;
+  if (input == nullptr) return info;
+  info.version = (static_cast<std::uint32_t>(input[0]) << 24) |
+                 (static_cast<std::uint32_t>(input[1]) << 16) |
+                 (static_cast<std::uint32_t>(input[2]) << 8) | input[3];
+  info.strip_count = input[4];
+  info.leds_per_strip = static_cast<std::uint16_t>((input[5] << 8) | input[6]);
+  info.crc = static_cast<std::uint16_t>((input[7] << 8) | input[8]);
+  return info;
+}
+
+bool layout_map_valid(
+    Crc16Engine engine,
+    const LayoutMapInfo& info,
+    const std::uint8_t* entries,
+    std::size_t entry_bytes) {
+  const std::size_t pixels = info.pixels();
+  // Entries index pixels with a u16 and reserve its top value.
+  if (entries == nullptr || info.version == 0 || pixels == 0 ||
+      pixels > kUnmappedPixel || entry_bytes < pixels * kLayoutEntryBytes ||
+      crc16_ccitt(engine, entries, pixels * kLayoutEntryBytes) != info.crc) {
+    return false;
+  }
+  for (std::size_t pixel = 0; pixel < pixels; ++pixel) {
+    if (!entry_in_range(entry_at(entries, pixel), pixels)) return false;
+  }
+  return true;
+}
+
+bool decode_layout_map(
+    const std::uint8_t* entries, std::size_t pixels, std::uint16_t* layout) {
+  if (entries == nullptr || layout == nullptr) return false;
+  for (std::size_t pixel = 0; pixel < pixels; ++pixel) {
+    const std::uint16_t entry = entry_at(entries, pixel);
+    if (!entry_in_range(entry, pixels)) return false;
+    layout[pixel] = entry;
+  }
+  return true;
+}
+
+}  // namespace ledgrid
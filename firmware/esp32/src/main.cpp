@@ -3,300 +3,1679 @@
 #include <algorithm>
 #include <atomic>
 #include <cstring>
+#include <utility>
 
 #include "driver/gpio.h"
 #include "driver/spi_common.h"
 #include "driver/spi_slave.h"
+#include "esp_heap_caps.h"
+#include "esp_memory_utils.h"
+#include "esp_system.h"
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "ledgrid/clip_store.hpp"
+#include "ledgrid/crc16.hpp"
+#include "ledgrid/effect_engine.hpp"
+#include "ledgrid/frame_blend.hpp"
 #include "ledgrid/frame_mailbox.hpp"
+#include "ledgrid/frame_memory.hpp"
+#include "ledgrid/latency_histogram.hpp"
+#include "ledgrid/layout_map.hpp"
 #include "ledgrid/parallel_led_driver.hpp"
+#include "ledgrid/power_budget.hpp"
 #include "ledgrid/protocol.hpp"
+#include "ledgrid/receiver_core.hpp"
 #include "ledgrid/ws2812_encoder.hpp"
+#include "nvs.h"
+
+#ifndef LEDGRID_STREAMING_DISPLAY
+#define LEDGRID_STREAMING_DISPLAY 0
+#endif
+
+#ifndef LEDGRID_SPI_QUEUE_DEPTH
+#define LEDGRID_SPI_QUEUE_DEPTH 4
+#endif
+
+// Brings up SPI3 as a second, receive-only link so the host can stripe frames
+// across two SPI clocks with SET_ALL_PART.
+#ifndef LEDGRID_DUAL_SPI
+#define LEDGRID_DUAL_SPI 0
+#endif
+
+// PSRAM set aside for uploaded clips, which doubles as the flight recorder.
+#ifndef LEDGRID_CLIP_STORE_KB
+#define LEDGRID_CLIP_STORE_KB 2048
+#endif
+
+// Streaming reads the mailbox frame while it is on the wire, which only the
+// serial display path allows.
+#ifndef LEDGRID_PIPELINED_DISPLAY
+#define LEDGRID_PIPELINED_DISPLAY (!LEDGRID_STREAMING_DISPLAY)
+#endif
+
+#if LEDGRID_STREAMING_DISPLAY && LEDGRID_PIPELINED_DISPLAY
+#error "LEDGRID_STREAMING_DISPLAY requires the serial display path"
+#endif
+
+#ifndef LEDGRID_CRC_ENGINE
+#define LEDGRID_CRC_ENGINE Slice8
+#endif
+
+#ifndef LEDGRID_ENCODER_KERNEL
+#define LEDGRID_ENCODER_KERNEL Table
+#endif
+
+// Shares each frame's encode with a helper task on core 1, beside the SPI
+// receive task; see ledgrid::EncodeCores.
+#ifndef LEDGRID_DUAL_CORE_ENCODE
+#define LEDGRID_DUAL_CORE_ENCODE 0
+#endif
 
 namespace {
 
-constexpr gpio_num_t kSpiMosi = GPIO_NUM_11;
-constexpr gpio_num_t kSpiMiso = GPIO_NUM_13;
-constexpr gpio_num_t kSpiClock = GPIO_NUM_12;
-constexpr gpio_num_t kSpiChipSelect = GPIO_NUM_10;
+struct SpiLinkPins {
+  spi_host_device_t host;
+  gpio_num_t mosi;
+  gpio_num_t miso;
+  gpio_num_t clock;
+  gpio_num_t chip_select;
+};
+// Link 0 carries every command and returns status. The DUAL_SPI link uses
+// pins still free with 16 lanes; it has no MISO, so its status travels on
+// link 0.
+constexpr SpiLinkPins kSpiLinkPins[] = {
+    {SPI2_HOST, GPIO_NUM_11, GPIO_NUM_13, GPIO_NUM_12, GPIO_NUM_10},
+#if LEDGRID_DUAL_SPI
+    {SPI3_HOST, GPIO_NUM_41, GPIO_NUM_NC, GPIO_NUM_42, GPIO_NUM_47},
+#endif
+};
+constexpr std::size_t kSpiLinkCount = sizeof(kSpiLinkPins) / sizeof(kSpiLinkPins[0]);
 constexpr std::uint8_t kStatusLed = 48;
+// Shared latch line: every receiver on the wall watches the same rising edge.
+constexpr gpio_num_t kLatchPin = GPIO_NUM_40;
 
-constexpr std::uint8_t kMaxStrips = 8;
-// Keep capacity at 140 for transport/mailbox/DMA buffers while allowing the
-// host to configure the camera-verified installed length (currently 138).
-constexpr std::uint16_t kMaxLedsPerStrip = 140;
-constexpr std::size_t kMaxTotalLeds = kMaxStrips * kMaxLedsPerStrip;
-constexpr std::size_t kMaxRgbBytes = kMaxTotalLeds * 3;
-constexpr std::uint8_t kDefaultStrips = 8;
+// LANES=16 builds drive sixteen strips over a 16-bit LCD bus.
+constexpr std::uint8_t kMaxStrips = ledgrid::kMaxParallelStrips;
+constexpr std::uint8_t kDefaultStrips = kMaxStrips;
+// The camera-verified installed length; capacity starts at 140 and grows when
+// CONFIG asks for more.
 constexpr std::uint16_t kDefaultLedsPerStrip = 138;
+#if LEDGRID_MAX_LANES > 8
+// Lanes 8-15 avoid the SPI, USB, UART, strapping, flash and octal PSRAM pins.
+constexpr int kLedPins[kMaxStrips] = {
+    18, 17, 16, 15, 7, 6, 5, 4, 1, 2, 8, 9, 14, 21, 38, 39};
+#else
 constexpr int kLedPins[kMaxStrips] = {18, 17, 16, 15, 7, 6, 5, 4};
+#endif
+
+constexpr std::size_t kColorCurveBytes = 256;
+// SET_LATCH modes. Off shows frames as they arrive; the others stage each
+// frame and start it on a LATCH command or a latch pin edge respectively.
+constexpr std::uint8_t kLatchOff = 0;
+constexpr std::uint8_t kLatchCommand = 1;
+constexpr std::uint8_t kLatchGpio = 2;
+// Set by SET_PACING rather than SET_LATCH: a periodic timer is the latch and
+// the mailbox becomes an ordered jitter buffer.
+constexpr std::uint8_t kLatchTimer = 3;
+constexpr std::uint16_t kMaxPacedFps = 1000;
 
-constexpr std::uint8_t kCmdSetPixel = 0x01;
-constexpr std::uint8_t kCmdSetBrightness = 0x02;
-constexpr std::uint8_t kCmdShow = 0x03;
-constexpr std::uint8_t kCmdClear = 0x04;
-constexpr std::uint8_t kCmdSetRange = 0x05;
-constexpr std::uint8_t kCmdSetAll = 0x06;
-constexpr std::uint8_t kCmdConfig = 0x07;
-constexpr std::uint8_t kCmdPing = 0xFF;
-
-constexpr std::size_t kCrcBytes = 2;
-constexpr std::size_t kSpiFrameBytes = 1 + kMaxRgbBytes + kCrcBytes;
-constexpr std::size_t kSpiBufferSize =
-    ((kSpiFrameBytes + 63U) / 64U) * 64U;
-constexpr std::size_t kSpiQueueDepth = 2;
-
-DMA_ATTR std::uint8_t spi_rx_buffers[kSpiQueueDepth][kSpiBufferSize] = {};
-DMA_ATTR std::uint8_t spi_tx_buffers[kSpiQueueDepth][kSpiBufferSize] = {};
-spi_slave_transaction_t spi_transactions[kSpiQueueDepth] = {};
-
-std::uint8_t working_frame[kMaxRgbBytes] = {};
-std::uint8_t mailbox_frames[ledgrid::kFrameMailboxSlots][kMaxRgbBytes] = {};
-ledgrid::LatestFrameMailbox frame_mailbox;
-portMUX_TYPE mailbox_mux = portMUX_INITIALIZER_UNLOCKED;
+// Receive transactions kept armed in the SPI slave driver. A deeper ring
+// absorbs host bursts while the receive task is busy with a long command; once
+// every slot has completed unserviced the slave has nothing armed and the host
+// clocks into nothing.
+constexpr std::size_t kSpiQueueDepth = LEDGRID_SPI_QUEUE_DEPTH;
+static_assert(kSpiQueueDepth >= 2 && kSpiQueueDepth <= ledgrid::kMaxSpiRingSlots,
+              "LEDGRID_SPI_QUEUE_DEPTH must be 2..16");
+// The receive task shares core 1 with the SPI interrupt, which is allocated on
+// the core that installs the driver, and outranks the display task on core 0.
+constexpr BaseType_t kSpiTaskCore = 1;
+constexpr UBaseType_t kSpiTaskPriority = 5;
+static_assert(kSpiLinkCount <= ledgrid::kMaxSpiLinks, "too many SPI links");
+
+// Frame capacity is chosen at boot. A CONFIG beyond it is stored here and
+// applied by restarting, since the SPI and LCD DMA buffers cannot be resized
+// under in-flight transfers. The configured length is stored alongside so the
+// receiver comes back up with the geometry the host asked for.
+constexpr char kNvsNamespace[] = "ledgrid";
+constexpr char kNvsCapacityKey[] = "capacity";
+constexpr char kNvsLedsKey[] = "leds";
+// The committed layout map: its LayoutMapInfo and its big-endian entries.
+constexpr char kNvsLayoutInfoKey[] = "layout_info";
+constexpr char kNvsLayoutKey[] = "layout";
+std::uint16_t led_capacity = ledgrid::kFactoryLedCapacity;
+// The stored length the receiver comes up with.
+std::uint16_t boot_leds_per_strip = kDefaultLedsPerStrip;
+ledgrid::FrameMemoryPlan frame_plan{};
+
+// With a zero-copy mailbox, SPI receive buffers double as mailbox frame
+// storage: a validated SET_ALL is published by handing its receive buffer to a
+// mailbox slot and re-queueing the slot's previous buffer for SPI in its
+// place. PSRAM mailbox slots are filled by copying the packet instead.
+// Every link's receive buffers share one size and tier, so any of them can
+// trade places with the spare or a mailbox slot.
+//
+// Ring accounting: post_trans_cb counts completions and stamps each slot's
+// chip-select release, and the receive task counts the ones it has taken; the
+// difference is the backlog, and a backlog of the whole ring means the host
+// outran the receiver. Everything not atomic belongs to the receive task.
+struct SpiLink {
+  spi_slave_transaction_t transactions[kSpiQueueDepth] = {};
+  std::uint8_t* rx_buffers[kSpiQueueDepth] = {};
+  // Status buffer each queued transaction transmits, on links with a MISO.
+  std::size_t transaction_status[kSpiQueueDepth] = {};
+  std::atomic<std::uint32_t> done_us[kSpiQueueDepth] = {};
+  std::atomic<std::uint32_t> slot_completions[kSpiQueueDepth] = {};
+  std::uint16_t slot_max_service_us[kSpiQueueDepth] = {};
+  std::uint16_t slot_requeue_failures[kSpiQueueDepth] = {};
+  // Slots, a bit each, that failed to re-queue and are out of the ring.
+  std::uint32_t requeue_pending = 0;
+  std::atomic<std::uint32_t> completed{0};
+  std::atomic<std::uint32_t> handled{0};
+  std::atomic<std::uint8_t> max_backlog{0};
+  std::atomic<std::uint32_t> ring_drained{0};
+  std::atomic<std::uint16_t> queued{0};
+  std::atomic<std::uint32_t> packets{0};
+  std::atomic<std::uint32_t> crc_ok_packets{0};
+  std::atomic<std::uint32_t> crc_errors{0};
+  std::atomic<std::uint32_t> queue_errors{0};
+};
+SpiLink spi_links[kSpiLinkCount];
+// One spare lets a completed transaction be re-queued before its packet has
+// been validated.
+std::uint8_t* spare_rx_buffer = nullptr;
+// Mailbox slots and the working frame, handed to the receiver core.
+ledgrid::ReceiverBuffers receiver_buffers;
+#if LEDGRID_PIPELINED_DISPLAY
+// Display-owned copies for keyframe interpolation; see KeyframeTransition.
+std::uint8_t* keyframe_buffers[2] = {};
+#endif
 TaskHandle_t display_task_handle = nullptr;
+TaskHandle_t spi_task_handle = nullptr;
 ledgrid::ParallelLedDriver led_driver;
+// Curves uploaded over SPI, handed to the driver by the display task; they
+// take effect with the next displayed frame. The receive task edits
+// host_curves, then copies them into staged_curves and raises curves_pending
+// once the display task has dropped the flag for the previous upload. Neither
+// 12 KB copy runs under a lock, so the SPI and DMA interrupts are never held
+// off for one.
+ledgrid::ChannelCurves host_curves;
+bool curves_unpublished = false;
+ledgrid::ChannelCurves staged_curves;
+std::atomic<bool> curves_pending{false};
+// The palette is staged under curves_mux instead.
+portMUX_TYPE curves_mux = portMUX_INITIALIZER_UNLOCKED;
+std::uint8_t staged_palette[ledgrid::kPaletteBytes] = {};
+bool palette_pending = false;
+// The power model and budget, staged the same way. The receive task keeps
+// its own copy for status.
+ledgrid::PowerModel power_model;
+ledgrid::PowerBudget power_budget;
+bool power_pending = false;
+// SET_LAYOUT slices land in layout_entries, sized for the frame capacity;
+// COMMIT_LAYOUT checks them against their CRC, stores them in NVS and hands
+// them to the display task, which decodes its own copy. Until it has, the
+// entries are not written again. layout_info is the committed map.
+std::uint8_t* layout_entries = nullptr;
+std::size_t layout_entry_bytes = 0;
+ledgrid::LayoutMapInfo layout_info;
+std::atomic<bool> layout_pending{false};
+std::uint16_t layout_rejected = 0;
 
-std::uint8_t active_strips = kDefaultStrips;
-std::uint16_t leds_per_strip = kDefaultLedsPerStrip;
-std::uint8_t brightness = 50;
-std::uint32_t next_sequence = 1;
-
-std::atomic<std::uint32_t> packets_received{0};
-std::atomic<std::uint32_t> crc_errors{0};
-std::atomic<std::uint32_t> crc_ok_packets{0};
 std::atomic<std::uint32_t> spi_queue_errors{0};
-std::atomic<std::uint32_t> display_errors{0};
 std::atomic<std::uint16_t> queued_transactions{0};
-std::atomic<std::uint16_t> last_crc_us{0};
-std::atomic<std::uint16_t> last_copy_us{0};
-std::atomic<std::uint32_t> last_accepted_sequence{0};
-std::atomic<std::uint32_t> last_displayed_sequence{0};
-
-constexpr std::uint16_t kCrc16NibbleTable[16] = {
-    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
-    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+
+std::atomic<std::uint8_t> latch_mode{kLatchOff};
+// Bumped by each latch command or edge; the display task latches once for
+// every change it sees, so back-to-back requests collapse into one.
+std::atomic<std::uint32_t> latch_requests{0};
+std::atomic<std::uint32_t> latch_event_us{0};
+std::uint32_t latch_requests_handled = 0;
+std::uint32_t staged_sequence = 0;
+std::atomic<std::uint16_t> last_latch_us{0};
+std::atomic<std::uint32_t> latches{0};
+std::atomic<std::uint32_t> latch_misses{0};
+std::atomic<std::uint32_t> last_latch_sequence{0};
+
+esp_timer_handle_t pacing_timer = nullptr;
+std::atomic<std::uint16_t> paced_fps{0};
+std::atomic<std::uint8_t> pacing_depth{0};
+// Ticks are ignored until the jitter buffer holds pacing_depth frames, and
+// again after it runs dry.
+std::atomic<bool> pacing_primed{false};
+std::atomic<std::uint32_t> frames_late{0};
+
+std::atomic<std::uint8_t> selected_histogram{ledgrid::kNoLatencyHistogram};
+
+// On-receiver effect, rendered by the receive task into the working frame
+// between SPI transactions. Any pixel-writing command hands the wall back to
+// the host.
+ledgrid::EffectParams effect_params;
+std::uint8_t effect_palette[ledgrid::kEffectPaletteBytes] = {};
+// Per-pixel static phase, allocated with the first effect and rebuilt when
+// the parameters or geometry change.
+std::uint8_t* effect_phase = nullptr;
+bool effect_phase_valid = false;
+std::int64_t effect_started_us = 0;
+std::uint32_t effect_tick_shown = 0;
+bool effect_frame_pending = false;
+std::atomic<std::uint32_t> effect_frames{0};
+
+// Clips play from the store straight into the display: each mailbox slot
+// carries a pointer to the clip frame instead of a copy. A store frame may
+// only be rewritten once no slot still points at it, which the receiver core
+// tracks for its external frames. Like effects, playback stops at the next
+// pixel-writing command.
+//
+// While recording, the display task appends every frame it puts up to the
+// same store. recorder_writing brackets each append so the receive task can
+// freeze the recording and then read it. The receive task waits for the
+// display on display_progress, which the display task gives after each append
+// and each mailbox slot it hands back; a waiter rechecks its condition, so a
+// give nobody was waiting for only costs one extra check.
+constexpr std::size_t kClipStoreBytes =
+    static_cast<std::size_t>(LEDGRID_CLIP_STORE_KB) * 1024U;
+// PSRAM left for everything else before the store is allocated.
+constexpr std::size_t kClipStoreHeadroomBytes = 512U * 1024U;
+constexpr std::uint32_t kClipReleaseTimeoutMs = 50;
+std::uint8_t* clip_storage = nullptr;
+ledgrid::ClipStore clip_store;
+ledgrid::ClipPlayer clip_player;
+std::uint16_t clip_rejected = 0;
+std::atomic<bool> recorder_on{false};
+std::atomic<bool> recorder_writing{false};
+StaticSemaphore_t display_progress_storage;
+SemaphoreHandle_t display_progress = nullptr;
+std::atomic<std::uint32_t> frames_recorded{0};
+std::uint32_t recording_started_frames = 0;
+std::uint16_t readback_back = 0;
+std::uint16_t readback_pixel = 0;
+
+// Status is encoded into one of two buffers and every queued transaction
+// transmits the front one, so re-queueing costs nothing. The SPI task
+// re-encodes the back buffer after a command or display changes something,
+// at most once per kStatusRefreshUs, and otherwise every kStatusIdleRefreshUs.
+// A buffer is only rewritten once no queued transaction still points at it.
+constexpr std::uint32_t kStatusRefreshUs = 1000;
+constexpr std::uint32_t kStatusIdleRefreshUs = 100000;
+std::uint8_t* status_buffers[2] = {};
+std::size_t status_bytes[2] = {};
+std::uint8_t status_refs[2] = {};
+std::size_t status_front = 0;
+std::uint32_t status_generation = 0;
+std::uint32_t status_refreshed_us = 0;
+std::atomic<bool> status_changed{true};
+std::atomic<std::uint8_t> status_page{
+    static_cast<std::uint8_t>(ledgrid::StatusPage::V2)};
+ledgrid::Crc16Engine crc_engine = ledgrid::Crc16Engine::LEDGRID_CRC_ENGINE;
+
+class EspTimerClock final : public ledgrid::ReceiverClock {
+ public:
+  std::uint32_t now_us() override {
+    return static_cast<std::uint32_t>(esp_timer_get_time());
+  }
+};
+
+class LedDriverDisplay final : public ledgrid::FrameDisplay {
+ public:
+  bool can_submit() const override { return led_driver.can_submit(); }
+  ledgrid::SubmitResult submit(
+      const std::uint8_t* pixels,
+      std::size_t bytes,
+      std::uint8_t strip_count,
+      std::uint16_t leds_per_strip,
+      std::uint8_t brightness,
+      std::uint32_t sequence,
+      ledgrid::PixelSpan dirty_columns,
+      const ledgrid::FrameBlend* blend,
+      ledgrid::PixelFormat format) override {
+    return led_driver.submit(pixels, bytes, strip_count, leds_per_strip, brightness,
+                             sequence, dirty_columns, blend, format);
+  }
+  bool take_completion(ledgrid::TransferCompletion* completion) override {
+    return led_driver.take_completion(completion);
+  }
+  std::uint16_t last_encode_us() const override { return led_driver.last_encode_us(); }
+};
+
+// Ties the receiver core to the tasks, effects, clips and staged encoder
+// settings around it; defined below, next to what each hook calls.
+class ReceiverGlue final : public ledgrid::ReceiverHooks {
+ public:
+  void run_command(std::uint8_t* data, std::size_t length) override;
+  void before_pixel_write() override;
+  void frame_published() override;
+  void state_changed() override;
+  void palette_changed(const std::uint8_t* palette) override;
+  void frame_shown(const std::uint8_t* pixels,
+                   const ledgrid::FrameMetadata& metadata) override;
+  void frame_released() override;
+  std::uint8_t* allocate_packet_buffer() override;
 };
 
+EspTimerClock receiver_clock;
+LedDriverDisplay led_display;
+ReceiverGlue receiver_glue;
+// The packet and frame pipeline. The SPI task is its receive side and the
+// display task its display side.
+ledgrid::ReceiverCore receiver(receiver_clock, led_display, receiver_glue);
+
 std::uint16_t duration_u16(std::uint32_t value) {
   return value > UINT16_MAX ? UINT16_MAX : static_cast<std::uint16_t>(value);
 }
 
-std::size_t total_leds() {
-  return static_cast<std::size_t>(active_strips) * leds_per_strip;
+std::uint32_t now_us() { return static_cast<std::uint32_t>(esp_timer_get_time()); }
+
+// Confirms the configured engine against the reference implementation on the
+// CCITT-FALSE check string and a frame-sized pattern before trusting it.
+void select_crc_engine() {
+  static const std::uint8_t kCheck[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  const std::uint8_t* pattern = spare_rx_buffer;
+  bool agrees = ledgrid::crc16_engine_available(crc_engine) &&
+                ledgrid::crc16_ccitt(crc_engine, kCheck, sizeof(kCheck)) ==
+                    0x29B1;
+  for (std::size_t length = 0; agrees && length <= frame_plan.spi_buffer_bytes;
+       length += 509U) {
+    agrees = ledgrid::crc16_ccitt(crc_engine, pattern, length) ==
+             ledgrid::crc16_ccitt_nibble(pattern, length);
+  }
+  if (!agrees) {
+    Serial.printf("CRC engine %s failed self-test; using nibble\n",
+                  ledgrid::crc16_engine_name(crc_engine));
+    crc_engine = ledgrid::Crc16Engine::Nibble;
+  }
+}
+
+std::uint16_t load_stored_u16(const char* key, std::uint16_t fallback) {
+  nvs_handle_t handle = 0;
+  if (nvs_open(kNvsNamespace, NVS_READONLY, &handle) != ESP_OK) return fallback;
+  std::uint16_t value = fallback;
+  if (nvs_get_u16(handle, key, &value) != ESP_OK) value = fallback;
+  nvs_close(handle);
+  return value;
+}
+
+bool store_geometry(std::uint16_t capacity, std::uint16_t leds) {
+  nvs_handle_t handle = 0;
+  if (nvs_open(kNvsNamespace, NVS_READWRITE, &handle) != ESP_OK) return false;
+  const bool stored = nvs_set_u16(handle, kNvsCapacityKey, capacity) == ESP_OK &&
+                      nvs_set_u16(handle, kNvsLedsKey, leds) == ESP_OK &&
+                      nvs_commit(handle) == ESP_OK;
+  nvs_close(handle);
+  return stored;
+}
+
+// Stores the committed map, or erases it for version 0.
+bool store_layout(const ledgrid::LayoutMapInfo& info) {
+  nvs_handle_t handle = 0;
+  if (nvs_open(kNvsNamespace, NVS_READWRITE, &handle) != ESP_OK) return false;
+  bool stored;
+  if (info.version == 0) {
+    nvs_erase_key(handle, kNvsLayoutInfoKey);
+    nvs_erase_key(handle, kNvsLayoutKey);
+    stored = nvs_commit(handle) == ESP_OK;
+  } else {
+    std::uint8_t info_bytes[ledgrid::kLayoutInfoBytes];
+    ledgrid::write_layout_info(info, info_bytes);
+    stored = nvs_set_blob(handle, kNvsLayoutKey, layout_entries,
+                          info.pixels() * ledgrid::kLayoutEntryBytes) == ESP_OK &&
+             nvs_set_blob(handle, kNvsLayoutInfoKey, info_bytes, sizeof(info_bytes)) ==
+                 ESP_OK &&
+             nvs_commit(handle) == ESP_OK;
+  }
+  nvs_close(handle);
+  return stored;
+}
+
+[[noreturn]] void restart_with_capacity(std::uint16_t capacity, std::uint16_t leds) {
+  store_geometry(capacity, leds);
+  Serial.printf("Restarting for %u LEDs/strip capacity\n", capacity);
+  Serial.flush();
+  esp_restart();
+  while (true) delay(1000);
+}
+
+void load_capacity() {
+  led_capacity = load_stored_u16(kNvsCapacityKey, ledgrid::kFactoryLedCapacity);
+  if (led_capacity < ledgrid::kFactoryLedCapacity ||
+      !ledgrid::led_capacity_valid(kMaxStrips, led_capacity)) {
+    led_capacity = ledgrid::kFactoryLedCapacity;
+  }
+  boot_leds_per_strip = load_stored_u16(kNvsLedsKey, kDefaultLedsPerStrip);
+  if (boot_leds_per_strip == 0 || boot_leds_per_strip > led_capacity) {
+    boot_leds_per_strip = std::min(kDefaultLedsPerStrip, led_capacity);
+  }
+}
+
+std::uint8_t* allocate_frame(std::size_t bytes, ledgrid::MemoryTier tier) {
+  std::uint32_t caps = MALLOC_CAP_8BIT;
+  switch (tier) {
+    case ledgrid::MemoryTier::InternalDma:
+      caps |= MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA;
+      break;
+    case ledgrid::MemoryTier::Internal:
+      caps |= MALLOC_CAP_INTERNAL;
+      break;
+    case ledgrid::MemoryTier::Psram:
+      caps |= MALLOC_CAP_SPIRAM;
+      break;
+  }
+  auto* buffer = static_cast<std::uint8_t*>(
+      heap_caps_aligned_alloc(ledgrid::kFrameAlignment, bytes, caps));
+  if (buffer != nullptr) std::memset(buffer, 0, bytes);
+  return buffer;
+}
+
+// Where an allocation actually landed, for the boot report.
+ledgrid::MemoryTier memory_tier_of(const void* buffer) {
+  if (esp_ptr_external_ram(buffer)) return ledgrid::MemoryTier::Psram;
+  return esp_ptr_dma_capable(buffer) ? ledgrid::MemoryTier::InternalDma
+                                     : ledgrid::MemoryTier::Internal;
+}
+
+void report_buffer(const char* name, std::size_t count, std::size_t bytes, const void* buffer) {
+  Serial.printf("  %-10s %u x %6u B  %s\n", name, static_cast<unsigned>(count),
+                static_cast<unsigned>(bytes),
+                ledgrid::memory_tier_name(memory_tier_of(buffer)));
+}
+
+// Allocates every frame-sized buffer for `led_capacity`. Returns false if any
+// allocation fails; the caller falls back to the factory capacity.
+bool initialize_frame_buffers() {
+  frame_plan = ledgrid::plan_frame_memory(
+      kMaxStrips, led_capacity, heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0);
+  if (frame_plan.rgb_bytes == 0) return false;
+
+  const std::size_t spi_bytes = frame_plan.spi_buffer_bytes;
+  for (auto& link : spi_links) {
+    for (auto& buffer : link.rx_buffers) {
+      buffer = allocate_frame(spi_bytes, ledgrid::MemoryTier::InternalDma);
+      if (buffer == nullptr) return false;
+    }
+  }
+  for (auto& buffer : status_buffers) {
+    buffer = allocate_frame(spi_bytes, ledgrid::MemoryTier::InternalDma);
+    if (buffer == nullptr) return false;
+  }
+  spare_rx_buffer = allocate_frame(spi_bytes, ledgrid::MemoryTier::InternalDma);
+  if (spare_rx_buffer == nullptr) return false;
+  // Zero-copy slots trade places with SPI receive buffers, so they share the
+  // SPI buffer size and tier.
+  const std::size_t slot_bytes = frame_plan.zero_copy_mailbox
+                                     ? spi_bytes
+                                     : ledgrid::kFramePixelOffset + frame_plan.rgb_bytes;
+  for (auto& buffer : receiver_buffers.mailbox) {
+    buffer = allocate_frame(slot_bytes, frame_plan.mailbox_tier);
+    if (buffer == nullptr) return false;
+  }
+  receiver_buffers.working_frame =
+      allocate_frame(frame_plan.rgb_bytes, ledgrid::MemoryTier::Internal);
+  if (receiver_buffers.working_frame == nullptr) return false;
+  receiver_buffers.zero_copy_mailbox = frame_plan.zero_copy_mailbox;
+  receiver_buffers.frame_bytes = frame_plan.rgb_bytes;
+#if LEDGRID_PIPELINED_DISPLAY
+  for (auto& buffer : keyframe_buffers) {
+    buffer = allocate_frame(frame_plan.rgb_bytes, frame_plan.history_tier);
+    if (buffer == nullptr) return false;
+  }
+#endif
+
+  // Give the CRC self-test a non-trivial pattern to checksum.
+  for (std::size_t i = 0; i < spi_bytes; ++i) {
+    spare_rx_buffer[i] = static_cast<std::uint8_t>(i * 131U + 7U);
+  }
+  return true;
 }
 
-std::size_t active_rgb_bytes() { return total_leds() * 3U; }
+// Makes the store safe to rewrite: the adopted frame moves into the working
+// frame and the display gets a few frame times to let go of queued clip
+// frames, waking this task as it hands each slot back. False if it still
+// holds one.
+bool release_clip_store() {
+  if (receiver.adopted_frame() != nullptr &&
+      clip_store.contains(receiver.adopted_frame())) {
+    receiver.sync_working_frame();
+  }
+  const TickType_t timeout = pdMS_TO_TICKS(kClipReleaseTimeoutMs);
+  const TickType_t started = xTaskGetTickCount();
+  while (receiver.external_frames_in_use()) {
+    const TickType_t waited = xTaskGetTickCount() - started;
+    if (waited >= timeout) return false;
+    xSemaphoreTake(display_progress, timeout - waited);
+  }
+  return true;
+}
 
-std::uint16_t crc16_ccitt(const std::uint8_t* data, std::size_t length) {
-  std::uint16_t crc = 0xFFFF;
-  for (std::size_t i = 0; i < length; ++i) {
-    crc ^= static_cast<std::uint16_t>(data[i]) << 8;
-    crc = static_cast<std::uint16_t>(
-        (crc << 4) ^ kCrc16NibbleTable[crc >> 12]);
-    crc = static_cast<std::uint16_t>(
-        (crc << 4) ^ kCrc16NibbleTable[crc >> 12]);
+// Runs on the display task for every frame it puts up.
+void record_shown_frame(const std::uint8_t* pixels, const ledgrid::FrameMetadata& metadata) {
+  if (!recorder_on.load(std::memory_order_relaxed)) return;
+  recorder_writing.store(true);
+  if (recorder_on.load() &&
+      clip_store.record(pixels, metadata.byte_count, metadata.sequence, now_us(),
+                        metadata.indexed)) {
+    ++frames_recorded;
+    status_changed = true;
   }
-  return crc;
+  recorder_writing.store(false, std::memory_order_release);
+  xSemaphoreGive(display_progress);
 }
 
-ledgrid::FrameMailboxCounters mailbox_counters() {
-  portENTER_CRITICAL(&mailbox_mux);
-  const auto counters = frame_mailbox.counters();
-  portEXIT_CRITICAL(&mailbox_mux);
-  return counters;
+// Waits out an append in progress, one frame copy on the other core, so the
+// recording can be read or reused. The tick timeout only bounds each sleep.
+void stop_recording() {
+  recorder_on.store(false);
+  while (recorder_writing.load()) {
+    xSemaphoreTake(display_progress, 1);
+  }
 }
 
-bool publish_working_frame() {
-  int slot = -1;
-  portENTER_CRITICAL(&mailbox_mux);
-  slot = frame_mailbox.begin_write();
-  portEXIT_CRITICAL(&mailbox_mux);
-  if (slot < 0) return false;
+// Receive task: hands the edited curves to the display task unless it has
+// yet to apply the previous ones, in which case the receive loop retries.
+void publish_curves() {
+  if (!curves_unpublished || curves_pending.load(std::memory_order_acquire)) return;
+  staged_curves = host_curves;
+  curves_unpublished = false;
+  curves_pending.store(true, std::memory_order_release);
+}
 
-  const std::size_t bytes = active_rgb_bytes();
-  const std::uint32_t copy_started =
-      static_cast<std::uint32_t>(esp_timer_get_time());
-  std::memcpy(mailbox_frames[slot], working_frame, bytes);
-  last_copy_us = duration_u16(
-      static_cast<std::uint32_t>(esp_timer_get_time()) - copy_started);
+void apply_pending_encoder_settings() {
+  if (curves_pending.load(std::memory_order_acquire)) {
+    led_driver.set_color_correction(staged_curves);
+    curves_pending.store(false, std::memory_order_release);
+  }
+  portENTER_CRITICAL(&curves_mux);
+  if (palette_pending) {
+    led_driver.set_palette(staged_palette);
+    palette_pending = false;
+  }
+  if (power_pending) {
+    led_driver.set_power_limit(power_model, power_budget);
+    power_pending = false;
+  }
+  portEXIT_CRITICAL(&curves_mux);
+  // Decoded outside the lock: the receive task leaves the entries and
+  // layout_info alone until the flag drops.
+  if (layout_pending.load(std::memory_order_acquire)) {
+    if (!led_driver.set_layout(layout_info, layout_entries)) {
+      receiver.note_display_error();
+    }
+    layout_pending.store(false, std::memory_order_release);
+  }
+}
 
-  ledgrid::FrameMetadata metadata{};
-  metadata.sequence = next_sequence++;
-  metadata.byte_count = bytes;
-  metadata.strip_count = active_strips;
-  metadata.leds_per_strip = leds_per_strip;
-  metadata.brightness = brightness;
-
-  portENTER_CRITICAL(&mailbox_mux);
-  const bool committed = frame_mailbox.commit_write(slot, metadata);
-  portEXIT_CRITICAL(&mailbox_mux);
-  if (!committed) return false;
-
-  last_accepted_sequence = metadata.sequence;
+ledgrid::PixelFormat pixel_format(const ledgrid::FrameMetadata& metadata) {
+  return metadata.indexed ? ledgrid::PixelFormat::Indexed : ledgrid::PixelFormat::Rgb;
+}
+
+void IRAM_ATTR request_latch() {
+  latch_event_us.store(
+      static_cast<std::uint32_t>(esp_timer_get_time()), std::memory_order_relaxed);
+  latch_requests.fetch_add(1, std::memory_order_release);
+}
+
+void IRAM_ATTR on_latch_edge(void*) {
+  if (latch_mode.load(std::memory_order_relaxed) != kLatchGpio) return;
+  request_latch();
+  BaseType_t task_woken = pdFALSE;
+  if (display_task_handle != nullptr) {
+    vTaskNotifyGiveFromISR(display_task_handle, &task_woken);
+  }
+  if (task_woken == pdTRUE) portYIELD_FROM_ISR();
+}
+
+void on_pacing_tick(void*) {
+  request_latch();
   if (display_task_handle != nullptr) xTaskNotifyGive(display_task_handle);
+}
+
+// Queues the staged frame. A latch is a miss when there was nothing new to
+// show or the previous frame was still on the wire, since the new one then
+// starts late and out of step with the other receivers.
+void apply_latch() {
+  const bool on_time = led_driver.has_staged() && !led_driver.in_flight();
+  if (led_driver.has_staged()) {
+    if (led_driver.latch()) {
+      last_latch_us = duration_u16(
+          static_cast<std::uint32_t>(esp_timer_get_time()) -
+          latch_event_us.load(std::memory_order_relaxed));
+      last_latch_sequence = staged_sequence;
+    } else {
+      receiver.note_display_error();
+    }
+  }
+  ++latches;
+  if (!on_time) ++latch_misses;
+}
+
+// A tick that finds nothing staged leaves the previous frame up for another
+// interval and re-buffers, so one stall costs one late frame rather than a
+// run of them.
+void apply_pacing_tick() {
+  if (!pacing_primed.load(std::memory_order_relaxed)) return;
+  if (!led_driver.has_staged()) {
+    ++frames_late;
+    pacing_primed = false;
+    return;
+  }
+  apply_latch();
+}
+
+// Keeps the next mailbox frame encoded and staged for the next latch; the
+// slot is released once encoded, like a pipelined submit. Paced frames are
+// never replaced once staged, since each one owns a tick; an unpaced frame
+// replaced before its latch counts as superseded, as in the mailbox.
+void stage_next_frame(bool paced) {
+  if (!led_driver.can_submit() || (paced && led_driver.has_staged())) return;
+  ledgrid::FrameMetadata metadata{};
+  const int slot = receiver.take_frame(&metadata);
+  if (slot < 0) return;
+  const bool replacing = led_driver.has_staged();
+
+  const ledgrid::SubmitResult result = led_driver.stage(
+      receiver.frame_pixels(slot, metadata),
+      metadata.byte_count,
+      metadata.strip_count,
+      metadata.leds_per_strip,
+      metadata.brightness,
+      metadata.sequence,
+      metadata.dirty_columns,
+      nullptr,
+      pixel_format(metadata));
+  receiver.record_encode(result);
+  receiver.finish_frame(slot, metadata, result != ledgrid::SubmitResult::Failed);
+
+  if (result == ledgrid::SubmitResult::Queued) {
+    if (replacing) receiver.mailbox().mark_superseded();
+    staged_sequence = metadata.sequence;
+  } else if (result == ledgrid::SubmitResult::Unchanged) {
+    receiver.record_displayed(metadata.sequence);
+  } else {
+    receiver.note_display_error();
+  }
+}
+
+// Runs one display step in latch mode and returns true, or returns false to
+// leave the frame to the normal display path. Leaving latch mode shows
+// whatever was still staged.
+bool service_latched_display() {
+  receiver.retire_completed_transfers();
+  if (latch_mode.load(std::memory_order_relaxed) == kLatchOff) {
+    if (led_driver.has_staged() && !led_driver.latch()) receiver.note_display_error();
+    return false;
+  }
+  const bool paced = latch_mode.load(std::memory_order_relaxed) == kLatchTimer;
+  const std::uint32_t requests = latch_requests.load(std::memory_order_acquire);
+  if (requests != latch_requests_handled) {
+    latch_requests_handled = requests;
+    if (paced) {
+      apply_pacing_tick();
+    } else {
+      apply_latch();
+    }
+  }
+  stage_next_frame(paced);
+  if (paced && !pacing_primed.load(std::memory_order_relaxed)) {
+    const std::size_t buffered =
+        receiver.mailbox().ready_count() + (led_driver.has_staged() ? 1U : 0U);
+    pacing_primed = buffered >= pacing_depth.load(std::memory_order_relaxed);
+  }
   return true;
 }
 
+#if LEDGRID_PIPELINED_DISPLAY
+// While transitions are on, `target` holds the newest frame taken from the
+// mailbox so a transition can start from it; while a transition runs, `origin` holds the
+// pixels it started from. Both point into keyframe_buffers.
+struct KeyframeTransition {
+  std::uint8_t* origin = nullptr;
+  std::uint8_t* target = nullptr;
+  ledgrid::FrameMetadata metadata{};
+  bool target_valid = false;
+  bool active = false;
+  std::uint32_t started_us = 0;
+  std::uint32_t duration_us = 0;
+  std::uint16_t submitted_weight = ledgrid::kBlendWeightMax;
+  // Columns where origin and target differ: the only columns a step changes.
+  ledgrid::PixelSpan columns{};
+  // Sequence of the keyframe until its first step has been queued.
+  std::uint32_t pending_sequence = 0;
+};
+
+KeyframeTransition transition;
+
+ledgrid::SubmitResult submit_transition_step() {
+  const std::uint32_t now = static_cast<std::uint32_t>(esp_timer_get_time());
+  const std::uint16_t weight = ledgrid::transition_weight(
+      now - transition.started_us,
+      transition.duration_us,
+      static_cast<ledgrid::TransitionEasing>(transition.metadata.easing));
+  const ledgrid::FrameBlend blend{transition.origin, weight};
+  const auto& metadata = transition.metadata;
+  const ledgrid::SubmitResult result = led_driver.submit(
+      transition.target,
+      metadata.byte_count,
+      metadata.strip_count,
+      metadata.leds_per_strip,
+      metadata.brightness,
+      transition.pending_sequence,
+      transition.columns,
+      &blend);
+  receiver.record_encode(result);
+  if (result != ledgrid::SubmitResult::Failed) {
+    transition.pending_sequence = 0;
+    transition.submitted_weight = weight;
+    transition.active = weight < ledgrid::kBlendWeightMax;
+  }
+  return result;
+}
+
+// Blends run on RGB bytes, so indexed frames always cut.
+bool starts_transition(const ledgrid::FrameMetadata& metadata) {
+  return metadata.transition_ms > 0 && transition.target_valid &&
+         !metadata.indexed && !transition.metadata.indexed &&
+         transition.metadata.strip_count == metadata.strip_count &&
+         transition.metadata.leds_per_strip == metadata.leds_per_strip;
+}
+
+// Shows a frame taken from the mailbox and releases or returns its slot.
+ledgrid::SubmitResult present_frame(int slot, const ledgrid::FrameMetadata& metadata) {
+  const std::uint8_t* pixels = receiver.frame_pixels(slot, metadata);
+  if (starts_transition(metadata)) {
+    // Start from exactly what the last step encoded so nothing jumps.
+    if (transition.active) {
+      ledgrid::blend_frames(
+          transition.origin, transition.target, metadata.byte_count,
+          transition.submitted_weight, transition.origin);
+    } else {
+      std::swap(transition.origin, transition.target);
+    }
+    std::memcpy(transition.target, pixels, metadata.byte_count);
+    receiver.finish_frame(slot, metadata, true);
+
+    transition.metadata = metadata;
+    transition.columns = ledgrid::changed_columns(
+        transition.origin, transition.target, metadata.strip_count,
+        metadata.leds_per_strip);
+    transition.started_us = static_cast<std::uint32_t>(esp_timer_get_time());
+    transition.duration_us = static_cast<std::uint32_t>(metadata.transition_ms) * 1000U;
+    transition.pending_sequence = metadata.sequence;
+    if (!transition.columns.empty()) {
+      transition.active = true;
+      return submit_transition_step();
+    }
+    transition.active = false;
+    receiver.record_displayed(metadata.sequence);
+    return ledgrid::SubmitResult::Unchanged;
+  }
+
+  // The newest buffer may hold a blend, which differs from the previous
+  // keyframe wherever the transition was still moving.
+  ledgrid::PixelSpan dirty = metadata.dirty_columns;
+  if (transition.active) dirty.include(transition.columns);
+  const ledgrid::SubmitResult result = receiver.submit_frame(slot, metadata, dirty);
+
+  if (result != ledgrid::SubmitResult::Failed) {
+    // Keep a copy to blend from only while transitions are on, so cut frames
+    // stay zero-copy; the first keyframe after SET_TRANSITION cuts.
+    transition.target_valid = metadata.transition_ms > 0;
+    if (transition.target_valid) {
+      std::memcpy(transition.target, pixels, metadata.byte_count);
+    }
+    transition.metadata = metadata;
+    transition.active = false;
+  }
+  receiver.finish_frame(slot, metadata, result != ledgrid::SubmitResult::Failed);
+
+  if (result == ledgrid::SubmitResult::Unchanged) {
+    receiver.record_displayed(metadata.sequence);
+  }
+  return result;
+}
+
+// Encodes frame N+1 into the idle DMA buffer while frame N is on the wire.
+// The mailbox slot is released as soon as its pixels are encoded; the frame
+// only counts as displayed once its transfer-done interrupt has fired. During
+// a keyframe transition every free buffer is filled with the next in-between
+// frame, so the wall refreshes at the DMA rate regardless of the host rate.
+void display_task(void*) {
+  transition.origin = keyframe_buffers[0];
+  transition.target = keyframe_buffers[1];
+  led_driver.set_completion_task(xTaskGetCurrentTaskHandle());
+  while (true) {
+    const bool waiting_on_dma = led_driver.in_flight();
+    TickType_t timeout = portMAX_DELAY;
+    if (waiting_on_dma) {
+      timeout = pdMS_TO_TICKS(100);
+    } else if (transition.active) {
+      // A step failed to queue; retry on the next tick.
+      timeout = 1;
+    }
+    const std::uint32_t notified = ulTaskNotifyTake(pdTRUE, timeout);
+    receiver.retire_completed_transfers();
+    if (notified == 0 && waiting_on_dma && led_driver.in_flight()) {
+      // A late transfer keeps its buffer until its completion is collected;
+      // count it and go on waiting for it rather than encoding or staging.
+      receiver.note_display_error();
+      continue;
+    }
+    apply_pending_encoder_settings();
+    if (service_latched_display()) {
+      // Latched frames bypass `target`, so the next keyframe cuts.
+      transition.active = false;
+      transition.target_valid = false;
+      continue;
+    }
+
+    while (led_driver.can_submit()) {
+      ledgrid::FrameMetadata metadata{};
+      const int slot = receiver.take_frame(&metadata);
+
+      ledgrid::SubmitResult result = ledgrid::SubmitResult::Unchanged;
+      if (slot >= 0) {
+        result = present_frame(slot, metadata);
+      } else if (transition.active) {
+        result = submit_transition_step();
+      } else {
+        break;
+      }
+      if (result == ledgrid::SubmitResult::Failed) {
+        receiver.note_display_error();
+        break;
+      }
+    }
+  }
+}
+#else
+// Holds each mailbox frame until its transfer completes, which streaming DMA
+// relies on since it encodes from the frame while the strips are clocked.
 void display_task(void*) {
+  // Latch mode does not wait for each transfer, so completions wake the task.
+  led_driver.set_completion_task(xTaskGetCurrentTaskHandle());
   while (true) {
     ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    apply_pending_encoder_settings();
+    if (service_latched_display()) continue;
     while (true) {
       ledgrid::FrameMetadata metadata{};
-      int slot = -1;
-      portENTER_CRITICAL(&mailbox_mux);
-      slot = frame_mailbox.begin_read(&metadata);
-      portEXIT_CRITICAL(&mailbox_mux);
+      const int slot = receiver.take_frame(&metadata);
       if (slot < 0) break;
 
-      const bool submitted = led_driver.submit(
-          mailbox_frames[slot],
+      const ledgrid::SubmitResult result = led_driver.submit(
+          receiver.frame_pixels(slot, metadata),
           metadata.byte_count,
           metadata.strip_count,
           metadata.leds_per_strip,
           metadata.brightness,
-          metadata.sequence);
-      const bool completed =
-          submitted && led_driver.wait_for_done(pdMS_TO_TICKS(100));
-
-      portENTER_CRITICAL(&mailbox_mux);
-      if (completed) {
-        frame_mailbox.finish_read(slot);
-      } else {
-        frame_mailbox.cancel_read(slot);
+          metadata.sequence,
+          metadata.dirty_columns,
+          nullptr,
+          pixel_format(metadata));
+      receiver.record_encode(result);
+      if (result == ledgrid::SubmitResult::Queued) {
+        // The transfer may still be reading the slot, so a late one only
+        // counts an error; the slot is released once it has finished.
+        while (!led_driver.wait_for_done(pdMS_TO_TICKS(100))) {
+          receiver.note_display_error();
+        }
       }
-      portEXIT_CRITICAL(&mailbox_mux);
 
-      if (completed) {
-        last_displayed_sequence = metadata.sequence;
+      receiver.finish_frame(slot, metadata, result != ledgrid::SubmitResult::Failed);
+
+      if (result == ledgrid::SubmitResult::Unchanged) {
+        receiver.record_displayed(metadata.sequence);
+      } else if (result == ledgrid::SubmitResult::Queued) {
+        receiver.retire_completed_transfers();
       } else {
-        ++display_errors;
+        receiver.note_display_error();
       }
     }
   }
 }
+#endif
+
+// Frames the display can take before one it has not shown is replaced: one
+// undisplayed frame, or the jitter buffer when paced.
+std::size_t display_room() {
+  return receiver.mailbox().ordered() ? pacing_depth.load(std::memory_order_relaxed) : 1U;
+}
+
+// Expected spacing of display slots: the pacing period, or how long one frame
+// holds the display, going by the last frame.
+std::uint32_t slot_interval_us() {
+  const std::uint16_t fps = paced_fps.load(std::memory_order_relaxed);
+  if (fps != 0) return 1000000U / fps;
+  const std::uint32_t show = led_driver.last_show_us();
+#if LEDGRID_STREAMING_DISPLAY
+  // Chunks are encoded while the ones before them are on the wire.
+  return show;
+#elif LEDGRID_PIPELINED_DISPLAY
+  return std::max<std::uint32_t>(show, led_driver.last_encode_us());
+#else
+  return show + led_driver.last_encode_us();
+#endif
+}
+
+// When the display should next take a frame from the mailbox: the next pacing
+// tick, or once a DMA buffer frees up; `now` when it would take one at once.
+std::uint32_t next_slot_us(std::uint32_t now) {
+  if (paced_fps.load(std::memory_order_relaxed) != 0) {
+    // Until the jitter buffer fills, frames only wait for each other.
+    if (!pacing_primed.load(std::memory_order_relaxed)) return now;
+    const std::uint32_t interval = slot_interval_us();
+    const std::uint32_t since_tick =
+        now - latch_event_us.load(std::memory_order_relaxed);
+    return now + (interval - since_tick % interval);
+  }
+#if LEDGRID_PIPELINED_DISPLAY
+  if (led_driver.can_submit()) return now;
+#endif
+  return led_driver.transfer_done_us(now);
+}
 
 ledgrid::ReceiverStatusV2 status_snapshot() {
-  const auto counters = mailbox_counters();
+  const auto counters = receiver.mailbox().counters();
   ledgrid::ReceiverStatusV2 status{};
-  status.flags = 0x01U | (led_driver.in_flight() ? 0x02U : 0U);
-  status.active_strips = active_strips;
-  status.leds_per_strip = leds_per_strip;
+  status.flags = 0x01U | (led_driver.in_flight() ? 0x02U : 0U) |
+                 (receiver.delta_rejected() ? 0x04U : 0U);
+  status.active_strips = receiver.strip_count();
+  status.capabilities =
+      ledgrid::kCapabilityBatch | ledgrid::kCapabilityCompressedFrames |
+      ledgrid::kCapabilityColorCorrection |
+      (LEDGRID_PIPELINED_DISPLAY ? ledgrid::kCapabilityKeyframeTransitions : 0U) |
+      ledgrid::kCapabilityStatusPages | ledgrid::kCapabilityEffects |
+      (LEDGRID_STREAMING_DISPLAY ? 0U
+                                 : ledgrid::kCapabilityFrameLatch |
+                                       ledgrid::kCapabilityPacedDisplay);
+  status.leds_per_strip = receiver.leds_per_strip();
   status.queued_transactions = queued_transactions.load(std::memory_order_relaxed);
-  status.packets = packets_received.load(std::memory_order_relaxed);
-  status.crc_errors = crc_errors.load(std::memory_order_relaxed);
-  status.crc_ok_packets = crc_ok_packets.load(std::memory_order_relaxed);
+  status.packets = receiver.packets();
+  status.crc_errors = receiver.crc_errors();
+  status.crc_ok_packets = receiver.crc_ok_packets();
   status.frames_accepted = counters.accepted;
   status.frames_displayed = counters.displayed;
   status.frames_superseded = counters.superseded;
   status.publish_drops = counters.publish_drops;
   status.spi_queue_errors = spi_queue_errors;
-  status.last_crc_us = last_crc_us.load(std::memory_order_relaxed);
-  status.last_copy_us = last_copy_us.load(std::memory_order_relaxed);
+  status.last_crc_us = receiver.last_crc_us();
+  status.last_copy_us = receiver.last_copy_us();
   status.last_encode_us = led_driver.last_encode_us();
   status.last_show_us = led_driver.last_show_us();
-  status.last_accepted_sequence =
-      last_accepted_sequence.load(std::memory_order_relaxed);
-  status.last_displayed_sequence =
-      last_displayed_sequence.load(std::memory_order_relaxed);
-  status.display_errors = display_errors.load(std::memory_order_relaxed);
+  status.last_accepted_sequence = receiver.last_accepted_sequence();
+  status.last_displayed_sequence = receiver.last_displayed_sequence();
+  // A streaming underrun can latch a torn frame, so it counts as one.
+  status.display_errors = receiver.display_errors() + led_driver.stream_underruns();
+  status.latch_mode = latch_mode.load(std::memory_order_relaxed);
+  status.last_latch_us = last_latch_us.load(std::memory_order_relaxed);
+  status.latches = latches.load(std::memory_order_relaxed);
+  status.latch_misses = latch_misses.load(std::memory_order_relaxed);
+  status.last_latch_sequence = last_latch_sequence.load(std::memory_order_relaxed);
+  status.paced_fps = paced_fps.load(std::memory_order_relaxed);
+  status.pacing_depth = pacing_depth.load(std::memory_order_relaxed);
+  status.frames_late = frames_late.load(std::memory_order_relaxed);
+  status.queue_drops = counters.queue_drops;
+  status.histogram_stage = selected_histogram.load(std::memory_order_relaxed);
+  if (status.histogram_stage < ledgrid::kLatencyStageCount) {
+    status.histogram =
+        receiver.histogram(static_cast<ledgrid::LatencyStage>(status.histogram_stage))
+            .snapshot();
+  }
+  const auto& assembler = receiver.assembler();
+  const auto& assembly = assembler.counters();
+  status.chunk_sequence = assembler.sequence();
+  status.missing_strips = static_cast<std::uint16_t>(assembler.missing());
+  status.chunk_crc_errors = assembly.chunk_crc_errors;
+  status.frames_recovered = assembly.frames_recovered;
+  const std::size_t room = display_room();
+  const std::size_t ready = receiver.mailbox().ready_count();
+  status.display_room = static_cast<std::uint8_t>(room);
+  status.display_credits = static_cast<std::uint8_t>(ready < room ? room - ready : 0U);
+  status.snapshot_us = now_us();
+  status.next_slot_us = next_slot_us(status.snapshot_us);
+  status.slot_interval_us = slot_interval_us();
   return status;
 }
 
-bool queue_spi_transaction(std::size_t index) {
-  ledgrid::encode_receiver_status_v2(
-      status_snapshot(), spi_tx_buffers[index], kSpiBufferSize);
-  auto& transaction = spi_transactions[index];
+ledgrid::ReceiverMemoryStatus memory_snapshot() {
+  ledgrid::ReceiverMemoryStatus memory{};
+  memory.led_capacity = led_capacity;
+  memory.mailbox_tier = static_cast<std::uint8_t>(frame_plan.mailbox_tier);
+  memory.history_tier = static_cast<std::uint8_t>(frame_plan.history_tier);
+  memory.zero_copy_mailbox = frame_plan.zero_copy_mailbox;
+  memory.rgb_bytes = frame_plan.rgb_bytes;
+  memory.spi_buffer_bytes = frame_plan.spi_buffer_bytes;
+  memory.led_dma_bytes = led_driver.dma_buffer_bytes();
+  memory.free_internal = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+  memory.min_free_internal = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+  memory.largest_internal_block =
+      heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+  memory.free_psram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+  memory.largest_psram_block = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+  return memory;
+}
+
+ledgrid::ReceiverConfigStatus config_snapshot() {
+  ledgrid::ReceiverConfigStatus config{};
+  config.active_strips = receiver.strip_count();
+  config.max_lanes = static_cast<std::uint8_t>(kMaxStrips);
+  config.leds_per_strip = receiver.leds_per_strip();
+  config.led_capacity = led_capacity;
+  config.brightness = receiver.brightness();
+  config.transition_easing = receiver.transition_easing();
+  config.transition_ms = receiver.transition_ms();
+  config.latch_mode = latch_mode.load(std::memory_order_relaxed);
+  config.pacing_depth = pacing_depth.load(std::memory_order_relaxed);
+  config.paced_fps = paced_fps.load(std::memory_order_relaxed);
+  config.crc_engine = static_cast<std::uint8_t>(crc_engine);
+  config.encoder_kernel =
+      static_cast<std::uint8_t>(ledgrid::EncoderKernel::LEDGRID_ENCODER_KERNEL);
+  config.display_mode = LEDGRID_STREAMING_DISPLAY   ? ledgrid::kDisplayStreaming
+                        : LEDGRID_PIPELINED_DISPLAY ? ledgrid::kDisplayPipelined
+                                                    : ledgrid::kDisplaySerial;
+  config.histogram_stage = selected_histogram.load(std::memory_order_relaxed);
+  config.status_refresh_us = static_cast<std::uint16_t>(kStatusRefreshUs);
+  config.effect_kind = static_cast<std::uint8_t>(effect_params.kind);
+  config.frame_formats = ledgrid::kFrameFormatIndexed |
+                         (kSpiLinkCount > 1 ? ledgrid::kFrameFormatStriped : 0U) |
+                         (clip_store.capacity() > 0 ? ledgrid::kFrameFormatClips : 0U) |
+                         ledgrid::kFrameFormatPowerLimit | ledgrid::kFrameFormatChunked |
+                         (layout_entries != nullptr ? ledgrid::kFrameFormatLayout : 0U);
+  config.effect_ticks_per_second = effect_params.ticks_per_second;
+  config.effect_frames = effect_frames.load(std::memory_order_relaxed);
+  config.encode_cores = led_driver.encode_cores() == ledgrid::EncodeCores::Two ? 2 : 1;
+  config.encode_helper_share = led_driver.last_helper_share();
+  if (layout_info.version != 0) {
+    const bool in_use = !layout_pending.load(std::memory_order_acquire) &&
+                        led_driver.layout_version() == layout_info.version &&
+                        layout_info.strip_count == receiver.strip_count() &&
+                        layout_info.leds_per_strip == receiver.leds_per_strip();
+    config.layout_state = in_use ? ledgrid::kLayoutActive : ledgrid::kLayoutInactive;
+  }
+  config.layout_version = layout_info.version;
+  config.layout_crc = layout_info.crc;
+  config.layout_rejected = layout_rejected;
+  return config;
+}
+
+// The ring and slot fields describe link 0; the links page has every link.
+ledgrid::ReceiverTransportStatus transport_snapshot() {
+  const SpiLink& link = spi_links[0];
+  ledgrid::ReceiverTransportStatus transport{};
+  transport.ring_depth = static_cast<std::uint8_t>(kSpiQueueDepth);
+  transport.max_backlog = link.max_backlog.load(std::memory_order_relaxed);
+  transport.task_core = static_cast<std::uint8_t>(kSpiTaskCore);
+  transport.task_priority = static_cast<std::uint8_t>(kSpiTaskPriority);
+  transport.ring_drained = link.ring_drained.load(std::memory_order_relaxed);
+  transport.spi_queue_errors = spi_queue_errors.load(std::memory_order_relaxed);
+  transport.packets = receiver.packets();
+  for (std::size_t i = 0; i < kSpiQueueDepth; ++i) {
+    transport.slots[i].completions =
+        link.slot_completions[i].load(std::memory_order_relaxed);
+    transport.slots[i].max_service_us = link.slot_max_service_us[i];
+    transport.slots[i].requeue_failures = link.slot_requeue_failures[i];
+  }
+  return transport;
+}
+
+ledgrid::ReceiverLinksStatus links_snapshot() {
+  ledgrid::ReceiverLinksStatus links{};
+  links.link_count = static_cast<std::uint8_t>(kSpiLinkCount);
+  const auto& assembly = receiver.assembler().counters();
+  links.parts = assembly.parts;
+  links.frames_assembled = assembly.frames;
+  links.frames_abandoned = assembly.abandoned;
+  links.stale_parts = assembly.stale;
+  links.rejected_parts = assembly.rejected;
+  links.last_assembled_sequence = assembly.last_sequence;
+  for (std::size_t i = 0; i < kSpiLinkCount; ++i) {
+    const SpiLink& link = spi_links[i];
+    auto& entry = links.links[i];
+    entry.host = static_cast<std::uint8_t>(kSpiLinkPins[i].host);
+    entry.has_miso = kSpiLinkPins[i].miso != GPIO_NUM_NC;
+    entry.max_backlog = link.max_backlog.load(std::memory_order_relaxed);
+    entry.queued_transactions =
+        static_cast<std::uint8_t>(link.queued.load(std::memory_order_relaxed));
+    entry.packets = link.packets.load(std::memory_order_relaxed);
+    entry.crc_ok_packets = link.crc_ok_packets.load(std::memory_order_relaxed);
+    entry.crc_errors = link.crc_errors.load(std::memory_order_relaxed);
+    entry.spi_queue_errors = link.queue_errors.load(std::memory_order_relaxed);
+    entry.ring_drained = link.ring_drained.load(std::memory_order_relaxed);
+  }
+  return links;
+}
+
+// The recording is only read back once frozen; while it runs the display
+// task owns the store.
+ledgrid::ReceiverClipStatus clips_snapshot() {
+  ledgrid::ReceiverClipStatus clips{};
+  const bool recording = recorder_on.load(std::memory_order_relaxed);
+  const auto& playback = clip_player.playback();
+  clips.capacity = clip_store.capacity();
+  clips.state = recording               ? ledgrid::kClipsRecording
+                : clip_player.playing() ? ledgrid::kClipsPlaying
+                                        : ledgrid::kClipsIdle;
+  clips.frame_bytes = static_cast<std::uint32_t>(clip_store.frame_bytes());
+  clips.first = playback.first;
+  clips.count = playback.count;
+  clips.current = playback.current;
+  clips.loops = playback.loops;
+  clips.loops_done = playback.loops_done;
+  clips.frames_played = playback.frames_played;
+  clips.frames_recorded = frames_recorded.load(std::memory_order_relaxed);
+  clips.rejected = clip_rejected;
+  clips.readback_back = readback_back;
+  if (recording) {
+    clips.recorded = static_cast<std::uint16_t>(std::min<std::uint32_t>(
+        clips.frames_recorded - recording_started_frames, clips.capacity));
+    return clips;
+  }
+  clips.recorded = clip_store.recorded();
+  const ledgrid::ClipFrameHeader* frame = clip_store.recorded_frame(readback_back);
+  if (frame == nullptr) return clips;
+  const bool indexed = (frame->flags & ledgrid::kClipFrameIndexed) != 0;
+  const std::size_t offset = static_cast<std::size_t>(readback_pixel) * (indexed ? 1U : 3U);
+  clips.readback_flags = ledgrid::kClipReadbackValid |
+                         (indexed ? ledgrid::kClipReadbackIndexed : 0U);
+  clips.readback_sequence = frame->sequence;
+  clips.readback_shown_us = frame->shown_us;
+  clips.readback_offset = static_cast<std::uint32_t>(offset);
+  if (offset < frame->byte_count) {
+    clips.readback = clip_store.recorded_pixels(readback_back) + offset;
+    clips.readback_bytes = static_cast<std::uint16_t>(
+        std::min<std::size_t>(frame->byte_count - offset, ledgrid::kClipReadbackBytes));
+  }
+  return clips;
+}
+
+ledgrid::ReceiverPowerStatus power_snapshot() {
+  const ledgrid::PowerEstimate estimate = led_driver.power_estimate();
+  ledgrid::ReceiverPowerStatus power{};
+  portENTER_CRITICAL(&curves_mux);
+  power.budget_total_ma = power_budget.total_ma;
+  power.budget_strip_ma = power_budget.strip_ma;
+  for (std::size_t channel = 0; channel < 3; ++channel) {
+    power.channel_ua[channel] = power_model.channel_ua[channel];
+  }
+  power.idle_ua = power_model.idle_ua;
+  portEXIT_CRITICAL(&curves_mux);
+  power.requested_brightness = estimate.requested_brightness;
+  power.applied_brightness = estimate.brightness;
+  power.strip_count = estimate.strip_count;
+  power.busiest_strip = estimate.busiest_strip;
+  power.demand_ma = estimate.demand_ma;
+  power.total_ma = estimate.total_ma;
+  power.limited_frames = led_driver.power_limited_frames();
+  for (std::size_t strip = 0; strip < estimate.strip_count; ++strip) {
+    power.strip_ma[strip] = estimate.strip_ma[strip];
+  }
+  return power;
+}
+
+std::size_t encode_status_page(std::uint8_t* output, std::size_t size) {
+  const auto status = status_snapshot();
+  const auto page =
+      static_cast<ledgrid::StatusPage>(status_page.load(std::memory_order_relaxed));
+  ledgrid::StatusPageHeader header{};
+  header.generation = status_generation;
+  header.capabilities = status.capabilities;
+  header.flags = status.flags;
+  switch (page) {
+    case ledgrid::StatusPage::Core:
+      return ledgrid::encode_status_core_page(header, status, output, size);
+    case ledgrid::StatusPage::Histograms: {
+      ledgrid::LatencySnapshot snapshots[ledgrid::kLatencyStageCount];
+      for (std::size_t i = 0; i < ledgrid::kLatencyStageCount; ++i) {
+        snapshots[i] =
+            receiver.histogram(static_cast<ledgrid::LatencyStage>(i)).snapshot();
+      }
+      return ledgrid::encode_status_histogram_page(header, snapshots, output, size);
+    }
+    case ledgrid::StatusPage::Memory:
+      return ledgrid::encode_status_memory_page(
+          header, memory_snapshot(), output, size);
+    case ledgrid::StatusPage::Config:
+      return ledgrid::encode_status_config_page(
+          header, config_snapshot(), output, size);
+    case ledgrid::StatusPage::Transport:
+      return ledgrid::encode_status_transport_page(
+          header, transport_snapshot(), output, size);
+    case ledgrid::StatusPage::Links:
+      return ledgrid::encode_status_links_page(
+          header, links_snapshot(), output, size);
+    case ledgrid::StatusPage::Clips:
+      return ledgrid::encode_status_clips_page(
+          header, clips_snapshot(), output, size);
+    case ledgrid::StatusPage::Power:
+      return ledgrid::encode_status_power_page(
+          header, power_snapshot(), output, size);
+    case ledgrid::StatusPage::V2:
+      break;
+  }
+  if (!ledgrid::encode_receiver_status_v2(status, output, size)) return 0;
+  // The v2 block grows by whichever tails fit.
+  for (const std::size_t bytes :
+       {ledgrid::kStatusBytesV2Credits, ledgrid::kStatusBytesV2Chunks,
+        ledgrid::kStatusBytesV2Histogram, ledgrid::kStatusBytesV2Pacing,
+        ledgrid::kStatusBytesV2Latch}) {
+    if (size >= bytes) return bytes;
+  }
+  return ledgrid::kStatusBytesV2;
+}
+
+// Runs on the receive task, which is the only one that queues transactions.
+void refresh_status() {
+  const std::uint32_t now = now_us();
+  const std::uint32_t age = now - status_refreshed_us;
+  const bool due = status_generation == 0 || age >= kStatusIdleRefreshUs ||
+                   (age >= kStatusRefreshUs &&
+                    status_changed.load(std::memory_order_relaxed));
+  const std::size_t back = status_front ^ 1U;
+  if (!due || status_refs[back] != 0) return;
+
+  status_changed = false;
+  ++status_generation;
+  std::uint8_t* buffer = status_buffers[back];
+  const std::size_t written =
+      encode_status_page(buffer, frame_plan.spi_buffer_bytes);
+  // A shorter page must not leave the tail of the previous one behind.
+  if (status_bytes[back] > written) {
+    std::memset(buffer + written, 0, status_bytes[back] - written);
+  }
+  status_bytes[back] = written;
+  status_front = back;
+  status_refreshed_us = now;
+}
+
+bool link_has_miso(std::size_t link) { return kSpiLinkPins[link].miso != GPIO_NUM_NC; }
+
+// Transactions carry their link and ring slot as user data.
+void* transaction_tag(std::size_t link, std::size_t index) {
+  return reinterpret_cast<void*>(link * kSpiQueueDepth + index);
+}
+
+void release_status(std::size_t link, std::size_t index) {
+  if (!link_has_miso(link)) return;
+  std::uint8_t& refs = status_refs[spi_links[link].transaction_status[index]];
+  if (refs > 0) --refs;
+}
+
+bool queue_spi_transaction(std::size_t link_index, std::size_t index) {
+  SpiLink& link = spi_links[link_index];
+  auto& transaction = link.transactions[index];
   transaction = {};
-  transaction.length = kSpiBufferSize * 8U;
-  transaction.tx_buffer = spi_tx_buffers[index];
-  transaction.rx_buffer = spi_rx_buffers[index];
-  transaction.user = reinterpret_cast<void*>(index);
+  transaction.length = frame_plan.spi_buffer_bytes * 8U;
+  transaction.rx_buffer = link.rx_buffers[index];
+  transaction.user = transaction_tag(link_index, index);
+  if (link_has_miso(link_index)) {
+    refresh_status();
+    transaction.tx_buffer = status_buffers[status_front];
+    link.transaction_status[index] = status_front;
+    ++status_refs[status_front];
+  }
+  // Never blocks: the slot being queued is the one just taken off the ring,
+  // so the driver queue always has room for it.
   const esp_err_t result =
-      spi_slave_queue_trans(SPI2_HOST, &transaction, pdMS_TO_TICKS(10));
+      spi_slave_queue_trans(kSpiLinkPins[link_index].host, &transaction, 0);
   if (result != ESP_OK) {
+    release_status(link_index, index);
     ++spi_queue_errors;
+    ++link.queue_errors;
     return false;
   }
   ++queued_transactions;
+  ++link.queued;
   return true;
 }
 
-void process_command(const std::uint8_t* data, std::size_t length) {
-  if (data == nullptr || length == 0) return;
+// fps 0 returns to showing frames as they arrive. pacing_primed is cleared
+// before the mode changes so a new pace always starts by buffering.
+void set_pacing(std::uint16_t fps, std::uint8_t depth) {
+  if (pacing_timer != nullptr) esp_timer_stop(pacing_timer);
+  pacing_primed = false;
+  receiver.mailbox().set_ordered(fps > 0);
+  paced_fps = fps;
+  pacing_depth = fps > 0 ? depth : 0;
+  latch_mode = fps > 0 ? kLatchTimer : kLatchOff;
+  if (fps > 0 && pacing_timer != nullptr) {
+    esp_timer_start_periodic(pacing_timer, 1000000ULL / fps);
+  }
+  if (display_task_handle != nullptr) xTaskNotifyGive(display_task_handle);
+}
+
+bool effect_running() { return effect_params.kind != ledgrid::EffectKind::Off; }
+
+void reset_effect_palette() {
+  for (std::size_t i = 0; i < 256; ++i) {
+    std::memset(effect_palette + i * 3U, static_cast<int>(i), 3);
+  }
+}
+
+// A new kind restarts the animation clock; new parameters for the running
+// kind keep it, so the host can steer an effect without it jumping.
+void start_effect(const ledgrid::EffectParams& params) {
+  if (params.kind != ledgrid::EffectKind::Off && effect_phase == nullptr) {
+    effect_phase = allocate_frame(
+        static_cast<std::size_t>(kMaxStrips) * led_capacity, frame_plan.history_tier);
+    if (effect_phase == nullptr) return;
+  }
+  clip_player.stop();
+  if (params.kind != effect_params.kind) effect_started_us = esp_timer_get_time();
+  effect_params = params;
+  effect_phase_valid = false;
+  effect_frame_pending = true;
+}
+
+void stop_effect() {
+  effect_params.kind = ledgrid::EffectKind::Off;
+  effect_frame_pending = false;
+}
+
+// Renders the next effect frame once the tick has moved on and the display
+// has room for it.
+void service_effect() {
+  if (!effect_running()) return;
+  if (receiver.mailbox().ready_count() >= display_room()) return;
+  const std::uint32_t elapsed_ms =
+      static_cast<std::uint32_t>((esp_timer_get_time() - effect_started_us) / 1000);
+  const std::uint32_t tick = ledgrid::effect_tick(effect_params, elapsed_ms);
+  if (!effect_frame_pending && tick == effect_tick_shown) return;
+
+  receiver.set_received_us(now_us());
+  if (!effect_phase_valid) {
+    ledgrid::build_effect_phase(effect_params, receiver.strip_count(),
+                                receiver.leds_per_strip(), effect_phase);
+    effect_phase_valid = true;
+  }
+  ledgrid::render_effect(effect_params, effect_phase, effect_palette,
+                         receiver.strip_count(), receiver.leds_per_strip(), tick,
+                         receiver.begin_full_frame());
+  if (!receiver.publish_working_frame()) return;
+  effect_tick_shown = tick;
+  effect_frame_pending = false;
+  ++effect_frames;
+}
+
+// How long the receive task may sleep before the effect's next tick.
+TickType_t effect_wait_ticks() {
+  if (!effect_running() || effect_params.ticks_per_second == 0) {
+    return effect_frame_pending ? 1 : pdMS_TO_TICKS(100);
+  }
+  const TickType_t wait = pdMS_TO_TICKS(1000U / effect_params.ticks_per_second);
+  return wait > 0 ? wait : 1;
+}
 
+// Shows the clip's next frame once it is due and the display has room for
+// it, on the same terms as an effect frame.
+void service_clip() {
+  if (!clip_player.playing()) return;
+  if (receiver.mailbox().ready_count() >= display_room()) return;
+  const std::uint32_t now = now_us();
+  if (!clip_player.due(now)) return;
+  const std::uint8_t* pixels = clip_store.pixels(clip_player.playback().current);
+  if (pixels == nullptr) {
+    clip_player.stop();
+    return;
+  }
+  receiver.set_received_us(now);
+  if (!receiver.publish_external_frame(pixels)) return;
+  clip_player.advance(clip_store, now);
+}
+
+// How long the receive task may sleep before the clip's next frame.
+TickType_t clip_wait_ticks() {
+  if (!clip_player.playing()) return portMAX_DELAY;
+  const TickType_t wait = pdMS_TO_TICKS(clip_player.wait_us(now_us()) / 1000U);
+  return wait > 0 ? wait : 1;
+}
+
+std::uint16_t command_u16(const std::uint8_t* data) {
+  return static_cast<std::uint16_t>((data[0] << 8) | data[1]);
+}
+
+// Commands beyond the frame commands the receiver core runs itself.
+void process_command(std::uint8_t* data, std::size_t length) {
   switch (data[0]) {
-    case kCmdPing:
-      digitalWrite(kStatusLed, !digitalRead(kStatusLed));
+    // Padded pings only read status, so they leave the LED alone.
+    case ledgrid::kCmdPing:
+      if (length == 1) digitalWrite(kStatusLed, !digitalRead(kStatusLed));
+      break;
+
+    // lane mask, channel mask (bit 0 R, 1 G, 2 B), 256-entry curve. The lane
+    // mask is one byte, or two big-endian bytes to reach lanes 8-15.
+    case ledgrid::kCmdSetColorCurve: {
+      const std::size_t mask_bytes = length - 2U - kColorCurveBytes;
+      if (length < 3U + kColorCurveBytes || mask_bytes > 2U) break;
+      const std::uint16_t lane_mask =
+          mask_bytes == 1U ? data[1]
+                           : static_cast<std::uint16_t>((data[1] << 8) | data[2]);
+      const std::uint8_t channel_mask = data[1 + mask_bytes];
+      const std::uint8_t* curve = data + 2 + mask_bytes;
+      if (lane_mask == 0 || channel_mask == 0 || channel_mask > 0x07) break;
+      for (std::uint8_t lane = 0; lane < kMaxStrips; ++lane) {
+        if ((lane_mask & (1U << lane)) == 0) continue;
+        for (std::uint8_t channel = 0; channel < 3; ++channel) {
+          if ((channel_mask & (1U << channel)) == 0) continue;
+          std::memcpy(host_curves.curve[lane][channel].data(), curve,
+                      kColorCurveBytes);
+        }
+      }
+      curves_unpublished = true;
+      publish_curves();
+      break;
+    }
+
+    // Streaming encodes from the mailbox slot, which cannot stay staged while
+    // newer frames arrive, so those builds only show frames as they come.
+    case ledgrid::kCmdSetLatch:
+      if (length != 2 || data[1] > kLatchGpio || LEDGRID_STREAMING_DISPLAY) break;
+      if (paced_fps.load(std::memory_order_relaxed) != 0) set_pacing(0, 0);
+      latch_mode = data[1];
+      if (display_task_handle != nullptr) xTaskNotifyGive(display_task_handle);
+      break;
+
+    case ledgrid::kCmdLatch:
+      if (length != 1 ||
+          latch_mode.load(std::memory_order_relaxed) != kLatchCommand) {
+        break;
+      }
+      request_latch();
+      if (display_task_handle != nullptr) xTaskNotifyGive(display_task_handle);
       break;
 
-    case kCmdSetPixel: {
-      if (length != 6) break;
-      const std::uint16_t pixel =
+    // target fps (u16), jitter buffer depth in frames; fps 0 turns pacing off
+    case ledgrid::kCmdSetPacing: {
+      if (length != 4 || LEDGRID_STREAMING_DISPLAY) break;
+      const std::uint16_t fps =
           (static_cast<std::uint16_t>(data[1]) << 8) | data[2];
-      if (pixel >= total_leds()) break;
-      const std::size_t offset = static_cast<std::size_t>(pixel) * 3U;
-      std::memcpy(working_frame + offset, data + 3, 3);
+      const std::uint8_t depth = data[3];
+      if (fps > kMaxPacedFps ||
+          (fps > 0 && (depth == 0 || depth > ledgrid::kFrameMailboxSlots))) {
+        break;
+      }
+      set_pacing(fps, depth);
       break;
     }
 
-    case kCmdSetBrightness:
-      if (length == 2) {
-        brightness = data[1];
-        publish_working_frame();
+    // stage (LatencyStage), or 0xFF to stop appending a histogram to status
+    case ledgrid::kCmdSelectHistogram:
+      if (length != 2 || (data[1] >= ledgrid::kLatencyStageCount &&
+                          data[1] != ledgrid::kNoLatencyHistogram)) {
+        break;
       }
+      selected_histogram = data[1];
+      break;
+
+    case ledgrid::kCmdResetHistograms:
+      if (length != 1) break;
+      receiver.reset_histograms();
       break;
 
-    case kCmdShow:
-      if (length == 1) publish_working_frame();
+    // StatusPage; 0 returns to the v2 layout
+    case ledgrid::kCmdSelectStatusPage:
+      if (length != 2 || data[1] >= ledgrid::kStatusPageCount) break;
+      status_page = data[1];
       break;
 
-    case kCmdClear:
-      if (length == 1) {
-        std::memset(working_frame, 0, active_rgb_bytes());
-        publish_working_frame();
+    // EffectKind, then the EffectParams fields; a lone kind 0 stops the effect
+    // and leaves its last frame up.
+    case ledgrid::kCmdSetEffect: {
+      ledgrid::EffectParams params{};
+      if (!ledgrid::parse_effect_params(data + 1, length - 1U, &params)) break;
+      if (params.kind == ledgrid::EffectKind::Off) {
+        stop_effect();
+      } else {
+        start_effect(params);
       }
       break;
+    }
 
-    case kCmdSetRange: {
-      if (length < 4) break;
-      const std::uint16_t start =
-          (static_cast<std::uint16_t>(data[1]) << 8) | data[2];
-      std::uint16_t count = data[3];
-      if (start >= total_leds()) break;
-      count = std::min<std::uint16_t>(count, total_leds() - start);
-      const std::size_t expected = 4U + static_cast<std::size_t>(count) * 3U;
-      if (length != expected) break;
-      std::memcpy(
-          working_frame + static_cast<std::size_t>(start) * 3U,
-          data + 4,
-          static_cast<std::size_t>(count) * 3U);
+    // 256 RGB entries indexed by every effect
+    case ledgrid::kCmdSetEffectPalette:
+      if (length != 1U + ledgrid::kEffectPaletteBytes) break;
+      std::memcpy(effect_palette, data + 1, ledgrid::kEffectPaletteBytes);
+      effect_frame_pending = effect_running();
+      break;
+
+    // frame index (u16), duration ms (u16), first pixel (u16), RGB bytes. A
+    // frame too large for one packet is sent as slices; the slice at pixel 0
+    // starts the frame. Refused while a clip plays or the recorder runs.
+    case ledgrid::kCmdClipFrame: {
+      if (length < 10 || (length - 7U) % 3U != 0) break;
+      const std::uint16_t index = command_u16(data + 1);
+      const std::uint16_t duration_ms = command_u16(data + 3);
+      const std::size_t first_pixel = command_u16(data + 5);
+      const std::size_t count = (length - 7U) / 3U;
+      if (first_pixel + count > receiver.total_leds() || clip_player.playing() ||
+          recorder_on.load(std::memory_order_relaxed) || !release_clip_store() ||
+          !clip_store.write_frame(index, duration_ms, first_pixel * 3U, data + 7,
+                                  count * 3U)) {
+        ++clip_rejected;
+      }
+      break;
+    }
+
+    // first frame (u16), frame count (u16), optional loop count (u16, 0
+    // loops forever); count 0 stops and leaves the current frame up
+    case ledgrid::kCmdClipPlay: {
+      if (length != 5 && length != 7) break;
+      const std::uint16_t count = command_u16(data + 3);
+      if (count == 0) {
+        clip_player.stop();
+        break;
+      }
+      if (recorder_on.load(std::memory_order_relaxed) ||
+          !clip_player.start(clip_store, command_u16(data + 1), count,
+                             length == 7 ? command_u16(data + 5) : 0, now_us())) {
+        ++clip_rejected;
+        break;
+      }
+      stop_effect();
       break;
     }
 
-    case kCmdSetAll: {
-      const std::size_t expected = 1U + active_rgb_bytes();
-      if (length != expected) break;
-      std::memcpy(working_frame, data + 1, active_rgb_bytes());
-      publish_working_frame();
+    // 1 records every frame put up into the clip store, replacing its clips;
+    // 0 freezes the recording so READ_RECORDER can walk it
+    case ledgrid::kCmdSetRecorder:
+      if (length != 2 || data[1] > 1) break;
+      stop_recording();
+      if (data[1] == 0) break;
+      clip_player.stop();
+      if (clip_store.capacity() == 0 || !release_clip_store()) {
+        ++clip_rejected;
+        break;
+      }
+      clip_store.start_recording();
+      recording_started_frames = frames_recorded.load(std::memory_order_relaxed);
+      recorder_on = true;
+      break;
+
+    // frames back from the newest (u16), first pixel (u16); may be padded so
+    // the same transfer returns that slice on the clips page
+    case ledgrid::kCmdReadRecorder:
+      if (length < 5) break;
+      readback_back = command_u16(data + 1);
+      readback_pixel = command_u16(data + 3);
+      break;
+
+    // total mA (u16), per-strip mA (u16), then optionally R, G, B and idle
+    // draw per LED in uA (u16 each); a zero limit is off. Like the curves,
+    // it applies from the next displayed frame.
+    case ledgrid::kCmdSetPowerBudget: {
+      if (length != 5 && length != 13) break;
+      portENTER_CRITICAL(&curves_mux);
+      power_budget.total_ma = command_u16(data + 1);
+      power_budget.strip_ma = command_u16(data + 3);
+      if (length == 13) {
+        for (std::size_t channel = 0; channel < 3; ++channel) {
+          power_model.channel_ua[channel] = command_u16(data + 5 + channel * 2U);
+        }
+        power_model.idle_ua = command_u16(data + 11);
+      }
+      power_pending = true;
+      portEXIT_CRITICAL(&curves_mux);
+      status_changed = true;
       break;
     }
 
-    case kCmdConfig: {
+    // first entry (u16), then big-endian u16 entries; a slice at entry 0
+    // starts a new map with every other pixel unmapped
+    case ledgrid::kCmdSetLayout: {
+      if (length < 5 || (length - 3U) % ledgrid::kLayoutEntryBytes != 0) break;
+      const std::size_t offset = command_u16(data + 1) * ledgrid::kLayoutEntryBytes;
+      const std::size_t bytes = length - 3U;
+      if (layout_pending.load(std::memory_order_acquire) ||
+          offset + bytes > layout_entry_bytes) {
+        ++layout_rejected;
+        break;
+      }
+      if (offset == 0) std::memset(layout_entries, 0xFF, layout_entry_bytes);
+      std::memcpy(layout_entries + offset, data + 3, bytes);
+      break;
+    }
+
+    // version (u32), strips (u8), LEDs per strip (u16), CRC of the entries
+    // (u16). Version 0 drops the map. A whole map is stored in NVS, which
+    // holds up this task for the flash write, and applies from the next frame
+    // with that geometry.
+    case ledgrid::kCmdCommitLayout: {
+      if (length != 1U + ledgrid::kLayoutInfoBytes) break;
+      const ledgrid::LayoutMapInfo info = ledgrid::read_layout_info(data + 1);
+      if (layout_pending.load(std::memory_order_acquire) ||
+          (info.version != 0 &&
+           (info.strip_count == 0 || info.strip_count > kMaxStrips ||
+            info.leds_per_strip > led_capacity ||
+            !ledgrid::layout_map_valid(crc_engine, info, layout_entries,
+                                       layout_entry_bytes)))) {
+        ++layout_rejected;
+        break;
+      }
+      layout_info = info.version != 0 ? info : ledgrid::LayoutMapInfo{};
+      if (!store_layout(layout_info)) {
+        Serial.printf("Layout %lu was not stored\n",
+                      static_cast<unsigned long>(layout_info.version));
+      }
+      layout_pending.store(true, std::memory_order_release);
+      status_changed = true;
+      break;
+    }
+
+    case ledgrid::kCmdConfig: {
       if (length < 4 || length > 5) break;
       const std::uint8_t new_strips = data[1];
       const std::uint16_t new_leds =
           (static_cast<std::uint16_t>(data[2]) << 8) | data[3];
-      if (new_strips != kMaxStrips || new_leds == 0 || new_leds > kMaxLedsPerStrip) {
+      if (new_strips != kMaxStrips ||
+          !ledgrid::led_capacity_valid(new_strips, new_leds)) {
         break;
       }
-      if (new_strips != active_strips || new_leds != leds_per_strip) {
-        active_strips = new_strips;
-        leds_per_strip = new_leds;
-        std::memset(working_frame, 0, sizeof(working_frame));
-        publish_working_frame();
+      if (new_leds > led_capacity) restart_with_capacity(new_leds, new_leds);
+      if (new_strips != receiver.strip_count() || new_leds != receiver.leds_per_strip()) {
+        store_geometry(led_capacity, new_leds);
+        effect_phase_valid = false;
+        clip_player.stop();
+        stop_recording();
+        release_clip_store();
+        clip_store.configure(static_cast<std::size_t>(new_strips) * new_leds * 3U);
+        receiver.set_geometry(new_strips, new_leds);
       }
       break;
     }
@@ -306,48 +1685,315 @@ void process_command(const std::uint8_t* data, std::size_t length) {
   }
 }
 
-void initialize_spi() {
-  gpio_reset_pin(kSpiChipSelect);
-  gpio_reset_pin(kSpiClock);
-  gpio_reset_pin(kSpiMosi);
-  gpio_set_direction(kSpiChipSelect, GPIO_MODE_INPUT);
-  gpio_set_direction(kSpiClock, GPIO_MODE_INPUT);
-  gpio_set_direction(kSpiMosi, GPIO_MODE_INPUT);
-  gpio_set_pull_mode(kSpiChipSelect, GPIO_PULLUP_ONLY);
-  gpio_set_pull_mode(kSpiClock, GPIO_FLOATING);
-  gpio_set_pull_mode(kSpiMosi, GPIO_FLOATING);
+void ReceiverGlue::run_command(std::uint8_t* data, std::size_t length) {
+  process_command(data, length);
+}
+
+void ReceiverGlue::before_pixel_write() {
+  if (effect_running()) stop_effect();
+  if (clip_player.playing()) clip_player.stop();
+}
+
+void ReceiverGlue::frame_published() {
+  status_changed = true;
+  if (display_task_handle != nullptr) xTaskNotifyGive(display_task_handle);
+}
+
+void ReceiverGlue::state_changed() { status_changed = true; }
+
+void ReceiverGlue::palette_changed(const std::uint8_t* palette) {
+  portENTER_CRITICAL(&curves_mux);
+  std::memcpy(staged_palette, palette, ledgrid::kPaletteBytes);
+  palette_pending = true;
+  portEXIT_CRITICAL(&curves_mux);
+}
+
+void ReceiverGlue::frame_shown(const std::uint8_t* pixels,
+                               const ledgrid::FrameMetadata& metadata) {
+  record_shown_frame(pixels, metadata);
+}
+
+void ReceiverGlue::frame_released() {
+  xSemaphoreGive(display_progress);
+}
+
+std::uint8_t* ReceiverGlue::allocate_packet_buffer() {
+  return allocate_frame(frame_plan.spi_buffer_bytes, ledgrid::MemoryTier::InternalDma);
+}
+
+void IRAM_ATTR on_spi_transaction_done(spi_slave_transaction_t* transaction) {
+  const std::size_t tag = reinterpret_cast<std::size_t>(transaction->user);
+  if (tag >= kSpiLinkCount * kSpiQueueDepth) return;
+  SpiLink& link = spi_links[tag / kSpiQueueDepth];
+  const std::size_t index = tag % kSpiQueueDepth;
+  link.done_us[index].store(
+      static_cast<std::uint32_t>(esp_timer_get_time()), std::memory_order_relaxed);
+  link.slot_completions[index].fetch_add(1, std::memory_order_relaxed);
+  const std::uint32_t backlog =
+      link.completed.fetch_add(1, std::memory_order_relaxed) + 1U -
+      link.handled.load(std::memory_order_relaxed);
+  // Only this callback raises the maximum, so a plain compare is enough.
+  if (backlog > link.max_backlog.load(std::memory_order_relaxed)) {
+    link.max_backlog.store(
+        static_cast<std::uint8_t>(std::min<std::uint32_t>(backlog, 255U)),
+        std::memory_order_relaxed);
+  }
+  if (backlog >= kSpiQueueDepth) {
+    link.ring_drained.fetch_add(1, std::memory_order_relaxed);
+  }
+  BaseType_t task_woken = pdFALSE;
+  if (spi_task_handle != nullptr) {
+    vTaskNotifyGiveFromISR(spi_task_handle, &task_woken);
+  }
+  if (task_woken == pdTRUE) portYIELD_FROM_ISR();
+}
+
+void initialize_spi_link(std::size_t link) {
+  const SpiLinkPins& pins = kSpiLinkPins[link];
+  for (const gpio_num_t pin : {pins.chip_select, pins.clock, pins.mosi}) {
+    gpio_reset_pin(pin);
+    gpio_set_direction(pin, GPIO_MODE_INPUT);
+  }
+  gpio_set_pull_mode(pins.chip_select, GPIO_PULLUP_ONLY);
+  gpio_set_pull_mode(pins.clock, GPIO_FLOATING);
+  gpio_set_pull_mode(pins.mosi, GPIO_FLOATING);
 
   spi_bus_config_t bus_config = {};
-  bus_config.mosi_io_num = kSpiMosi;
-  bus_config.miso_io_num = kSpiMiso;
-  bus_config.sclk_io_num = kSpiClock;
+  bus_config.mosi_io_num = pins.mosi;
+  bus_config.miso_io_num = pins.miso;
+  bus_config.sclk_io_num = pins.clock;
   bus_config.quadwp_io_num = -1;
   bus_config.quadhd_io_num = -1;
-  bus_config.max_transfer_sz = kSpiBufferSize;
-  bus_config.flags =
-      SPICOMMON_BUSFLAG_SCLK | SPICOMMON_BUSFLAG_MOSI | SPICOMMON_BUSFLAG_MISO;
+  bus_config.max_transfer_sz = frame_plan.spi_buffer_bytes;
+  bus_config.flags = SPICOMMON_BUSFLAG_SCLK | SPICOMMON_BUSFLAG_MOSI |
+                     (link_has_miso(link) ? SPICOMMON_BUSFLAG_MISO : 0U);
 
   spi_slave_interface_config_t slave_config = {};
   slave_config.mode = 0;
-  slave_config.spics_io_num = kSpiChipSelect;
+  slave_config.spics_io_num = pins.chip_select;
   slave_config.queue_size = kSpiQueueDepth;
+  slave_config.post_trans_cb = on_spi_transaction_done;
 
   const esp_err_t result = spi_slave_initialize(
-      SPI2_HOST, &bus_config, &slave_config, SPI_DMA_CH_AUTO);
+      pins.host, &bus_config, &slave_config, SPI_DMA_CH_AUTO);
   if (result != ESP_OK) {
-    Serial.printf("SPI initialization failed: %d\n", result);
+    Serial.printf("SPI link %u initialization failed: %d\n",
+                  static_cast<unsigned>(link), result);
     while (true) delay(1000);
   }
 
   for (std::size_t i = 0; i < kSpiQueueDepth; ++i) {
-    if (!queue_spi_transaction(i)) {
-      Serial.printf("SPI queue initialization failed for slot %u\n",
-                    static_cast<unsigned>(i));
+    if (!queue_spi_transaction(link, i)) {
+      Serial.printf("SPI link %u queue initialization failed for slot %u\n",
+                    static_cast<unsigned>(link), static_cast<unsigned>(i));
       while (true) delay(1000);
     }
   }
 }
 
+void initialize_latch_pin() {
+  gpio_reset_pin(kLatchPin);
+  gpio_set_direction(kLatchPin, GPIO_MODE_INPUT);
+  gpio_set_pull_mode(kLatchPin, GPIO_PULLDOWN_ONLY);
+  gpio_set_intr_type(kLatchPin, GPIO_INTR_POSEDGE);
+  if (gpio_install_isr_service(0) != ESP_OK ||
+      gpio_isr_handler_add(kLatchPin, on_latch_edge, nullptr) != ESP_OK) {
+    Serial.println("Latch pin interrupt unavailable");
+    return;
+  }
+  gpio_intr_enable(kLatchPin);
+}
+
+void initialize_pacing_timer() {
+  esp_timer_create_args_t args = {};
+  args.callback = on_pacing_tick;
+  args.dispatch_method = ESP_TIMER_TASK;
+  args.name = "led-pace";
+  // A late tick is a late frame already; catching up would bunch them.
+  args.skip_unhandled_events = true;
+  if (esp_timer_create(&args, &pacing_timer) != ESP_OK) {
+    pacing_timer = nullptr;
+    Serial.println("Pacing timer unavailable");
+  }
+}
+
+// Takes LEDGRID_CLIP_STORE_KB of PSRAM when that still leaves headroom.
+// Without it the store has no capacity and clip commands are refused.
+void initialize_clip_store() {
+  // Needed by the geometry change even without a store.
+  display_progress = xSemaphoreCreateBinaryStatic(&display_progress_storage);
+  if (kClipStoreBytes == 0 ||
+      heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM) <
+          kClipStoreBytes + kClipStoreHeadroomBytes) {
+    return;
+  }
+  clip_storage = allocate_frame(kClipStoreBytes, ledgrid::MemoryTier::Psram);
+  if (clip_storage == nullptr) return;
+  clip_store.attach(clip_storage, kClipStoreBytes);
+  clip_store.configure(receiver.rgb_bytes());
+}
+
+// Allocates the upload buffer and loads the stored map, if it is still whole.
+void initialize_layout() {
+  layout_entry_bytes =
+      static_cast<std::size_t>(kMaxStrips) * led_capacity * ledgrid::kLayoutEntryBytes;
+  layout_entries = allocate_frame(layout_entry_bytes, ledgrid::MemoryTier::Psram);
+  if (layout_entries == nullptr) {
+    layout_entries = allocate_frame(layout_entry_bytes, ledgrid::MemoryTier::Internal);
+  }
+  if (layout_entries == nullptr) {
+    layout_entry_bytes = 0;
+    return;
+  }
+  nvs_handle_t handle = 0;
+  if (nvs_open(kNvsNamespace, NVS_READONLY, &handle) != ESP_OK) return;
+  std::uint8_t info_bytes[ledgrid::kLayoutInfoBytes] = {};
+  std::size_t info_length = sizeof(info_bytes);
+  std::size_t entry_length = layout_entry_bytes;
+  ledgrid::LayoutMapInfo info;
+  if (nvs_get_blob(handle, kNvsLayoutInfoKey, info_bytes, &info_length) == ESP_OK &&
+      info_length == sizeof(info_bytes)) {
+    info = ledgrid::read_layout_info(info_bytes);
+  }
+  if (info.version != 0 &&
+      nvs_get_blob(handle, kNvsLayoutKey, layout_entries, &entry_length) == ESP_OK &&
+      ledgrid::layout_map_valid(crc_engine, info, layout_entries, entry_length)) {
+    layout_info = info;
+    layout_pending = true;
+    Serial.printf("Layout %lu loaded for %u x %u LEDs\n",
+                  static_cast<unsigned long>(info.version), info.strip_count,
+                  info.leds_per_strip);
+  }
+  nvs_close(handle);
+}
+
+void report_frame_memory() {
+  Serial.printf(
+      "Memory: capacity %u LEDs/strip, %s mailbox\n",
+      led_capacity,
+      frame_plan.zero_copy_mailbox ? "zero-copy" : "copied");
+  const std::size_t spi_bytes = frame_plan.spi_buffer_bytes;
+  report_buffer("spi rx", kSpiLinkCount * kSpiQueueDepth + 1U, spi_bytes,
+                spare_rx_buffer);
+  report_buffer("status", 2, spi_bytes, status_buffers[0]);
+  report_buffer(
+      "mailbox",
+      ledgrid::kFrameMailboxSlots,
+      frame_plan.zero_copy_mailbox ? spi_bytes
+                                   : ledgrid::kFramePixelOffset + frame_plan.rgb_bytes,
+      receiver.mailbox_buffer(0));
+  report_buffer("working", 1, frame_plan.rgb_bytes, receiver_buffers.working_frame);
+#if LEDGRID_PIPELINED_DISPLAY
+  report_buffer("keyframes", 2, frame_plan.rgb_bytes, keyframe_buffers[0]);
+#endif
+  if (clip_storage != nullptr) {
+    report_buffer("clips", clip_store.capacity(), clip_store.frame_bytes(), clip_storage);
+  }
+  Serial.printf(
+      "  %-10s %8u B  %s\n", "led dma",
+      static_cast<unsigned>(led_driver.dma_buffer_bytes()),
+      ledgrid::memory_tier_name(ledgrid::MemoryTier::InternalDma));
+}
+
+// Feeds one link's completed transactions to the receiver core, re-queueing
+// each with the spare buffer before its packet is checked.
+class SpiLinkTransport final : public ledgrid::PacketTransport {
+ public:
+  explicit SpiLinkTransport(std::size_t link) : link_(link) {}
+  bool receive(ledgrid::ReceivedPacket* packet) override;
+  void finish(std::uint8_t* buffer, bool valid) override;
+
+ private:
+  std::size_t link_;
+};
+
+bool SpiLinkTransport::receive(ledgrid::ReceivedPacket* packet) {
+  SpiLink& link = spi_links[link_];
+  spi_slave_transaction_t* completed = nullptr;
+  const esp_err_t result =
+      spi_slave_get_trans_result(kSpiLinkPins[link_].host, &completed, 0);
+  if (result == ESP_ERR_TIMEOUT) return false;
+  if (result != ESP_OK || completed == nullptr) {
+    ++spi_queue_errors;
+    ++link.queue_errors;
+    return false;
+  }
+  link.handled.fetch_add(1, std::memory_order_relaxed);
+  if (queued_transactions > 0) --queued_transactions;
+  if (link.queued > 0) --link.queued;
+  ++link.packets;
+  const std::size_t index =
+      reinterpret_cast<std::size_t>(completed->user) % kSpiQueueDepth;
+  release_status(link_, index);
+  packet->data = link.rx_buffers[index];
+  packet->bytes = completed->trans_len / 8U;
+  packet->received_us = link.done_us[index].load(std::memory_order_relaxed);
+  link.slot_max_service_us[index] = std::max(
+      link.slot_max_service_us[index], duration_u16(now_us() - packet->received_us));
+
+  // Keep the bus fed: hand the transaction a spare buffer and re-queue it
+  // before spending time validating the packet that just completed.
+  link.rx_buffers[index] = spare_rx_buffer;
+  if (!queue_spi_transaction(link_, index)) {
+    link.requeue_pending |= 1U << index;
+    if (link.slot_requeue_failures[index] < UINT16_MAX) {
+      ++link.slot_requeue_failures[index];
+    }
+  }
+  spare_rx_buffer = packet->data;
+  return true;
+}
+
+void SpiLinkTransport::finish(std::uint8_t* buffer, bool valid) {
+  spare_rx_buffer = buffer;
+  if (valid) {
+    ++spi_links[link_].crc_ok_packets;
+  } else {
+    ++spi_links[link_].crc_errors;
+  }
+}
+
+// Re-arms slots whose re-queue failed, then takes every completed
+// transaction off one link's ring. True while a slot is still out of the
+// ring.
+bool drain_spi_link(std::size_t link_index) {
+  SpiLink& link = spi_links[link_index];
+  for (std::size_t index = 0; index < kSpiQueueDepth; ++index) {
+    const std::uint32_t bit = 1U << index;
+    if ((link.requeue_pending & bit) != 0 && queue_spi_transaction(link_index, index)) {
+      link.requeue_pending &= ~bit;
+    }
+  }
+  SpiLinkTransport transport(link_index);
+  receiver.service_transport(transport);
+  return link.requeue_pending != 0;
+}
+
+// Installs the SPI slaves from this task so their interrupts land on the same
+// core, then drains every completed transaction on each link per
+// notification from post_trans_cb. One task serves every link, so commands
+// stay in one thread and striped parts meet in one assembler. While an
+// effect or clip runs the wait is bounded by its next frame, which is
+// published after the bus has been drained, and while a slot waits to be
+// re-queued or curves wait to be handed over by the next tick.
+void spi_receive_task(void* setup_task) {
+  for (std::size_t link = 0; link < kSpiLinkCount; ++link) initialize_spi_link(link);
+  xTaskNotifyGive(static_cast<TaskHandle_t>(setup_task));
+  bool requeue_pending = false;
+  while (true) {
+    const TickType_t wait = std::min(effect_wait_ticks(), clip_wait_ticks());
+    const bool retry = requeue_pending || curves_unpublished;
+    ulTaskNotifyTake(pdTRUE, retry ? std::min<TickType_t>(wait, 1) : wait);
+    requeue_pending = false;
+    for (std::size_t link = 0; link < kSpiLinkCount; ++link) {
+      if (drain_spi_link(link)) requeue_pending = true;
+    }
+    publish_curves();
+    service_effect();
+    service_clip();
+  }
+}
+
 }  // namespace
 
 void setup() {
@@ -357,10 +2003,35 @@ void setup() {
   digitalWrite(kStatusLed, LOW);
 
   Serial.println("LED Grid native ESP32-S3 parallel receiver v2");
-  if (!led_driver.begin(kLedPins, kMaxStrips, kMaxLedsPerStrip)) {
+  load_capacity();
+  // A capacity that does not fit is dropped back to the factory size rather
+  // than leaving the wall dark.
+  const std::uint16_t fallback_leds =
+      std::min(kDefaultLedsPerStrip, ledgrid::kFactoryLedCapacity);
+  if (!initialize_frame_buffers()) {
+    Serial.printf("Frame buffers for %u LEDs/strip do not fit\n", led_capacity);
+    if (led_capacity > ledgrid::kFactoryLedCapacity) {
+      restart_with_capacity(ledgrid::kFactoryLedCapacity, fallback_leds);
+    }
+    while (true) delay(1000);
+  }
+  select_crc_engine();
+  receiver.begin(receiver_buffers, kDefaultStrips, boot_leds_per_strip, crc_engine);
+  initialize_clip_store();
+  if (!led_driver.begin(kLedPins, kMaxStrips, led_capacity,
+                        ledgrid::EncoderKernel::LEDGRID_ENCODER_KERNEL,
+                        LEDGRID_STREAMING_DISPLAY
+                            ? ledgrid::DmaBuffering::Streaming
+                            : ledgrid::DmaBuffering::FullFrames,
+                        LEDGRID_DUAL_CORE_ENCODE ? ledgrid::EncodeCores::Two
+                                                 : ledgrid::EncodeCores::One)) {
     Serial.println("LCD/I80 parallel LED driver initialization failed");
+    if (led_capacity > ledgrid::kFactoryLedCapacity) {
+      restart_with_capacity(ledgrid::kFactoryLedCapacity, fallback_leds);
+    }
     while (true) delay(1000);
   }
+  report_frame_memory();
 
   if (xTaskCreatePinnedToCore(
           display_task,
@@ -375,51 +2046,47 @@ void setup() {
   }
 
   // Publish a black startup frame before accepting transport data.
-  publish_working_frame();
-  initialize_spi();
+  ledgrid::set_identity_curves(&host_curves);
+  reset_effect_palette();
+  // Indexed frames start out on the same grey ramp as effects.
+  receiver.set_indexed_palette(effect_palette);
+  initialize_layout();
+  receiver.publish_working_frame();
+  initialize_latch_pin();
+  initialize_pacing_timer();
+  if (xTaskCreatePinnedToCore(
+          spi_receive_task,
+          "spi-receive",
+          8192,
+          xTaskGetCurrentTaskHandle(),
+          kSpiTaskPriority,
+          &spi_task_handle,
+          kSpiTaskCore) != pdPASS) {
+    Serial.println("SPI receive task creation failed");
+    while (true) delay(1000);
+  }
+  // Wait for the ring to be armed before reporting ready.
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
   Serial.printf(
-      "Ready: %u strips x %u LEDs, SPI queue=%u, encoded frame=%u bytes\n",
-      active_strips,
-      leds_per_strip,
+      "Ready: %u strips x %u LEDs, SPI links=%u, SPI queue=%u, display=%s, "
+      "CRC=%s, encoder=%s x%u cores, encoded frame=%u bytes\n",
+      receiver.strip_count(),
+      receiver.leds_per_strip(),
+      static_cast<unsigned>(kSpiLinkCount),
       static_cast<unsigned>(kSpiQueueDepth),
-      static_cast<unsigned>(ledgrid::ws2812_encoded_size(leds_per_strip)));
+      LEDGRID_STREAMING_DISPLAY   ? "streaming"
+      : LEDGRID_PIPELINED_DISPLAY ? "pipelined"
+                                  : "serial",
+      ledgrid::crc16_engine_name(crc_engine),
+      ledgrid::encoder_kernel_name(
+          ledgrid::EncoderKernel::LEDGRID_ENCODER_KERNEL),
+      led_driver.encode_cores() == ledgrid::EncodeCores::Two ? 2U : 1U,
+      static_cast<unsigned>(
+          ledgrid::parallel_encoded_size(receiver.strip_count(),
+                                         receiver.leds_per_strip())));
 }
 
 void loop() {
-  spi_slave_transaction_t* completed = nullptr;
-  const esp_err_t result = spi_slave_get_trans_result(
-      SPI2_HOST, &completed, pdMS_TO_TICKS(100));
-  if (result == ESP_ERR_TIMEOUT) return;
-  if (result != ESP_OK || completed == nullptr) {
-    ++spi_queue_errors;
-    return;
-  }
-
-  if (queued_transactions > 0) --queued_transactions;
-  ++packets_received;
-  const std::size_t index = reinterpret_cast<std::size_t>(completed->user);
-  const std::size_t bytes = completed->trans_len / 8U;
-  const std::uint8_t* packet = spi_rx_buffers[index];
-
-  if (bytes < 1U + kCrcBytes) {
-    ++crc_errors;
-  } else {
-    const std::size_t payload_bytes = bytes - kCrcBytes;
-    const std::uint16_t received_crc =
-        (static_cast<std::uint16_t>(packet[bytes - 2]) << 8) |
-        packet[bytes - 1];
-    const std::uint32_t crc_started =
-        static_cast<std::uint32_t>(esp_timer_get_time());
-    const std::uint16_t computed_crc = crc16_ccitt(packet, payload_bytes);
-    last_crc_us = duration_u16(
-        static_cast<std::uint32_t>(esp_timer_get_time()) - crc_started);
-    if (received_crc != computed_crc) {
-      ++crc_errors;
-    } else {
-      ++crc_ok_packets;
-      process_command(packet, payload_bytes);
-    }
-  }
-
-  queue_spi_transaction(index);
+  // SPI is serviced by the pinned receive task.
+  vTaskDelete(nullptr);
 }
@@ -13,6 +13,18 @@ namespace {
 
 constexpr std::size_t kDmaAlignment = 64;
 constexpr int kGhostClockPin = 0;
+// The refill task must preempt the display task it feeds.
+constexpr UBaseType_t kStreamTaskPriority = 4;
+constexpr BaseType_t kStreamTaskCore = 0;
+// The encode helper shares core 1 with the SPI receive task and stays below
+// it, so the bus is always fed first; the caller takes any slices it leaves.
+constexpr UBaseType_t kEncodeTaskPriority = 4;
+constexpr BaseType_t kEncodeTaskCore = 1;
+
+std::uint8_t* allocate_dma(std::size_t bytes) {
+  return static_cast<std::uint8_t*>(heap_caps_aligned_alloc(
+      kDmaAlignment, bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA | MALLOC_CAP_8BIT));
+}
 
 std::uint16_t duration_u16(std::uint32_t value) {
   return value > UINT16_MAX ? UINT16_MAX : static_cast<std::uint16_t>(value);
@@ -21,41 +33,96 @@ std::uint16_t duration_u16(std::uint32_t value) {
 }  // namespace
 
 ParallelLedDriver::~ParallelLedDriver() {
+  if (stream_task_ != nullptr) vTaskDelete(stream_task_);
+  if (encode_helper_ != nullptr) vTaskDelete(encode_helper_);
   if (io_ != nullptr) esp_lcd_panel_io_del(io_);
   if (bus_ != nullptr) esp_lcd_del_i80_bus(bus_);
   for (auto*& buffer : buffers_) {
     if (buffer != nullptr) heap_caps_free(buffer);
     buffer = nullptr;
   }
+  for (auto*& chunk : chunks_) {
+    if (chunk != nullptr) heap_caps_free(chunk);
+    chunk = nullptr;
+  }
+  if (reset_chunk_ != nullptr) heap_caps_free(reset_chunk_);
+  if (uniform_tables_ != nullptr) heap_caps_free(uniform_tables_);
+  if (lane_tables_ != nullptr) heap_caps_free(lane_tables_);
+  if (palette_rows_ != nullptr) heap_caps_free(palette_rows_);
+  if (palette_ != nullptr) heap_caps_free(palette_);
+  if (layout_ != nullptr) heap_caps_free(layout_);
+  if (curves_ != nullptr) heap_caps_free(curves_);
   if (done_ != nullptr) vSemaphoreDelete(done_);
+  if (job_done_ != nullptr) vSemaphoreDelete(job_done_);
 }
 
 bool ParallelLedDriver::begin(
     const int* pins,
     std::uint8_t strip_count,
-    std::uint16_t max_leds_per_strip) {
+    std::uint16_t max_leds_per_strip,
+    EncoderKernel encoder,
+    DmaBuffering buffering,
+    EncodeCores cores) {
   if (pins == nullptr || strip_count == 0 || strip_count > kMaxParallelStrips ||
       max_leds_per_strip == 0 || io_ != nullptr) {
     return false;
   }
 
-  buffer_capacity_ = ws2812_encoded_size(max_leds_per_strip);
-  for (auto*& buffer : buffers_) {
-    buffer = static_cast<std::uint8_t*>(heap_caps_aligned_alloc(
-        kDmaAlignment,
-        buffer_capacity_,
-        MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA | MALLOC_CAP_8BIT));
-    if (buffer == nullptr) return false;
-    if (!initialize_parallel_grb_waveform(
-            strip_count,
-            max_leds_per_strip,
-            buffer,
-            buffer_capacity_)) {
-      return false;
+  buffering_ = buffering;
+  std::size_t max_transfer_bytes = 0;
+  if (buffering_ == DmaBuffering::Streaming) {
+    // Chunks carry only symbol columns; the latch low time is a separate
+    // all-zero transfer queued after the last chunk of each frame.
+    chunk_capacity_ = parallel_encoded_size(strip_count, kStreamChunkColumns, 0);
+    for (auto*& chunk : chunks_) {
+      chunk = allocate_dma(chunk_capacity_);
+      if (chunk == nullptr) return false;
+      if (!initialize_parallel_grb_waveform(
+              strip_count,
+              kStreamChunkColumns,
+              chunk,
+              chunk_capacity_,
+              0)) {
+        return false;
+      }
     }
+    reset_bytes_ = ws2812_sample_bytes(strip_count) *
+                   ws2812_reset_samples(kWs2812ResetUs, kWs2812SampleRateHz);
+    reset_chunk_ = allocate_dma(reset_bytes_);
+    if (reset_chunk_ == nullptr) return false;
+    std::memset(reset_chunk_, 0, reset_bytes_);
+    max_transfer_bytes = std::max(chunk_capacity_, reset_bytes_);
+  } else {
+    buffer_capacity_ = parallel_encoded_size(strip_count, max_leds_per_strip);
+    for (auto*& buffer : buffers_) {
+      buffer = allocate_dma(buffer_capacity_);
+      if (buffer == nullptr) return false;
+      if (!initialize_parallel_grb_waveform(
+              strip_count,
+              max_leds_per_strip,
+              buffer,
+              buffer_capacity_)) {
+        return false;
+      }
+    }
+    max_transfer_bytes = buffer_capacity_;
+  }
+
+  uniform_tables_ = static_cast<UniformExpandTableStorage*>(heap_caps_malloc(
+      sizeof(UniformExpandTableStorage), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+  curves_ = static_cast<ChannelCurves*>(heap_caps_malloc(
+      sizeof(ChannelCurves), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+  palette_ = static_cast<std::uint8_t*>(heap_caps_malloc(
+      kPaletteBytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+  if (uniform_tables_ == nullptr || curves_ == nullptr || palette_ == nullptr) {
+    return false;
   }
+  set_identity_curves(curves_);
+  uniform_curves_ = true;
+  encoder_ = encoder;
+  kernels_ = select_parallel_encode_kernels(strip_count, uniform_curves_, encoder_);
 
-  done_ = xSemaphoreCreateBinary();
+  done_ = xSemaphoreCreateCounting(kBufferCount, 0);
   if (done_ == nullptr) return false;
 
   esp_lcd_i80_bus_config_t bus_config = {};
@@ -66,8 +133,9 @@ bool ParallelLedDriver::begin(
   for (std::uint8_t i = 0; i < strip_count; ++i) {
     bus_config.data_gpio_nums[i] = pins[i];
   }
-  bus_config.bus_width = 8;
-  bus_config.max_transfer_bytes = buffer_capacity_;
+  // More than eight strips need two-byte samples on a 16-bit bus.
+  bus_config.bus_width = ws2812_sample_bytes(strip_count) * kLanesPerSampleByte;
+  bus_config.max_transfer_bytes = max_transfer_bytes;
   bus_config.dma_burst_size = kDmaAlignment;
   if (esp_lcd_new_i80_bus(&bus_config, &bus_) != ESP_OK) return false;
 
@@ -84,7 +152,10 @@ bool ParallelLedDriver::begin(
   esp_lcd_panel_io_i80_config_t io_config = {};
   io_config.cs_gpio_num = -1;
   io_config.pclk_hz = kWs2812SampleRateHz;
-  io_config.trans_queue_depth = 2;
+  // A streamed frame keeps every chunk plus its reset tail queued at once.
+  io_config.trans_queue_depth = buffering_ == DmaBuffering::Streaming
+                                    ? kStreamChunkCount + 1U
+                                    : kBufferCount;
   io_config.dc_levels.dc_idle_level = 0;
   io_config.dc_levels.dc_cmd_level = 0;
   io_config.dc_levels.dc_dummy_level = 0;
@@ -93,64 +164,721 @@ bool ParallelLedDriver::begin(
   io_config.user_ctx = this;
   io_config.lcd_cmd_bits = 0;
   io_config.lcd_param_bits = 0;
-  return esp_lcd_new_panel_io_i80(bus_, &io_config, &io_) == ESP_OK;
+  if (esp_lcd_new_panel_io_i80(bus_, &io_config, &io_) != ESP_OK) return false;
+
+  if (buffering_ == DmaBuffering::Streaming &&
+      xTaskCreatePinnedToCore(
+          stream_task,
+          "led-stream",
+          4096,
+          this,
+          kStreamTaskPriority,
+          &stream_task_,
+          kStreamTaskCore) != pdPASS) {
+    return false;
+  }
+  if (cores == EncodeCores::Two) {
+    job_done_ = xSemaphoreCreateBinary();
+    if (job_done_ == nullptr ||
+        xTaskCreatePinnedToCore(
+            encode_task,
+            "led-encode",
+            4096,
+            this,
+            kEncodeTaskPriority,
+            &encode_helper_,
+            kEncodeTaskCore) != pdPASS) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ParallelLedDriver::set_color_correction(const ChannelCurves& curves) {
+  if (curves_ == nullptr) return;
+  *curves_ = curves;
+  uniform_curves_ = curves_are_uniform(curves);
+  lane_tables_failed_ = false;
+  tables_valid_ = false;
+  palette_rows_valid_ = false;
+  power_totals_valid_ = false;
+  ++correction_generation_;
+}
+
+void ParallelLedDriver::set_palette(const std::uint8_t* palette) {
+  if (palette == nullptr || palette_ == nullptr) return;
+  std::memcpy(palette_, palette, kPaletteBytes);
+  palette_loaded_ = true;
+  palette_rows_valid_ = false;
+  if (power_totals_format_ == PixelFormat::Indexed) power_totals_valid_ = false;
+  ++palette_generation_;
+}
+
+bool ParallelLedDriver::set_layout(
+    const LayoutMapInfo& info, const std::uint8_t* entries) {
+  // Either way the buffers hold the old order.
+  ++correction_generation_;
+  power_totals_valid_ = false;
+  layout_info_ = {};
+  layout_version_ = 0;
+  if (entries == nullptr || info.version == 0) return true;
+  const std::size_t pixels = info.pixels();
+  if (pixels > layout_capacity_) {
+    if (layout_ != nullptr) heap_caps_free(layout_);
+    layout_ = static_cast<std::uint16_t*>(heap_caps_malloc(
+        pixels * sizeof(std::uint16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    layout_capacity_ = layout_ != nullptr ? pixels : 0;
+    if (layout_ == nullptr) return false;
+  }
+  if (!decode_layout_map(entries, pixels, layout_)) return false;
+  layout_info_ = info;
+  layout_version_ = info.version;
+  return true;
+}
+
+void ParallelLedDriver::set_power_limit(
+    const PowerModel& model, const PowerBudget& budget) {
+  power_model_ = model;
+  power_budget_ = budget;
+}
+
+PowerEstimate ParallelLedDriver::power_estimate() const {
+  portENTER_CRITICAL(&power_mux_);
+  const PowerEstimate estimate = power_estimate_;
+  portEXIT_CRITICAL(&power_mux_);
+  return estimate;
+}
+
+std::uint8_t ParallelLedDriver::limit_brightness(
+    const std::uint8_t* rgb,
+    std::size_t rgb_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint8_t brightness,
+    PixelSpan dirty_columns,
+    const FrameBlend* blend,
+    PixelFormat format) {
+  const bool blended = blend != nullptr;
+  if (!power_totals_valid_ || !dirty_columns.empty() || blended ||
+      power_totals_blended_ || power_totals_format_ != format ||
+      power_totals_.strip_count != strip_count ||
+      power_totals_.leds_per_strip != leds_per_strip) {
+    const std::uint16_t* layout = frame_layout(strip_count, leds_per_strip);
+    power_totals_valid_ =
+        format == PixelFormat::Indexed
+            ? total_indexed_channels(
+                  curves_, rgb, rgb_bytes, palette_loaded_ ? palette_ : nullptr,
+                  strip_count, leds_per_strip, &power_totals_, layout)
+            : total_rgb_channels(
+                  curves_, rgb, rgb_bytes, strip_count, leds_per_strip,
+                  &power_totals_, layout);
+    if (power_totals_valid_ && blended) {
+      ChannelTotals from{};
+      if (total_rgb_channels(
+              curves_, blend->from, rgb_bytes, strip_count, leds_per_strip, &from,
+              layout)) {
+        include_channel_totals(from, &power_totals_);
+      }
+    }
+    power_totals_blended_ = blended;
+    power_totals_format_ = format;
+  }
+  // A frame the encoder will reject anyway keeps the last estimate.
+  if (!power_totals_valid_) return brightness;
+  const PowerEstimate estimate =
+      limit_power(power_model_, power_budget_, power_totals_, brightness);
+  portENTER_CRITICAL(&power_mux_);
+  power_estimate_ = estimate;
+  portEXIT_CRITICAL(&power_mux_);
+  if (estimate.limited()) {
+    power_limited_frames_.fetch_add(1, std::memory_order_relaxed);
+  }
+  return estimate.brightness;
+}
+
+// Allocated outside set_color_correction(), which runs under a spinlock.
+bool ParallelLedDriver::reserve_lane_tables() {
+  if (lane_tables_ != nullptr) return true;
+  if (lane_tables_failed_) return false;
+  lane_tables_ = static_cast<LaneExpandTableStorage*>(heap_caps_malloc(
+      sizeof(LaneExpandTableStorage), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+  lane_tables_failed_ = lane_tables_ == nullptr;
+  return lane_tables_ != nullptr;
+}
+
+bool ParallelLedDriver::prepare_encoder(
+    std::uint8_t strip_count,
+    std::uint8_t brightness,
+    PixelFormat format) {
+  // Palette rows have their own storage; only RGB frames need the lane tables.
+  const bool uniform =
+      uniform_curves_ || (format == PixelFormat::Rgb && !reserve_lane_tables());
+  if (kernels_.strip_count != strip_count || kernels_.uniform_tables != uniform) {
+    kernels_ = select_parallel_encode_kernels(strip_count, uniform, encoder_);
+  }
+  if (format == PixelFormat::Indexed) {
+    if (!palette_loaded_) return false;
+    const std::uint8_t rows = palette_expand_rows(strip_count, uniform_curves_);
+    if (rows > palette_row_capacity_) {
+      if (palette_rows_ != nullptr) heap_caps_free(palette_rows_);
+      palette_rows_ = static_cast<PaletteExpandRow*>(heap_caps_malloc(
+          rows * sizeof(PaletteExpandRow), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+      palette_row_capacity_ = palette_rows_ != nullptr ? rows : 0;
+      palette_rows_valid_ = false;
+      if (palette_rows_ == nullptr) return false;
+    }
+    if (!palette_rows_valid_ || palette_rows_brightness_ != brightness ||
+        palette_rows_uniform_ != uniform_curves_ ||
+        palette_rows_strips_ != strip_count) {
+      build_palette_expand_rows(
+          curves_, uniform_curves_, palette_, brightness, strip_count, palette_rows_);
+      palette_rows_brightness_ = brightness;
+      palette_rows_uniform_ = uniform_curves_;
+      palette_rows_strips_ = strip_count;
+      palette_rows_valid_ = true;
+    }
+    return true;
+  }
+  if (tables_valid_ && tables_brightness_ == brightness && tables_uniform_ == uniform) {
+    return true;
+  }
+  if (uniform) {
+    tables_ = uniform_tables_->tables();
+    build_uniform_expand_table(&curves_->curve[0][0], brightness, &tables_);
+  } else {
+    tables_ = lane_tables_->tables();
+    build_parallel_expand_tables(curves_, brightness, &tables_);
+  }
+  tables_brightness_ = brightness;
+  tables_uniform_ = uniform;
+  tables_valid_ = true;
+  return true;
 }
 
-bool ParallelLedDriver::submit(
+SubmitResult ParallelLedDriver::submit(
     const std::uint8_t* rgb,
     std::size_t rgb_bytes,
     std::uint8_t strip_count,
     std::uint16_t leds_per_strip,
     std::uint8_t brightness,
-    std::uint32_t sequence) {
-  if (io_ == nullptr || in_flight_) return false;
+    std::uint32_t sequence,
+    PixelSpan dirty_columns,
+    const FrameBlend* blend,
+    PixelFormat format) {
+  const SubmitResult result = stage(
+      rgb, rgb_bytes, strip_count, leds_per_strip, brightness, sequence,
+      dirty_columns, blend, format);
+  if (result != SubmitResult::Queued) return result;
+  return latch() ? SubmitResult::Queued : SubmitResult::Failed;
+}
+
+SubmitResult ParallelLedDriver::stage(
+    const std::uint8_t* rgb,
+    std::size_t rgb_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint8_t brightness,
+    std::uint32_t sequence,
+    PixelSpan dirty_columns,
+    const FrameBlend* blend,
+    PixelFormat format) {
+  if (io_ == nullptr || (format == PixelFormat::Indexed && blend != nullptr)) {
+    return SubmitResult::Failed;
+  }
+  const std::uint16_t* layout = frame_layout(strip_count, leds_per_strip);
+  if (layout != nullptr && !dirty_columns.empty()) dirty_columns = PixelSpan::all();
+  brightness = limit_brightness(
+      rgb, rgb_bytes, strip_count, leds_per_strip, brightness, dirty_columns,
+      blend, format);
+  if (buffering_ == DmaBuffering::Streaming) {
+    return stage_stream(
+        rgb, rgb_bytes, strip_count, leds_per_strip, brightness, sequence,
+        dirty_columns, blend, format);
+  }
+  const std::uint32_t palette = palette_tag(format);
+  for (auto& stale : stale_columns_) stale.include(dirty_columns);
+
+  // A staged frame occupies the idle buffer; staging again re-encodes it.
+  const std::uint8_t index = next_buffer_;
+  const std::uint8_t newest = index ^ 1U;
+  if (stale_columns_[newest].empty() &&
+      contents_[newest].matches(
+          strip_count, leds_per_strip, brightness, correction_generation_,
+          palette)) {
+    // The wall already shows this frame, so an older staged one is stale.
+    staged_.pending = false;
+    last_encode_us_ = 0;
+    return SubmitResult::Unchanged;
+  }
+  if (!can_submit()) return SubmitResult::Failed;
+
+  PixelSpan encode_span = stale_columns_[index];
+  if (!contents_[index].matches(
+          strip_count, leds_per_strip, brightness, correction_generation_,
+          palette)) {
+    encode_span = PixelSpan::all();
+  }
+  encode_span = encode_span.clamped(leds_per_strip);
 
-  std::uint8_t* output = buffers_[next_buffer_];
   const std::uint32_t encode_started =
       static_cast<std::uint32_t>(esp_timer_get_time());
-  const EncodeResult encoded = encode_parallel_grb_pixels(
-      rgb,
-      rgb_bytes,
-      strip_count,
-      leds_per_strip,
-      brightness,
-      output,
-      buffer_capacity_);
+  const bool prepared = prepare_encoder(strip_count, brightness, format);
+  EncodeResult encoded{};
+  if (prepared) {
+    job_.frame = StreamFrame{};
+    job_.frame.rgb = rgb;
+    job_.frame.rgb_bytes = rgb_bytes;
+    job_.frame.from = blend != nullptr ? blend->from : nullptr;
+    job_.frame.weight = blend != nullptr ? blend->weight : kBlendWeightMax;
+    job_.frame.format = format;
+    job_.frame.strip_count = strip_count;
+    job_.frame.leds_per_strip = leds_per_strip;
+    job_.frame.layout = layout;
+    job_.output = buffers_[index];
+    job_.output_capacity = buffer_capacity_;
+    PixelSpan slices[kMaxEncodeSlices];
+    const std::uint8_t count = split_columns(
+        encode_span, kEncodeSliceColumns,
+        encode_helper_ != nullptr ? kMaxEncodeSlices : 1U, slices);
+    for (std::uint8_t i = 0; i < count; ++i) {
+      job_.slices[i] = {slices[i].begin, slices[i].end, nullptr, false, {}};
+    }
+    if (run_encode_job(count)) encoded = job_.slices[0].result;
+    std::uint16_t helper_columns = 0;
+    for (std::uint8_t i = 0; i < count; ++i) {
+      if (job_.slices[i].by_helper) {
+        helper_columns += job_.slices[i].end - job_.slices[i].first;
+      }
+    }
+    const std::uint16_t columns = encode_span.end - encode_span.begin;
+    last_helper_share_ =
+        columns != 0 ? static_cast<std::uint8_t>(helper_columns * 100U / columns) : 0U;
+  }
   last_encode_us_ = duration_u16(
       static_cast<std::uint32_t>(esp_timer_get_time()) - encode_started);
-  if (!encoded.ok) return false;
-
-  xSemaphoreTake(done_, 0);
-  last_submitted_sequence_ = sequence;
-  show_started_us_ = static_cast<std::uint32_t>(esp_timer_get_time());
-  in_flight_ = true;
-  const esp_err_t result =
-      esp_lcd_panel_io_tx_color(io_, 0, output, encoded.bytes_written);
-  if (result != ESP_OK) {
-    in_flight_ = false;
+  if (!encoded.ok) {
+    contents_[index].valid = false;
+    staged_.pending = false;
+    return SubmitResult::Failed;
+  }
+  contents_[index] = {
+      true, strip_count, leds_per_strip, brightness, correction_generation_,
+      palette};
+  stale_columns_[index].clear();
+  staged_ = {true, index, encoded.bytes_written, sequence};
+  return SubmitResult::Queued;
+}
+
+bool ParallelLedDriver::latch() {
+  if (!staged_.pending) return false;
+  staged_.pending = false;
+  const std::uint8_t index =
+      buffering_ == DmaBuffering::Streaming
+          ? static_cast<std::uint8_t>(
+                submitted_.load(std::memory_order_relaxed) % kBufferCount)
+          : staged_.index;
+  last_submitted_sequence_ = staged_.sequence;
+  buffer_sequence_[index] = staged_.sequence;
+  // A queued transfer starts when its predecessor finishes; the done ISR
+  // moves this timestamp forward in that case.
+  show_started_us_[index] = static_cast<std::uint32_t>(esp_timer_get_time());
+  submitted_.fetch_add(1, std::memory_order_acq_rel);
+
+  if (buffering_ == DmaBuffering::Streaming) {
+    ++stream_queued_;
+    if (esp_lcd_panel_io_tx_color(io_, 0, chunks_[0], staged_.bytes) != ESP_OK) {
+      --stream_queued_;
+      submitted_.fetch_sub(1, std::memory_order_acq_rel);
+      contents_[0].valid = false;
+      return false;
+    }
+    stream_active_.store(true, std::memory_order_release);
+    xTaskNotifyGive(stream_task_);
+    return true;
+  }
+
+  if (esp_lcd_panel_io_tx_color(io_, 0, buffers_[index], staged_.bytes) !=
+      ESP_OK) {
+    submitted_.fetch_sub(1, std::memory_order_acq_rel);
     return false;
   }
   next_buffer_ ^= 1U;
   return true;
 }
 
+SubmitResult ParallelLedDriver::stage_stream(
+    const std::uint8_t* rgb,
+    std::size_t rgb_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint8_t brightness,
+    std::uint32_t sequence,
+    PixelSpan dirty_columns,
+    const FrameBlend* blend,
+    PixelFormat format) {
+  // Every streamed frame is encoded in full, so only the last one sent can
+  // make a frame redundant. While a frame is staged, contents_ describes it
+  // rather than the wall, so it is always replaced.
+  const std::uint32_t palette = palette_tag(format);
+  stale_columns_[0].include(dirty_columns);
+  if (!staged_.pending && stale_columns_[0].empty() &&
+      contents_[0].matches(
+          strip_count, leds_per_strip, brightness, correction_generation_,
+          palette)) {
+    last_encode_us_ = 0;
+    return SubmitResult::Unchanged;
+  }
+  if (!can_submit()) return SubmitResult::Failed;
+
+  // The first chunk is encoded here so bad arguments fail the submit rather
+  // than a frame that is already on the wire.
+  const std::uint32_t encode_started =
+      static_cast<std::uint32_t>(esp_timer_get_time());
+  const bool prepared = prepare_encoder(strip_count, brightness, format);
+  StreamFrame frame;
+  frame.rgb = rgb;
+  frame.rgb_bytes = rgb_bytes;
+  frame.from = blend != nullptr ? blend->from : nullptr;
+  frame.weight = blend != nullptr ? blend->weight : kBlendWeightMax;
+  frame.format = format;
+  frame.strip_count = strip_count;
+  frame.leds_per_strip = leds_per_strip;
+  frame.layout = frame_layout(strip_count, leds_per_strip);
+  frame.next_column = std::min(leds_per_strip, kStreamChunkColumns);
+  frame.next_chunk = 1;
+  const EncodeResult encoded =
+      prepared ? encode_stream_chunk(frame, 0, frame.next_column, chunks_[0])
+               : EncodeResult{};
+  const std::uint32_t now = static_cast<std::uint32_t>(esp_timer_get_time());
+  frame.encode_us = now - encode_started;
+  if (!encoded.ok) {
+    contents_[0].valid = false;
+    staged_.pending = false;
+    return SubmitResult::Failed;
+  }
+  contents_[0] = {
+      true, strip_count, leds_per_strip, brightness, correction_generation_,
+      palette};
+  stale_columns_[0].clear();
+  stream_ = frame;
+  staged_ = {true, 0, encoded.bytes_written, sequence};
+  return SubmitResult::Queued;
+}
+
+EncodeResult ParallelLedDriver::encode_stream_chunk(
+    const StreamFrame& frame,
+    std::uint16_t first,
+    std::uint16_t end,
+    std::uint8_t* chunk) {
+  if (frame.layout != nullptr && frame.format == PixelFormat::Indexed) {
+    return encode_parallel_grb_mapped_indexed_chunk(
+        kernels_,
+        palette_rows_,
+        frame.layout,
+        frame.rgb,
+        frame.rgb_bytes,
+        frame.strip_count,
+        frame.leds_per_strip,
+        first,
+        end,
+        chunk,
+        chunk_capacity_);
+  }
+  if (frame.layout != nullptr) {
+    return encode_parallel_grb_mapped_chunk(
+        kernels_,
+        tables_,
+        frame.layout,
+        frame.from,
+        frame.rgb,
+        frame.rgb_bytes,
+        frame.strip_count,
+        frame.leds_per_strip,
+        frame.weight,
+        first,
+        end,
+        chunk,
+        chunk_capacity_);
+  }
+  if (frame.format == PixelFormat::Indexed) {
+    return encode_parallel_grb_indexed_chunk(
+        kernels_,
+        palette_rows_,
+        frame.rgb,
+        frame.rgb_bytes,
+        frame.strip_count,
+        frame.leds_per_strip,
+        first,
+        end,
+        chunk,
+        chunk_capacity_);
+  }
+  return encode_parallel_grb_kernel_chunk(
+      kernels_,
+      tables_,
+      frame.from,
+      frame.rgb,
+      frame.rgb_bytes,
+      frame.strip_count,
+      frame.leds_per_strip,
+      frame.weight,
+      first,
+      end,
+      chunk,
+      chunk_capacity_);
+}
+
+void ParallelLedDriver::refill_stream() {
+  while (stream_active_.load(std::memory_order_acquire)) {
+    StreamFrame& frame = stream_;
+    const std::uint32_t pending =
+        stream_queued_ - stream_done_.load(std::memory_order_acquire);
+    if (frame.next_column == frame.leds_per_strip) {
+      // Mark the end before queueing so the reset's done ISR cannot miss it;
+      // after this the frame belongs to the ISR and the next submit.
+      last_encode_us_ = duration_u16(frame.encode_us);
+      last_helper_share_ = static_cast<std::uint8_t>(
+          frame.helper_columns * 100U / frame.leds_per_strip);
+      stream_active_.store(false, std::memory_order_release);
+      const std::uint32_t previous_end = stream_frame_end_;
+      stream_frame_end_ = ++stream_queued_;
+      if (esp_lcd_panel_io_tx_color(io_, 0, reset_chunk_, reset_bytes_) !=
+          ESP_OK) {
+        // Nothing else is queued behind the tail, so finish the frame here
+        // rather than leave the display task waiting on a done that never
+        // comes.
+        --stream_queued_;
+        stream_frame_end_ = previous_end;
+        stream_underruns_.fetch_add(1, std::memory_order_relaxed);
+        while (stream_queued_ != stream_done_.load(std::memory_order_acquire)) {
+          vTaskDelay(1);
+        }
+        finish_transfer(static_cast<std::uint32_t>(esp_timer_get_time()));
+        xSemaphoreGive(done_);
+        if (completion_task_ != nullptr) xTaskNotifyGive(completion_task_);
+      }
+      return;
+    }
+    // Chunk k reuses the slot of chunk k - kStreamChunkCount, which is free
+    // once fewer than a full ring of transactions is outstanding.
+    if (pending >= kStreamChunkCount) return;
+    if (pending == 0) stream_underruns_.fetch_add(1, std::memory_order_relaxed);
+
+    // With a helper, two free slots are filled at once, one chunk per core.
+    const std::uint32_t slots = std::min<std::uint32_t>(
+        kStreamChunkCount - pending, encode_helper_ != nullptr ? 2U : 1U);
+    std::uint8_t count = 0;
+    for (std::uint16_t first = frame.next_column;
+         count < slots && first < frame.leds_per_strip; ++count) {
+      const std::uint16_t end = static_cast<std::uint16_t>(std::min<std::uint32_t>(
+          first + kStreamChunkColumns, frame.leds_per_strip));
+      job_.slices[count] = {
+          first, end, chunks_[(frame.next_chunk + count) % kStreamChunkCount], false, {}};
+      first = end;
+    }
+    job_.frame = frame;
+    const std::uint32_t encode_started =
+        static_cast<std::uint32_t>(esp_timer_get_time());
+    run_encode_job(count);
+    frame.encode_us +=
+        static_cast<std::uint32_t>(esp_timer_get_time()) - encode_started;
+    for (std::uint8_t i = 0; i < count; ++i) {
+      const EncodeSlice& slice = job_.slices[i];
+      if (slice.by_helper) frame.helper_columns += slice.end - slice.first;
+      frame.next_column = slice.end;
+      ++frame.next_chunk;
+      ++stream_queued_;
+      if (!slice.result.ok ||
+          esp_lcd_panel_io_tx_color(io_, 0, slice.chunk, slice.result.bytes_written) !=
+              ESP_OK) {
+        // Cut the frame short; the reset tail still latches what was sent.
+        --stream_queued_;
+        frame.next_column = frame.leds_per_strip;
+        stream_underruns_.fetch_add(1, std::memory_order_relaxed);
+        break;
+      }
+    }
+  }
+}
+
+bool ParallelLedDriver::run_encode_job(std::uint8_t count) {
+  job_count_.store(count, std::memory_order_relaxed);
+  job_finished_.store(0, std::memory_order_relaxed);
+  job_next_.store(0, std::memory_order_release);
+  if (encode_helper_ != nullptr && count > 1) xTaskNotifyGive(encode_helper_);
+  encode_slices(false);
+  // Every slice is claimed by now; wait out the one the helper may hold. A
+  // give left over from a job the spin already saw finish only costs one more
+  // pass round the loop.
+  for (std::uint32_t spins = 0;
+       spins < kEncodeJoinSpins &&
+       job_finished_.load(std::memory_order_acquire) != count;
+       ++spins) {
+  }
+  while (job_finished_.load(std::memory_order_acquire) != count) {
+    xSemaphoreTake(job_done_, portMAX_DELAY);
+  }
+  job_next_.store(kNoEncodeJob, std::memory_order_relaxed);
+  for (std::uint8_t i = 0; i < count; ++i) {
+    if (!job_.slices[i].result.ok) return false;
+  }
+  return true;
+}
+
+bool ParallelLedDriver::encode_slices(bool helper) {
+  bool encoded = false;
+  while (true) {
+    const std::uint32_t claim = job_next_.fetch_add(1, std::memory_order_acq_rel);
+    if (claim >= job_count_.load(std::memory_order_relaxed)) return encoded;
+    EncodeSlice& slice = job_.slices[claim];
+    slice.result = encode_slice(slice);
+    slice.by_helper = helper;
+    job_finished_.fetch_add(1, std::memory_order_release);
+    encoded = true;
+  }
+}
+
+EncodeResult ParallelLedDriver::encode_slice(const EncodeSlice& slice) {
+  const StreamFrame& frame = job_.frame;
+  if (slice.chunk != nullptr) {
+    return encode_stream_chunk(frame, slice.first, slice.end, slice.chunk);
+  }
+  if (frame.layout != nullptr && frame.format == PixelFormat::Indexed) {
+    return encode_parallel_grb_mapped_indexed_span(
+        kernels_,
+        palette_rows_,
+        frame.layout,
+        frame.rgb,
+        frame.rgb_bytes,
+        frame.strip_count,
+        frame.leds_per_strip,
+        slice.first,
+        slice.end,
+        job_.output,
+        job_.output_capacity);
+  }
+  if (frame.layout != nullptr) {
+    return encode_parallel_grb_mapped_span(
+        kernels_,
+        tables_,
+        frame.layout,
+        frame.from,
+        frame.rgb,
+        frame.rgb_bytes,
+        frame.strip_count,
+        frame.leds_per_strip,
+        frame.weight,
+        slice.first,
+        slice.end,
+        job_.output,
+        job_.output_capacity);
+  }
+  if (frame.format == PixelFormat::Indexed) {
+    return encode_parallel_grb_indexed_span(
+        kernels_,
+        palette_rows_,
+        frame.rgb,
+        frame.rgb_bytes,
+        frame.strip_count,
+        frame.leds_per_strip,
+        slice.first,
+        slice.end,
+        job_.output,
+        job_.output_capacity);
+  }
+  return encode_parallel_grb_kernel_span(
+      kernels_,
+      tables_,
+      frame.from,
+      frame.rgb,
+      frame.rgb_bytes,
+      frame.strip_count,
+      frame.leds_per_strip,
+      frame.weight,
+      slice.first,
+      slice.end,
+      job_.output,
+      job_.output_capacity);
+}
+
+void ParallelLedDriver::encode_task(void* context) {
+  auto* driver = static_cast<ParallelLedDriver*>(context);
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (driver->encode_slices(true)) xSemaphoreGive(driver->job_done_);
+  }
+}
+
+void ParallelLedDriver::stream_task(void* context) {
+  auto* driver = static_cast<ParallelLedDriver*>(context);
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    driver->refill_stream();
+  }
+}
+
+bool ParallelLedDriver::take_completion(TransferCompletion* completion) {
+  if (collected_ == completed_.load(std::memory_order_acquire)) return false;
+  const std::uint8_t index = collected_ % kBufferCount;
+  if (completion != nullptr) {
+    completion->sequence = buffer_sequence_[index];
+    completion->started_us = show_started_us_[index];
+    completion->completed_us = completed_us_[index];
+  }
+  ++collected_;
+  return true;
+}
+
 bool ParallelLedDriver::wait_for_done(TickType_t timeout_ticks) {
-  if (!in_flight_) return true;
-  if (xSemaphoreTake(done_, timeout_ticks) != pdTRUE) return false;
-  in_flight_ = false;
+  while (in_flight()) {
+    if (xSemaphoreTake(done_, timeout_ticks) != pdTRUE) return false;
+  }
   return true;
 }
 
+std::uint32_t ParallelLedDriver::transfer_done_us(std::uint32_t now) const {
+  const std::uint32_t completed = completed_.load(std::memory_order_acquire);
+  if (submitted_.load(std::memory_order_acquire) == completed) return now;
+  // The done ISR moves a chained transfer's start to its predecessor's end.
+  const std::uint32_t done =
+      show_started_us_[completed % kBufferCount] + last_show_us_;
+  return static_cast<std::int32_t>(done - now) > 0 ? done : now;
+}
+
+void IRAM_ATTR ParallelLedDriver::finish_transfer(std::uint32_t now) {
+  const std::uint32_t completed = completed_.load(std::memory_order_relaxed);
+  const std::uint8_t index = completed % kBufferCount;
+  last_show_us_ = duration_u16(now - show_started_us_[index]);
+  completed_us_[index] = now;
+  last_completed_sequence_ = buffer_sequence_[index];
+  if (submitted_.load(std::memory_order_acquire) - completed > 1U) {
+    show_started_us_[index ^ 1U] = now;
+  }
+  completed_.store(completed + 1U, std::memory_order_release);
+}
+
 bool IRAM_ATTR ParallelLedDriver::on_transfer_done(
     esp_lcd_panel_io_handle_t,
     esp_lcd_panel_io_event_data_t*,
     void* user_context) {
   auto* driver = static_cast<ParallelLedDriver*>(user_context);
-  const std::uint32_t now = static_cast<std::uint32_t>(esp_timer_get_time());
-  driver->last_show_us_ = duration_u16(now - driver->show_started_us_);
-  driver->last_completed_sequence_ = driver->last_submitted_sequence_;
   BaseType_t task_woken = pdFALSE;
+  if (driver->buffering_ == DmaBuffering::Streaming) {
+    const std::uint32_t done =
+        driver->stream_done_.load(std::memory_order_relaxed) + 1U;
+    driver->stream_done_.store(done, std::memory_order_release);
+    if (done != driver->stream_frame_end_) {
+      // A chunk finished and its slot is free for the refill task.
+      vTaskNotifyGiveFromISR(driver->stream_task_, &task_woken);
+      return task_woken == pdTRUE;
+    }
+  }
+  driver->finish_transfer(static_cast<std::uint32_t>(esp_timer_get_time()));
+
   xSemaphoreGiveFromISR(driver->done_, &task_woken);
+  if (driver->completion_task_ != nullptr) {
+    vTaskNotifyGiveFromISR(driver->completion_task_, &task_woken);
+  }
   return task_woken == pdTRUE;
 }
 
@@ -0,0 +1,186 @@
+#include "ledgrid/power_budget.hpp"
+
+#include <algorithm>
+#include <array>
+
+#include "ledgrid/layout_map.hpp"
+
+namespace ledgrid {
+
+namespace {
+
+// Corrected channel values are scaled by curve (to 255) and brightness (to
+// 255), so draw is sum * channel_ua * brightness / kFullScale.
+constexpr std::uint64_t kFullScale = 255U * 255U;
+
+const std::uint8_t* identity_curve() {
+  static const auto curve = [] {
+    std::array<std::uint8_t, 256> values{};
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      values[i] = static_cast<std::uint8_t>(i);
+    }
+    return values;
+  }();
+  return curve.data();
+}
+
+const std::uint8_t* channel_curve(
+    const ChannelCurves* curves, std::uint8_t lane, std::uint8_t channel) {
+  return curves != nullptr ? curves->curve[lane][channel].data() : identity_curve();
+}
+
+bool valid_geometry(std::uint8_t strip_count, std::uint16_t leds_per_strip) {
+  return strip_count > 0 && strip_count <= kMaxParallelStrips && leds_per_strip > 0;
+}
+
+std::uint32_t to_ma(std::uint64_t ua) {
+  const std::uint64_t ma = (ua + 999U) / 1000U;
+  return ma > UINT32_MAX ? UINT32_MAX : static_cast<std::uint32_t>(ma);
+}
+
+// Largest brightness up to `brightness` keeping idle + dynamic draw within
+// `limit_ma`, where `dynamic` is the draw at full scale times kFullScale.
+std::uint8_t brightness_within(
+    std::uint16_t limit_ma,
+    std::uint64_t idle_ua,
+    std::uint64_t dynamic,
+    std::uint8_t brightness) {
+  if (limit_ma == 0) return brightness;
+  const std::uint64_t limit_ua = static_cast<std::uint64_t>(limit_ma) * 1000U;
+  if (limit_ua <= idle_ua) return 0;
+  if (dynamic == 0) return brightness;
+  const std::uint64_t allowed = (limit_ua - idle_ua) * kFullScale / dynamic;
+  return static_cast<std::uint8_t>(std::min<std::uint64_t>(allowed, brightness));
+}
+
+}  // namespace
+
+bool total_rgb_channels(
+    const ChannelCurves* curves,
+    const std::uint8_t* rgb,
+    std::size_t rgb_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    ChannelTotals* totals,
+    const std::uint16_t* layout) {
+  if (rgb == nullptr || totals == nullptr || !valid_geometry(strip_count, leds_per_strip) ||
+      rgb_bytes < static_cast<std::size_t>(strip_count) * leds_per_strip * 3U) {
+    return false;
+  }
+  *totals = ChannelTotals{};
+  totals->strip_count = strip_count;
+  totals->leds_per_strip = leds_per_strip;
+  for (std::uint8_t lane = 0; lane < strip_count; ++lane) {
+    const std::uint8_t* red = channel_curve(curves, lane, 0);
+    const std::uint8_t* green = channel_curve(curves, lane, 1);
+    const std::uint8_t* blue = channel_curve(curves, lane, 2);
+    const std::size_t lane_start = static_cast<std::size_t>(lane) * leds_per_strip;
+    std::uint32_t r = 0;
+    std::uint32_t g = 0;
+    std::uint32_t b = 0;
+    for (std::uint16_t i = 0; i < leds_per_strip; ++i) {
+      const std::size_t source = layout != nullptr ? layout[lane_start + i] : lane_start + i;
+      if (source == kUnmappedPixel) continue;
+      const std::uint8_t* pixel = rgb + source * 3U;
+      r += red[pixel[0]];
+      g += green[pixel[1]];
+      b += blue[pixel[2]];
+    }
+    totals->sum[lane][0] = r;
+    totals->sum[lane][1] = g;
+    totals->sum[lane][2] = b;
+  }
+  return true;
+}
+
+bool total_indexed_channels(
+    const ChannelCurves* curves,
+    const std::uint8_t* indices,
+    std::size_t index_bytes,
+    const std::uint8_t* palette,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    ChannelTotals* totals,
+    const std::uint16_t* layout) {
+  if (indices == nullptr || palette == nullptr || totals == nullptr ||
+      !valid_geometry(strip_count, leds_per_strip) ||
+      index_bytes < static_cast<std::size_t>(strip_count) * leds_per_strip) {
+    return false;
+  }
+  *totals = ChannelTotals{};
+  totals->strip_count = strip_count;
+  totals->leds_per_strip = leds_per_strip;
+  for (std::uint8_t lane = 0; lane < strip_count; ++lane) {
+    const std::uint8_t* red = channel_curve(curves, lane, 0);
+    const std::uint8_t* green = channel_curve(curves, lane, 1);
+    const std::uint8_t* blue = channel_curve(curves, lane, 2);
+    const std::size_t lane_start = static_cast<std::size_t>(lane) * leds_per_strip;
+    std::uint32_t r = 0;
+    std::uint32_t g = 0;
+    std::uint32_t b = 0;
+    for (std::uint16_t i = 0; i < leds_per_strip; ++i) {
+      const std::size_t source = layout != nullptr ? layout[lane_start + i] : lane_start + i;
+      if (source == kUnmappedPixel) continue;
+      const std::uint8_t* entry = palette + static_cast<std::size_t>(indices[source]) * 3U;
+      r += red[entry[0]];
+      g += green[entry[1]];
+      b += blue[entry[2]];
+    }
+    totals->sum[lane][0] = r;
+    totals->sum[lane][1] = g;
+    totals->sum[lane][2] = b;
+  }
+  return true;
+}
+
+void include_channel_totals(const ChannelTotals& other, ChannelTotals* totals) {
+  if (totals == nullptr) return;
+  for (std::uint8_t lane = 0; lane < kMaxParallelStrips; ++lane) {
+    for (std::uint8_t channel = 0; channel < 3; ++channel) {
+      totals->sum[lane][channel] =
+          std::max(totals->sum[lane][channel], other.sum[lane][channel]);
+    }
+  }
+}
+
+PowerEstimate limit_power(
+    const PowerModel& model,
+    const PowerBudget& budget,
+    const ChannelTotals& totals,
+    std::uint8_t brightness) {
+  PowerEstimate estimate{};
+  estimate.requested_brightness = brightness;
+  estimate.strip_count = std::min<std::uint8_t>(totals.strip_count, kMaxParallelStrips);
+  const std::uint64_t strip_idle_ua =
+      static_cast<std::uint64_t>(totals.leds_per_strip) * model.idle_ua;
+
+  std::uint64_t dynamic[kMaxParallelStrips] = {};
+  std::uint64_t total_dynamic = 0;
+  std::uint64_t busiest_dynamic = 0;
+  for (std::uint8_t lane = 0; lane < estimate.strip_count; ++lane) {
+    for (std::uint8_t channel = 0; channel < 3; ++channel) {
+      dynamic[lane] +=
+          static_cast<std::uint64_t>(totals.sum[lane][channel]) * model.channel_ua[channel];
+    }
+    total_dynamic += dynamic[lane];
+    if (dynamic[lane] > busiest_dynamic) {
+      busiest_dynamic = dynamic[lane];
+      estimate.busiest_strip = lane;
+    }
+  }
+  const std::uint64_t total_idle_ua = strip_idle_ua * estimate.strip_count;
+
+  std::uint8_t applied =
+      brightness_within(budget.total_ma, total_idle_ua, total_dynamic, brightness);
+  applied = brightness_within(budget.strip_ma, strip_idle_ua, busiest_dynamic, applied);
+  estimate.brightness = applied;
+
+  estimate.demand_ma = to_ma(total_idle_ua + total_dynamic * brightness / kFullScale);
+  estimate.total_ma = to_ma(total_idle_ua + total_dynamic * applied / kFullScale);
+  for (std::uint8_t lane = 0; lane < estimate.strip_count; ++lane) {
+    estimate.strip_ma[lane] = to_ma(strip_idle_ua + dynamic[lane] * applied / kFullScale);
+  }
+  return estimate;
+}
+
+}  // namespace ledgrid
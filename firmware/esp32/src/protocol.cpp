@@ -17,6 +17,37 @@ void write_u32(std::uint8_t* output, std::uint32_t value) {
   output[3] = static_cast<std::uint8_t>(value);
 }
 
+std::uint16_t read_u16(const std::uint8_t* input) {
+  return static_cast<std::uint16_t>(
+      (static_cast<std::uint16_t>(input[0]) << 8) | input[1]);
+}
+
+// Writes the v3 header and reports whether `page_bytes` fit; a page that does
+// not fit is reduced to its header.
+bool write_page_header(
+    StatusPage page,
+    const StatusPageHeader& header,
+    std::size_t page_bytes,
+    std::uint8_t* output,
+    std::size_t output_size) {
+  const bool fits = output_size >= page_bytes;
+  std::memset(output, 0, fits ? page_bytes : kStatusV3HeaderBytes);
+  output[0] = 'L';
+  output[1] = 'G';
+  output[2] = 'S';
+  output[3] = '3';
+  output[4] = kStatusProtocolVersion3;
+  output[5] = static_cast<std::uint8_t>(page);
+  output[6] = kStatusPageCount;
+  output[7] = fits ? 0 : kStatusPageTruncated;
+  write_u32(output + 8, header.generation);
+  write_u16(output + 12, static_cast<std::uint16_t>(
+                             fits ? page_bytes - kStatusV3HeaderBytes : 0));
+  output[14] = header.capabilities;
+  output[15] = header.flags;
+  return fits;
+}
+
 }  // namespace
 
 bool encode_receiver_status_v2(
@@ -32,6 +63,7 @@ bool encode_receiver_status_v2(
   output[4] = kStatusProtocolVersion;
   output[5] = status.flags;
   output[6] = status.active_strips;
+  output[7] = status.capabilities;
   write_u16(output + 8, status.leds_per_strip);
   write_u16(output + 10, status.queued_transactions);
   write_u32(output + 12, status.packets);
@@ -49,7 +81,362 @@ bool encode_receiver_status_v2(
   write_u32(output + 52, status.last_accepted_sequence);
   write_u32(output + 56, status.last_displayed_sequence);
   write_u32(output + 60, status.display_errors);
+  if (output_size < kStatusBytesV2Latch) return true;
+
+  std::memset(output + kStatusBytesV2, 0, kStatusBytesV2Latch - kStatusBytesV2);
+  output[64] = status.latch_mode;
+  write_u16(output + 66, status.last_latch_us);
+  write_u32(output + 68, status.latches);
+  write_u32(output + 72, status.latch_misses);
+  write_u32(output + 76, status.last_latch_sequence);
+  if (output_size < kStatusBytesV2Pacing) return true;
+
+  std::memset(output + kStatusBytesV2Latch, 0,
+              kStatusBytesV2Pacing - kStatusBytesV2Latch);
+  write_u16(output + 80, status.paced_fps);
+  output[82] = status.pacing_depth;
+  write_u32(output + 84, status.frames_late);
+  write_u32(output + 88, status.queue_drops);
+  if (output_size < kStatusBytesV2Histogram) return true;
+
+  output[92] = status.histogram_stage;
+  output[93] = static_cast<std::uint8_t>(kLatencyBuckets);
+  write_u16(output + 94, 0);
+  write_u32(output + 96, status.histogram.max_us);
+  for (std::size_t i = 0; i < kLatencyBuckets; ++i) {
+    write_u32(output + 100 + i * 4U, status.histogram.buckets[i]);
+  }
+  if (output_size < kStatusBytesV2Chunks) return true;
+
+  write_u16(output + 180, status.chunk_sequence);
+  write_u16(output + 182, status.missing_strips);
+  write_u32(output + 184, status.chunk_crc_errors);
+  write_u32(output + 188, status.frames_recovered);
+  if (output_size < kStatusBytesV2Credits) return true;
+
+  output[192] = status.display_credits;
+  output[193] = status.display_room;
+  write_u16(output + 194, 0);
+  write_u32(output + 196, status.snapshot_us);
+  write_u32(output + 200, status.next_slot_us);
+  write_u32(output + 204, status.slot_interval_us);
   return true;
 }
 
+BatchReader::BatchReader(
+    const std::uint8_t* payload, std::size_t length, std::size_t total_leds)
+    : payload_(payload), length_(payload == nullptr ? 0 : length), total_leds_(total_leds) {}
+
+bool BatchReader::fail() {
+  failed_ = true;
+  return false;
+}
+
+bool BatchReader::next(BatchOp* op) {
+  if (failed_ || op == nullptr || offset_ >= length_) return false;
+  const std::uint8_t* input = payload_ + offset_;
+  const std::size_t remaining = length_ - offset_;
+  *op = BatchOp{};
+  op->opcode = input[0];
+
+  switch (op->opcode) {
+    case kBatchSetPixel:
+      if (remaining < 6) return fail();
+      op->start = read_u16(input + 1);
+      op->count = 1;
+      op->rgb = input + 3;
+      if (op->start >= total_leds_) return fail();
+      offset_ += 6;
+      return true;
+
+    case kBatchSetBrightness:
+      if (remaining < 2) return fail();
+      op->brightness = input[1];
+      offset_ += 2;
+      return true;
+
+    case kBatchShow:
+      if (remaining != 1) return fail();
+      offset_ += 1;
+      return true;
+
+    case kBatchSetRange: {
+      if (remaining < 5) return fail();
+      op->start = read_u16(input + 1);
+      op->count = read_u16(input + 3);
+      const std::size_t rgb_bytes = static_cast<std::size_t>(op->count) * 3U;
+      if (op->count == 0 ||
+          static_cast<std::size_t>(op->start) + op->count > total_leds_ ||
+          remaining - 5U < rgb_bytes) {
+        return fail();
+      }
+      op->rgb = input + 5;
+      offset_ += 5U + rgb_bytes;
+      return true;
+    }
+
+    default:
+      return fail();
+  }
+}
+
+std::size_t encode_status_core_page(
+    const StatusPageHeader& header,
+    const ReceiverStatusV2& status,
+    std::uint8_t* output,
+    std::size_t output_size) {
+  if (output == nullptr || output_size < kStatusV3HeaderBytes) return 0;
+  if (!write_page_header(StatusPage::Core, header, kStatusCorePageBytes,
+                         output, output_size)) {
+    return kStatusV3HeaderBytes;
+  }
+  write_u16(output + 16, status.leds_per_strip);
+  write_u16(output + 18, status.queued_transactions);
+  write_u32(output + 20, status.packets);
+  write_u32(output + 24, status.crc_errors);
+  write_u32(output + 28, status.crc_ok_packets);
+  write_u32(output + 32, status.frames_accepted);
+  write_u32(output + 36, status.frames_displayed);
+  write_u32(output + 40, status.frames_superseded);
+  write_u32(output + 44, status.publish_drops);
+  write_u32(output + 48, status.spi_queue_errors);
+  write_u32(output + 52, status.display_errors);
+  write_u32(output + 56, status.last_accepted_sequence);
+  write_u32(output + 60, status.last_displayed_sequence);
+  write_u16(output + 64, status.last_crc_us);
+  write_u16(output + 66, status.last_copy_us);
+  write_u16(output + 68, status.last_encode_us);
+  write_u16(output + 70, status.last_show_us);
+  output[72] = status.active_strips;
+  output[73] = status.latch_mode;
+  write_u16(output + 74, status.last_latch_us);
+  write_u32(output + 76, status.latches);
+  write_u32(output + 80, status.latch_misses);
+  write_u32(output + 84, status.last_latch_sequence);
+  write_u16(output + 88, status.paced_fps);
+  output[90] = status.pacing_depth;
+  write_u32(output + 92, status.frames_late);
+  write_u32(output + 96, status.queue_drops);
+  return kStatusCorePageBytes;
+}
+
+std::size_t encode_status_histogram_page(
+    const StatusPageHeader& header,
+    const LatencySnapshot (&snapshots)[kLatencyStageCount],
+    std::uint8_t* output,
+    std::size_t output_size) {
+  if (output == nullptr || output_size < kStatusV3HeaderBytes) return 0;
+  if (!write_page_header(StatusPage::Histograms, header,
+                         kStatusHistogramPageBytes, output, output_size)) {
+    return kStatusV3HeaderBytes;
+  }
+  output[16] = static_cast<std::uint8_t>(kLatencyStageCount);
+  output[17] = static_cast<std::uint8_t>(kLatencyBuckets);
+  std::uint8_t* stage = output + 20;
+  for (const LatencySnapshot& snapshot : snapshots) {
+    write_u32(stage, snapshot.max_us);
+    for (std::size_t i = 0; i < kLatencyBuckets; ++i) {
+      write_u32(stage + 4 + i * 4U, snapshot.buckets[i]);
+    }
+    stage += 4 + kLatencyBuckets * 4U;
+  }
+  return kStatusHistogramPageBytes;
+}
+
+std::size_t encode_status_memory_page(
+    const StatusPageHeader& header,
+    const ReceiverMemoryStatus& memory,
+    std::uint8_t* output,
+    std::size_t output_size) {
+  if (output == nullptr || output_size < kStatusV3HeaderBytes) return 0;
+  if (!write_page_header(StatusPage::Memory, header, kStatusMemoryPageBytes,
+                         output, output_size)) {
+    return kStatusV3HeaderBytes;
+  }
+  write_u16(output + 16, memory.led_capacity);
+  output[18] = memory.mailbox_tier;
+  output[19] = memory.history_tier;
+  output[20] = memory.zero_copy_mailbox ? 1 : 0;
+  write_u32(output + 24, memory.rgb_bytes);
+  write_u32(output + 28, memory.spi_buffer_bytes);
+  write_u32(output + 32, memory.led_dma_bytes);
+  write_u32(output + 36, memory.free_internal);
+  write_u32(output + 40, memory.min_free_internal);
+  write_u32(output + 44, memory.largest_internal_block);
+  write_u32(output + 48, memory.free_psram);
+  write_u32(output + 52, memory.largest_psram_block);
+  return kStatusMemoryPageBytes;
+}
+
+std::size_t encode_status_config_page(
+    const StatusPageHeader& header,
+    const ReceiverConfigStatus& config,
+    std::uint8_t* output,
+    std::size_t output_size) {
+  if (output == nullptr || output_size < kStatusV3HeaderBytes) return 0;
+  if (!write_page_header(StatusPage::Config, header, kStatusConfigPageBytes,
+                         output, output_size)) {
+    return kStatusV3HeaderBytes;
+  }
+  output[16] = config.active_strips;
+  output[17] = config.max_lanes;
+  write_u16(output + 18, config.leds_per_strip);
+  write_u16(output + 20, config.led_capacity);
+  output[22] = config.brightness;
+  output[23] = config.transition_easing;
+  write_u16(output + 24, config.transition_ms);
+  output[26] = config.latch_mode;
+  output[27] = config.pacing_depth;
+  write_u16(output + 28, config.paced_fps);
+  output[30] = config.crc_engine;
+  output[31] = config.encoder_kernel;
+  output[32] = config.display_mode;
+  output[33] = config.histogram_stage;
+  write_u16(output + 34, config.status_refresh_us);
+  output[36] = config.effect_kind;
+  output[37] = config.frame_formats;
+  write_u16(output + 38, config.effect_ticks_per_second);
+  write_u32(output + 40, config.effect_frames);
+  output[44] = config.encode_cores;
+  output[45] = config.encode_helper_share;
+  output[46] = config.layout_state;
+  output[47] = 0;
+  write_u32(output + 48, config.layout_version);
+  write_u16(output + 52, config.layout_crc);
+  write_u16(output + 54, config.layout_rejected);
+  return kStatusConfigPageBytes;
+}
+
+std::size_t encode_status_transport_page(
+    const StatusPageHeader& header,
+    const ReceiverTransportStatus& transport,
+    std::uint8_t* output,
+    std::size_t output_size) {
+  if (output == nullptr || output_size < kStatusV3HeaderBytes) return 0;
+  if (!write_page_header(StatusPage::Transport, header, kStatusTransportPageBytes,
+                         output, output_size)) {
+    return kStatusV3HeaderBytes;
+  }
+  output[16] = transport.ring_depth;
+  output[17] = transport.max_backlog;
+  output[18] = transport.task_core;
+  output[19] = transport.task_priority;
+  write_u32(output + 20, transport.ring_drained);
+  write_u32(output + 24, transport.spi_queue_errors);
+  write_u32(output + 28, transport.packets);
+  for (std::size_t i = 0; i < kMaxSpiRingSlots; ++i) {
+    std::uint8_t* slot = output + 32 + i * 8U;
+    write_u32(slot, transport.slots[i].completions);
+    write_u16(slot + 4, transport.slots[i].max_service_us);
+    write_u16(slot + 6, transport.slots[i].requeue_failures);
+  }
+  return kStatusTransportPageBytes;
+}
+
+std::size_t encode_status_links_page(
+    const StatusPageHeader& header,
+    const ReceiverLinksStatus& links,
+    std::uint8_t* output,
+    std::size_t output_size) {
+  if (output == nullptr || output_size < kStatusV3HeaderBytes) return 0;
+  if (!write_page_header(StatusPage::Links, header, kStatusLinksPageBytes,
+                         output, output_size)) {
+    return kStatusV3HeaderBytes;
+  }
+  output[16] = links.link_count;
+  write_u32(output + 20, links.parts);
+  write_u32(output + 24, links.frames_assembled);
+  write_u32(output + 28, links.frames_abandoned);
+  write_u32(output + 32, links.stale_parts);
+  write_u32(output + 36, links.rejected_parts);
+  write_u16(output + 40, links.last_assembled_sequence);
+  for (std::size_t i = 0; i < kMaxSpiLinks; ++i) {
+    const SpiLinkStatus& link = links.links[i];
+    std::uint8_t* entry = output + 44 + i * 24U;
+    write_u32(entry, link.packets);
+    write_u32(entry + 4, link.crc_ok_packets);
+    write_u32(entry + 8, link.crc_errors);
+    write_u32(entry + 12, link.spi_queue_errors);
+    write_u32(entry + 16, link.ring_drained);
+    entry[20] = link.host;
+    entry[21] = link.max_backlog;
+    entry[22] = link.queued_transactions;
+    entry[23] = link.has_miso ? 1 : 0;
+  }
+  return kStatusLinksPageBytes;
+}
+
+std::size_t encode_status_clips_page(
+    const StatusPageHeader& header,
+    const ReceiverClipStatus& clips,
+    std::uint8_t* output,
+    std::size_t output_size) {
+  if (output == nullptr || output_size < kStatusV3HeaderBytes) return 0;
+  if (!write_page_header(StatusPage::Clips, header, kStatusClipsPageBytes,
+                         output, output_size)) {
+    return kStatusV3HeaderBytes;
+  }
+  write_u16(output + 16, clips.capacity);
+  output[18] = clips.state;
+  output[19] = clips.readback_flags;
+  write_u32(output + 20, clips.frame_bytes);
+  write_u16(output + 24, clips.first);
+  write_u16(output + 26, clips.count);
+  write_u16(output + 28, clips.current);
+  write_u16(output + 30, clips.loops);
+  write_u32(output + 32, clips.frames_played);
+  write_u16(output + 36, clips.loops_done);
+  write_u16(output + 38, clips.recorded);
+  write_u32(output + 40, clips.frames_recorded);
+  write_u16(output + 44, clips.rejected);
+  write_u16(output + 46, clips.readback_back);
+  write_u32(output + 48, clips.readback_sequence);
+  write_u32(output + 52, clips.readback_shown_us);
+  write_u32(output + 56, clips.readback_offset);
+  std::size_t bytes = clips.readback == nullptr ? 0 : clips.readback_bytes;
+  if (bytes > kClipReadbackBytes) bytes = kClipReadbackBytes;
+  write_u16(output + 60, static_cast<std::uint16_t>(bytes));
+  if (bytes != 0) std::memcpy(output + 64, clips.readback, bytes);
+  return kStatusClipsPageBytes;
+}
+
+std::size_t encode_status_power_page(
+    const StatusPageHeader& header,
+    const ReceiverPowerStatus& power,
+    std::uint8_t* output,
+    std::size_t output_size) {
+  if (output == nullptr || output_size < kStatusV3HeaderBytes) return 0;
+  if (!write_page_header(StatusPage::Power, header, kStatusPowerPageBytes,
+                         output, output_size)) {
+    return kStatusV3HeaderBytes;
+  }
+  write_u16(output + 16, power.budget_total_ma);
+  write_u16(output + 18, power.budget_strip_ma);
+  for (std::size_t channel = 0; channel < 3; ++channel) {
+    write_u16(output + 20 + channel * 2U, power.channel_ua[channel]);
+  }
+  write_u16(output + 26, power.idle_ua);
+  output[28] = power.requested_brightness;
+  output[29] = power.applied_brightness;
+  output[30] = power.strip_count;
+  output[31] = power.busiest_strip;
+  write_u32(output + 32, power.demand_ma);
+  write_u32(output + 36, power.total_ma);
+  write_u32(output + 40, power.limited_frames);
+  for (std::size_t strip = 0; strip < kMaxPowerStrips; ++strip) {
+    write_u32(output + 48 + strip * 4U, power.strip_ma[strip]);
+  }
+  return kStatusPowerPageBytes;
+}
+
+bool validate_command_batch(
+    const std::uint8_t* payload, std::size_t length, std::size_t total_leds) {
+  if (payload == nullptr || length == 0) return false;
+  BatchReader reader(payload, length, total_leds);
+  BatchOp op{};
+  while (reader.next(&op)) {
+  }
+  return !reader.failed();
+}
+
 }  // namespace ledgrid
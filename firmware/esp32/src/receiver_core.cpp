@@ -0,0 +1,591 @@
+#include "ledgrid/receiver_core.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "ledgrid/frame_blend.hpp"
+#include "ledgrid/frame_compression.hpp"
+#include "ledgrid/protocol.hpp"
+
+namespace ledgrid {
+
+namespace {
+
+std::uint16_t duration_u16(std::uint32_t value) {
+  return value > UINT16_MAX ? UINT16_MAX : static_cast<std::uint16_t>(value);
+}
+
+PixelFormat pixel_format(const FrameMetadata& metadata) {
+  return metadata.indexed ? PixelFormat::Indexed : PixelFormat::Rgb;
+}
+
+}  // namespace
+
+bool command_writes_pixels(std::uint8_t command) {
+  switch (command) {
+    case kCmdSetPixel:
+    case kCmdClear:
+    case kCmdSetRange:
+    case kCmdSetAll:
+    case kCmdBatch:
+    case kCmdSetAllRle:
+    case kCmdSetAllDelta:
+    case kCmdSetAllIndexed:
+    case kCmdSetAllPart:
+    case kCmdSetAllChunked:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void ReceiverCore::begin(const ReceiverBuffers& buffers,
+                         std::uint8_t strip_count,
+                         std::uint16_t leds_per_strip,
+                         Crc16Engine crc_engine) {
+  std::copy(std::begin(buffers.mailbox), std::end(buffers.mailbox), mailbox_);
+  zero_copy_mailbox_ = buffers.zero_copy_mailbox;
+  working_frame_ = buffers.working_frame;
+  frame_bytes_ = buffers.frame_bytes;
+  strip_count_ = strip_count;
+  leds_per_strip_ = leds_per_strip;
+  crc_engine_ = crc_engine;
+}
+
+std::size_t ReceiverCore::service_transport(PacketTransport& transport) {
+  std::size_t handled = 0;
+  ReceivedPacket packet;
+  while (transport.receive(&packet)) {
+    bool valid = false;
+    std::uint8_t* buffer = handle_packet(packet, &valid);
+    transport.finish(buffer, valid);
+    ++handled;
+  }
+  return handled;
+}
+
+std::uint8_t* ReceiverCore::handle_packet(const ReceivedPacket& packet, bool* valid) {
+  packets_.fetch_add(1, std::memory_order_relaxed);
+  packet_received_us_ = packet.received_us;
+  record_latency(LatencyStage::SpiReceive, now() - packet.received_us);
+  std::uint8_t* data = packet.data;
+  const std::size_t bytes = packet.bytes;
+  *valid = false;
+
+  std::size_t payload_bytes = 0;
+  if (bytes > 0 && data[0] == kCmdSetAllChunked) {
+    // Each strip carries its own CRC, checked as the frame is assembled, so a
+    // packet with an intact header counts as good even when strips fail.
+    *valid = frame_chunk_header_intact(crc_engine_, data + 1, bytes - 1U);
+    payload_bytes = bytes;
+  } else if (bytes >= 1U + kPacketCrcBytes) {
+    payload_bytes = bytes - kPacketCrcBytes;
+    const std::uint16_t received_crc =
+        (static_cast<std::uint16_t>(data[bytes - 2]) << 8) | data[bytes - 1];
+    const std::uint32_t crc_started = now();
+    const std::uint16_t computed_crc = crc16_ccitt(crc_engine_, data, payload_bytes);
+    const std::uint32_t crc_elapsed = now() - crc_started;
+    last_crc_us_ = duration_u16(crc_elapsed);
+    record_latency(LatencyStage::Crc, crc_elapsed);
+    *valid = received_crc == computed_crc;
+  }
+  if (!*valid) {
+    crc_errors_.fetch_add(1, std::memory_order_relaxed);
+    return data;
+  }
+  crc_ok_packets_.fetch_add(1, std::memory_order_relaxed);
+  std::uint8_t* buffer = run_command(data, payload_bytes);
+  hooks_.state_changed();
+  return buffer;
+}
+
+std::uint8_t* ReceiverCore::run_command(std::uint8_t* data, std::size_t length) {
+  if (data == nullptr || length == 0) return data;
+  if (command_writes_pixels(data[0])) hooks_.before_pixel_write();
+
+  switch (data[0]) {
+    case kCmdSetPixel: {
+      if (length != 6) break;
+      const std::uint16_t pixel =
+          (static_cast<std::uint16_t>(data[1]) << 8) | data[2];
+      if (pixel >= total_leds()) break;
+      sync_working_frame();
+      working_frame_tag_ = kUntaggedFrame;
+      const std::size_t offset = static_cast<std::size_t>(pixel) * 3U;
+      std::memcpy(working_frame_ + offset, data + 3, 3);
+      mark_pixels_dirty(pixel, 1);
+      break;
+    }
+
+    case kCmdSetBrightness:
+      if (length == 2) {
+        brightness_ = data[1];
+        publish_working_frame();
+      }
+      break;
+
+    case kCmdShow:
+      if (length == 1) publish_working_frame();
+      break;
+
+    // duration ms (u16), optional easing; zero duration cuts to each frame
+    case kCmdSetTransition:
+      if (length < 3 || length > 4) break;
+      if (length == 4 &&
+          data[3] > static_cast<std::uint8_t>(TransitionEasing::EaseInOut)) {
+        break;
+      }
+      transition_ms_ = (static_cast<std::uint16_t>(data[1]) << 8) | data[2];
+      transition_easing_ = length == 4 ? data[3] : 0;
+      break;
+
+    case kCmdClear:
+      if (length == 1) {
+        adopted_frame_ = nullptr;
+        working_frame_tag_ = kUntaggedFrame;
+        std::memset(working_frame_, 0, rgb_bytes());
+        working_dirty_ = PixelSpan::all();
+        publish_working_frame();
+      }
+      break;
+
+    case kCmdSetRange: {
+      if (length < 4) break;
+      const std::uint16_t start =
+          (static_cast<std::uint16_t>(data[1]) << 8) | data[2];
+      std::uint16_t count = data[3];
+      if (start >= total_leds()) break;
+      count = std::min<std::uint16_t>(count, total_leds() - start);
+      const std::size_t expected = 4U + static_cast<std::size_t>(count) * 3U;
+      if (length != expected) break;
+      sync_working_frame();
+      working_frame_tag_ = kUntaggedFrame;
+      std::memcpy(
+          working_frame_ + static_cast<std::size_t>(start) * 3U,
+          data + 4,
+          static_cast<std::size_t>(count) * 3U);
+      mark_pixels_dirty(start, count);
+      break;
+    }
+
+    case kCmdSetAll: {
+      if (length != 1U + rgb_bytes()) break;
+      working_frame_tag_ = kUntaggedFrame;
+      return publish_received_frame(data, false);
+    }
+
+    // one palette index per pixel, lane-major like SET_ALL
+    case kCmdSetAllIndexed: {
+      if (length != 1U + total_leds()) break;
+      working_frame_tag_ = kUntaggedFrame;
+      return publish_received_frame(data, true);
+    }
+
+    // u16 frame sequence, first strip, strip count, then those strips' RGB
+    // bytes. Parts may arrive on any link; the frame publishes like a SET_ALL
+    // once every strip of one sequence has arrived. Chunked frames check each
+    // strip's CRC here instead of one over the packet; strips that fail stay
+    // missing, reported in the v2 chunk tail, until the host resends them.
+    case kCmdSetAllPart:
+    case kCmdSetAllChunked: {
+      if (assembly_buffer_ == nullptr) {
+        assembly_buffer_ = hooks_.allocate_packet_buffer();
+        if (assembly_buffer_ == nullptr) break;
+        assembly_buffer_[0] = kCmdSetAll;
+      }
+      std::uint8_t* rgb = assembly_buffer_ + kFramePixelOffset;
+      const auto assembled =
+          data[0] == kCmdSetAllChunked
+              ? assembler_.add_chunked(crc_engine_, data + 1, length - 1U,
+                                       strip_count_, leds_per_strip_, rgb)
+              : assembler_.add(data + 1, length - 1U, strip_count_,
+                               leds_per_strip_, rgb);
+      if (assembled != FrameAssembly::Complete) break;
+      working_frame_tag_ = kUntaggedFrame;
+      assembly_buffer_ = publish_received_frame(assembly_buffer_, false);
+      break;
+    }
+
+    // 256 RGB entries for SET_ALL_INDEXED. Takes effect from the next frame
+    // displayed; an adopted indexed frame is expanded with the old palette
+    // first so later RGB edits keep its colours.
+    case kCmdSetPalette:
+      if (length != 1U + kPaletteBytes) break;
+      set_indexed_palette(data + 1);
+      break;
+
+    case kCmdBatch:
+      apply_command_batch(data + 1, length - 1U);
+      break;
+
+    // tag, token bytes (u16), RLE tokens, optional padding
+    case kCmdSetAllRle: {
+      if (length < 4) break;
+      const std::size_t token_bytes =
+          (static_cast<std::size_t>(data[2]) << 8) | data[3];
+      if (4U + token_bytes > length) break;
+      sync_working_frame();
+      if (!decode_rle_frame(data + 4, token_bytes, working_frame_, total_leds(),
+                            leds_per_strip_, &working_dirty_)) {
+        break;
+      }
+      working_frame_tag_ = data[1];
+      delta_rejected_ = false;
+      publish_working_frame();
+      break;
+    }
+
+    // base tag, new tag, token bytes (u16), XOR tokens, optional padding
+    case kCmdSetAllDelta: {
+      const std::size_t token_bytes =
+          length < 5 ? 0 : (static_cast<std::size_t>(data[3]) << 8) | data[4];
+      if (length < 5 || data[1] == kUntaggedFrame || data[1] != working_frame_tag_ ||
+          5U + token_bytes > length) {
+        delta_rejected_ = true;
+        break;
+      }
+      sync_working_frame();
+      if (!apply_xor_delta_frame(data + 5, token_bytes, working_frame_, total_leds(),
+                                 leds_per_strip_, &working_dirty_)) {
+        delta_rejected_ = true;
+        break;
+      }
+      working_frame_tag_ = data[2];
+      publish_working_frame();
+      break;
+    }
+
+    default:
+      hooks_.run_command(data, length);
+      break;
+  }
+  return data;
+}
+
+void ReceiverCore::mark_pixels_dirty(std::size_t first_pixel, std::size_t count) {
+  if (count == 0) return;
+  const std::size_t column = first_pixel % leds_per_strip_;
+  if (column + count > leds_per_strip_) {
+    working_dirty_.include(0, leds_per_strip_);
+    return;
+  }
+  working_dirty_.include(
+      static_cast<std::uint16_t>(column),
+      static_cast<std::uint16_t>(column + count));
+}
+
+// A mailbox buffer is only rewritten after sync_working_frame(), after it has
+// been swapped out for a newer adopted buffer, or (copied mailbox) by the
+// SET_ALL that replaces it as the adopted frame, so the adopted pixels stay
+// valid for as long as adopted_frame_ points at them.
+void ReceiverCore::sync_working_frame() {
+  if (adopted_frame_ == nullptr) return;
+  if (adopted_indexed_) {
+    expand_indexed_frame(adopted_frame_, total_leds(), indexed_palette_, working_frame_);
+  } else {
+    std::memcpy(working_frame_, adopted_frame_, rgb_bytes());
+  }
+  adopted_frame_ = nullptr;
+}
+
+std::uint8_t* ReceiverCore::begin_full_frame() {
+  adopted_frame_ = nullptr;
+  working_frame_tag_ = kUntaggedFrame;
+  working_dirty_ = PixelSpan::all();
+  return working_frame_;
+}
+
+// Marks only the columns where `next` differs from the current frame, so an
+// unchanged full frame costs no re-encode. A change of format marks every
+// column, since the display re-encodes such a frame in full anyway.
+void ReceiverCore::mark_changed_columns(const std::uint8_t* next, bool indexed) {
+  if (indexed != current_frame_indexed()) {
+    working_dirty_ = PixelSpan::all();
+    return;
+  }
+  working_dirty_.include(changed_columns(
+      current_frame(), next, strip_count_, leds_per_strip_, indexed ? 1U : 3U));
+}
+
+void ReceiverCore::replace_working_frame(const std::uint8_t* pixels, bool indexed) {
+  mark_changed_columns(pixels, indexed);
+  adopted_frame_ = nullptr;
+  if (indexed) {
+    expand_indexed_frame(pixels, total_leds(), indexed_palette_, working_frame_);
+  } else {
+    std::memcpy(working_frame_, pixels, rgb_bytes());
+  }
+}
+
+// A claimed slot no longer holds whatever frame it was published with.
+int ReceiverCore::begin_frame_write() {
+  const int slot = mailbox_state_.begin_write();
+  if (slot >= 0) external_slots_ &= static_cast<std::uint8_t>(~(1U << slot));
+  return slot;
+}
+
+void ReceiverCore::record_copy(std::uint32_t started_us) {
+  const std::uint32_t elapsed = now() - started_us;
+  last_copy_us_ = duration_u16(elapsed);
+  record_latency(LatencyStage::Copy, elapsed);
+}
+
+// `pixels` publishes a frame shown in place from outside the mailbox.
+bool ReceiverCore::commit_frame(int slot, bool indexed, const std::uint8_t* pixels) {
+  FrameMetadata metadata{};
+  metadata.sequence = next_sequence_++;
+  metadata.byte_count = indexed ? total_leds() : rgb_bytes();
+  metadata.indexed = indexed;
+  metadata.strip_count = strip_count_;
+  metadata.leds_per_strip = leds_per_strip_;
+  metadata.brightness = brightness_;
+  metadata.dirty_columns = working_dirty_;
+  metadata.transition_ms = transition_ms_;
+  metadata.easing = transition_easing_;
+  metadata.received_us = packet_received_us_;
+  metadata.published_us = now();
+  metadata.pixels = pixels;
+
+  if (!mailbox_state_.commit_write(slot, metadata)) return false;
+  if (pixels != nullptr) external_slots_ |= static_cast<std::uint8_t>(1U << slot);
+
+  working_dirty_.clear();
+  last_accepted_sequence_ = metadata.sequence;
+  hooks_.frame_published();
+  return true;
+}
+
+bool ReceiverCore::publish_working_frame() {
+  const int slot = begin_frame_write();
+  if (slot < 0) return false;
+
+  sync_working_frame();
+  const std::uint32_t copy_started = now();
+  std::memcpy(mailbox_frame(slot), working_frame_, rgb_bytes());
+  record_copy(copy_started);
+  return commit_frame(slot);
+}
+
+// Publishes a validated SET_ALL or SET_ALL_INDEXED packet, without copying
+// its pixels when the mailbox is zero-copy. Indexed frames stay one byte per
+// pixel all the way to the encoder. Returns the buffer to hand back to the
+// transport: the slot's previous buffer when the packet was adopted, or the
+// packet itself otherwise.
+std::uint8_t* ReceiverCore::publish_received_frame(std::uint8_t* packet, bool indexed) {
+  const std::uint8_t* pixels = packet + kFramePixelOffset;
+  const int slot = begin_frame_write();
+  if (slot < 0) {
+    replace_working_frame(pixels, indexed);
+    return packet;
+  }
+
+  // The column diff replaces the publish copy as this path's frame cost.
+  const std::uint32_t copy_started = now();
+  mark_changed_columns(pixels, indexed);
+  if (!zero_copy_mailbox_) {
+    // One sequential copy into the PSRAM slot; the slot then serves as the
+    // adopted frame exactly like a swapped-in receive buffer.
+    std::memcpy(mailbox_frame(slot), pixels, indexed ? total_leds() : rgb_bytes());
+  }
+  record_copy(copy_started);
+
+  if (!zero_copy_mailbox_) {
+    if (!commit_frame(slot, indexed)) {
+      replace_working_frame(pixels, indexed);
+      return packet;
+    }
+    adopted_frame_ = mailbox_frame(slot);
+    adopted_indexed_ = indexed;
+    return packet;
+  }
+
+  std::uint8_t* previous = mailbox_[slot];
+  mailbox_[slot] = packet;
+  if (!commit_frame(slot, indexed)) {
+    mailbox_[slot] = previous;
+    replace_working_frame(pixels, indexed);
+    return packet;
+  }
+  adopted_frame_ = pixels;
+  adopted_indexed_ = indexed;
+  return previous;
+}
+
+// The pixels become the adopted frame, so the working frame is only filled if
+// a command edits it.
+bool ReceiverCore::publish_external_frame(const std::uint8_t* pixels) {
+  working_frame_tag_ = kUntaggedFrame;
+  const int slot = begin_frame_write();
+  if (slot < 0) return false;
+  const std::uint32_t copy_started = now();
+  mark_changed_columns(pixels, false);
+  record_copy(copy_started);
+  if (!commit_frame(slot, false, pixels)) return false;
+  adopted_frame_ = pixels;
+  adopted_indexed_ = false;
+  return true;
+}
+
+bool ReceiverCore::external_frames_in_use() {
+  for (std::size_t slot = 0; slot < kFrameMailboxSlots; ++slot) {
+    if ((external_slots_ & (1U << slot)) != 0 &&
+        mailbox_state_.state(static_cast<int>(slot)) ==
+            LatestFrameMailbox::SlotState::Free) {
+      external_slots_ &= static_cast<std::uint8_t>(~(1U << slot));
+    }
+  }
+  return external_slots_ != 0;
+}
+
+void ReceiverCore::set_geometry(std::uint8_t strip_count, std::uint16_t leds_per_strip) {
+  strip_count_ = strip_count;
+  leds_per_strip_ = leds_per_strip;
+  assembler_.reset();
+  adopted_frame_ = nullptr;
+  working_frame_tag_ = kUntaggedFrame;
+  std::memset(working_frame_, 0, frame_bytes_);
+  working_dirty_ = PixelSpan::all();
+  publish_working_frame();
+}
+
+void ReceiverCore::set_indexed_palette(const std::uint8_t* palette) {
+  if (current_frame_indexed()) sync_working_frame();
+  std::memcpy(indexed_palette_, palette, kPaletteBytes);
+  hooks_.palette_changed(indexed_palette_);
+}
+
+// Applies a whole batch or none of it: the payload is validated up front so a
+// malformed trailing op cannot leave a half-written working frame. A trailing
+// SHOW publishes everything as one frame.
+void ReceiverCore::apply_command_batch(const std::uint8_t* payload, std::size_t length) {
+  const std::size_t leds = total_leds();
+  if (!validate_command_batch(payload, length, leds)) return;
+
+  sync_working_frame();
+  working_frame_tag_ = kUntaggedFrame;
+  BatchReader reader(payload, length, leds);
+  BatchOp op{};
+  bool show = false;
+  while (reader.next(&op)) {
+    switch (op.opcode) {
+      case kBatchSetPixel:
+      case kBatchSetRange:
+        std::memcpy(
+            working_frame_ + static_cast<std::size_t>(op.start) * 3U,
+            op.rgb,
+            static_cast<std::size_t>(op.count) * 3U);
+        mark_pixels_dirty(op.start, op.count);
+        break;
+      case kBatchSetBrightness:
+        brightness_ = op.brightness;
+        break;
+      case kBatchShow:
+        show = true;
+        break;
+      default:
+        break;
+    }
+  }
+  if (show) publish_working_frame();
+}
+
+int ReceiverCore::take_frame(FrameMetadata* metadata) {
+  const int slot = mailbox_state_.begin_read(metadata);
+  if (slot < 0) return slot;
+  record_latency(LatencyStage::MailboxWait, now() - metadata->published_us);
+  frame_receipts_[next_frame_receipt_] = {metadata->sequence, metadata->received_us};
+  next_frame_receipt_ = (next_frame_receipt_ + 1U) % kFrameReceipts;
+  return slot;
+}
+
+const std::uint8_t* ReceiverCore::frame_pixels(
+    int slot, const FrameMetadata& metadata) const {
+  return metadata.pixels != nullptr ? metadata.pixels : mailbox_frame(slot);
+}
+
+SubmitResult ReceiverCore::submit_frame(int slot, const FrameMetadata& metadata,
+                                        PixelSpan dirty) {
+  const SubmitResult result = display_.submit(
+      frame_pixels(slot, metadata),
+      metadata.byte_count,
+      metadata.strip_count,
+      metadata.leds_per_strip,
+      metadata.brightness,
+      metadata.sequence,
+      dirty,
+      nullptr,
+      pixel_format(metadata));
+  record_encode(result);
+  return result;
+}
+
+void ReceiverCore::finish_frame(int slot, const FrameMetadata& metadata, bool shown) {
+  if (shown) {
+    hooks_.frame_shown(frame_pixels(slot, metadata), metadata);
+    mailbox_state_.release_read(slot);
+    hooks_.frame_released();
+  } else {
+    mailbox_state_.cancel_read(slot);
+  }
+}
+
+SubmitResult ReceiverCore::present_frame(int slot, const FrameMetadata& metadata) {
+  const SubmitResult result = submit_frame(slot, metadata, metadata.dirty_columns);
+  finish_frame(slot, metadata, result != SubmitResult::Failed);
+  if (result == SubmitResult::Unchanged) record_displayed(metadata.sequence);
+  return result;
+}
+
+bool ReceiverCore::service_display() {
+  retire_completed_transfers();
+  while (display_.can_submit()) {
+    FrameMetadata metadata{};
+    const int slot = take_frame(&metadata);
+    if (slot < 0) break;
+    if (present_frame(slot, metadata) == SubmitResult::Failed) {
+      note_display_error();
+      return false;
+    }
+  }
+  return true;
+}
+
+void ReceiverCore::record_encode(SubmitResult result) {
+  if (result == SubmitResult::Queued) {
+    record_latency(LatencyStage::Encode, display_.last_encode_us());
+  }
+}
+
+// Frames identical to the newest queued buffer are displayed without DMA, so
+// completions can arrive for older sequences; never move backwards.
+// Interpolated in-between frames carry sequence 0 and are not counted.
+void ReceiverCore::record_displayed(std::uint32_t sequence) {
+  if (sequence == 0) return;
+  mailbox_state_.mark_displayed();
+  if (sequence > last_displayed_sequence_.load(std::memory_order_relaxed)) {
+    last_displayed_sequence_ = sequence;
+  }
+  hooks_.state_changed();
+}
+
+void ReceiverCore::retire_completed_transfers() {
+  TransferCompletion completion{};
+  while (display_.take_completion(&completion)) {
+    record_displayed(completion.sequence);
+    record_latency(LatencyStage::Dma, completion.completed_us - completion.started_us);
+    if (completion.sequence == 0) continue;
+    for (const FrameReceipt& receipt : frame_receipts_) {
+      if (receipt.sequence == completion.sequence) {
+        record_latency(LatencyStage::EndToEnd,
+                       completion.completed_us - receipt.received_us);
+        break;
+      }
+    }
+  }
+}
+
+void ReceiverCore::reset_histograms() {
+  for (auto& histogram : histograms_) histogram.reset();
+}
+
+}  // namespace ledgrid
@@ -1,7 +1,11 @@
 #include "ledgrid/ws2812_encoder.hpp"
 
+#include <algorithm>
 #include <array>
 #include <cstring>
+#include <utility>
+
+#include "ledgrid/layout_map.hpp"
 
 namespace ledgrid {
 namespace {
@@ -31,6 +35,577 @@ constexpr std::array<std::uint64_t, 256> make_expand_table() {
 
 constexpr auto kExpandTable = make_expand_table();
 
+// Shared span kernel. `byte_at(offset)` yields the RGB byte at `offset` of a
+// lane-major frame, which lets blends run inside the encode pass.
+// `lane_bits(lane, rgb_channel, value)` returns that byte's expanded samples
+// already shifted onto `lane` within its sample byte.
+template <typename ByteSource, typename LaneBits>
+void encode_span(
+    ByteSource byte_at,
+    LaneBits lane_bits,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* output) {
+  constexpr std::uint8_t kGrbOffsets[3] = {1, 0, 2};
+  const std::size_t lane_stride = static_cast<std::size_t>(leds_per_strip) * 3U;
+  const std::uint8_t sample_bytes = ws2812_sample_bytes(strip_count);
+  const std::size_t sample_stride = 3U * sample_bytes;
+  std::uint8_t* dynamic_sample =
+      output + sample_bytes +
+      static_cast<std::size_t>(first_pixel) * 3U * 8U * sample_stride;
+
+  for (std::uint16_t pixel = first_pixel; pixel < end_pixel; ++pixel) {
+    for (std::uint8_t channel = 0; channel < 3; ++channel) {
+      const std::uint8_t c = kGrbOffsets[channel];
+      const std::size_t offset = static_cast<std::size_t>(pixel) * 3U + c;
+      for (std::uint8_t plane = 0; plane < sample_bytes; ++plane) {
+        const std::uint8_t first_lane = plane * kLanesPerSampleByte;
+        const std::uint8_t end_lane = std::min<std::uint8_t>(
+            strip_count, first_lane + kLanesPerSampleByte);
+        std::uint64_t parallel_bits = 0;
+        if (end_lane - first_lane == kLanesPerSampleByte) {
+          const std::size_t base = offset + lane_stride * first_lane;
+          parallel_bits = lane_bits(first_lane, c, byte_at(base));
+          parallel_bits |= lane_bits(first_lane + 1, c, byte_at(base + lane_stride));
+          parallel_bits |= lane_bits(first_lane + 2, c, byte_at(base + lane_stride * 2U));
+          parallel_bits |= lane_bits(first_lane + 3, c, byte_at(base + lane_stride * 3U));
+          parallel_bits |= lane_bits(first_lane + 4, c, byte_at(base + lane_stride * 4U));
+          parallel_bits |= lane_bits(first_lane + 5, c, byte_at(base + lane_stride * 5U));
+          parallel_bits |= lane_bits(first_lane + 6, c, byte_at(base + lane_stride * 6U));
+          parallel_bits |= lane_bits(first_lane + 7, c, byte_at(base + lane_stride * 7U));
+        } else {
+          for (std::uint8_t lane = first_lane; lane < end_lane; ++lane) {
+            parallel_bits |= lane_bits(lane, c, byte_at(offset + lane_stride * lane));
+          }
+        }
+
+        std::uint8_t* sample = dynamic_sample + plane;
+        for (std::uint8_t bit = 0; bit < 8; ++bit) {
+          sample[bit * sample_stride] =
+              static_cast<std::uint8_t>(parallel_bits >> (bit * 8U));
+        }
+      }
+      dynamic_sample += 8U * sample_stride;
+    }
+  }
+}
+
+// Brightness-only callers get a 2 KB table in internal RAM per call. The inner
+// loop then needs one fast lookup per lane rather than a brightness lookup
+// followed by a flash-resident 64-bit lookup.
+struct BrightnessTable {
+  explicit BrightnessTable(std::uint8_t brightness) {
+    for (std::size_t value = 0; value < bits.size(); ++value) {
+      const auto channel = static_cast<std::uint8_t>(value);
+      const auto scaled = brightness == 255
+                              ? channel
+                              : scale_channel(channel, brightness);
+      bits[value] = kExpandTable[scaled];
+    }
+  }
+
+  std::uint64_t operator()(std::uint8_t lane, std::uint8_t, std::uint8_t value) const {
+    return bits[value] << (lane % kLanesPerSampleByte);
+  }
+
+  std::array<std::uint64_t, 256> bits{};
+};
+
+struct PrebuiltTables {
+  std::uint64_t operator()(std::uint8_t lane, std::uint8_t channel, std::uint8_t value) const {
+    return tables->bits[lane][channel][value];
+  }
+
+  const ParallelExpandTables* tables;
+};
+
+struct FrameBytes {
+  std::uint8_t operator()(std::size_t offset) const { return rgb[offset]; }
+  const std::uint8_t* rgb;
+};
+
+struct BlendedBytes {
+  std::uint8_t operator()(std::size_t offset) const {
+    const int start = from[offset];
+    return static_cast<std::uint8_t>(
+        start + (((static_cast<int>(to[offset]) - start) * weight) >> 8));
+  }
+  const std::uint8_t* from;
+  const std::uint8_t* to;
+  int weight;
+};
+
+// Palette colour of the indexed pixel covering RGB offset `offset`.
+struct PaletteBytes {
+  std::uint8_t operator()(std::size_t offset) const {
+    return palette[indices[offset / 3U] * 3U + offset % 3U];
+  }
+  const std::uint8_t* indices;
+  const std::uint8_t* palette;
+};
+
+// Lanes [kLane, kEnd) of one channel byte for one sample byte, with the strip
+// count, table layout and blend known at compile time so the lanes unroll
+// completely.
+template <std::uint8_t kLane, std::uint8_t kEnd, bool kUniform, bool kBlend>
+inline std::uint64_t gather_lanes(
+    const ParallelExpandTables& tables,
+    std::uint8_t channel,
+    const std::uint8_t* const* from_lanes,
+    const std::uint8_t* const* to_lanes,
+    int weight,
+    std::size_t offset) {
+  if constexpr (kLane >= kEnd) {
+    return 0;
+  } else {
+    std::uint8_t value = to_lanes[kLane][offset];
+    if constexpr (kBlend) {
+      const int start = from_lanes[kLane][offset];
+      value = static_cast<std::uint8_t>(
+          start + (((static_cast<int>(value) - start) * weight) >> 8));
+    }
+    std::uint64_t bits;
+    if constexpr (kUniform) {
+      bits = tables.bits[0][0][value] << (kLane % kLanesPerSampleByte);
+    } else {
+      bits = tables.bits[kLane][channel][value];
+    }
+    return bits | gather_lanes<kLane + 1, kEnd, kUniform, kBlend>(
+                      tables, channel, from_lanes, to_lanes, weight, offset);
+  }
+}
+
+constexpr std::uint8_t sample_bytes_for(std::uint8_t strip_count) {
+  return strip_count > kLanesPerSampleByte ? 2 : 1;
+}
+
+constexpr std::uint8_t plane_end(std::uint8_t strip_count, std::uint8_t plane) {
+  return strip_count < (plane + 1) * kLanesPerSampleByte
+             ? strip_count
+             : static_cast<std::uint8_t>((plane + 1) * kLanesPerSampleByte);
+}
+
+template <std::uint8_t kStrips, bool kUniform, bool kBlend>
+void specialized_span(
+    const ParallelExpandTables& tables,
+    const std::uint8_t* from,
+    const std::uint8_t* to,
+    std::uint16_t weight,
+    std::uint16_t leds_per_strip,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* output) {
+  constexpr std::uint8_t kGrbOffsets[3] = {1, 0, 2};
+  constexpr std::uint8_t kSampleBytes = sample_bytes_for(kStrips);
+  constexpr std::size_t kSampleStride = 3U * kSampleBytes;
+  const std::size_t lane_stride = static_cast<std::size_t>(leds_per_strip) * 3U;
+  const std::size_t first_byte = static_cast<std::size_t>(first_pixel) * 3U;
+  const std::uint8_t* to_lanes[kStrips];
+  const std::uint8_t* from_lanes[kStrips] = {};
+  for (std::uint8_t lane = 0; lane < kStrips; ++lane) {
+    to_lanes[lane] = to + first_byte + lane_stride * lane;
+    if constexpr (kBlend) from_lanes[lane] = from + first_byte + lane_stride * lane;
+  }
+  std::uint8_t* dynamic_sample = output + kSampleBytes;
+  const std::size_t pixel_bytes =
+      static_cast<std::size_t>(end_pixel - first_pixel) * 3U;
+
+  for (std::size_t offset = 0; offset < pixel_bytes; offset += 3U) {
+    for (const std::uint8_t c : kGrbOffsets) {
+      const std::uint64_t low_lanes =
+          gather_lanes<0, plane_end(kStrips, 0), kUniform, kBlend>(
+              tables, c, from_lanes, to_lanes, weight, offset + c);
+      for (std::uint8_t bit = 0; bit < 8; ++bit) {
+        dynamic_sample[bit * kSampleStride] =
+            static_cast<std::uint8_t>(low_lanes >> (bit * 8U));
+      }
+      if constexpr (kSampleBytes == 2) {
+        const std::uint64_t high_lanes =
+            gather_lanes<kLanesPerSampleByte, kStrips, kUniform, kBlend>(
+                tables, c, from_lanes, to_lanes, weight, offset + c);
+        for (std::uint8_t bit = 0; bit < 8; ++bit) {
+          dynamic_sample[bit * kSampleStride + 1U] =
+              static_cast<std::uint8_t>(high_lanes >> (bit * 8U));
+        }
+      }
+      dynamic_sample += 8U * kSampleStride;
+    }
+  }
+}
+
+template <bool kUniform, bool kBlend, std::size_t... kIndex>
+constexpr std::array<ParallelSpanKernel, sizeof...(kIndex)> make_specialized_kernels(
+    std::index_sequence<kIndex...>) {
+  return {&specialized_span<kIndex + 1, kUniform, kBlend>...};
+}
+
+template <bool kUniform, bool kBlend>
+constexpr auto kSpecializedKernels = make_specialized_kernels<kUniform, kBlend>(
+    std::make_index_sequence<kMaxParallelStrips>());
+
+// Indexed counterpart of gather_lanes(): `entries` holds each lane's palette
+// index for the current pixel.
+template <std::uint8_t kLane, std::uint8_t kEnd, bool kUniform>
+inline std::uint64_t gather_indexed_lanes(
+    const PaletteExpandRow* rows,
+    std::uint8_t channel,
+    const std::uint8_t* entries) {
+  if constexpr (kLane >= kEnd) {
+    return 0;
+  } else {
+    std::uint64_t bits;
+    if constexpr (kUniform) {
+      bits = rows[0][channel][entries[kLane]] << (kLane % kLanesPerSampleByte);
+    } else {
+      bits = rows[kLane][channel][entries[kLane]];
+    }
+    return bits | gather_indexed_lanes<kLane + 1, kEnd, kUniform>(rows, channel, entries);
+  }
+}
+
+// Reads each lane's index once per pixel, so a pixel costs one load per lane
+// where an RGB frame costs three.
+template <std::uint8_t kStrips, bool kUniform>
+void indexed_span(
+    const PaletteExpandRow* rows,
+    const std::uint8_t* indices,
+    std::uint16_t leds_per_strip,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* output) {
+  constexpr std::uint8_t kGrbOffsets[3] = {1, 0, 2};
+  constexpr std::uint8_t kSampleBytes = sample_bytes_for(kStrips);
+  constexpr std::size_t kSampleStride = 3U * kSampleBytes;
+  const std::uint8_t* lanes[kStrips];
+  for (std::uint8_t lane = 0; lane < kStrips; ++lane) {
+    lanes[lane] = indices + first_pixel + static_cast<std::size_t>(leds_per_strip) * lane;
+  }
+  std::uint8_t* dynamic_sample = output + kSampleBytes;
+  const std::size_t pixels = end_pixel - first_pixel;
+
+  for (std::size_t pixel = 0; pixel < pixels; ++pixel) {
+    std::uint8_t entries[kStrips];
+    for (std::uint8_t lane = 0; lane < kStrips; ++lane) entries[lane] = lanes[lane][pixel];
+    for (const std::uint8_t c : kGrbOffsets) {
+      const std::uint64_t low_lanes =
+          gather_indexed_lanes<0, plane_end(kStrips, 0), kUniform>(rows, c, entries);
+      for (std::uint8_t bit = 0; bit < 8; ++bit) {
+        dynamic_sample[bit * kSampleStride] =
+            static_cast<std::uint8_t>(low_lanes >> (bit * 8U));
+      }
+      if constexpr (kSampleBytes == 2) {
+        const std::uint64_t high_lanes =
+            gather_indexed_lanes<kLanesPerSampleByte, kStrips, kUniform>(
+                rows, c, entries);
+        for (std::uint8_t bit = 0; bit < 8; ++bit) {
+          dynamic_sample[bit * kSampleStride + 1U] =
+              static_cast<std::uint8_t>(high_lanes >> (bit * 8U));
+        }
+      }
+      dynamic_sample += 8U * kSampleStride;
+    }
+  }
+}
+
+template <bool kUniform, std::size_t... kIndex>
+constexpr std::array<IndexedSpanKernel, sizeof...(kIndex)> make_indexed_kernels(
+    std::index_sequence<kIndex...>) {
+  return {&indexed_span<kIndex + 1, kUniform>...};
+}
+
+template <bool kUniform>
+constexpr auto kIndexedKernels =
+    make_indexed_kernels<kUniform>(std::make_index_sequence<kMaxParallelStrips>());
+
+// Lanes [kLane, kEnd) of one channel byte, lane k in byte k % 4 of the result,
+// for the transpose kernels. The ESP32-S3 core is 32-bit, so eight lanes are
+// packed and transposed as two words.
+template <std::uint8_t kLane, std::uint8_t kEnd, bool kUniform, bool kBlend>
+inline std::uint32_t pack_lanes(
+    const ParallelExpandTables& tables,
+    std::uint8_t channel,
+    const std::uint8_t* const* from_lanes,
+    const std::uint8_t* const* to_lanes,
+    int weight,
+    std::size_t offset) {
+  if constexpr (kLane >= kEnd) {
+    return 0;
+  } else {
+    std::uint8_t value = to_lanes[kLane][offset];
+    if constexpr (kBlend) {
+      const int start = from_lanes[kLane][offset];
+      value = static_cast<std::uint8_t>(
+          start + (((static_cast<int>(value) - start) * weight) >> 8));
+    }
+    const std::uint8_t scaled = kUniform ? tables.values[0][0][value]
+                                         : tables.values[kLane][channel][value];
+    return (std::uint32_t{scaled} << ((kLane % 4U) * 8U)) |
+           pack_lanes<kLane + 1, kEnd, kUniform, kBlend>(
+               tables, channel, from_lanes, to_lanes, weight, offset);
+  }
+}
+
+// 8x8 bit transpose of lanes 0-3 (`low`) and 4-7 (`high`): swaps the
+// off-diagonal 1x1, 2x2 and 4x4 blocks. Afterwards byte b of `low` holds bit b
+// of every lane and byte b of `high` bit b + 4, lane k in bit k.
+inline void transpose_lane_words(std::uint32_t& low, std::uint32_t& high) {
+  std::uint32_t t = (low ^ (low >> 7U)) & 0x00AA00AAU;
+  low ^= t ^ (t << 7U);
+  t = (high ^ (high >> 7U)) & 0x00AA00AAU;
+  high ^= t ^ (t << 7U);
+  t = (low ^ (low >> 14U)) & 0x0000CCCCU;
+  low ^= t ^ (t << 14U);
+  t = (high ^ (high >> 14U)) & 0x0000CCCCU;
+  high ^= t ^ (t << 14U);
+  t = (low ^ (high << 4U)) & 0xF0F0F0F0U;
+  low ^= t;
+  high ^= t >> 4U;
+}
+
+// Two-byte sample j of planes (low0, high0) and (low1, high1) after
+// transpose_lane_words(): bit 7 - j of lanes 0-7, then of lanes 8-15.
+inline std::uint32_t wide_sample(
+    std::uint8_t j,
+    std::uint32_t low0,
+    std::uint32_t high0,
+    std::uint32_t low1,
+    std::uint32_t high1) {
+  const std::uint8_t shift = 24U - 8U * (j % 4U);
+  const std::uint32_t lanes0 = j < 4 ? high0 : low0;
+  const std::uint32_t lanes1 = j < 4 ? high1 : low1;
+  return ((lanes0 >> shift) & 0xFFU) | (((lanes1 >> shift) & 0xFFU) << 8U);
+}
+
+// Rewrites whole 100/110 symbols, start and end samples included, so each
+// channel is six (one-byte samples) or twelve (two-byte samples) aligned word
+// stores instead of strided byte stores.
+template <std::uint8_t kStrips, bool kUniform, bool kBlend>
+void transpose_span(
+    const ParallelExpandTables& tables,
+    const std::uint8_t* from,
+    const std::uint8_t* to,
+    std::uint16_t weight,
+    std::uint16_t leds_per_strip,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* output) {
+  constexpr std::uint8_t kGrbOffsets[3] = {1, 0, 2};
+  constexpr std::uint8_t kSampleBytes = sample_bytes_for(kStrips);
+  constexpr std::uint32_t kMask = (std::uint32_t{1} << kStrips) - 1U;
+  const std::size_t lane_stride = static_cast<std::size_t>(leds_per_strip) * 3U;
+  const std::size_t first_byte = static_cast<std::size_t>(first_pixel) * 3U;
+  const std::uint8_t* to_lanes[kStrips];
+  const std::uint8_t* from_lanes[kStrips] = {};
+  for (std::uint8_t lane = 0; lane < kStrips; ++lane) {
+    to_lanes[lane] = to + first_byte + lane_stride * lane;
+    if constexpr (kBlend) from_lanes[lane] = from + first_byte + lane_stride * lane;
+  }
+  // Channel groups are 24 or 48 bytes long, so a 4-byte aligned span start
+  // makes every group word aligned.
+  std::uint8_t* group =
+      static_cast<std::uint8_t*>(__builtin_assume_aligned(output, 4));
+  const std::size_t pixel_bytes =
+      static_cast<std::size_t>(end_pixel - first_pixel) * 3U;
+
+  for (std::size_t offset = 0; offset < pixel_bytes; offset += 3U) {
+    for (const std::uint8_t c : kGrbOffsets) {
+      std::uint32_t low = pack_lanes<0, (kStrips < 4 ? kStrips : 4), kUniform, kBlend>(
+          tables, c, from_lanes, to_lanes, weight, offset + c);
+      std::uint32_t high = pack_lanes<4, plane_end(kStrips, 0), kUniform, kBlend>(
+          tables, c, from_lanes, to_lanes, weight, offset + c);
+      transpose_lane_words(low, high);
+      if constexpr (kSampleBytes == 1) {
+        // Sample j carries bit 7 - j: d0..d3 are the top-down bytes of `high`
+        // and d4..d7 those of `low`. Little-endian symbol bytes are
+        // mask, d0, 0, mask, d1, 0, ... d7, 0.
+        const std::uint32_t words[6] = {
+            kMask | ((high >> 24U) << 8U) | (kMask << 24U),
+            ((high >> 16U) & 0xFFU) | (kMask << 16U) | (((high >> 8U) & 0xFFU) << 24U),
+            (kMask << 8U) | ((high & 0xFFU) << 16U),
+            kMask | ((low >> 24U) << 8U) | (kMask << 24U),
+            ((low >> 16U) & 0xFFU) | (kMask << 16U) | (((low >> 8U) & 0xFFU) << 24U),
+            (kMask << 8U) | ((low & 0xFFU) << 16U),
+        };
+        std::memcpy(group, words, sizeof(words));
+        group += sizeof(words);
+      } else {
+        std::uint32_t low1 = pack_lanes<8, (kStrips < 12 ? kStrips : 12), kUniform, kBlend>(
+            tables, c, from_lanes, to_lanes, weight, offset + c);
+        std::uint32_t high1 = pack_lanes<12, kStrips, kUniform, kBlend>(
+            tables, c, from_lanes, to_lanes, weight, offset + c);
+        transpose_lane_words(low1, high1);
+        // Two symbols, mask 0 0 mask 0 0 in 16-bit samples, fill three words.
+        std::uint32_t words[12];
+        for (std::uint8_t pair = 0; pair < 4; ++pair) {
+          words[pair * 3U] =
+              kMask | (wide_sample(pair * 2U, low, high, low1, high1) << 16U);
+          words[pair * 3U + 1U] = kMask << 16U;
+          words[pair * 3U + 2U] = wide_sample(pair * 2U + 1U, low, high, low1, high1);
+        }
+        std::memcpy(group, words, sizeof(words));
+        group += sizeof(words);
+      }
+    }
+  }
+}
+
+template <bool kUniform, bool kBlend, std::size_t... kIndex>
+constexpr std::array<ParallelSpanKernel, sizeof...(kIndex)> make_transpose_kernels(
+    std::index_sequence<kIndex...>) {
+  return {&transpose_span<kIndex + 1, kUniform, kBlend>...};
+}
+
+template <bool kUniform, bool kBlend>
+constexpr auto kTransposeKernels = make_transpose_kernels<kUniform, kBlend>(
+    std::make_index_sequence<kMaxParallelStrips>());
+
+// Byte offset of pixel column `pixel` from the start of the waveform.
+std::size_t column_offset(std::uint8_t strip_count, std::uint16_t pixel) {
+  return static_cast<std::size_t>(ws2812_sample_bytes(strip_count)) *
+         ws2812_encoded_size(pixel, 0);
+}
+
+bool span_arguments_valid(
+    const std::uint8_t* rgb,
+    std::size_t rgb_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    const std::uint8_t* output,
+    std::size_t output_capacity,
+    std::size_t required_output,
+    std::uint32_t sample_rate_hz,
+    std::size_t bytes_per_pixel = 3U) {
+  if (rgb == nullptr || output == nullptr || strip_count == 0 ||
+      strip_count > kMaxParallelStrips || leds_per_strip == 0 ||
+      sample_rate_hz == 0 || first_pixel > end_pixel ||
+      end_pixel > leds_per_strip) {
+    return false;
+  }
+  const std::size_t required_rgb =
+      static_cast<std::size_t>(strip_count) * leds_per_strip * bytes_per_pixel;
+  return rgb_bytes >= required_rgb && required_output != 0 &&
+         output_capacity >= required_output;
+}
+
+// What an unmapped pixel reads instead of a channel byte; MappedLaneBits
+// turns it into zero bits, so it stays dark whatever the curves say.
+constexpr std::uint16_t kDarkValue = 0x100;
+
+// A logical-order frame seen through a layout map: RGB offset `offset` of the
+// physical frame, moved on by `shift` bytes for chunks, reads the same
+// channel of the logical pixel its entry names.
+template <typename Pixels>
+struct MappedBytes {
+  std::uint16_t operator()(std::size_t offset) const {
+    offset += shift;
+    const std::uint16_t source = layout[offset / 3U];
+    if (source == kUnmappedPixel) return kDarkValue;
+    return pixels(static_cast<std::size_t>(source) * 3U + offset % 3U);
+  }
+  Pixels pixels;
+  const std::uint16_t* layout;
+  std::size_t shift;
+};
+
+template <typename LaneBits>
+struct MappedLaneBits {
+  std::uint64_t operator()(std::uint8_t lane, std::uint8_t channel, std::uint16_t value) const {
+    return value == kDarkValue ? 0 : bits(lane, channel, static_cast<std::uint8_t>(value));
+  }
+  LaneBits bits;
+};
+
+// Tables built by build_uniform_expand_table(): one row for every lane.
+struct UniformTables {
+  std::uint64_t operator()(std::uint8_t lane, std::uint8_t, std::uint8_t value) const {
+    return tables->bits[0][0][value] << (lane % kLanesPerSampleByte);
+  }
+  const ParallelExpandTables* tables;
+};
+
+// The palette index covering RGB offset `offset`, for PaletteRows.
+struct IndexBytes {
+  std::uint8_t operator()(std::size_t offset) const { return indices[offset / 3U]; }
+  const std::uint8_t* indices;
+};
+
+struct PaletteRows {
+  std::uint64_t operator()(std::uint8_t lane, std::uint8_t channel, std::uint8_t entry) const {
+    return uniform ? rows[0][channel][entry] << (lane % kLanesPerSampleByte)
+                   : rows[lane][channel][entry];
+  }
+  const PaletteExpandRow* rows;
+  bool uniform;
+};
+
+// Encodes pixels [first_pixel, end_pixel) of the physical frame. Spans pass
+// the frame as `output`; chunks pass the chunk and a `shift` of the span
+// start, so the loop runs from column 0 of the chunk.
+template <typename Pixels, typename LaneBits>
+void encode_mapped(
+    Pixels pixels,
+    LaneBits lane_bits,
+    const std::uint16_t* layout,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    bool chunk,
+    std::uint8_t* output) {
+  const std::size_t shift = chunk ? static_cast<std::size_t>(first_pixel) * 3U : 0U;
+  encode_span(
+      MappedBytes<Pixels>{pixels, layout, shift}, MappedLaneBits<LaneBits>{lane_bits},
+      strip_count, leds_per_strip, chunk ? 0 : first_pixel,
+      chunk ? end_pixel - first_pixel : end_pixel, output);
+}
+
+template <typename Pixels>
+void encode_mapped_rgb(
+    const ParallelEncodeKernels& kernels,
+    const ParallelExpandTables& tables,
+    Pixels pixels,
+    const std::uint16_t* layout,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    bool chunk,
+    std::uint8_t* output) {
+  if (kernels.uniform_tables) {
+    encode_mapped(pixels, UniformTables{&tables}, layout, strip_count, leds_per_strip,
+                  first_pixel, end_pixel, chunk, output);
+  } else {
+    encode_mapped(pixels, PrebuiltTables{&tables}, layout, strip_count, leds_per_strip,
+                  first_pixel, end_pixel, chunk, output);
+  }
+}
+
+void encode_mapped_frame(
+    const ParallelEncodeKernels& kernels,
+    const ParallelExpandTables& tables,
+    const std::uint16_t* layout,
+    const std::uint8_t* from,
+    const std::uint8_t* rgb,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t weight,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    bool chunk,
+    std::uint8_t* output) {
+  if (from != nullptr) {
+    encode_mapped_rgb(kernels, tables, BlendedBytes{from, rgb, weight}, layout,
+                      strip_count, leds_per_strip, first_pixel, end_pixel, chunk, output);
+  } else {
+    encode_mapped_rgb(kernels, tables, FrameBytes{rgb}, layout, strip_count,
+                      leds_per_strip, first_pixel, end_pixel, chunk, output);
+  }
+}
+
 }  // namespace
 
 std::size_t ws2812_reset_samples(
@@ -82,6 +657,20 @@ EncodeResult encode_parallel_grb(
       sample_rate_hz);
 }
 
+std::uint8_t ws2812_sample_bytes(std::uint8_t strip_count) {
+  if (strip_count == 0 || strip_count > kMaxParallelStrips) return 0;
+  return sample_bytes_for(strip_count);
+}
+
+std::size_t parallel_encoded_size(
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t reset_us,
+    std::uint32_t sample_rate_hz) {
+  return ws2812_sample_bytes(strip_count) *
+         ws2812_encoded_size(leds_per_strip, reset_us, sample_rate_hz);
+}
+
 bool initialize_parallel_grb_waveform(
     std::uint8_t strip_count,
     std::uint16_t leds_per_strip,
@@ -94,21 +683,22 @@ bool initialize_parallel_grb_waveform(
       sample_rate_hz == 0) {
     return false;
   }
-  const std::size_t required_output =
-      ws2812_encoded_size(leds_per_strip, reset_us, sample_rate_hz);
+  const std::size_t required_output = parallel_encoded_size(
+      strip_count, leds_per_strip, reset_us, sample_rate_hz);
   if (required_output == 0 || output_capacity < required_output) return false;
 
-  const std::uint8_t active_mask =
-      strip_count == 8 ? 0xFFU
-                       : static_cast<std::uint8_t>((1U << strip_count) - 1U);
-  const std::size_t data_samples =
-      static_cast<std::size_t>(leds_per_strip) * 3U * 8U * 3U;
-  for (std::size_t sample = 0; sample < data_samples; sample += 3U) {
-    output[sample] = active_mask;
-    output[sample + 1U] = 0;
-    output[sample + 2U] = 0;
-  }
-  std::memset(output + data_samples, 0, required_output - data_samples);
+  const std::uint8_t sample_bytes = ws2812_sample_bytes(strip_count);
+  const std::uint32_t active_mask = (std::uint32_t{1} << strip_count) - 1U;
+  const std::size_t symbol_bytes = 3U * sample_bytes;
+  const std::size_t data_bytes =
+      static_cast<std::size_t>(leds_per_strip) * 3U * 8U * symbol_bytes;
+  for (std::size_t symbol = 0; symbol < data_bytes; symbol += symbol_bytes) {
+    std::memset(output + symbol, 0, symbol_bytes);
+    for (std::uint8_t byte = 0; byte < sample_bytes; ++byte) {
+      output[symbol + byte] = static_cast<std::uint8_t>(active_mask >> (byte * 8U));
+    }
+  }
+  std::memset(output + data_bytes, 0, required_output - data_bytes);
   return true;
 }
 
@@ -122,69 +712,529 @@ EncodeResult encode_parallel_grb_pixels(
     std::size_t output_capacity,
     std::uint16_t reset_us,
     std::uint32_t sample_rate_hz) {
-  if (rgb == nullptr || output == nullptr || strip_count == 0 ||
-      strip_count > kMaxParallelStrips || leds_per_strip == 0 ||
-      sample_rate_hz == 0) {
+  return encode_parallel_grb_pixel_span(
+      rgb,
+      rgb_bytes,
+      strip_count,
+      leds_per_strip,
+      brightness,
+      0,
+      leds_per_strip,
+      output,
+      output_capacity,
+      reset_us,
+      sample_rate_hz);
+}
+
+EncodeResult encode_parallel_grb_pixel_span(
+    const std::uint8_t* rgb,
+    std::size_t rgb_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint8_t brightness,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* output,
+    std::size_t output_capacity,
+    std::uint16_t reset_us,
+    std::uint32_t sample_rate_hz) {
+  const std::size_t required_output = parallel_encoded_size(
+      strip_count, leds_per_strip, reset_us, sample_rate_hz);
+  if (!span_arguments_valid(
+          rgb, rgb_bytes, strip_count, leds_per_strip, first_pixel, end_pixel,
+          output, output_capacity, required_output, sample_rate_hz)) {
     return {};
   }
+  if (first_pixel == end_pixel) return {true, required_output};
 
-  const std::size_t required_rgb =
-      static_cast<std::size_t>(strip_count) * leds_per_strip * 3U;
-  const std::size_t required_output =
-      ws2812_encoded_size(leds_per_strip, reset_us, sample_rate_hz);
-  if (rgb_bytes < required_rgb || required_output == 0 ||
-      output_capacity < required_output) {
+  encode_span(
+      FrameBytes{rgb}, BrightnessTable(brightness), strip_count, leds_per_strip,
+      first_pixel, end_pixel, output);
+  return {true, required_output};
+}
+
+EncodeResult encode_parallel_grb_blend_span(
+    const std::uint8_t* from,
+    const std::uint8_t* to,
+    std::size_t rgb_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint8_t brightness,
+    std::uint16_t weight,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* output,
+    std::size_t output_capacity,
+    std::uint16_t reset_us,
+    std::uint32_t sample_rate_hz) {
+  const std::size_t required_output = parallel_encoded_size(
+      strip_count, leds_per_strip, reset_us, sample_rate_hz);
+  if (from == nullptr || weight > kBlendWeightMax ||
+      !span_arguments_valid(
+          to, rgb_bytes, strip_count, leds_per_strip, first_pixel, end_pixel,
+          output, output_capacity, required_output, sample_rate_hz)) {
     return {};
   }
+  if (first_pixel == end_pixel) return {true, required_output};
 
-  constexpr std::uint8_t kGrbOffsets[3] = {1, 0, 2};
-  // Materialize the brightness-adjusted expansion table in internal RAM once
-  // per frame. The inner loop then needs one fast lookup per lane rather than
-  // a brightness lookup followed by a flash-resident 64-bit lookup.
-  std::array<std::uint64_t, 256> frame_expand_table{};
-  for (std::size_t value = 0; value < frame_expand_table.size(); ++value) {
-    const auto channel = static_cast<std::uint8_t>(value);
-    const auto scaled = brightness == 255
-                            ? channel
-                            : scale_channel(channel, brightness);
-    frame_expand_table[value] = kExpandTable[scaled];
-  }
+  encode_span(
+      BlendedBytes{from, to, weight}, BrightnessTable(brightness), strip_count,
+      leds_per_strip, first_pixel, end_pixel, output);
+  return {true, required_output};
+}
 
-  const std::size_t lane_stride = static_cast<std::size_t>(leds_per_strip) * 3U;
-  std::uint8_t* dynamic_sample = output + 1U;
+void set_identity_curves(ChannelCurves* curves) {
+  if (curves == nullptr) return;
+  for (auto& lane : curves->curve) {
+    for (auto& channel : lane) {
+      for (std::size_t value = 0; value < channel.size(); ++value) {
+        channel[value] = static_cast<std::uint8_t>(value);
+      }
+    }
+  }
+}
 
-  for (std::uint16_t pixel = 0; pixel < leds_per_strip; ++pixel) {
+void build_parallel_expand_tables(
+    const ChannelCurves* curves,
+    std::uint8_t brightness,
+    ParallelExpandTables* tables) {
+  if (tables == nullptr || tables->bits == nullptr) return;
+  for (std::uint8_t lane = 0; lane < kMaxParallelStrips; ++lane) {
     for (std::uint8_t channel = 0; channel < 3; ++channel) {
-      const std::size_t offset =
-          static_cast<std::size_t>(pixel) * 3U + kGrbOffsets[channel];
-      std::uint64_t parallel_bits = frame_expand_table[rgb[offset]];
-      if (strip_count == 8) {
-        parallel_bits |= frame_expand_table[rgb[offset + lane_stride]] << 1U;
-        parallel_bits |= frame_expand_table[rgb[offset + lane_stride * 2U]] << 2U;
-        parallel_bits |= frame_expand_table[rgb[offset + lane_stride * 3U]] << 3U;
-        parallel_bits |= frame_expand_table[rgb[offset + lane_stride * 4U]] << 4U;
-        parallel_bits |= frame_expand_table[rgb[offset + lane_stride * 5U]] << 5U;
-        parallel_bits |= frame_expand_table[rgb[offset + lane_stride * 6U]] << 6U;
-        parallel_bits |= frame_expand_table[rgb[offset + lane_stride * 7U]] << 7U;
-      } else {
-        for (std::uint8_t lane = 1; lane < strip_count; ++lane) {
-          parallel_bits |=
-              frame_expand_table[rgb[offset + lane_stride * lane]] << lane;
-        }
+      for (std::size_t value = 0; value < 256; ++value) {
+        const std::uint8_t corrected =
+            curves != nullptr ? curves->curve[lane][channel][value]
+                              : static_cast<std::uint8_t>(value);
+        const std::uint8_t scaled =
+            brightness == 255 ? corrected : scale_channel(corrected, brightness);
+        tables->bits[lane][channel][value] =
+            kExpandTable[scaled] << (lane % kLanesPerSampleByte);
+        tables->values[lane][channel][value] = scaled;
       }
+    }
+  }
+}
+
+EncodeResult encode_parallel_grb_table_span(
+    const ParallelExpandTables& tables,
+    const std::uint8_t* rgb,
+    std::size_t rgb_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* output,
+    std::size_t output_capacity,
+    std::uint16_t reset_us,
+    std::uint32_t sample_rate_hz) {
+  const std::size_t required_output = parallel_encoded_size(
+      strip_count, leds_per_strip, reset_us, sample_rate_hz);
+  if (tables.bits == nullptr ||
+      !span_arguments_valid(
+          rgb, rgb_bytes, strip_count, leds_per_strip, first_pixel, end_pixel,
+          output, output_capacity, required_output, sample_rate_hz)) {
+    return {};
+  }
+  if (first_pixel == end_pixel) return {true, required_output};
+
+  encode_span(
+      FrameBytes{rgb}, PrebuiltTables{&tables}, strip_count, leds_per_strip,
+      first_pixel, end_pixel, output);
+  return {true, required_output};
+}
+
+EncodeResult encode_parallel_grb_table_blend_span(
+    const ParallelExpandTables& tables,
+    const std::uint8_t* from,
+    const std::uint8_t* to,
+    std::size_t rgb_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t weight,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* output,
+    std::size_t output_capacity,
+    std::uint16_t reset_us,
+    std::uint32_t sample_rate_hz) {
+  const std::size_t required_output = parallel_encoded_size(
+      strip_count, leds_per_strip, reset_us, sample_rate_hz);
+  if (from == nullptr || tables.bits == nullptr || weight > kBlendWeightMax ||
+      !span_arguments_valid(
+          to, rgb_bytes, strip_count, leds_per_strip, first_pixel, end_pixel,
+          output, output_capacity, required_output, sample_rate_hz)) {
+    return {};
+  }
+  if (first_pixel == end_pixel) return {true, required_output};
+
+  encode_span(
+      BlendedBytes{from, to, weight}, PrebuiltTables{&tables}, strip_count,
+      leds_per_strip, first_pixel, end_pixel, output);
+  return {true, required_output};
+}
+
+bool curves_are_uniform(const ChannelCurves& curves) {
+  const auto& reference = curves.curve[0][0];
+  for (const auto& lane : curves.curve) {
+    for (const auto& channel : lane) {
+      if (channel != reference) return false;
+    }
+  }
+  return true;
+}
+
+void build_uniform_expand_table(
+    const std::array<std::uint8_t, 256>* curve,
+    std::uint8_t brightness,
+    ParallelExpandTables* tables) {
+  if (tables == nullptr || tables->bits == nullptr) return;
+  for (std::size_t value = 0; value < 256; ++value) {
+    const std::uint8_t corrected =
+        curve != nullptr ? (*curve)[value] : static_cast<std::uint8_t>(value);
+    const std::uint8_t scaled =
+        brightness == 255 ? corrected : scale_channel(corrected, brightness);
+    tables->bits[0][0][value] = kExpandTable[scaled];
+    tables->values[0][0][value] = scaled;
+  }
+}
+
+const char* encoder_kernel_name(EncoderKernel kernel) {
+  switch (kernel) {
+    case EncoderKernel::Table:
+      return "table";
+    case EncoderKernel::Transpose:
+      return "transpose";
+  }
+  return "unknown";
+}
+
+std::uint64_t transpose_lane_bits(std::uint64_t lanes) {
+  auto low = static_cast<std::uint32_t>(lanes);
+  auto high = static_cast<std::uint32_t>(lanes >> 32U);
+  transpose_lane_words(low, high);
+  // Reverse the bytes so the most significant bit is sent first.
+  return (std::uint64_t{__builtin_bswap32(low)} << 32U) | __builtin_bswap32(high);
+}
+
+ParallelEncodeKernels select_parallel_encode_kernels(
+    std::uint8_t strip_count,
+    bool uniform_tables,
+    EncoderKernel kind) {
+  ParallelEncodeKernels kernels;
+  if (strip_count == 0 || strip_count > kMaxParallelStrips) return kernels;
+  const std::uint8_t index = strip_count - 1U;
+  if (kind == EncoderKernel::Transpose) {
+    kernels.span = uniform_tables ? kTransposeKernels<true, false>[index]
+                                  : kTransposeKernels<false, false>[index];
+    kernels.blend = uniform_tables ? kTransposeKernels<true, true>[index]
+                                   : kTransposeKernels<false, true>[index];
+  } else {
+    kernels.span = uniform_tables ? kSpecializedKernels<true, false>[index]
+                                  : kSpecializedKernels<false, false>[index];
+    kernels.blend = uniform_tables ? kSpecializedKernels<true, true>[index]
+                                   : kSpecializedKernels<false, true>[index];
+  }
+  kernels.indexed = uniform_tables ? kIndexedKernels<true>[index]
+                                   : kIndexedKernels<false>[index];
+  kernels.strip_count = strip_count;
+  kernels.uniform_tables = uniform_tables;
+  kernels.kind = kind;
+  return kernels;
+}
+
+EncodeResult encode_parallel_grb_kernel_span(
+    const ParallelEncodeKernels& kernels,
+    const ParallelExpandTables& tables,
+    const std::uint8_t* from,
+    const std::uint8_t* rgb,
+    std::size_t rgb_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t weight,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* output,
+    std::size_t output_capacity,
+    std::uint16_t reset_us,
+    std::uint32_t sample_rate_hz) {
+  const std::size_t required_output = parallel_encoded_size(
+      strip_count, leds_per_strip, reset_us, sample_rate_hz);
+  const ParallelSpanKernel kernel = from == nullptr ? kernels.span : kernels.blend;
+  const bool aligned = (reinterpret_cast<std::uintptr_t>(output) & 3U) == 0;
+  if (kernel == nullptr || tables.bits == nullptr || kernels.strip_count != strip_count ||
+      weight > kBlendWeightMax ||
+      (kernels.kind == EncoderKernel::Transpose && !aligned) ||
+      !span_arguments_valid(
+          rgb, rgb_bytes, strip_count, leds_per_strip, first_pixel, end_pixel,
+          output, output_capacity, required_output, sample_rate_hz)) {
+    return {};
+  }
+  if (first_pixel == end_pixel) return {true, required_output};
+
+  kernel(
+      tables, from, rgb, weight, leds_per_strip, first_pixel, end_pixel,
+      output + column_offset(strip_count, first_pixel));
+  return {true, required_output};
+}
+
+EncodeResult encode_parallel_grb_kernel_chunk(
+    const ParallelEncodeKernels& kernels,
+    const ParallelExpandTables& tables,
+    const std::uint8_t* from,
+    const std::uint8_t* rgb,
+    std::size_t rgb_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t weight,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* chunk,
+    std::size_t chunk_capacity) {
+  const ParallelSpanKernel kernel = from == nullptr ? kernels.span : kernels.blend;
+  const bool aligned = (reinterpret_cast<std::uintptr_t>(chunk) & 3U) == 0;
+  const std::size_t required_output = column_offset(strip_count, end_pixel) -
+                                      column_offset(strip_count, first_pixel);
+  if (kernel == nullptr || tables.bits == nullptr || kernels.strip_count != strip_count ||
+      weight > kBlendWeightMax || first_pixel == end_pixel ||
+      (kernels.kind == EncoderKernel::Transpose && !aligned) ||
+      !span_arguments_valid(
+          rgb, rgb_bytes, strip_count, leds_per_strip, first_pixel, end_pixel,
+          chunk, chunk_capacity, required_output, kWs2812SampleRateHz)) {
+    return {};
+  }
+
+  kernel(tables, from, rgb, weight, leds_per_strip, first_pixel, end_pixel, chunk);
+  return {true, required_output};
+}
 
-      dynamic_sample[0] = static_cast<std::uint8_t>(parallel_bits);
-      dynamic_sample[3] = static_cast<std::uint8_t>(parallel_bits >> 8U);
-      dynamic_sample[6] = static_cast<std::uint8_t>(parallel_bits >> 16U);
-      dynamic_sample[9] = static_cast<std::uint8_t>(parallel_bits >> 24U);
-      dynamic_sample[12] = static_cast<std::uint8_t>(parallel_bits >> 32U);
-      dynamic_sample[15] = static_cast<std::uint8_t>(parallel_bits >> 40U);
-      dynamic_sample[18] = static_cast<std::uint8_t>(parallel_bits >> 48U);
-      dynamic_sample[21] = static_cast<std::uint8_t>(parallel_bits >> 56U);
-      dynamic_sample += 24U;
+std::uint8_t palette_expand_rows(std::uint8_t strip_count, bool uniform_tables) {
+  if (strip_count == 0 || strip_count > kMaxParallelStrips) return 0;
+  return uniform_tables ? 1 : strip_count;
+}
+
+void build_palette_expand_rows(
+    const ChannelCurves* curves,
+    bool uniform_tables,
+    const std::uint8_t* palette,
+    std::uint8_t brightness,
+    std::uint8_t strip_count,
+    PaletteExpandRow* rows) {
+  if (rows == nullptr || palette == nullptr) return;
+  const std::uint8_t row_count = palette_expand_rows(strip_count, uniform_tables);
+  for (std::uint8_t row = 0; row < row_count; ++row) {
+    for (std::uint8_t channel = 0; channel < 3; ++channel) {
+      for (std::size_t entry = 0; entry < kPaletteEntries; ++entry) {
+        const std::uint8_t value = palette[entry * 3U + channel];
+        const std::uint8_t corrected =
+            curves != nullptr ? curves->curve[row][channel][value] : value;
+        const std::uint8_t scaled =
+            brightness == 255 ? corrected : scale_channel(corrected, brightness);
+        rows[row][channel][entry] =
+            kExpandTable[scaled] << (uniform_tables ? 0U : row % kLanesPerSampleByte);
+      }
     }
   }
+}
+
+EncodeResult encode_parallel_grb_indexed_span(
+    const ParallelEncodeKernels& kernels,
+    const PaletteExpandRow* rows,
+    const std::uint8_t* indices,
+    std::size_t index_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* output,
+    std::size_t output_capacity,
+    std::uint16_t reset_us,
+    std::uint32_t sample_rate_hz) {
+  const std::size_t required_output = parallel_encoded_size(
+      strip_count, leds_per_strip, reset_us, sample_rate_hz);
+  if (kernels.indexed == nullptr || rows == nullptr ||
+      kernels.strip_count != strip_count ||
+      !span_arguments_valid(
+          indices, index_bytes, strip_count, leds_per_strip, first_pixel,
+          end_pixel, output, output_capacity, required_output, sample_rate_hz,
+          1U)) {
+    return {};
+  }
+  if (first_pixel == end_pixel) return {true, required_output};
+
+  kernels.indexed(
+      rows, indices, leds_per_strip, first_pixel, end_pixel,
+      output + column_offset(strip_count, first_pixel));
+  return {true, required_output};
+}
+
+EncodeResult encode_parallel_grb_indexed_chunk(
+    const ParallelEncodeKernels& kernels,
+    const PaletteExpandRow* rows,
+    const std::uint8_t* indices,
+    std::size_t index_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* chunk,
+    std::size_t chunk_capacity) {
+  const std::size_t required_output = column_offset(strip_count, end_pixel) -
+                                      column_offset(strip_count, first_pixel);
+  if (kernels.indexed == nullptr || rows == nullptr ||
+      kernels.strip_count != strip_count || first_pixel == end_pixel ||
+      !span_arguments_valid(
+          indices, index_bytes, strip_count, leds_per_strip, first_pixel,
+          end_pixel, chunk, chunk_capacity, required_output,
+          kWs2812SampleRateHz, 1U)) {
+    return {};
+  }
+
+  kernels.indexed(rows, indices, leds_per_strip, first_pixel, end_pixel, chunk);
+  return {true, required_output};
+}
+
+EncodeResult encode_parallel_grb_indexed_pixels(
+    const std::uint8_t* indices,
+    std::size_t index_bytes,
+    const std::uint8_t* palette,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint8_t brightness,
+    std::uint8_t* output,
+    std::size_t output_capacity,
+    std::uint16_t reset_us,
+    std::uint32_t sample_rate_hz) {
+  const std::size_t required_output = parallel_encoded_size(
+      strip_count, leds_per_strip, reset_us, sample_rate_hz);
+  if (palette == nullptr ||
+      !span_arguments_valid(
+          indices, index_bytes, strip_count, leds_per_strip, 0, leds_per_strip,
+          output, output_capacity, required_output, sample_rate_hz, 1U)) {
+    return {};
+  }
+
+  encode_span(
+      PaletteBytes{indices, palette}, BrightnessTable(brightness), strip_count,
+      leds_per_strip, 0, leds_per_strip, output);
+  return {true, required_output};
+}
+
+EncodeResult encode_parallel_grb_mapped_span(
+    const ParallelEncodeKernels& kernels,
+    const ParallelExpandTables& tables,
+    const std::uint16_t* layout,
+    const std::uint8_t* from,
+    const std::uint8_t* rgb,
+    std::size_t rgb_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t weight,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* output,
+    std::size_t output_capacity,
+    std::uint16_t reset_us,
+    std::uint32_t sample_rate_hz) {
+  const std::size_t required_output = parallel_encoded_size(
+      strip_count, leds_per_strip, reset_us, sample_rate_hz);
+  if (layout == nullptr || tables.bits == nullptr || kernels.strip_count != strip_count ||
+      weight > kBlendWeightMax ||
+      !span_arguments_valid(
+          rgb, rgb_bytes, strip_count, leds_per_strip, first_pixel, end_pixel,
+          output, output_capacity, required_output, sample_rate_hz)) {
+    return {};
+  }
+  if (first_pixel == end_pixel) return {true, required_output};
+
+  encode_mapped_frame(kernels, tables, layout, from, rgb, strip_count, leds_per_strip,
+                      weight, first_pixel, end_pixel, false, output);
+  return {true, required_output};
+}
+
+EncodeResult encode_parallel_grb_mapped_chunk(
+    const ParallelEncodeKernels& kernels,
+    const ParallelExpandTables& tables,
+    const std::uint16_t* layout,
+    const std::uint8_t* from,
+    const std::uint8_t* rgb,
+    std::size_t rgb_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t weight,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* chunk,
+    std::size_t chunk_capacity) {
+  const std::size_t required_output = column_offset(strip_count, end_pixel) -
+                                      column_offset(strip_count, first_pixel);
+  if (layout == nullptr || tables.bits == nullptr || kernels.strip_count != strip_count ||
+      weight > kBlendWeightMax || first_pixel == end_pixel ||
+      !span_arguments_valid(
+          rgb, rgb_bytes, strip_count, leds_per_strip, first_pixel, end_pixel,
+          chunk, chunk_capacity, required_output, kWs2812SampleRateHz)) {
+    return {};
+  }
+
+  encode_mapped_frame(kernels, tables, layout, from, rgb, strip_count, leds_per_strip,
+                      weight, first_pixel, end_pixel, true, chunk);
+  return {true, required_output};
+}
+
+EncodeResult encode_parallel_grb_mapped_indexed_span(
+    const ParallelEncodeKernels& kernels,
+    const PaletteExpandRow* rows,
+    const std::uint16_t* layout,
+    const std::uint8_t* indices,
+    std::size_t index_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* output,
+    std::size_t output_capacity,
+    std::uint16_t reset_us,
+    std::uint32_t sample_rate_hz) {
+  const std::size_t required_output = parallel_encoded_size(
+      strip_count, leds_per_strip, reset_us, sample_rate_hz);
+  if (layout == nullptr || rows == nullptr || kernels.strip_count != strip_count ||
+      !span_arguments_valid(
+          indices, index_bytes, strip_count, leds_per_strip, first_pixel,
+          end_pixel, output, output_capacity, required_output, sample_rate_hz,
+          1U)) {
+    return {};
+  }
+  if (first_pixel == end_pixel) return {true, required_output};
+
+  encode_mapped(IndexBytes{indices}, PaletteRows{rows, kernels.uniform_tables}, layout,
+                strip_count, leds_per_strip, first_pixel, end_pixel, false, output);
+  return {true, required_output};
+}
+
+EncodeResult encode_parallel_grb_mapped_indexed_chunk(
+    const ParallelEncodeKernels& kernels,
+    const PaletteExpandRow* rows,
+    const std::uint16_t* layout,
+    const std::uint8_t* indices,
+    std::size_t index_bytes,
+    std::uint8_t strip_count,
+    std::uint16_t leds_per_strip,
+    std::uint16_t first_pixel,
+    std::uint16_t end_pixel,
+    std::uint8_t* chunk,
+    std::size_t chunk_capacity) {
+  const std::size_t required_output = column_offset(strip_count, end_pixel) -
+                                      column_offset(strip_count, first_pixel);
+  if (layout == nullptr || rows == nullptr || kernels.strip_count != strip_count ||
+      first_pixel == end_pixel ||
+      !span_arguments_valid(
+          indices, index_bytes, strip_count, leds_per_strip, first_pixel,
+          end_pixel, chunk, chunk_capacity, required_output,
+          kWs2812SampleRateHz, 1U)) {
+    return {};
+  }
 
+  encode_mapped(IndexBytes{indices}, PaletteRows{rows, kernels.uniform_tables}, layout,
+                strip_count, leds_per_strip, first_pixel, end_pixel, true, chunk);
   return {true, required_output};
 }
 
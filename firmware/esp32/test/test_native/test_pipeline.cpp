@@ -1,12 +1,27 @@
 #include <unity.h>
 
 #include <array>
+#include <atomic>
 #include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
 #include <vector>
 
+#include "ledgrid/clip_store.hpp"
+#include "ledgrid/crc16.hpp"
+#include "ledgrid/effect_engine.hpp"
+#include "ledgrid/frame_assembly.hpp"
+#include "ledgrid/frame_blend.hpp"
+#include "ledgrid/frame_compression.hpp"
 #include "ledgrid/frame_mailbox.hpp"
+#include "ledgrid/frame_memory.hpp"
+#include "ledgrid/layout_map.hpp"
+#include "ledgrid/power_budget.hpp"
 #include "ledgrid/protocol.hpp"
+#include "ledgrid/receiver_core.hpp"
 #include "ledgrid/ws2812_encoder.hpp"
+#include "../../bench/receiver_sim.hpp"
 
 namespace {
 
@@ -84,6 +99,45 @@ void test_optimized_encoder_updates_all_eight_lanes() {
   }
 }
 
+void test_span_encoder_matches_full_reencode() {
+  constexpr std::uint8_t kStrips = 8;
+  constexpr std::uint16_t kLeds = 12;
+  std::vector<std::uint8_t> before(kStrips * kLeds * 3U);
+  for (std::size_t i = 0; i < before.size(); ++i) {
+    before[i] = static_cast<std::uint8_t>(i * 37U + 11U);
+  }
+  std::vector<std::uint8_t> after = before;
+  // Change columns 3 and 7 on different strips.
+  after[(2U * kLeds + 3U) * 3U + 1U] ^= 0x5AU;
+  after[(6U * kLeds + 7U) * 3U + 2U] ^= 0xC3U;
+
+  std::vector<std::uint8_t> incremental(ledgrid::ws2812_encoded_size(kLeds));
+  std::vector<std::uint8_t> full(incremental.size());
+  TEST_ASSERT_TRUE(ledgrid::encode_parallel_grb(
+      before.data(), before.size(), kStrips, kLeds, 200,
+      incremental.data(), incremental.size()).ok);
+  const auto result = ledgrid::encode_parallel_grb_pixel_span(
+      after.data(), after.size(), kStrips, kLeds, 200, 3, 8,
+      incremental.data(), incremental.size());
+  TEST_ASSERT_TRUE(result.ok);
+  TEST_ASSERT_EQUAL_UINT32(incremental.size(), result.bytes_written);
+  TEST_ASSERT_TRUE(ledgrid::encode_parallel_grb(
+      after.data(), after.size(), kStrips, kLeds, 200,
+      full.data(), full.size()).ok);
+  TEST_ASSERT_EQUAL_MEMORY(full.data(), incremental.data(), full.size());
+
+  // An empty span is a valid no-op; an inverted or oversized one is not.
+  TEST_ASSERT_TRUE(ledgrid::encode_parallel_grb_pixel_span(
+      after.data(), after.size(), kStrips, kLeds, 200, 5, 5,
+      incremental.data(), incremental.size()).ok);
+  TEST_ASSERT_FALSE(ledgrid::encode_parallel_grb_pixel_span(
+      after.data(), after.size(), kStrips, kLeds, 200, 6, 5,
+      incremental.data(), incremental.size()).ok);
+  TEST_ASSERT_FALSE(ledgrid::encode_parallel_grb_pixel_span(
+      after.data(), after.size(), kStrips, kLeds, 200, 0, kLeds + 1,
+      incremental.data(), incremental.size()).ok);
+}
+
 void test_encoder_appends_300us_reset_and_rejects_bad_bounds() {
   TEST_ASSERT_EQUAL_UINT32(720, ledgrid::ws2812_reset_samples());
   TEST_ASSERT_EQUAL_UINT32(792, ledgrid::ws2812_encoded_size(1));
@@ -145,10 +199,226 @@ void test_mailbox_replaces_only_unread_ready_frames() {
   TEST_ASSERT_EQUAL_UINT32(4, reading.sequence);
 }
 
+void test_mailbox_counts_released_frames_when_displayed() {
+  ledgrid::LatestFrameMailbox mailbox;
+  ledgrid::FrameMetadata metadata{};
+
+  int slot = mailbox.begin_write();
+  metadata.sequence = 1;
+  TEST_ASSERT_TRUE(mailbox.commit_write(slot, metadata));
+  TEST_ASSERT_EQUAL_INT(slot, mailbox.begin_read(&metadata));
+
+  // Once encoded, the slot is free for the writer even though the frame has
+  // not finished transmitting, and it is not yet counted as displayed.
+  TEST_ASSERT_TRUE(mailbox.release_read(slot));
+  TEST_ASSERT_EQUAL(ledgrid::LatestFrameMailbox::SlotState::Free,
+                    mailbox.state(slot));
+  TEST_ASSERT_EQUAL_UINT32(0, mailbox.counters().displayed);
+  TEST_ASSERT_FALSE(mailbox.release_read(slot));
+
+  // A second frame can be read while the first is still in flight.
+  int next = mailbox.begin_write();
+  metadata.sequence = 2;
+  TEST_ASSERT_TRUE(mailbox.commit_write(next, metadata));
+  TEST_ASSERT_EQUAL_INT(next, mailbox.begin_read(&metadata));
+  TEST_ASSERT_TRUE(mailbox.release_read(next));
+
+  mailbox.mark_displayed();
+  mailbox.mark_displayed();
+  TEST_ASSERT_EQUAL_UINT32(2, mailbox.counters().accepted);
+  TEST_ASSERT_EQUAL_UINT32(2, mailbox.counters().displayed);
+  TEST_ASSERT_EQUAL_UINT32(0, mailbox.counters().superseded);
+
+  // A released frame replaced before it was shown, as a staged latch frame
+  // can be, counts as superseded instead.
+  slot = mailbox.begin_write();
+  metadata.sequence = 3;
+  TEST_ASSERT_TRUE(mailbox.commit_write(slot, metadata));
+  TEST_ASSERT_EQUAL_INT(slot, mailbox.begin_read(&metadata));
+  TEST_ASSERT_TRUE(mailbox.release_read(slot));
+  mailbox.mark_superseded();
+  TEST_ASSERT_EQUAL_UINT32(3, mailbox.counters().accepted);
+  TEST_ASSERT_EQUAL_UINT32(2, mailbox.counters().displayed);
+  TEST_ASSERT_EQUAL_UINT32(1, mailbox.counters().superseded);
+}
+
+void test_mailbox_merges_dirty_columns_of_superseded_frames() {
+  ledgrid::LatestFrameMailbox mailbox;
+  ledgrid::FrameMetadata metadata{};
+
+  int slot = mailbox.begin_write();
+  metadata.sequence = 1;
+  metadata.dirty_columns = {4, 6};
+  TEST_ASSERT_TRUE(mailbox.commit_write(slot, metadata));
+  slot = mailbox.begin_write();
+  metadata.sequence = 2;
+  metadata.dirty_columns = {10, 12};
+  TEST_ASSERT_TRUE(mailbox.commit_write(slot, metadata));
+
+  ledgrid::FrameMetadata reading{};
+  slot = mailbox.begin_read(&reading);
+  TEST_ASSERT_EQUAL_UINT32(2, reading.sequence);
+  TEST_ASSERT_EQUAL_UINT16(4, reading.dirty_columns.begin);
+  TEST_ASSERT_EQUAL_UINT16(12, reading.dirty_columns.end);
+
+  // A cancelled read hands its changes to the next reader.
+  TEST_ASSERT_TRUE(mailbox.cancel_read(slot));
+  slot = mailbox.begin_write();
+  metadata.sequence = 3;
+  metadata.dirty_columns = {};
+  TEST_ASSERT_TRUE(mailbox.commit_write(slot, metadata));
+  slot = mailbox.begin_read(&reading);
+  TEST_ASSERT_EQUAL_UINT32(3, reading.sequence);
+  TEST_ASSERT_EQUAL_UINT16(4, reading.dirty_columns.begin);
+  TEST_ASSERT_EQUAL_UINT16(12, reading.dirty_columns.end);
+  TEST_ASSERT_TRUE(mailbox.release_read(slot));
+
+  // An unchanged republish carries an empty span.
+  slot = mailbox.begin_write();
+  metadata.sequence = 4;
+  TEST_ASSERT_TRUE(mailbox.commit_write(slot, metadata));
+  mailbox.begin_read(&reading);
+  TEST_ASSERT_TRUE(reading.dirty_columns.empty());
+}
+
+void test_ordered_mailbox_reads_oldest_first_and_drops_on_overflow() {
+  ledgrid::LatestFrameMailbox mailbox;
+  mailbox.set_ordered(true);
+  ledgrid::FrameMetadata metadata{};
+  const ledgrid::PixelSpan spans[] = {{0, 1}, {2, 3}, {4, 5}, {6, 7}};
+  for (std::uint32_t sequence = 1; sequence <= 4; ++sequence) {
+    const int slot = mailbox.begin_write();
+    TEST_ASSERT_GREATER_OR_EQUAL(0, slot);
+    metadata.sequence = sequence;
+    metadata.dirty_columns = spans[sequence - 1];
+    TEST_ASSERT_TRUE(mailbox.commit_write(slot, metadata));
+  }
+  // The fourth frame displaced the oldest instead of superseding the rest.
+  TEST_ASSERT_EQUAL_UINT32(1, mailbox.counters().queue_drops);
+  TEST_ASSERT_EQUAL_UINT32(0, mailbox.counters().superseded);
+  TEST_ASSERT_EQUAL_UINT32(3, mailbox.ready_count());
+
+  ledgrid::FrameMetadata reading{};
+  int slot = mailbox.begin_read(&reading);
+  TEST_ASSERT_EQUAL_UINT32(2, reading.sequence);
+  // The mode switch and the dropped frame both widen the first read.
+  TEST_ASSERT_TRUE(reading.dirty_columns.begin == 0 &&
+                   reading.dirty_columns.end >= 3);
+  TEST_ASSERT_TRUE(mailbox.release_read(slot));
+
+  slot = mailbox.begin_read(&reading);
+  TEST_ASSERT_EQUAL_UINT32(3, reading.sequence);
+  TEST_ASSERT_EQUAL_UINT16(4, reading.dirty_columns.begin);
+  TEST_ASSERT_EQUAL_UINT16(5, reading.dirty_columns.end);
+  TEST_ASSERT_TRUE(mailbox.cancel_read(slot));
+
+  // A cancelled frame is lost, but its columns carry to the next one.
+  slot = mailbox.begin_read(&reading);
+  TEST_ASSERT_EQUAL_UINT32(4, reading.sequence);
+  TEST_ASSERT_EQUAL_UINT16(4, reading.dirty_columns.begin);
+  TEST_ASSERT_EQUAL_UINT16(7, reading.dirty_columns.end);
+  TEST_ASSERT_TRUE(mailbox.release_read(slot));
+  TEST_ASSERT_EQUAL_INT(-1, mailbox.begin_read(&reading));
+}
+
+// One writer and one reader thread hammer the mailbox. Every read must be
+// newer than the last and cover the columns of every frame since the last
+// one the reader consumed, including superseded, dropped and cancelled ones.
+void check_mailbox_across_threads(bool ordered) {
+  constexpr std::uint32_t kFrames = 100000;
+  ledgrid::LatestFrameMailbox mailbox;
+  mailbox.set_ordered(ordered);
+  std::vector<std::uint16_t> columns(kFrames + 1);
+  std::atomic<bool> writing{true};
+  std::atomic<std::uint32_t> failures{0};
+
+  std::thread reader([&] {
+    std::uint32_t consumed = 0;
+    std::uint32_t last_read = 0;
+    std::uint32_t step = 0;
+    while (writing.load() || mailbox.ready_count() > 0) {
+      ledgrid::FrameMetadata reading{};
+      const int slot = mailbox.begin_read(&reading);
+      if (slot < 0) continue;
+      if (reading.sequence <= last_read) failures.fetch_add(1);
+      for (std::uint32_t s = consumed + 1; s <= reading.sequence; ++s) {
+        if (reading.dirty_columns.begin > columns[s] ||
+            reading.dirty_columns.end <= columns[s]) {
+          failures.fetch_add(1);
+          break;
+        }
+      }
+      last_read = reading.sequence;
+      if (++step % 7 == 0) {
+        mailbox.cancel_read(slot);
+      } else {
+        consumed = reading.sequence;
+        mailbox.finish_read(slot);
+      }
+    }
+  });
+
+  ledgrid::FrameMetadata metadata{};
+  for (std::uint32_t sequence = 1; sequence <= kFrames;) {
+    const int slot = mailbox.begin_write();
+    if (slot < 0) continue;
+    const auto column = static_cast<std::uint16_t>((sequence * 37U) % 64U);
+    columns[sequence] = column;
+    metadata.sequence = sequence++;
+    metadata.dirty_columns = {column, static_cast<std::uint16_t>(column + 1)};
+    mailbox.commit_write(slot, metadata);
+  }
+  writing = false;
+  reader.join();
+
+  const auto counters = mailbox.counters();
+  TEST_ASSERT_EQUAL_UINT32(0, failures.load());
+  TEST_ASSERT_EQUAL_UINT32(kFrames, counters.accepted);
+  TEST_ASSERT_EQUAL_UINT32(0, counters.publish_drops);
+  TEST_ASSERT_EQUAL_UINT32(0, mailbox.ready_count());
+}
+
+void test_mailbox_hands_off_lock_free_across_threads() {
+  check_mailbox_across_threads(false);
+  check_mailbox_across_threads(true);
+}
+
+void test_crc_engines_match_reference() {
+  const std::uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  TEST_ASSERT_EQUAL_HEX16(
+      0x29B1, ledgrid::crc16_ccitt_nibble(check, sizeof(check)));
+  TEST_ASSERT_EQUAL_HEX16(
+      0x29B1, ledgrid::crc16_ccitt_slice8(check, sizeof(check)));
+
+  // Cover every tail length around the eight-byte stride and a full
+  // 8 x 140 SET_ALL payload.
+  std::vector<std::uint8_t> data(1U + 8U * 140U * 3U);
+  for (std::size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<std::uint8_t>(i * 17U + (i >> 5));
+  }
+  const ledgrid::Crc16Engine engines[] = {
+      ledgrid::Crc16Engine::Nibble,
+      ledgrid::Crc16Engine::Slice8,
+      ledgrid::Crc16Engine::Rom,
+  };
+  for (const auto engine : engines) {
+    for (std::size_t length = 0; length < 40; ++length) {
+      TEST_ASSERT_EQUAL_HEX16(
+          ledgrid::crc16_ccitt_nibble(data.data(), length),
+          ledgrid::crc16_ccitt(engine, data.data(), length));
+    }
+    TEST_ASSERT_EQUAL_HEX16(
+        ledgrid::crc16_ccitt_nibble(data.data(), data.size()),
+        ledgrid::crc16_ccitt(engine, data.data(), data.size()));
+  }
+  TEST_ASSERT_FALSE(ledgrid::crc16_engine_available(ledgrid::Crc16Engine::Rom));
+}
+
 void test_status_v2_layout_is_stable() {
   ledgrid::ReceiverStatusV2 status{};
   status.flags = 3;
   status.active_strips = 8;
+  status.capabilities = ledgrid::kCapabilityBatch;
   status.leds_per_strip = 140;
   status.queued_transactions = 2;
   status.packets = 11;
@@ -173,13 +443,1708 @@ void test_status_v2_layout_is_stable() {
   TEST_ASSERT_EQUAL_UINT8(2, encoded[4]);
   TEST_ASSERT_EQUAL_UINT8(3, encoded[5]);
   TEST_ASSERT_EQUAL_UINT8(8, encoded[6]);
+  TEST_ASSERT_EQUAL_UINT8(ledgrid::kCapabilityBatch, encoded[7]);
   TEST_ASSERT_EQUAL_UINT16(140, read_u16(encoded.data() + 8));
   TEST_ASSERT_EQUAL_UINT16(2, read_u16(encoded.data() + 10));
   TEST_ASSERT_EQUAL_UINT32(14, read_u32(encoded.data() + 24));
   TEST_ASSERT_EQUAL_UINT32(16, read_u32(encoded.data() + 32));
   TEST_ASSERT_EQUAL_UINT16(21, read_u16(encoded.data() + 48));
   TEST_ASSERT_EQUAL_UINT32(24, read_u32(encoded.data() + 56));
+
+  // The latch tail is only written when the buffer has room for it.
+  status.latch_mode = 2;
+  status.last_latch_us = 31;
+  status.latches = 32;
+  status.latch_misses = 33;
+  status.last_latch_sequence = 34;
+  std::array<std::uint8_t, ledgrid::kStatusBytesV2Latch> extended{};
+  extended.fill(0xAA);
+  TEST_ASSERT_TRUE(ledgrid::encode_receiver_status_v2(
+      status, extended.data(), ledgrid::kStatusBytesV2));
+  TEST_ASSERT_EQUAL_HEX8(0xAA, extended[64]);
+  TEST_ASSERT_TRUE(ledgrid::encode_receiver_status_v2(
+      status, extended.data(), extended.size()));
+  TEST_ASSERT_EQUAL_MEMORY(encoded.data(), extended.data(), ledgrid::kStatusBytesV2);
+  TEST_ASSERT_EQUAL_UINT8(2, extended[64]);
+  TEST_ASSERT_EQUAL_UINT8(0, extended[65]);
+  TEST_ASSERT_EQUAL_UINT16(31, read_u16(extended.data() + 66));
+  TEST_ASSERT_EQUAL_UINT32(32, read_u32(extended.data() + 68));
+  TEST_ASSERT_EQUAL_UINT32(33, read_u32(extended.data() + 72));
+  TEST_ASSERT_EQUAL_UINT32(34, read_u32(extended.data() + 76));
+
+  status.paced_fps = 60;
+  status.pacing_depth = 3;
+  status.frames_late = 35;
+  status.queue_drops = 36;
+  std::array<std::uint8_t, ledgrid::kStatusBytesV2Pacing> paced{};
+  paced.fill(0xAA);
+  TEST_ASSERT_TRUE(ledgrid::encode_receiver_status_v2(
+      status, paced.data(), paced.size()));
+  TEST_ASSERT_EQUAL_MEMORY(extended.data(), paced.data(), extended.size());
+  TEST_ASSERT_EQUAL_UINT16(60, read_u16(paced.data() + 80));
+  TEST_ASSERT_EQUAL_UINT8(3, paced[82]);
+  TEST_ASSERT_EQUAL_UINT8(0, paced[83]);
+  TEST_ASSERT_EQUAL_UINT32(35, read_u32(paced.data() + 84));
+  TEST_ASSERT_EQUAL_UINT32(36, read_u32(paced.data() + 88));
+
+  status.histogram_stage =
+      static_cast<std::uint8_t>(ledgrid::LatencyStage::Encode);
+  status.histogram.max_us = 37;
+  status.histogram.buckets[0] = 38;
+  status.histogram.buckets[ledgrid::kLatencyBuckets - 1] = 39;
+  std::array<std::uint8_t, ledgrid::kStatusBytesV2Histogram> histogram{};
+  TEST_ASSERT_TRUE(ledgrid::encode_receiver_status_v2(
+      status, histogram.data(), histogram.size()));
+  TEST_ASSERT_EQUAL_MEMORY(paced.data(), histogram.data(), paced.size());
+  TEST_ASSERT_EQUAL_UINT8(4, histogram[92]);
+  TEST_ASSERT_EQUAL_UINT8(ledgrid::kLatencyBuckets, histogram[93]);
+  TEST_ASSERT_EQUAL_UINT32(37, read_u32(histogram.data() + 96));
+  TEST_ASSERT_EQUAL_UINT32(38, read_u32(histogram.data() + 100));
+  TEST_ASSERT_EQUAL_UINT32(39, read_u32(histogram.data() + 176));
+
+  status.chunk_sequence = 40;
+  status.missing_strips = 0x8001;
+  status.chunk_crc_errors = 41;
+  status.frames_recovered = 42;
+  std::array<std::uint8_t, ledgrid::kStatusBytesV2Chunks> chunks{};
+  TEST_ASSERT_TRUE(ledgrid::encode_receiver_status_v2(status, chunks.data(), chunks.size()));
+  TEST_ASSERT_EQUAL_MEMORY(histogram.data(), chunks.data(), histogram.size());
+  TEST_ASSERT_EQUAL_UINT16(40, read_u16(chunks.data() + 180));
+  TEST_ASSERT_EQUAL_UINT16(0x8001, read_u16(chunks.data() + 182));
+  TEST_ASSERT_EQUAL_UINT32(41, read_u32(chunks.data() + 184));
+  TEST_ASSERT_EQUAL_UINT32(42, read_u32(chunks.data() + 188));
+
+  status.display_credits = 1;
+  status.display_room = 3;
+  status.snapshot_us = 0xFFFFFF00U;
+  status.next_slot_us = 0x00000100U;
+  status.slot_interval_us = 16667;
+  std::array<std::uint8_t, ledgrid::kStatusBytesV2Credits> credits{};
+  TEST_ASSERT_TRUE(ledgrid::encode_receiver_status_v2(status, credits.data(), credits.size()));
+  TEST_ASSERT_EQUAL_MEMORY(chunks.data(), credits.data(), chunks.size());
+  TEST_ASSERT_EQUAL_UINT8(1, credits[192]);
+  TEST_ASSERT_EQUAL_UINT8(3, credits[193]);
+  TEST_ASSERT_EQUAL_UINT16(0, read_u16(credits.data() + 194));
+  TEST_ASSERT_EQUAL_HEX32(0xFFFFFF00U, read_u32(credits.data() + 196));
+  TEST_ASSERT_EQUAL_HEX32(0x00000100U, read_u32(credits.data() + 200));
+  TEST_ASSERT_EQUAL_UINT32(16667, read_u32(credits.data() + 204));
+}
+
+void test_status_v3_pages_share_a_header_and_truncate() {
+  ledgrid::StatusPageHeader header{};
+  header.generation = 0x01020304;
+  header.capabilities = ledgrid::kCapabilityStatusPages;
+  header.flags = 1;
+  ledgrid::ReceiverStatusV2 status{};
+  status.leds_per_strip = 140;
+  status.packets = 41;
+  status.last_displayed_sequence = 42;
+  status.active_strips = 8;
+  status.queue_drops = 43;
+  std::array<std::uint8_t, ledgrid::kStatusHistogramPageBytes> page{};
+
+  TEST_ASSERT_EQUAL_UINT32(ledgrid::kStatusCorePageBytes,
+                           ledgrid::encode_status_core_page(
+                               header, status, page.data(), page.size()));
+  TEST_ASSERT_EQUAL_MEMORY("LGS3", page.data(), 4);
+  TEST_ASSERT_EQUAL_UINT8(3, page[4]);
+  TEST_ASSERT_EQUAL_UINT8(1, page[5]);
+  TEST_ASSERT_EQUAL_UINT8(ledgrid::kStatusPageCount, page[6]);
+  TEST_ASSERT_EQUAL_UINT8(0, page[7]);
+  TEST_ASSERT_EQUAL_UINT32(0x01020304, read_u32(page.data() + 8));
+  TEST_ASSERT_EQUAL_UINT16(ledgrid::kStatusCorePageBytes - 16,
+                           read_u16(page.data() + 12));
+  TEST_ASSERT_EQUAL_UINT8(ledgrid::kCapabilityStatusPages, page[14]);
+  TEST_ASSERT_EQUAL_UINT8(1, page[15]);
+  TEST_ASSERT_EQUAL_UINT16(140, read_u16(page.data() + 16));
+  TEST_ASSERT_EQUAL_UINT32(41, read_u32(page.data() + 20));
+  TEST_ASSERT_EQUAL_UINT32(42, read_u32(page.data() + 60));
+  TEST_ASSERT_EQUAL_UINT8(8, page[72]);
+  TEST_ASSERT_EQUAL_UINT32(43, read_u32(page.data() + 96));
+
+  ledgrid::LatencySnapshot snapshots[ledgrid::kLatencyStageCount] = {};
+  snapshots[6].max_us = 44;
+  snapshots[6].buckets[ledgrid::kLatencyBuckets - 1] = 45;
+  TEST_ASSERT_EQUAL_UINT32(ledgrid::kStatusHistogramPageBytes,
+                           ledgrid::encode_status_histogram_page(
+                               header, snapshots, page.data(), page.size()));
+  TEST_ASSERT_EQUAL_UINT8(2, page[5]);
+  TEST_ASSERT_EQUAL_UINT8(ledgrid::kLatencyStageCount, page[16]);
+  TEST_ASSERT_EQUAL_UINT8(ledgrid::kLatencyBuckets, page[17]);
+  TEST_ASSERT_EQUAL_UINT32(44, read_u32(page.data() + 20 + 6 * 84));
+  TEST_ASSERT_EQUAL_UINT32(45, read_u32(page.end() - 4));
+
+  // A page that does not fit leaves a header saying so.
+  page.fill(0xAA);
+  TEST_ASSERT_EQUAL_UINT32(ledgrid::kStatusV3HeaderBytes,
+                           ledgrid::encode_status_histogram_page(
+                               header, snapshots, page.data(), 200));
+  TEST_ASSERT_EQUAL_UINT8(ledgrid::kStatusPageTruncated, page[7]);
+  TEST_ASSERT_EQUAL_UINT16(0, read_u16(page.data() + 12));
+  TEST_ASSERT_EQUAL_HEX8(0xAA, page[16]);
+  TEST_ASSERT_EQUAL_UINT32(0, ledgrid::encode_status_histogram_page(
+                                  header, snapshots, page.data(), 15));
+
+  ledgrid::ReceiverMemoryStatus memory{};
+  memory.led_capacity = 600;
+  memory.zero_copy_mailbox = true;
+  memory.largest_psram_block = 46;
+  TEST_ASSERT_EQUAL_UINT32(ledgrid::kStatusMemoryPageBytes,
+                           ledgrid::encode_status_memory_page(
+                               header, memory, page.data(), page.size()));
+  TEST_ASSERT_EQUAL_UINT16(600, read_u16(page.data() + 16));
+  TEST_ASSERT_EQUAL_UINT8(1, page[20]);
+  TEST_ASSERT_EQUAL_UINT32(46, read_u32(page.data() + 52));
+
+  ledgrid::ReceiverConfigStatus config{};
+  config.max_lanes = 16;
+  config.paced_fps = 60;
+  config.display_mode = ledgrid::kDisplayStreaming;
+  config.effect_kind = static_cast<std::uint8_t>(ledgrid::EffectKind::Plasma);
+  config.effect_frames = 900;
+  config.frame_formats = ledgrid::kFrameFormatIndexed;
+  config.encode_cores = 2;
+  config.encode_helper_share = 48;
+  config.layout_state = ledgrid::kLayoutActive;
+  config.layout_version = 0x01020304;
+  config.layout_crc = 0xBEEF;
+  TEST_ASSERT_EQUAL_UINT32(ledgrid::kStatusConfigPageBytes,
+                           ledgrid::encode_status_config_page(
+                               header, config, page.data(), page.size()));
+  TEST_ASSERT_EQUAL_UINT8(4, page[5]);
+  TEST_ASSERT_EQUAL_UINT8(16, page[17]);
+  TEST_ASSERT_EQUAL_UINT16(60, read_u16(page.data() + 28));
+  TEST_ASSERT_EQUAL_UINT8(ledgrid::kDisplayStreaming, page[32]);
+  TEST_ASSERT_EQUAL_HEX8(ledgrid::kNoLatencyHistogram, page[33]);
+  TEST_ASSERT_EQUAL_UINT8(2, page[36]);
+  TEST_ASSERT_EQUAL_HEX8(ledgrid::kFrameFormatIndexed, page[37]);
+  TEST_ASSERT_EQUAL_UINT32(900, read_u32(page.data() + 40));
+  TEST_ASSERT_EQUAL_UINT8(2, page[44]);
+  TEST_ASSERT_EQUAL_UINT8(48, page[45]);
+  TEST_ASSERT_EQUAL_UINT8(ledgrid::kLayoutActive, page[46]);
+  TEST_ASSERT_EQUAL_HEX32(0x01020304, read_u32(page.data() + 48));
+  TEST_ASSERT_EQUAL_HEX16(0xBEEF, read_u16(page.data() + 52));
+
+  ledgrid::ReceiverTransportStatus transport{};
+  transport.ring_depth = 4;
+  transport.max_backlog = 4;
+  transport.ring_drained = 47;
+  transport.slots[3].completions = 48;
+  transport.slots[3].max_service_us = 49;
+  transport.slots[3].requeue_failures = 2;
+  transport.slots[15].completions = 50;
+  TEST_ASSERT_EQUAL_UINT32(ledgrid::kStatusTransportPageBytes,
+                           ledgrid::encode_status_transport_page(
+                               header, transport, page.data(), page.size()));
+  TEST_ASSERT_EQUAL_UINT8(5, page[5]);
+  TEST_ASSERT_EQUAL_UINT16(ledgrid::kStatusTransportPageBytes - 16,
+                           read_u16(page.data() + 12));
+  TEST_ASSERT_EQUAL_UINT8(4, page[16]);
+  TEST_ASSERT_EQUAL_UINT8(4, page[17]);
+  TEST_ASSERT_EQUAL_UINT32(47, read_u32(page.data() + 20));
+  TEST_ASSERT_EQUAL_UINT32(48, read_u32(page.data() + 32 + 3 * 8));
+  TEST_ASSERT_EQUAL_UINT16(49, read_u16(page.data() + 36 + 3 * 8));
+  TEST_ASSERT_EQUAL_UINT16(2, read_u16(page.data() + 38 + 3 * 8));
+  TEST_ASSERT_EQUAL_UINT32(50, read_u32(page.data() + 32 + 15 * 8));
+
+  ledgrid::ReceiverLinksStatus links{};
+  links.link_count = 2;
+  links.frames_assembled = 51;
+  links.last_assembled_sequence = 0xBEEF;
+  links.links[1].host = 2;
+  links.links[1].crc_errors = 52;
+  links.links[1].max_backlog = 3;
+  links.links[0].has_miso = true;
+  TEST_ASSERT_EQUAL_UINT32(ledgrid::kStatusLinksPageBytes,
+                           ledgrid::encode_status_links_page(
+                               header, links, page.data(), page.size()));
+  TEST_ASSERT_EQUAL_UINT8(6, page[5]);
+  TEST_ASSERT_EQUAL_UINT8(2, page[16]);
+  TEST_ASSERT_EQUAL_UINT32(51, read_u32(page.data() + 24));
+  TEST_ASSERT_EQUAL_HEX16(0xBEEF, read_u16(page.data() + 40));
+  TEST_ASSERT_EQUAL_UINT8(1, page[44 + 23]);
+  TEST_ASSERT_EQUAL_UINT32(52, read_u32(page.data() + 44 + 24 + 8));
+  TEST_ASSERT_EQUAL_UINT8(2, page[44 + 24 + 20]);
+  TEST_ASSERT_EQUAL_UINT8(3, page[44 + 24 + 21]);
+  TEST_ASSERT_EQUAL_UINT8(0, page[44 + 24 + 23]);
+
+  // The clips page outgrows the histogram page; it carries a readback slice.
+  std::vector<std::uint8_t> readback(ledgrid::kClipReadbackBytes + 9U, 0x5A);
+  readback[0] = 0x11;
+  ledgrid::ReceiverClipStatus clips{};
+  clips.capacity = 600;
+  clips.state = ledgrid::kClipsPlaying;
+  clips.frame_bytes = 3312;
+  clips.count = 12;
+  clips.current = 7;
+  clips.frames_played = 53;
+  clips.rejected = 2;
+  clips.readback_flags = ledgrid::kClipReadbackValid;
+  clips.readback_sequence = 54;
+  clips.readback_offset = 1536;
+  clips.readback_bytes = static_cast<std::uint16_t>(readback.size());
+  clips.readback = readback.data();
+  TEST_ASSERT_EQUAL_UINT32(
+      ledgrid::kStatusV3HeaderBytes,
+      ledgrid::encode_status_clips_page(header, clips, page.data(), page.size()));
+  TEST_ASSERT_EQUAL_HEX8(ledgrid::kStatusPageTruncated, page[7]);
+  std::vector<std::uint8_t> clips_page(ledgrid::kStatusClipsPageBytes, 0xEE);
+  TEST_ASSERT_EQUAL_UINT32(ledgrid::kStatusClipsPageBytes,
+                           ledgrid::encode_status_clips_page(
+                               header, clips, clips_page.data(), clips_page.size()));
+  TEST_ASSERT_EQUAL_UINT8(7, clips_page[5]);
+  TEST_ASSERT_EQUAL_UINT16(600, read_u16(clips_page.data() + 16));
+  TEST_ASSERT_EQUAL_UINT8(ledgrid::kClipsPlaying, clips_page[18]);
+  TEST_ASSERT_EQUAL_UINT32(3312, read_u32(clips_page.data() + 20));
+  TEST_ASSERT_EQUAL_UINT16(7, read_u16(clips_page.data() + 28));
+  TEST_ASSERT_EQUAL_UINT32(53, read_u32(clips_page.data() + 32));
+  TEST_ASSERT_EQUAL_UINT16(2, read_u16(clips_page.data() + 44));
+  TEST_ASSERT_EQUAL_UINT32(54, read_u32(clips_page.data() + 48));
+  TEST_ASSERT_EQUAL_UINT32(1536, read_u32(clips_page.data() + 56));
+  TEST_ASSERT_EQUAL_UINT16(ledgrid::kClipReadbackBytes, read_u16(clips_page.data() + 60));
+  TEST_ASSERT_EQUAL_HEX8(0x11, clips_page[64]);
+  TEST_ASSERT_EQUAL_HEX8(0x5A, clips_page.back());
+
+  ledgrid::ReceiverPowerStatus power{};
+  power.budget_total_ma = 3000;
+  power.channel_ua[1] = 11000;
+  power.requested_brightness = 200;
+  power.applied_brightness = 150;
+  power.strip_count = 16;
+  power.busiest_strip = 9;
+  power.demand_ma = 4100;
+  power.total_ma = 2995;
+  power.limited_frames = 12;
+  power.strip_ma[15] = 310;
+  std::vector<std::uint8_t> power_page(ledgrid::kStatusPowerPageBytes, 0xEE);
+  TEST_ASSERT_EQUAL_UINT32(ledgrid::kStatusPowerPageBytes,
+                           ledgrid::encode_status_power_page(
+                               header, power, power_page.data(), power_page.size()));
+  TEST_ASSERT_EQUAL_UINT8(8, power_page[5]);
+  TEST_ASSERT_EQUAL_UINT16(3000, read_u16(power_page.data() + 16));
+  TEST_ASSERT_EQUAL_UINT16(11000, read_u16(power_page.data() + 22));
+  TEST_ASSERT_EQUAL_UINT8(150, power_page[29]);
+  TEST_ASSERT_EQUAL_UINT8(9, power_page[31]);
+  TEST_ASSERT_EQUAL_UINT32(4100, read_u32(power_page.data() + 32));
+  TEST_ASSERT_EQUAL_UINT32(12, read_u32(power_page.data() + 40));
+  TEST_ASSERT_EQUAL_UINT32(0, read_u32(power_page.data() + 44));
+  TEST_ASSERT_EQUAL_UINT32(310, read_u32(power_page.data() + 48 + 15 * 4));
+}
+
+void test_effect_engine_renders_palette_fields_across_the_wall() {
+  std::uint8_t payload[ledgrid::kEffectParamBytes] = {
+      static_cast<std::uint8_t>(ledgrid::EffectKind::PaletteField),
+      0x00, 100,  // ticks per second
+      0x00, 16,   // wall width
+      0x00, 8,    // x origin of this receiver
+      0x0D, 0x00, 0x03, 0xB3, 0x11, 0x00, 0x00, 0x38, 0x85, 0x1F,
+  };
+  ledgrid::EffectParams params{};
+  TEST_ASSERT_TRUE(ledgrid::parse_effect_params(payload, sizeof(payload), &params));
+  TEST_ASSERT_EQUAL_UINT16(16, params.wall_width);
+  TEST_ASSERT_EQUAL_UINT16(947, params.y_scale);
+  TEST_ASSERT_EQUAL_UINT16(34079, params.center_y);
+  TEST_ASSERT_FALSE(ledgrid::parse_effect_params(payload, 1, &params));
+  payload[0] = ledgrid::kEffectKindCount;
+  TEST_ASSERT_FALSE(ledgrid::parse_effect_params(payload, sizeof(payload), &params));
+  TEST_ASSERT_EQUAL(ledgrid::EffectKind::PaletteField, params.kind);
+
+  // AnimatedPaletteField's phases for wall columns 8 and 9 of 16.
+  std::uint8_t phase[8] = {};
+  ledgrid::build_effect_phase(params, 2, 4, phase);
+  const std::uint8_t field[8] = {111, 111, 111, 118, 135, 138, 141, 145};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(field, phase, 8);
+
+  std::uint8_t palette[ledgrid::kEffectPaletteBytes];
+  for (int i = 0; i < 256; ++i) {
+    palette[i * 3] = static_cast<std::uint8_t>(i);
+    palette[i * 3 + 1] = static_cast<std::uint8_t>(255 - i);
+    palette[i * 3 + 2] = 0;
+  }
+  const std::uint32_t tick = ledgrid::effect_tick(params, 3000);
+  TEST_ASSERT_EQUAL_UINT32(300, tick);
+  std::uint8_t rgb[8 * 3] = {};
+  ledgrid::render_effect(params, phase, palette, 2, 4, tick, rgb);
+  TEST_ASSERT_EQUAL_UINT8(162, rgb[3 * 3]);
+  TEST_ASSERT_EQUAL_UINT8(255 - 162, rgb[3 * 3 + 1]);
+  TEST_ASSERT_EQUAL_UINT8(189, rgb[7 * 3]);
+
+  params.kind = ledgrid::EffectKind::Gradient;
+  ledgrid::build_effect_phase(params, 2, 4, phase);
+  const std::uint8_t gradient[8] = {104, 107, 111, 115, 117, 120, 124, 128};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(gradient, phase, 8);
+
+  params.kind = ledgrid::EffectKind::Plasma;
+  ledgrid::build_effect_phase(params, 2, 4, phase);
+  ledgrid::render_effect(params, phase, palette, 2, 4, 0, rgb);
+  TEST_ASSERT_EQUAL_UINT8((198 + 128 + 149) / 3, rgb[0]);
+
+  TEST_ASSERT_EQUAL_UINT8(128, ledgrid::sin8(0));
+  TEST_ASSERT_EQUAL_UINT8(255, ledgrid::sin8(64));
+  TEST_ASSERT_EQUAL_UINT8(127, ledgrid::sin8(128));
+  TEST_ASSERT_EQUAL_UINT8(0, ledgrid::sin8(192));
+}
+
+void test_latency_histogram_buckets_by_powers_of_two() {
+  TEST_ASSERT_EQUAL_UINT32(0, ledgrid::latency_bucket(0));
+  TEST_ASSERT_EQUAL_UINT32(1, ledgrid::latency_bucket(1));
+  TEST_ASSERT_EQUAL_UINT32(2, ledgrid::latency_bucket(2));
+  TEST_ASSERT_EQUAL_UINT32(2, ledgrid::latency_bucket(3));
+  TEST_ASSERT_EQUAL_UINT32(11, ledgrid::latency_bucket(1024));
+  TEST_ASSERT_EQUAL_UINT32(ledgrid::kLatencyBuckets - 1,
+                           ledgrid::latency_bucket(1U << 18));
+  TEST_ASSERT_EQUAL_UINT32(ledgrid::kLatencyBuckets - 1,
+                           ledgrid::latency_bucket(UINT32_MAX));
+
+  ledgrid::LatencyHistogram histogram;
+  histogram.record(3);
+  histogram.record(2);
+  histogram.record(5000);
+  ledgrid::LatencySnapshot snapshot = histogram.snapshot();
+  TEST_ASSERT_EQUAL_UINT32(2, snapshot.buckets[2]);
+  TEST_ASSERT_EQUAL_UINT32(1, snapshot.buckets[13]);
+  TEST_ASSERT_EQUAL_UINT32(5000, snapshot.max_us);
+
+  histogram.reset();
+  snapshot = histogram.snapshot();
+  TEST_ASSERT_EQUAL_UINT32(0, snapshot.buckets[2]);
+  TEST_ASSERT_EQUAL_UINT32(0, snapshot.max_us);
+  TEST_ASSERT_EQUAL_STRING(
+      "end-to-end", ledgrid::latency_stage_name(ledgrid::LatencyStage::EndToEnd));
+}
+
+void test_batch_reader_walks_sixteen_bit_ranges() {
+  std::vector<std::uint8_t> batch = {
+      ledgrid::kBatchSetBrightness, 77,
+      ledgrid::kBatchSetPixel, 0x04, 0x4F, 1, 2, 3,
+      ledgrid::kBatchSetRange, 0x00, 0x10, 0x01, 0x2C};
+  // A 300-pixel range does not fit the legacy 8-bit SET_RANGE count.
+  for (std::size_t i = 0; i < 300U * 3U; ++i) {
+    batch.push_back(static_cast<std::uint8_t>(i));
+  }
+  batch.push_back(ledgrid::kBatchShow);
+
+  TEST_ASSERT_TRUE(ledgrid::validate_command_batch(batch.data(), batch.size(), 1120));
+  ledgrid::BatchReader reader(batch.data(), batch.size(), 1120);
+  ledgrid::BatchOp op{};
+  TEST_ASSERT_TRUE(reader.next(&op));
+  TEST_ASSERT_EQUAL_HEX8(ledgrid::kBatchSetBrightness, op.opcode);
+  TEST_ASSERT_EQUAL_UINT8(77, op.brightness);
+  TEST_ASSERT_TRUE(reader.next(&op));
+  TEST_ASSERT_EQUAL_UINT16(1103, op.start);
+  TEST_ASSERT_EQUAL_UINT16(1, op.count);
+  TEST_ASSERT_EQUAL_HEX8(2, op.rgb[1]);
+  TEST_ASSERT_TRUE(reader.next(&op));
+  TEST_ASSERT_EQUAL_HEX8(ledgrid::kBatchSetRange, op.opcode);
+  TEST_ASSERT_EQUAL_UINT16(16, op.start);
+  TEST_ASSERT_EQUAL_UINT16(300, op.count);
+  TEST_ASSERT_TRUE(op.rgb == batch.data() + 13);
+  TEST_ASSERT_TRUE(reader.next(&op));
+  TEST_ASSERT_EQUAL_HEX8(ledgrid::kBatchShow, op.opcode);
+  TEST_ASSERT_FALSE(reader.next(&op));
+  TEST_ASSERT_FALSE(reader.failed());
+}
+
+void test_batch_validation_rejects_malformed_ops() {
+  const std::uint8_t out_of_range[] = {ledgrid::kBatchSetPixel, 0x04, 0x60, 1, 2, 3};
+  const std::uint8_t range_overflow[] = {
+      ledgrid::kBatchSetRange, 0x04, 0x5F, 0x00, 0x02, 1, 2, 3, 4, 5, 6};
+  const std::uint8_t truncated_range[] = {
+      ledgrid::kBatchSetRange, 0x00, 0x00, 0x00, 0x02, 1, 2, 3};
+  const std::uint8_t empty_range[] = {ledgrid::kBatchSetRange, 0x00, 0x00, 0x00, 0x00};
+  const std::uint8_t show_not_last[] = {
+      ledgrid::kBatchShow, ledgrid::kBatchSetBrightness, 10};
+  const std::uint8_t unknown_op[] = {ledgrid::kBatchSetBrightness, 10, 0x06};
+
+  TEST_ASSERT_FALSE(ledgrid::validate_command_batch(out_of_range, sizeof(out_of_range), 1120));
+  TEST_ASSERT_FALSE(ledgrid::validate_command_batch(range_overflow, sizeof(range_overflow), 1120));
+  TEST_ASSERT_FALSE(ledgrid::validate_command_batch(truncated_range, sizeof(truncated_range), 1120));
+  TEST_ASSERT_FALSE(ledgrid::validate_command_batch(empty_range, sizeof(empty_range), 1120));
+  TEST_ASSERT_FALSE(ledgrid::validate_command_batch(show_not_last, sizeof(show_not_last), 1120));
+  TEST_ASSERT_FALSE(ledgrid::validate_command_batch(unknown_op, sizeof(unknown_op), 1120));
+  TEST_ASSERT_FALSE(ledgrid::validate_command_batch(unknown_op, 0, 1120));
+}
+
+void test_rle_frame_decodes_runs_and_literals() {
+  // Four lanes of three pixels: a nine-pixel red run, then three literals.
+  const std::uint8_t tokens[] = {
+      0x88, 0xFF, 0x00, 0x00,
+      0x02, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  std::array<std::uint8_t, 36> frame{};
+  ledgrid::PixelSpan changed{};
+
+  TEST_ASSERT_TRUE(ledgrid::decode_rle_frame(
+      tokens, sizeof(tokens), frame.data(), 12, 3, &changed));
+  for (std::size_t pixel = 0; pixel < 9; ++pixel) {
+    TEST_ASSERT_EQUAL_HEX8(0xFF, frame[pixel * 3U]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, frame[pixel * 3U + 1U]);
+  }
+  TEST_ASSERT_EQUAL_HEX8(1, frame[27]);
+  TEST_ASSERT_EQUAL_HEX8(9, frame[35]);
+  TEST_ASSERT_EQUAL_UINT16(0, changed.begin);
+  TEST_ASSERT_EQUAL_UINT16(3, changed.end);
+
+  // Re-decoding the same frame changes nothing.
+  changed.clear();
+  TEST_ASSERT_TRUE(ledgrid::decode_rle_frame(
+      tokens, sizeof(tokens), frame.data(), 12, 3, &changed));
+  TEST_ASSERT_TRUE(changed.empty());
+}
+
+void test_xor_delta_touches_only_changed_columns() {
+  std::array<std::uint8_t, 24> frame{};
+  for (std::size_t i = 0; i < frame.size(); ++i) frame[i] = static_cast<std::uint8_t>(i);
+  // Two lanes of four pixels; only pixel 6 (lane 1, column 2) changes.
+  const std::uint8_t tokens[] = {
+      0x85, 0x00, 0x00, 0x00,
+      0x00, 0x10, 0x20, 0x30,
+      0x80, 0x00, 0x00, 0x00};
+  ledgrid::PixelSpan changed{};
+
+  TEST_ASSERT_TRUE(ledgrid::apply_xor_delta_frame(
+      tokens, sizeof(tokens), frame.data(), 8, 4, &changed));
+  TEST_ASSERT_EQUAL_HEX8(18 ^ 0x10, frame[18]);
+  TEST_ASSERT_EQUAL_HEX8(19 ^ 0x20, frame[19]);
+  TEST_ASSERT_EQUAL_HEX8(20 ^ 0x30, frame[20]);
+  TEST_ASSERT_EQUAL_HEX8(17, frame[17]);
+  TEST_ASSERT_EQUAL_HEX8(21, frame[21]);
+  TEST_ASSERT_EQUAL_UINT16(2, changed.begin);
+  TEST_ASSERT_EQUAL_UINT16(3, changed.end);
+}
+
+void test_compressed_frames_reject_bad_coverage_without_writing() {
+  std::array<std::uint8_t, 12> frame{};
+  frame.fill(0x5A);
+  const std::uint8_t short_frame[] = {0x82, 1, 2, 3};
+  const std::uint8_t long_frame[] = {0x84, 1, 2, 3};
+  const std::uint8_t truncated[] = {0x80, 1, 2, 3, 0x02, 1, 2, 3, 4};
+
+  TEST_ASSERT_FALSE(ledgrid::decode_rle_frame(
+      short_frame, sizeof(short_frame), frame.data(), 4, 4, nullptr));
+  TEST_ASSERT_FALSE(ledgrid::decode_rle_frame(
+      long_frame, sizeof(long_frame), frame.data(), 4, 4, nullptr));
+  TEST_ASSERT_FALSE(ledgrid::apply_xor_delta_frame(
+      truncated, sizeof(truncated), frame.data(), 4, 4, nullptr));
+  TEST_ASSERT_FALSE(ledgrid::decode_rle_frame(nullptr, 0, frame.data(), 4, 4, nullptr));
+  for (const std::uint8_t value : frame) TEST_ASSERT_EQUAL_HEX8(0x5A, value);
+}
+
+std::vector<std::uint8_t> frame_part(
+    std::uint16_t sequence, std::uint8_t first_strip, std::uint8_t strips,
+    const std::vector<std::uint8_t>& rgb, std::uint16_t leds) {
+  std::vector<std::uint8_t> part = {
+      static_cast<std::uint8_t>(sequence >> 8), static_cast<std::uint8_t>(sequence),
+      first_strip, strips};
+  const std::size_t offset = static_cast<std::size_t>(first_strip) * leds * 3U;
+  part.insert(part.end(), rgb.begin() + offset,
+              rgb.begin() + offset + static_cast<std::size_t>(strips) * leds * 3U);
+  return part;
+}
+
+void test_frame_assembler_publishes_only_whole_frames() {
+  constexpr std::uint8_t kStrips = 4;
+  constexpr std::uint16_t kLeds = 3;
+  std::vector<std::uint8_t> first(kStrips * kLeds * 3U);
+  std::vector<std::uint8_t> second(first.size());
+  for (std::size_t i = 0; i < first.size(); ++i) {
+    first[i] = static_cast<std::uint8_t>(i * 7U + 1U);
+    second[i] = static_cast<std::uint8_t>(255U - i);
+  }
+  std::vector<std::uint8_t> frame(first.size());
+  ledgrid::FrameAssembler assembler;
+  const auto add = [&](const std::vector<std::uint8_t>& part) {
+    return assembler.add(part.data(), part.size(), kStrips, kLeds, frame.data());
+  };
+
+  // Halves in either order; only the second completes the frame.
+  TEST_ASSERT_EQUAL(ledgrid::FrameAssembly::Pending,
+                    add(frame_part(0xFFFF, 2, 2, first, kLeds)));
+  TEST_ASSERT_TRUE(assembler.in_progress());
+  TEST_ASSERT_EQUAL(ledgrid::FrameAssembly::Complete,
+                    add(frame_part(0xFFFF, 0, 2, first, kLeds)));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(first.data(), frame.data(), frame.size());
+  TEST_ASSERT_EQUAL(ledgrid::FrameAssembly::Stale,
+                    add(frame_part(0xFFFF, 0, 2, second, kLeds)));
+
+  // A newer sequence, across the u16 wrap, abandons the one in progress and
+  // a late part of the abandoned frame cannot tear it.
+  TEST_ASSERT_EQUAL(ledgrid::FrameAssembly::Pending,
+                    add(frame_part(0, 0, 2, second, kLeds)));
+  TEST_ASSERT_EQUAL(ledgrid::FrameAssembly::Pending,
+                    add(frame_part(1, 0, 2, second, kLeds)));
+  TEST_ASSERT_EQUAL(ledgrid::FrameAssembly::Stale,
+                    add(frame_part(0, 2, 2, first, kLeds)));
+  TEST_ASSERT_EQUAL(ledgrid::FrameAssembly::Complete,
+                    add(frame_part(1, 2, 2, second, kLeds)));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(second.data(), frame.data(), frame.size());
+
+  // Parts outside the geometry or of the wrong size never touch the frame.
+  auto wide = frame_part(2, 2, 2, first, kLeds);
+  wide[3] = 3;
+  auto short_part = frame_part(2, 0, 2, first, kLeds);
+  short_part.pop_back();
+  TEST_ASSERT_EQUAL(ledgrid::FrameAssembly::Rejected, add(wide));
+  TEST_ASSERT_EQUAL(ledgrid::FrameAssembly::Rejected, add(short_part));
+  TEST_ASSERT_EQUAL(ledgrid::FrameAssembly::Rejected,
+                    add(frame_part(2, 0, 0, first, kLeds)));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(second.data(), frame.data(), frame.size());
+
+  // After a reset any sequence starts a frame, even an older one.
+  TEST_ASSERT_EQUAL(ledgrid::FrameAssembly::Pending,
+                    add(frame_part(5, 1, 3, first, kLeds)));
+  assembler.reset();
+  TEST_ASSERT_EQUAL(ledgrid::FrameAssembly::Complete,
+                    add(frame_part(3, 0, 4, first, kLeds)));
+
+  const auto& counters = assembler.counters();
+  TEST_ASSERT_EQUAL_UINT32(3, counters.frames);
+  TEST_ASSERT_EQUAL_UINT32(2, counters.abandoned);
+  TEST_ASSERT_EQUAL_UINT32(2, counters.stale);
+  TEST_ASSERT_EQUAL_UINT32(3, counters.rejected);
+  TEST_ASSERT_EQUAL_UINT32(7, counters.parts);
+  TEST_ASSERT_EQUAL_UINT16(3, counters.last_sequence);
+}
+
+std::vector<std::uint8_t> chunked_frame(
+    std::uint16_t sequence, std::uint16_t strips, const std::vector<std::uint8_t>& rgb,
+    std::uint16_t leds) {
+  std::vector<std::uint8_t> payload = {
+      static_cast<std::uint8_t>(sequence >> 8), static_cast<std::uint8_t>(sequence),
+      static_cast<std::uint8_t>(strips >> 8), static_cast<std::uint8_t>(strips)};
+  const auto append_crc = [&payload](std::size_t from) {
+    const std::uint16_t crc =
+        ledgrid::crc16_ccitt_nibble(payload.data() + from, payload.size() - from);
+    payload.push_back(static_cast<std::uint8_t>(crc >> 8));
+    payload.push_back(static_cast<std::uint8_t>(crc));
+  };
+  append_crc(0);
+  const std::size_t strip_bytes = static_cast<std::size_t>(leds) * 3U;
+  for (std::size_t strip = 0; strip < 16; ++strip) {
+    if ((strips & (1U << strip)) == 0) continue;
+    const std::size_t from = payload.size();
+    payload.insert(payload.end(), rgb.begin() + strip * strip_bytes,
+                   rgb.begin() + (strip + 1U) * strip_bytes);
+    append_crc(from);
+  }
+  return payload;
+}
+
+void test_frame_assembler_recovers_chunks_that_fail_their_crc() {
+  constexpr std::uint8_t kStrips = 4;
+  constexpr std::uint16_t kLeds = 3;
+  constexpr auto kEngine = ledgrid::Crc16Engine::Nibble;
+  std::vector<std::uint8_t> rgb(kStrips * kLeds * 3U);
+  for (std::size_t i = 0; i < rgb.size(); ++i) rgb[i] = static_cast<std::uint8_t>(i * 5U + 3U);
+  std::vector<std::uint8_t> frame(rgb.size());
+  ledgrid::FrameAssembler assembler;
+  const auto add = [&](const std::vector<std::uint8_t>& payload) {
+    return assembler.add_chunked(kEngine, payload.data(), payload.size(), kStrips, kLeds,
+                                 frame.data());
+  };
+  const std::size_t chunk_bytes = kLeds * 3U + ledgrid::kFrameChunkCrcBytes;
+  TEST_ASSERT_EQUAL_UINT32(ledgrid::kFrameChunkHeaderBytes + kStrips * chunk_bytes,
+                           ledgrid::frame_chunk_overhead(kStrips) + rgb.size());
+
+  // Flipped bits in strips 1 and 3 cost only those strips; trailing padding
+  // is ignored.
+  auto noisy = chunked_frame(7, 0x000F, rgb, kLeds);
+  noisy[ledgrid::kFrameChunkHeaderBytes + chunk_bytes + 2] ^= 0x10;
+  noisy[ledgrid::kFrameChunkHeaderBytes + 3 * chunk_bytes + chunk_bytes - 1] ^= 0x01;
+  noisy.resize(noisy.size() + 5, 0);
+  TEST_ASSERT_EQUAL(ledgrid::FrameAssembly::Pending, add(noisy));
+  TEST_ASSERT_EQUAL_UINT16(7, assembler.sequence());
+  TEST_ASSERT_EQUAL_UINT32(0x0A, assembler.missing());
+
+  // Resending just those strips completes the frame exactly as sent.
+  TEST_ASSERT_EQUAL(ledgrid::FrameAssembly::Complete, add(chunked_frame(7, 0x0A, rgb, kLeds)));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(rgb.data(), frame.data(), frame.size());
+  TEST_ASSERT_EQUAL_UINT32(0, assembler.missing());
+  TEST_ASSERT_EQUAL(ledgrid::FrameAssembly::Stale, add(chunked_frame(7, 0x01, rgb, kLeds)));
+
+  // A bad header, strips beyond the geometry or a short packet are rejected
+  // before any strip is looked at.
+  auto bad_header = chunked_frame(8, 0x0F, rgb, kLeds);
+  bad_header[1] ^= 0x01;
+  auto short_packet = chunked_frame(8, 0x0F, rgb, kLeds);
+  short_packet.pop_back();
+  TEST_ASSERT_FALSE(ledgrid::frame_chunk_header_intact(kEngine, bad_header.data(),
+                                                       bad_header.size()));
+  TEST_ASSERT_EQUAL(ledgrid::FrameAssembly::Rejected, add(bad_header));
+  TEST_ASSERT_EQUAL(ledgrid::FrameAssembly::Rejected, add(chunked_frame(8, 0x10, rgb, kLeds)));
+  TEST_ASSERT_EQUAL(ledgrid::FrameAssembly::Rejected, add(chunked_frame(8, 0, rgb, kLeds)));
+  TEST_ASSERT_EQUAL(ledgrid::FrameAssembly::Rejected, add(short_packet));
+
+  // Chunked strips and SET_ALL_PART parts meet in the same frame.
+  auto lost = chunked_frame(9, 0x03, rgb, kLeds);
+  lost[ledgrid::kFrameChunkHeaderBytes] ^= 0x80;
+  TEST_ASSERT_EQUAL(ledgrid::FrameAssembly::Pending, add(lost));
+  TEST_ASSERT_EQUAL_UINT32(0x0D, assembler.missing());
+  const auto part = frame_part(9, 2, 2, rgb, kLeds);
+  TEST_ASSERT_EQUAL(ledgrid::FrameAssembly::Pending,
+                    assembler.add(part.data(), part.size(), kStrips, kLeds, frame.data()));
+  TEST_ASSERT_EQUAL(ledgrid::FrameAssembly::Complete, add(chunked_frame(9, 0x01, rgb, kLeds)));
+
+  const auto& counters = assembler.counters();
+  TEST_ASSERT_EQUAL_UINT32(2, counters.frames);
+  TEST_ASSERT_EQUAL_UINT32(2, counters.frames_recovered);
+  TEST_ASSERT_EQUAL_UINT32(3, counters.chunk_crc_errors);
+  TEST_ASSERT_EQUAL_UINT32(4, counters.rejected);
+  TEST_ASSERT_EQUAL_UINT32(1, counters.stale);
+  TEST_ASSERT_EQUAL_UINT16(9, counters.last_sequence);
+}
+
+void test_clip_store_holds_clips_or_a_recording() {
+  constexpr std::size_t kFrameBytes = 30;
+  // Room for three 16 + 32-byte entries and a bit.
+  std::vector<std::uint8_t> storage(3 * 48 + 20, 0xCC);
+  ledgrid::ClipStore store;
+  store.attach(storage.data(), storage.size());
+  store.configure(kFrameBytes);
+  TEST_ASSERT_EQUAL_UINT16(3, store.capacity());
+  TEST_ASSERT_NULL(store.pixels(0));
+
+  // A frame in two slices; starting it clears whatever the entry held.
+  const std::uint8_t head[12] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+  const std::uint8_t tail[6] = {21, 22, 23, 24, 25, 26};
+  TEST_ASSERT_FALSE(store.write_frame(1, 40, 12, tail, sizeof(tail)));
+  TEST_ASSERT_TRUE(store.write_frame(1, 40, 0, head, sizeof(head)));
+  TEST_ASSERT_TRUE(store.write_frame(1, 40, 24, tail, sizeof(tail)));
+  TEST_ASSERT_FALSE(store.write_frame(1, 40, 27, tail, sizeof(tail)));
+  TEST_ASSERT_FALSE(store.write_frame(3, 40, 0, head, sizeof(head)));
+  const std::uint8_t* pixels = store.pixels(1);
+  TEST_ASSERT_NOT_NULL(pixels);
+  TEST_ASSERT_TRUE(store.contains(pixels));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(head, pixels, sizeof(head));
+  TEST_ASSERT_EQUAL_UINT8(0, pixels[12]);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(tail, pixels + 24, sizeof(tail));
+  TEST_ASSERT_EQUAL_UINT16(40, store.frame(1)->duration_ms);
+  TEST_ASSERT_FALSE(store.holds_clip(0, 2));
+  TEST_ASSERT_TRUE(store.write_frame(0, 10, 0, head, sizeof(head)));
+  TEST_ASSERT_TRUE(store.holds_clip(0, 2));
+  TEST_ASSERT_FALSE(store.holds_clip(1, 3));
+
+  // Recording forgets the clips and keeps the newest `capacity` frames.
+  store.start_recording();
+  TEST_ASSERT_NULL(store.pixels(0));
+  std::uint8_t frame[kFrameBytes] = {};
+  for (std::uint8_t i = 1; i <= 4; ++i) {
+    frame[0] = i;
+    TEST_ASSERT_TRUE(store.record(frame, sizeof(frame), 100U + i, 1000U * i, i == 4));
+  }
+  TEST_ASSERT_FALSE(store.record(frame, kFrameBytes + 1U, 200, 0, false));
+  TEST_ASSERT_EQUAL_UINT16(3, store.recorded());
+  TEST_ASSERT_EQUAL_UINT32(104, store.recorded_frame(0)->sequence);
+  TEST_ASSERT_EQUAL_HEX8(ledgrid::kClipFrameIndexed, store.recorded_frame(0)->flags);
+  TEST_ASSERT_EQUAL_UINT8(2, store.recorded_pixels(2)[0]);
+  TEST_ASSERT_EQUAL_UINT32(2000, store.recorded_frame(2)->shown_us);
+  TEST_ASSERT_NULL(store.recorded_frame(3));
+
+  // Uploading again returns to clips, and a new geometry forgets everything.
+  TEST_ASSERT_TRUE(store.write_frame(2, 5, 0, head, sizeof(head)));
+  TEST_ASSERT_EQUAL_UINT16(0, store.recorded());
+  TEST_ASSERT_NULL(store.pixels(1));
+  store.configure(60);
+  TEST_ASSERT_EQUAL_UINT16(2, store.capacity());
+  TEST_ASSERT_NULL(store.pixels(0));
+  TEST_ASSERT_EQUAL_HEX8(0xCC, storage.back());
+}
+
+void test_clip_player_keeps_each_frame_duration() {
+  std::vector<std::uint8_t> storage(4 * 32);
+  ledgrid::ClipStore store;
+  store.attach(storage.data(), storage.size());
+  store.configure(3);
+  const std::uint8_t rgb[3] = {1, 2, 3};
+  store.write_frame(1, 10, 0, rgb, sizeof(rgb));
+  store.write_frame(2, 30, 0, rgb, sizeof(rgb));
+
+  ledgrid::ClipPlayer player;
+  TEST_ASSERT_FALSE(player.start(store, 0, 2, 0, 0));
+  TEST_ASSERT_FALSE(player.playing());
+  TEST_ASSERT_TRUE(player.start(store, 1, 2, 2, 5000));
+  TEST_ASSERT_TRUE(player.due(5000));
+  player.advance(store, 5000);
+  TEST_ASSERT_EQUAL_UINT16(2, player.playback().current);
+  TEST_ASSERT_FALSE(player.due(14999));
+  TEST_ASSERT_EQUAL_UINT32(1, player.wait_us(14999));
+
+  // Published 4 ms late: the next due time still counts from the schedule.
+  TEST_ASSERT_TRUE(player.due(19000));
+  player.advance(store, 19000);
+  TEST_ASSERT_EQUAL_UINT16(1, player.playback().current);
+  TEST_ASSERT_EQUAL_UINT16(1, player.playback().loops_done);
+  TEST_ASSERT_EQUAL_UINT32(26000, player.wait_us(19000));
+
+  // A stall of more than a frame restarts the cadence from now.
+  player.advance(store, 100000);
+  TEST_ASSERT_EQUAL_UINT32(10000, player.wait_us(100000));
+
+  // The second loop ends on the clip's last frame.
+  player.advance(store, 130000);
+  TEST_ASSERT_FALSE(player.playing());
+  TEST_ASSERT_EQUAL_UINT16(2, player.playback().current);
+  TEST_ASSERT_EQUAL_UINT16(2, player.playback().loops_done);
+  TEST_ASSERT_EQUAL_UINT32(4, player.playback().frames_played);
+  TEST_ASSERT_FALSE(player.due(1000000));
+}
+
+void test_power_limit_scales_brightness_into_budget() {
+  // Strip 0 white, strip 1 red: 42 and 16 mA per LED at full scale, plus
+  // 1 mA idle each.
+  constexpr std::uint16_t kLeds = 4;
+  std::vector<std::uint8_t> rgb(2U * kLeds * 3U, 0);
+  for (std::size_t i = 0; i < kLeds * 3U; ++i) rgb[i] = 255;
+  for (std::size_t i = 0; i < kLeds; ++i) rgb[(kLeds + i) * 3U] = 255;
+  ledgrid::ChannelTotals totals{};
+  TEST_ASSERT_FALSE(ledgrid::total_rgb_channels(
+      nullptr, rgb.data(), rgb.size() - 1, 2, kLeds, &totals));
+  TEST_ASSERT_TRUE(
+      ledgrid::total_rgb_channels(nullptr, rgb.data(), rgb.size(), 2, kLeds, &totals));
+  TEST_ASSERT_EQUAL_UINT32(1020, totals.sum[1][0]);
+  TEST_ASSERT_EQUAL_UINT32(0, totals.sum[1][2]);
+
+  const ledgrid::PowerModel model{};
+  ledgrid::PowerBudget budget{};
+  auto estimate = ledgrid::limit_power(model, budget, totals, 255);
+  TEST_ASSERT_FALSE(estimate.limited());
+  TEST_ASSERT_EQUAL_UINT32(240, estimate.demand_ma);
+  TEST_ASSERT_EQUAL_UINT32(240, estimate.total_ma);
+  TEST_ASSERT_EQUAL_UINT32(172, estimate.strip_ma[0]);
+  TEST_ASSERT_EQUAL_UINT32(68, estimate.strip_ma[1]);
+  TEST_ASSERT_EQUAL_UINT8(0, estimate.busiest_strip);
+
+  // The brightest level that fits, priced at what is then encoded.
+  budget.total_ma = 124;
+  estimate = ledgrid::limit_power(model, budget, totals, 255);
+  TEST_ASSERT_TRUE(estimate.limited());
+  TEST_ASSERT_EQUAL_UINT8(127, estimate.brightness);
+  TEST_ASSERT_EQUAL_UINT32(240, estimate.demand_ma);
+  TEST_ASSERT_EQUAL_UINT32(124, estimate.total_ma);
+  TEST_ASSERT_FALSE(ledgrid::limit_power(model, budget, totals, 100).limited());
+
+  // The busiest strip sets the level under a per-strip limit.
+  budget = {0, 90};
+  estimate = ledgrid::limit_power(model, budget, totals, 255);
+  TEST_ASSERT_EQUAL_UINT8(130, estimate.brightness);
+  TEST_ASSERT_EQUAL_UINT32(90, estimate.strip_ma[0]);
+  budget = {5, 0};
+  estimate = ledgrid::limit_power(model, budget, totals, 255);
+  TEST_ASSERT_EQUAL_UINT8(0, estimate.brightness);
+  TEST_ASSERT_EQUAL_UINT32(8, estimate.total_ma);
+
+  // Curves are priced as encoded; indexed frames match their RGB expansion.
+  ledgrid::ChannelCurves curves{};
+  ledgrid::set_identity_curves(&curves);
+  for (int value = 0; value < 256; ++value) {
+    curves.curve[1][0][value] = static_cast<std::uint8_t>(value / 2);
+  }
+  ledgrid::ChannelTotals corrected{};
+  ledgrid::total_rgb_channels(&curves, rgb.data(), rgb.size(), 2, kLeds, &corrected);
+  TEST_ASSERT_EQUAL_UINT32(508, corrected.sum[1][0]);
+  TEST_ASSERT_EQUAL_UINT32(1020, corrected.sum[0][0]);
+
+  std::uint8_t palette[ledgrid::kPaletteBytes] = {255, 255, 255, 255, 0, 0};
+  std::vector<std::uint8_t> indices(2U * kLeds, 0);
+  for (std::size_t i = kLeds; i < indices.size(); ++i) indices[i] = 1;
+  ledgrid::ChannelTotals indexed{};
+  TEST_ASSERT_TRUE(ledgrid::total_indexed_channels(
+      nullptr, indices.data(), indices.size(), palette, 2, kLeds, &indexed));
+  for (std::size_t channel = 0; channel < 3; ++channel) {
+    TEST_ASSERT_EQUAL_UINT32(totals.sum[0][channel], indexed.sum[0][channel]);
+    TEST_ASSERT_EQUAL_UINT32(totals.sum[1][channel], indexed.sum[1][channel]);
+  }
+
+  // A blend is priced at the larger of its ends, channel by channel.
+  ledgrid::include_channel_totals(corrected, &indexed);
+  TEST_ASSERT_EQUAL_UINT32(1020, indexed.sum[1][0]);
+}
+
+void test_blend_encoder_matches_encode_of_blended_frame() {
+  constexpr std::uint8_t kStrips = 8;
+  constexpr std::uint16_t kLeds = 5;
+  std::vector<std::uint8_t> from(kStrips * kLeds * 3U);
+  std::vector<std::uint8_t> to(from.size());
+  for (std::size_t i = 0; i < from.size(); ++i) {
+    from[i] = static_cast<std::uint8_t>(i * 37U);
+    to[i] = static_cast<std::uint8_t>(255U - i * 11U);
+  }
+  const std::size_t encoded_size = ledgrid::ws2812_encoded_size(kLeds);
+
+  for (const std::uint16_t weight : {0, 1, 100, 255, 256}) {
+    std::vector<std::uint8_t> blended(from.size());
+    ledgrid::blend_frames(from.data(), to.data(), from.size(), weight, blended.data());
+    std::vector<std::uint8_t> expected(encoded_size);
+    TEST_ASSERT_TRUE(ledgrid::encode_parallel_grb(
+        blended.data(), blended.size(), kStrips, kLeds, 200,
+        expected.data(), expected.size()).ok);
+
+    std::vector<std::uint8_t> fused(encoded_size);
+    TEST_ASSERT_TRUE(ledgrid::initialize_parallel_grb_waveform(
+        kStrips, kLeds, fused.data(), fused.size()));
+    TEST_ASSERT_TRUE(ledgrid::encode_parallel_grb_blend_span(
+        from.data(), to.data(), to.size(), kStrips, kLeds, 200, weight, 0, kLeds,
+        fused.data(), fused.size()).ok);
+    TEST_ASSERT_EQUAL_MEMORY(expected.data(), fused.data(), encoded_size);
+  }
+
+  std::vector<std::uint8_t> output(encoded_size);
+  TEST_ASSERT_FALSE(ledgrid::encode_parallel_grb_blend_span(
+      from.data(), to.data(), to.size(), kStrips, kLeds, 255, 257, 0, kLeds,
+      output.data(), output.size()).ok);
+}
+
+void test_transition_weights_reach_target_and_ease() {
+  using ledgrid::TransitionEasing;
+  TEST_ASSERT_EQUAL_UINT16(0, ledgrid::transition_weight(0, 1000, TransitionEasing::Linear));
+  TEST_ASSERT_EQUAL_UINT16(128, ledgrid::transition_weight(500, 1000, TransitionEasing::Linear));
+  TEST_ASSERT_EQUAL_UINT16(256, ledgrid::transition_weight(1000, 1000, TransitionEasing::Linear));
+  TEST_ASSERT_EQUAL_UINT16(256, ledgrid::transition_weight(5, 0, TransitionEasing::Linear));
+
+  // Smoothstep is symmetric about the midpoint and slow at both ends.
+  TEST_ASSERT_EQUAL_UINT16(128, ledgrid::transition_weight(500, 1000, TransitionEasing::EaseInOut));
+  const auto early = ledgrid::transition_weight(100, 1000, TransitionEasing::EaseInOut);
+  const auto late = ledgrid::transition_weight(900, 1000, TransitionEasing::EaseInOut);
+  TEST_ASSERT_TRUE(early < ledgrid::transition_weight(100, 1000, TransitionEasing::Linear));
+  TEST_ASSERT_TRUE(early + late >= 254 && early + late <= 256);
+  std::uint16_t previous = 0;
+  for (std::uint32_t elapsed = 0; elapsed <= 1000; elapsed += 10) {
+    const auto weight = ledgrid::transition_weight(elapsed, 1000, TransitionEasing::EaseInOut);
+    TEST_ASSERT_TRUE(weight >= previous);
+    previous = weight;
+  }
+  TEST_ASSERT_EQUAL_UINT16(256, previous);
+}
+
+void test_changed_columns_spans_every_lane() {
+  std::array<std::uint8_t, 2 * 6 * 3> a{};
+  auto b = a;
+  TEST_ASSERT_TRUE(ledgrid::changed_columns(a.data(), b.data(), 2, 6).empty());
+  b[1 * 3 + 2] = 1;            // Lane 0, column 1.
+  b[(6 + 4) * 3] = 1;          // Lane 1, column 4.
+  const auto changed = ledgrid::changed_columns(a.data(), b.data(), 2, 6);
+  TEST_ASSERT_EQUAL_UINT16(1, changed.begin);
+  TEST_ASSERT_EQUAL_UINT16(5, changed.end);
+}
+
+void test_split_columns_covers_the_span_in_order() {
+  ledgrid::PixelSpan slices[16] = {};
+  TEST_ASSERT_EQUAL_UINT8(1, ledgrid::split_columns({4, 4}, 16, 16, slices));
+  TEST_ASSERT_TRUE(slices[0].empty());
+
+  // Narrow spans stay whole rather than splitting below the minimum.
+  TEST_ASSERT_EQUAL_UINT8(1, ledgrid::split_columns({3, 12}, 16, 16, slices));
+  TEST_ASSERT_EQUAL_UINT16(3, slices[0].begin);
+  TEST_ASSERT_EQUAL_UINT16(12, slices[0].end);
+
+  TEST_ASSERT_EQUAL_UINT8(9, ledgrid::split_columns({10, 150}, 16, 16, slices));
+  std::uint16_t next = 10;
+  for (std::uint8_t i = 0; i < 9; ++i) {
+    TEST_ASSERT_EQUAL_UINT16(next, slices[i].begin);
+    TEST_ASSERT_TRUE(slices[i].end - slices[i].begin <= 16);
+    next = slices[i].end;
+  }
+  TEST_ASSERT_EQUAL_UINT16(150, next);
+
+  // Wide spans widen the slices rather than exceeding the cap.
+  TEST_ASSERT_EQUAL_UINT8(4, ledgrid::split_columns({0, 1000}, 16, 4, slices));
+  TEST_ASSERT_EQUAL_UINT16(250, slices[1].begin);
+  TEST_ASSERT_EQUAL_UINT16(1000, slices[3].end);
+  TEST_ASSERT_EQUAL_UINT8(0, ledgrid::split_columns({0, 10}, 16, 0, slices));
+}
+
+void test_table_encoder_bakes_curves_and_brightness() {
+  constexpr std::uint8_t kStrips = 8;
+  constexpr std::uint16_t kLeds = 4;
+  std::vector<std::uint8_t> rgb(kStrips * kLeds * 3U);
+  for (std::size_t i = 0; i < rgb.size(); ++i) rgb[i] = static_cast<std::uint8_t>(i * 29U + 3U);
+  const std::size_t encoded_size = ledgrid::ws2812_encoded_size(kLeds);
+  auto curves = std::make_unique<ledgrid::ChannelCurves>();
+  auto tables_storage = std::make_unique<ledgrid::LaneExpandTableStorage>();
+  auto tables = tables_storage->tables();
+  ledgrid::set_identity_curves(curves.get());
+
+  // Identity curves reproduce the brightness-only encoder exactly.
+  std::vector<std::uint8_t> expected(encoded_size);
+  TEST_ASSERT_TRUE(ledgrid::encode_parallel_grb(
+      rgb.data(), rgb.size(), kStrips, kLeds, 180, expected.data(), expected.size()).ok);
+  ledgrid::build_parallel_expand_tables(curves.get(), 180, &tables);
+  std::vector<std::uint8_t> actual(encoded_size);
+  TEST_ASSERT_TRUE(ledgrid::initialize_parallel_grb_waveform(
+      kStrips, kLeds, actual.data(), actual.size()));
+  TEST_ASSERT_TRUE(ledgrid::encode_parallel_grb_table_span(
+      tables, rgb.data(), rgb.size(), kStrips, kLeds, 0, kLeds,
+      actual.data(), actual.size()).ok);
+  TEST_ASSERT_EQUAL_MEMORY(expected.data(), actual.data(), encoded_size);
+
+  // A curve on lane 3 green matches pre-correcting those bytes on the host.
+  for (std::size_t value = 0; value < 256; ++value) {
+    curves->curve[3][1][value] = static_cast<std::uint8_t>((value * value) / 255U);
+  }
+  std::vector<std::uint8_t> corrected = rgb;
+  for (std::uint16_t pixel = 0; pixel < kLeds; ++pixel) {
+    auto& green = corrected[(3U * kLeds + pixel) * 3U + 1U];
+    green = curves->curve[3][1][green];
+  }
+  TEST_ASSERT_TRUE(ledgrid::encode_parallel_grb(
+      corrected.data(), corrected.size(), kStrips, kLeds, 180,
+      expected.data(), expected.size()).ok);
+  ledgrid::build_parallel_expand_tables(curves.get(), 180, &tables);
+  TEST_ASSERT_TRUE(ledgrid::encode_parallel_grb_table_span(
+      tables, rgb.data(), rgb.size(), kStrips, kLeds, 0, kLeds,
+      actual.data(), actual.size()).ok);
+  TEST_ASSERT_EQUAL_MEMORY(expected.data(), actual.data(), encoded_size);
+}
+
+void test_specialized_kernels_match_table_encoders() {
+  constexpr std::uint16_t kLeds = 6;
+  auto curves = std::make_unique<ledgrid::ChannelCurves>();
+  auto tables_storage = std::make_unique<ledgrid::LaneExpandTableStorage>();
+  auto tables = tables_storage->tables();
+  auto uniform_storage = std::make_unique<ledgrid::UniformExpandTableStorage>();
+  auto uniform = uniform_storage->tables();
+  for (std::size_t value = 0; value < 256; ++value) {
+    for (auto& lane : curves->curve) {
+      for (auto& channel : lane) {
+        channel[value] = static_cast<std::uint8_t>((value * value) / 255U);
+      }
+    }
+  }
+  TEST_ASSERT_TRUE(ledgrid::curves_are_uniform(*curves));
+  ledgrid::build_uniform_expand_table(&curves->curve[0][0], 200, &uniform);
+  curves->curve[2][1][128] ^= 0x5AU;
+  TEST_ASSERT_FALSE(ledgrid::curves_are_uniform(*curves));
+  curves->curve[2][1][128] ^= 0x5AU;
+
+  for (const std::uint8_t strips : {1, 5, 8, 12, 16}) {
+    if (strips > ledgrid::kMaxParallelStrips) continue;
+    std::vector<std::uint8_t> from(strips * kLeds * 3U);
+    std::vector<std::uint8_t> to(from.size());
+    for (std::size_t i = 0; i < from.size(); ++i) {
+      from[i] = static_cast<std::uint8_t>(i * 37U + 11U);
+      to[i] = static_cast<std::uint8_t>(i * 91U + strips);
+    }
+    const std::size_t encoded_size = ledgrid::parallel_encoded_size(strips, kLeds);
+    for (const auto kind :
+         {ledgrid::EncoderKernel::Table, ledgrid::EncoderKernel::Transpose}) {
+      for (const bool uniform_tables : {true, false}) {
+        ledgrid::build_parallel_expand_tables(
+            uniform_tables ? curves.get() : nullptr, 200, &tables);
+        const auto kernels =
+            ledgrid::select_parallel_encode_kernels(strips, uniform_tables, kind);
+        const auto& kernel_tables = uniform_tables ? uniform : tables;
+        for (const std::uint16_t weight : {0, 97, 256}) {
+          const std::uint8_t* blend_from = weight == 0 ? nullptr : from.data();
+          std::vector<std::uint8_t> expected(encoded_size);
+          std::vector<std::uint8_t> actual(encoded_size);
+          TEST_ASSERT_TRUE(ledgrid::initialize_parallel_grb_waveform(
+              strips, kLeds, expected.data(), expected.size()));
+          actual = expected;
+          TEST_ASSERT_TRUE(
+              (blend_from == nullptr
+                   ? ledgrid::encode_parallel_grb_table_span(
+                         tables, to.data(), to.size(), strips, kLeds, 1, 5,
+                         expected.data(), expected.size())
+                   : ledgrid::encode_parallel_grb_table_blend_span(
+                         tables, blend_from, to.data(), to.size(), strips, kLeds,
+                         weight, 1, 5, expected.data(), expected.size()))
+                  .ok);
+          TEST_ASSERT_TRUE(ledgrid::encode_parallel_grb_kernel_span(
+              kernels, kernel_tables, blend_from, to.data(), to.size(), strips,
+              kLeds, weight, 1, 5, actual.data(), actual.size()).ok);
+          TEST_ASSERT_EQUAL_MEMORY(expected.data(), actual.data(), encoded_size);
+        }
+      }
+    }
+  }
+
+  // Kernels run only for the geometry they were selected for.
+  const std::size_t encoded_size = ledgrid::ws2812_encoded_size(kLeds);
+  std::vector<std::uint8_t> rgb(8U * kLeds * 3U);
+  std::vector<std::uint8_t> output(encoded_size);
+  TEST_ASSERT_FALSE(ledgrid::encode_parallel_grb_kernel_span(
+      ledgrid::select_parallel_encode_kernels(4, false), tables, nullptr,
+      rgb.data(), rgb.size(), 8, kLeds, 0, 0, kLeds, output.data(),
+      output.size()).ok);
+  TEST_ASSERT_TRUE(ledgrid::select_parallel_encode_kernels(
+      ledgrid::kMaxParallelStrips + 1, false).span == nullptr);
+  // Transpose kernels store whole words and refuse a misaligned buffer.
+  std::vector<std::uint8_t> padded(encoded_size + 1U);
+  TEST_ASSERT_FALSE(ledgrid::encode_parallel_grb_kernel_span(
+      ledgrid::select_parallel_encode_kernels(
+          8, false, ledgrid::EncoderKernel::Transpose),
+      tables, nullptr, rgb.data(), rgb.size(), 8, kLeds, 0, 0, kLeds,
+      padded.data() + 1, encoded_size).ok);
+}
+
+void test_lane_transpose_matches_expansion() {
+  std::uint8_t lanes[8] = {};
+  for (std::uint32_t round = 0; round < 64; ++round) {
+    std::uint64_t packed = 0;
+    std::uint64_t expected = 0;
+    for (std::uint8_t lane = 0; lane < 8; ++lane) {
+      lanes[lane] = static_cast<std::uint8_t>(round * 53U + lane * 149U + (round >> 3));
+      packed |= std::uint64_t{lanes[lane]} << (lane * 8U);
+      for (std::uint8_t sample = 0; sample < 8; ++sample) {
+        if ((lanes[lane] & (0x80U >> sample)) != 0) {
+          expected |= std::uint64_t{1} << (sample * 8U + lane);
+        }
+      }
+    }
+    TEST_ASSERT_EQUAL_HEX64(expected, ledgrid::transpose_lane_bits(packed));
+  }
+}
+
+void test_chunked_encode_concatenates_to_full_frame() {
+  constexpr std::uint16_t kLeds = 11;
+  constexpr std::uint16_t kChunkColumns = 4;
+  auto tables_storage = std::make_unique<ledgrid::LaneExpandTableStorage>();
+  auto tables = tables_storage->tables();
+  ledgrid::build_parallel_expand_tables(nullptr, 180, &tables);
+
+  for (const std::uint8_t strips : {3, 8, 16}) {
+    if (strips > ledgrid::kMaxParallelStrips) continue;
+    std::vector<std::uint8_t> rgb(strips * kLeds * 3U);
+    for (std::size_t i = 0; i < rgb.size(); ++i) {
+      rgb[i] = static_cast<std::uint8_t>(i * 29U + strips);
+    }
+    const std::size_t frame_size = ledgrid::parallel_encoded_size(strips, kLeds);
+    const std::size_t data_size = ledgrid::parallel_encoded_size(strips, kLeds, 0);
+    for (const auto kind :
+         {ledgrid::EncoderKernel::Table, ledgrid::EncoderKernel::Transpose}) {
+      const auto kernels = ledgrid::select_parallel_encode_kernels(strips, false, kind);
+      std::vector<std::uint8_t> frame(frame_size);
+      TEST_ASSERT_TRUE(ledgrid::initialize_parallel_grb_waveform(
+          strips, kLeds, frame.data(), frame.size()));
+      TEST_ASSERT_TRUE(ledgrid::encode_parallel_grb_kernel_span(
+          kernels, tables, nullptr, rgb.data(), rgb.size(), strips, kLeds,
+          ledgrid::kBlendWeightMax, 0, kLeds, frame.data(), frame.size()).ok);
+
+      std::vector<std::uint8_t> streamed;
+      std::vector<std::uint8_t> chunk(
+          ledgrid::parallel_encoded_size(strips, kChunkColumns, 0));
+      TEST_ASSERT_TRUE(ledgrid::initialize_parallel_grb_waveform(
+          strips, kChunkColumns, chunk.data(), chunk.size(), 0));
+      for (std::uint16_t first = 0; first < kLeds; first += kChunkColumns) {
+        const std::uint16_t end =
+            first + kChunkColumns < kLeds ? first + kChunkColumns : kLeds;
+        const auto encoded = ledgrid::encode_parallel_grb_kernel_chunk(
+            kernels, tables, nullptr, rgb.data(), rgb.size(), strips, kLeds,
+            ledgrid::kBlendWeightMax, first, end, chunk.data(), chunk.size());
+        TEST_ASSERT_TRUE(encoded.ok);
+        TEST_ASSERT_EQUAL_UINT32(
+            ledgrid::parallel_encoded_size(strips, end - first, 0),
+            encoded.bytes_written);
+        streamed.insert(
+            streamed.end(), chunk.begin(), chunk.begin() + encoded.bytes_written);
+      }
+      TEST_ASSERT_EQUAL_UINT32(data_size, streamed.size());
+      TEST_ASSERT_EQUAL_MEMORY(frame.data(), streamed.data(), data_size);
+    }
+  }
+
+  // Chunks must hold their columns and cannot be empty.
+  const auto kernels = ledgrid::select_parallel_encode_kernels(8, false);
+  std::vector<std::uint8_t> rgb(8U * kLeds * 3U);
+  std::vector<std::uint8_t> chunk(ledgrid::parallel_encoded_size(8, kChunkColumns, 0));
+  TEST_ASSERT_FALSE(ledgrid::encode_parallel_grb_kernel_chunk(
+      kernels, tables, nullptr, rgb.data(), rgb.size(), 8, kLeds,
+      ledgrid::kBlendWeightMax, 2, 2, chunk.data(), chunk.size()).ok);
+  TEST_ASSERT_FALSE(ledgrid::encode_parallel_grb_kernel_chunk(
+      kernels, tables, nullptr, rgb.data(), rgb.size(), 8, kLeds,
+      ledgrid::kBlendWeightMax, 0, kChunkColumns + 1, chunk.data(),
+      chunk.size()).ok);
+}
+
+void test_indexed_kernels_match_expanded_rgb() {
+  constexpr std::uint16_t kLeds = 6;
+  std::vector<std::uint8_t> palette(ledgrid::kPaletteBytes);
+  for (std::size_t entry = 0; entry < ledgrid::kPaletteEntries; ++entry) {
+    palette[entry * 3U] = static_cast<std::uint8_t>(entry * 7U + 3U);
+    palette[entry * 3U + 1U] = static_cast<std::uint8_t>(255U - entry);
+    palette[entry * 3U + 2U] = static_cast<std::uint8_t>((entry * entry) / 255U);
+  }
+  auto uniform_curves = std::make_unique<ledgrid::ChannelCurves>();
+  auto lane_curves = std::make_unique<ledgrid::ChannelCurves>();
+  for (std::size_t value = 0; value < 256; ++value) {
+    for (std::uint8_t lane = 0; lane < ledgrid::kMaxParallelStrips; ++lane) {
+      for (std::uint8_t channel = 0; channel < 3; ++channel) {
+        uniform_curves->curve[lane][channel][value] =
+            static_cast<std::uint8_t>((value * value) / 255U);
+        lane_curves->curve[lane][channel][value] =
+            static_cast<std::uint8_t>(value * (lane + channel + 1U));
+      }
+    }
+  }
+  auto tables_storage = std::make_unique<ledgrid::LaneExpandTableStorage>();
+  auto tables = tables_storage->tables();
+  std::vector<ledgrid::PaletteExpandRow> rows(ledgrid::kMaxParallelStrips);
+
+  for (const std::uint8_t strips : {1, 5, 8, 12, 16}) {
+    if (strips > ledgrid::kMaxParallelStrips) continue;
+    std::vector<std::uint8_t> indices(strips * kLeds);
+    for (std::size_t i = 0; i < indices.size(); ++i) {
+      indices[i] = static_cast<std::uint8_t>(i * 61U + strips);
+    }
+    std::vector<std::uint8_t> rgb(indices.size() * 3U);
+    ledgrid::expand_indexed_frame(
+        indices.data(), indices.size(), palette.data(), rgb.data());
+    TEST_ASSERT_EQUAL_MEMORY(palette.data() + indices[5] * 3U, rgb.data() + 15, 3);
+
+    const std::size_t encoded_size = ledgrid::parallel_encoded_size(strips, kLeds);
+    for (const bool uniform_tables : {true, false}) {
+      const auto* curves = uniform_tables ? uniform_curves.get() : lane_curves.get();
+      ledgrid::build_parallel_expand_tables(curves, 200, &tables);
+      TEST_ASSERT_EQUAL_UINT8(uniform_tables ? 1 : strips,
+                              ledgrid::palette_expand_rows(strips, uniform_tables));
+      ledgrid::build_palette_expand_rows(
+          curves, uniform_tables, palette.data(), 200, strips, rows.data());
+      const auto kernels = ledgrid::select_parallel_encode_kernels(
+          strips, uniform_tables, ledgrid::EncoderKernel::Transpose);
+      std::vector<std::uint8_t> expected(encoded_size);
+      TEST_ASSERT_TRUE(ledgrid::initialize_parallel_grb_waveform(
+          strips, kLeds, expected.data(), expected.size()));
+      std::vector<std::uint8_t> actual = expected;
+      TEST_ASSERT_TRUE(ledgrid::encode_parallel_grb_table_span(
+          tables, rgb.data(), rgb.size(), strips, kLeds, 1, 5,
+          expected.data(), expected.size()).ok);
+      TEST_ASSERT_TRUE(ledgrid::encode_parallel_grb_indexed_span(
+          kernels, rows.data(), indices.data(), indices.size(), strips, kLeds,
+          1, 5, actual.data(), actual.size()).ok);
+      TEST_ASSERT_EQUAL_MEMORY(expected.data(), actual.data(), encoded_size);
+
+      std::vector<std::uint8_t> chunk(ledgrid::parallel_encoded_size(strips, 4, 0));
+      TEST_ASSERT_TRUE(ledgrid::initialize_parallel_grb_waveform(
+          strips, 4, chunk.data(), chunk.size(), 0));
+      const auto encoded = ledgrid::encode_parallel_grb_indexed_chunk(
+          kernels, rows.data(), indices.data(), indices.size(), strips, kLeds,
+          1, 5, chunk.data(), chunk.size());
+      TEST_ASSERT_TRUE(encoded.ok);
+      TEST_ASSERT_EQUAL_MEMORY(
+          expected.data() + ledgrid::parallel_encoded_size(strips, 1, 0),
+          chunk.data(), encoded.bytes_written);
+    }
+
+    // The brightness-only reference agrees with the RGB one.
+    std::vector<std::uint8_t> expected(encoded_size);
+    std::vector<std::uint8_t> actual(encoded_size);
+    TEST_ASSERT_TRUE(ledgrid::encode_parallel_grb(
+        rgb.data(), rgb.size(), strips, kLeds, 90, expected.data(),
+        expected.size()).ok);
+    TEST_ASSERT_TRUE(ledgrid::initialize_parallel_grb_waveform(
+        strips, kLeds, actual.data(), actual.size()));
+    TEST_ASSERT_TRUE(ledgrid::encode_parallel_grb_indexed_pixels(
+        indices.data(), indices.size(), palette.data(), strips, kLeds, 90,
+        actual.data(), actual.size()).ok);
+    TEST_ASSERT_EQUAL_MEMORY(expected.data(), actual.data(), encoded_size);
+  }
+
+  // One byte per pixel is the whole frame; no rows means no encode.
+  const auto kernels = ledgrid::select_parallel_encode_kernels(8, false);
+  std::vector<std::uint8_t> indices(8U * kLeds);
+  std::vector<std::uint8_t> output(ledgrid::ws2812_encoded_size(kLeds));
+  TEST_ASSERT_FALSE(ledgrid::encode_parallel_grb_indexed_span(
+      kernels, rows.data(), indices.data(), indices.size() - 1U, 8, kLeds, 0,
+      kLeds, output.data(), output.size()).ok);
+  TEST_ASSERT_FALSE(ledgrid::encode_parallel_grb_indexed_span(
+      kernels, nullptr, indices.data(), indices.size(), 8, kLeds, 0, kLeds,
+      output.data(), output.size()).ok);
+
+  std::vector<std::uint8_t> changed = indices;
+  changed[kLeds + 4U] = 9;
+  const auto columns = ledgrid::changed_columns(indices.data(), changed.data(), 8, kLeds, 1);
+  TEST_ASSERT_EQUAL_UINT16(4, columns.begin);
+  TEST_ASSERT_EQUAL_UINT16(5, columns.end);
+}
+
+// Serpentine wiring: odd strips run backwards. The last physical pixel is
+// left unmapped so the dark path is covered too.
+std::vector<std::uint16_t> serpentine_layout(std::uint8_t strips, std::uint16_t leds) {
+  std::vector<std::uint16_t> layout(static_cast<std::size_t>(strips) * leds);
+  for (std::uint8_t lane = 0; lane < strips; ++lane) {
+    for (std::uint16_t column = 0; column < leds; ++column) {
+      const std::uint16_t logical = (lane & 1U) != 0 ? leds - 1U - column : column;
+      layout[lane * leds + column] = static_cast<std::uint16_t>(lane * leds + logical);
+    }
+  }
+  layout.back() = ledgrid::kUnmappedPixel;
+  return layout;
+}
+
+std::vector<std::uint8_t> layout_entries(const std::vector<std::uint16_t>& layout) {
+  std::vector<std::uint8_t> entries;
+  for (const std::uint16_t entry : layout) {
+    entries.push_back(static_cast<std::uint8_t>(entry >> 8));
+    entries.push_back(static_cast<std::uint8_t>(entry));
+  }
+  return entries;
+}
+
+// What the host would have sent without a map: each physical pixel's
+// logical value, unmapped pixels zero.
+std::vector<std::uint8_t> remap_frame(
+    const std::vector<std::uint8_t>& frame,
+    const std::vector<std::uint16_t>& layout,
+    std::size_t bytes_per_pixel) {
+  std::vector<std::uint8_t> remapped(frame.size());
+  for (std::size_t pixel = 0; pixel < layout.size(); ++pixel) {
+    if (layout[pixel] == ledgrid::kUnmappedPixel) continue;
+    for (std::size_t byte = 0; byte < bytes_per_pixel; ++byte) {
+      remapped[pixel * bytes_per_pixel + byte] =
+          frame[layout[pixel] * bytes_per_pixel + byte];
+    }
+  }
+  return remapped;
+}
+
+void test_layout_map_validates_entries() {
+  const auto layout = serpentine_layout(3, 5);
+  auto entries = layout_entries(layout);
+  ledgrid::LayoutMapInfo info;
+  info.version = 0x01020304;
+  info.strip_count = 3;
+  info.leds_per_strip = 5;
+  info.crc = ledgrid::crc16_ccitt(
+      ledgrid::Crc16Engine::Nibble, entries.data(), entries.size());
+  TEST_ASSERT_TRUE(ledgrid::layout_map_valid(
+      ledgrid::Crc16Engine::Nibble, info, entries.data(), entries.size()));
+  TEST_ASSERT_FALSE(ledgrid::layout_map_valid(
+      ledgrid::Crc16Engine::Nibble, info, entries.data(), entries.size() - 1));
+
+  std::uint8_t packed[ledgrid::kLayoutInfoBytes] = {};
+  ledgrid::write_layout_info(info, packed);
+  const std::uint8_t expected[] = {0x01, 0x02, 0x03, 0x04, 3, 0, 5,
+                                   static_cast<std::uint8_t>(info.crc >> 8),
+                                   static_cast<std::uint8_t>(info.crc)};
+  TEST_ASSERT_EQUAL_MEMORY(expected, packed, sizeof(expected));
+  const auto read = ledgrid::read_layout_info(packed);
+  TEST_ASSERT_EQUAL_UINT32(info.version, read.version);
+  TEST_ASSERT_EQUAL_UINT8(3, read.strip_count);
+  TEST_ASSERT_EQUAL_UINT16(5, read.leds_per_strip);
+  TEST_ASSERT_EQUAL_HEX16(info.crc, read.crc);
+
+  std::vector<std::uint16_t> decoded(layout.size());
+  TEST_ASSERT_TRUE(ledgrid::decode_layout_map(
+      entries.data(), layout.size(), decoded.data()));
+  TEST_ASSERT_EQUAL_UINT16(9, decoded[5]);
+  TEST_ASSERT_EQUAL_UINT16(ledgrid::kUnmappedPixel, decoded[14]);
+  for (std::size_t pixel = 0; pixel < layout.size(); ++pixel) {
+    TEST_ASSERT_EQUAL_UINT16(layout[pixel], decoded[pixel]);
+  }
+
+  // Version 0 means no map, and a CRC over other entries does not match.
+  auto unversioned = info;
+  unversioned.version = 0;
+  TEST_ASSERT_FALSE(ledgrid::layout_map_valid(
+      ledgrid::Crc16Engine::Nibble, unversioned, entries.data(), entries.size()));
+  entries[1] ^= 0x01U;
+  TEST_ASSERT_FALSE(ledgrid::layout_map_valid(
+      ledgrid::Crc16Engine::Nibble, info, entries.data(), entries.size()));
+
+  // Entries must name a pixel of the frame, even with a matching CRC.
+  entries[0] = 0;
+  entries[1] = 15;
+  info.crc = ledgrid::crc16_ccitt(
+      ledgrid::Crc16Engine::Nibble, entries.data(), entries.size());
+  TEST_ASSERT_FALSE(ledgrid::layout_map_valid(
+      ledgrid::Crc16Engine::Nibble, info, entries.data(), entries.size()));
+  TEST_ASSERT_FALSE(ledgrid::decode_layout_map(
+      entries.data(), layout.size(), decoded.data()));
+}
+
+void test_mapped_encoders_match_remapped_frames() {
+  constexpr std::uint16_t kLeds = 6;
+  std::vector<std::uint8_t> palette(ledgrid::kPaletteBytes);
+  for (std::size_t entry = 0; entry < ledgrid::kPaletteEntries; ++entry) {
+    palette[entry * 3U] = static_cast<std::uint8_t>(entry * 7U + 3U);
+    palette[entry * 3U + 1U] = static_cast<std::uint8_t>(255U - entry);
+    palette[entry * 3U + 2U] = static_cast<std::uint8_t>((entry * entry) / 255U);
+  }
+  auto uniform_curves = std::make_unique<ledgrid::ChannelCurves>();
+  auto lane_curves = std::make_unique<ledgrid::ChannelCurves>();
+  for (std::size_t value = 0; value < 256; ++value) {
+    for (std::uint8_t lane = 0; lane < ledgrid::kMaxParallelStrips; ++lane) {
+      for (std::uint8_t channel = 0; channel < 3; ++channel) {
+        uniform_curves->curve[lane][channel][value] =
+            static_cast<std::uint8_t>((value * value) / 255U);
+        lane_curves->curve[lane][channel][value] =
+            static_cast<std::uint8_t>(value * (lane + channel + 1U));
+      }
+    }
+  }
+  auto tables_storage = std::make_unique<ledgrid::LaneExpandTableStorage>();
+  auto tables = tables_storage->tables();
+  auto uniform_storage = std::make_unique<ledgrid::UniformExpandTableStorage>();
+  auto uniform = uniform_storage->tables();
+  ledgrid::build_uniform_expand_table(
+      &uniform_curves->curve[0][0], 200, &uniform);
+  std::vector<ledgrid::PaletteExpandRow> rows(ledgrid::kMaxParallelStrips);
+
+  for (const std::uint8_t strips : {1, 5, 8, 16}) {
+    if (strips > ledgrid::kMaxParallelStrips) continue;
+    const auto layout = serpentine_layout(strips, kLeds);
+    std::vector<std::uint8_t> from(strips * kLeds * 3U);
+    std::vector<std::uint8_t> to(from.size());
+    std::vector<std::uint8_t> indices(strips * kLeds);
+    for (std::size_t i = 0; i < from.size(); ++i) {
+      from[i] = static_cast<std::uint8_t>(i * 37U + 11U);
+      to[i] = static_cast<std::uint8_t>(i * 91U + strips);
+    }
+    for (std::size_t i = 0; i < indices.size(); ++i) {
+      indices[i] = static_cast<std::uint8_t>(i * 61U + strips);
+    }
+    const auto physical_from = remap_frame(from, layout, 3);
+    const auto physical_to = remap_frame(to, layout, 3);
+    std::vector<std::uint8_t> logical_rgb(to.size());
+    ledgrid::expand_indexed_frame(
+        indices.data(), indices.size(), palette.data(), logical_rgb.data());
+    // Unmapped pixels are dark, not palette entry 0.
+    const auto physical_rgb = remap_frame(logical_rgb, layout, 3);
+
+    const std::size_t encoded_size = ledgrid::parallel_encoded_size(strips, kLeds);
+    std::vector<std::uint8_t> waveform(encoded_size);
+    TEST_ASSERT_TRUE(ledgrid::initialize_parallel_grb_waveform(
+        strips, kLeds, waveform.data(), waveform.size()));
+    std::vector<std::uint8_t> chunk(ledgrid::parallel_encoded_size(strips, 4, 0));
+    TEST_ASSERT_TRUE(ledgrid::initialize_parallel_grb_waveform(
+        strips, 4, chunk.data(), chunk.size(), 0));
+    const std::size_t chunk_offset = ledgrid::parallel_encoded_size(strips, 1, 0);
+
+    for (const bool uniform_tables : {true, false}) {
+      const auto* curves = uniform_tables ? uniform_curves.get() : lane_curves.get();
+      ledgrid::build_parallel_expand_tables(curves, 200, &tables);
+      ledgrid::build_palette_expand_rows(
+          curves, uniform_tables, palette.data(), 200, strips, rows.data());
+      const auto kernels = ledgrid::select_parallel_encode_kernels(
+          strips, uniform_tables, ledgrid::EncoderKernel::Transpose);
+      const auto& kernel_tables = uniform_tables ? uniform : tables;
+      for (const std::uint16_t weight : {0, 97, 256}) {
+        const std::uint8_t* blend_from = weight == 0 ? nullptr : from.data();
+        auto expected = waveform;
+        auto actual = waveform;
+        TEST_ASSERT_TRUE(ledgrid::encode_parallel_grb_kernel_span(
+            kernels, kernel_tables, weight == 0 ? nullptr : physical_from.data(),
+            physical_to.data(), physical_to.size(), strips, kLeds, weight, 1, 5,
+            expected.data(), expected.size()).ok);
+        TEST_ASSERT_TRUE(ledgrid::encode_parallel_grb_mapped_span(
+            kernels, kernel_tables, layout.data(), blend_from, to.data(),
+            to.size(), strips, kLeds, weight, 1, 5, actual.data(),
+            actual.size()).ok);
+        TEST_ASSERT_EQUAL_MEMORY(expected.data(), actual.data(), encoded_size);
+
+        const auto encoded = ledgrid::encode_parallel_grb_mapped_chunk(
+            kernels, kernel_tables, layout.data(), blend_from, to.data(),
+            to.size(), strips, kLeds, weight, 1, 5, chunk.data(), chunk.size());
+        TEST_ASSERT_TRUE(encoded.ok);
+        TEST_ASSERT_EQUAL_MEMORY(
+            expected.data() + chunk_offset, chunk.data(), encoded.bytes_written);
+      }
+
+      auto expected = waveform;
+      auto actual = waveform;
+      TEST_ASSERT_TRUE(ledgrid::encode_parallel_grb_table_span(
+          tables, physical_rgb.data(), physical_rgb.size(), strips, kLeds, 0,
+          kLeds, expected.data(), expected.size()).ok);
+      TEST_ASSERT_TRUE(ledgrid::encode_parallel_grb_mapped_indexed_span(
+          kernels, rows.data(), layout.data(), indices.data(), indices.size(),
+          strips, kLeds, 0, kLeds, actual.data(), actual.size()).ok);
+      TEST_ASSERT_EQUAL_MEMORY(expected.data(), actual.data(), encoded_size);
+
+      const auto encoded = ledgrid::encode_parallel_grb_mapped_indexed_chunk(
+          kernels, rows.data(), layout.data(), indices.data(), indices.size(),
+          strips, kLeds, 1, 5, chunk.data(), chunk.size());
+      TEST_ASSERT_TRUE(encoded.ok);
+      TEST_ASSERT_EQUAL_MEMORY(
+          expected.data() + chunk_offset, chunk.data(), encoded.bytes_written);
+    }
+
+    // Power totals follow the map, so strip limits see the physical strips.
+    ledgrid::ChannelTotals mapped;
+    ledgrid::ChannelTotals remapped;
+    TEST_ASSERT_TRUE(ledgrid::total_rgb_channels(
+        lane_curves.get(), to.data(), to.size(), strips, kLeds, &mapped,
+        layout.data()));
+    TEST_ASSERT_TRUE(ledgrid::total_rgb_channels(
+        lane_curves.get(), physical_to.data(), physical_to.size(), strips, kLeds,
+        &remapped));
+    TEST_ASSERT_EQUAL_MEMORY(&remapped.sum, &mapped.sum, sizeof(mapped.sum));
+    TEST_ASSERT_TRUE(ledgrid::total_indexed_channels(
+        lane_curves.get(), indices.data(), indices.size(), palette.data(), strips,
+        kLeds, &mapped, layout.data()));
+    TEST_ASSERT_TRUE(ledgrid::total_rgb_channels(
+        lane_curves.get(), physical_rgb.data(), physical_rgb.size(), strips, kLeds,
+        &remapped));
+    TEST_ASSERT_EQUAL_MEMORY(&remapped.sum, &mapped.sum, sizeof(mapped.sum));
+  }
+}
+
+void test_frame_memory_plan_moves_large_frames_to_psram() {
+  const auto factory = ledgrid::plan_frame_memory(8, 140, true);
+  TEST_ASSERT_EQUAL_UINT32(8U * 140U * 3U, factory.rgb_bytes);
+  TEST_ASSERT_EQUAL_UINT32(3392, factory.spi_buffer_bytes);
+  TEST_ASSERT_TRUE(factory.zero_copy_mailbox);
+  TEST_ASSERT_TRUE(factory.mailbox_tier == ledgrid::MemoryTier::InternalDma);
+  TEST_ASSERT_TRUE(factory.history_tier == ledgrid::MemoryTier::Internal);
+
+  const auto grown = ledgrid::plan_frame_memory(8, 512, true);
+  TEST_ASSERT_EQUAL_UINT32(0, grown.spi_buffer_bytes % ledgrid::kFrameAlignment);
+  TEST_ASSERT_TRUE(grown.spi_buffer_bytes >= 1U + grown.rgb_bytes + 2U);
+  TEST_ASSERT_FALSE(grown.zero_copy_mailbox);
+  TEST_ASSERT_TRUE(grown.mailbox_tier == ledgrid::MemoryTier::Psram);
+  TEST_ASSERT_TRUE(grown.history_tier == ledgrid::MemoryTier::Psram);
+
+  // Without PSRAM a grown capacity keeps the internal zero-copy layout.
+  const auto internal = ledgrid::plan_frame_memory(8, 512, false);
+  TEST_ASSERT_TRUE(internal.zero_copy_mailbox);
+  TEST_ASSERT_TRUE(internal.mailbox_tier == ledgrid::MemoryTier::InternalDma);
+
+  TEST_ASSERT_TRUE(ledgrid::led_capacity_valid(8, 512));
+  TEST_ASSERT_FALSE(ledgrid::led_capacity_valid(8, 513));
+  TEST_ASSERT_FALSE(ledgrid::led_capacity_valid(8, 0));
+  TEST_ASSERT_EQUAL_UINT32(0, ledgrid::plan_frame_memory(8, 513, true).rgb_bytes);
+}
+
+void test_receiver_sim_shows_every_paced_frame() {
+  ledgrid::ReceiverSimConfig config;
+  config.strip_count = 4;
+  config.leds_per_strip = 60;
+  config.led_capacity = 60;
+  config.cpu_scale = 0;
+  // 2.1 ms per transfer, so 100 frames a second all reach the wall.
+  config.packets_per_s = 100;
+  auto packets = ledgrid::synthesize_frames(config, 30);
+  packets[7].bytes[10] ^= 0x40U;
+
+  const auto result = ledgrid::run_receiver_sim(config, packets);
+  TEST_ASSERT_EQUAL_UINT32(30, result.handled);
+  TEST_ASSERT_EQUAL_UINT32(1, result.crc_errors);
+  TEST_ASSERT_EQUAL_UINT32(0, result.ring_overruns);
+  TEST_ASSERT_EQUAL_UINT32(0, result.display_errors);
+  // The boot frame plus every intact packet.
+  TEST_ASSERT_EQUAL_UINT32(30, result.frames.accepted);
+  TEST_ASSERT_EQUAL_UINT32(30, result.frames.displayed);
+  TEST_ASSERT_EQUAL_UINT32(0, result.frames.superseded);
+  TEST_ASSERT_EQUAL_UINT32(
+      2100, result.stages[static_cast<std::size_t>(ledgrid::LatencyStage::Dma)].max_us);
+  // With no CPU cost the encode lands between transfers and adds nothing.
+  TEST_ASSERT_EQUAL_UINT32(
+      0, result.stages[static_cast<std::size_t>(ledgrid::LatencyStage::Encode)].max_us);
+}
+
+void test_receiver_sim_supersedes_frames_past_the_display_rate() {
+  ledgrid::ReceiverSimConfig config;
+  config.strip_count = 4;
+  config.leds_per_strip = 60;
+  config.led_capacity = 60;
+  config.cpu_scale = 0;
+  const auto packets = ledgrid::synthesize_frames(config, 200);
+
+  // 723-byte packets take 289 us at 20 MHz against a 2.1 ms transfer.
+  for (const bool zero_copy : {true, false}) {
+    config.zero_copy_mailbox = zero_copy;
+    const auto result = ledgrid::run_receiver_sim(config, packets);
+    TEST_ASSERT_EQUAL_UINT32(200, result.handled);
+    TEST_ASSERT_EQUAL_UINT32(0, result.crc_errors);
+    TEST_ASSERT_EQUAL_UINT32(0, result.ring_overruns);
+    TEST_ASSERT_EQUAL_UINT32(201, result.frames.accepted);
+    TEST_ASSERT_EQUAL_UINT32(
+        result.frames.accepted, result.frames.displayed + result.frames.superseded);
+    TEST_ASSERT_TRUE(result.frames.displayed < 40);
+    TEST_ASSERT_TRUE(result.displayed_fps() > 400 && result.displayed_fps() < 480);
+  }
+
+  const std::string line =
+      ledgrid::format_receiver_sim_result("link-limited", config,
+                                          ledgrid::run_receiver_sim(config, packets));
+  TEST_ASSERT_TRUE(line.rfind("{\"suite\":\"ledgrid-receiver-sim\",", 0) == 0);
+  TEST_ASSERT_TRUE(line.find("\"end_to_end_p99_us\":") != std::string::npos);
+  TEST_ASSERT_EQUAL_INT('}', line.back());
+}
+
+class StillClock final : public ledgrid::ReceiverClock {
+ public:
+  std::uint32_t now_us() override { return 0; }
+};
+
+class SilentHooks final : public ledgrid::ReceiverHooks {};
+
+// A display that holds each submitted frame's pixels until the test completes
+// its transfer, as streaming DMA does, so only one frame is ever in flight.
+class SlowDisplay final : public ledgrid::FrameDisplay {
+ public:
+  bool can_submit() const override { return pixels == nullptr; }
+  ledgrid::SubmitResult submit(const std::uint8_t* frame, std::size_t, std::uint8_t,
+                               std::uint16_t, std::uint8_t, std::uint32_t frame_sequence,
+                               ledgrid::PixelSpan, const ledgrid::FrameBlend*,
+                               ledgrid::PixelFormat) override {
+    pixels = frame;
+    sequence = frame_sequence;
+    return ledgrid::SubmitResult::Queued;
+  }
+  bool take_completion(ledgrid::TransferCompletion* completion) override {
+    if (!completed) return false;
+    completed = false;
+    completion->sequence = sequence;
+    return true;
+  }
+  std::uint16_t last_encode_us() const override { return 0; }
+
+  const std::uint8_t* pixels = nullptr;
+  std::uint32_t sequence = 0;
+  bool completed = false;
+};
+
+void fill_set_all_packet(std::uint8_t* packet, std::size_t rgb_bytes, std::uint8_t seed) {
+  packet[0] = ledgrid::kCmdSetAll;
+  for (std::size_t i = 0; i < rgb_bytes; ++i) {
+    packet[ledgrid::kFramePixelOffset + i] = static_cast<std::uint8_t>(seed * 29U + i);
+  }
+  const std::size_t payload = ledgrid::kFramePixelOffset + rgb_bytes;
+  const std::uint16_t crc =
+      ledgrid::crc16_ccitt(ledgrid::Crc16Engine::Nibble, packet, payload);
+  packet[payload] = static_cast<std::uint8_t>(crc >> 8);
+  packet[payload + 1] = static_cast<std::uint8_t>(crc);
+}
+
+void test_zero_copy_set_all_trades_buffers_with_the_mailbox() {
+  constexpr std::size_t kRgbBytes = 2U * 4U * 3U;
+  constexpr std::size_t kPacketBytes =
+      ledgrid::kFramePixelOffset + kRgbBytes + ledgrid::kPacketCrcBytes;
+  // Three mailbox buffers and a four-deep receive ring; a packet lands in
+  // whichever buffer the ring last got back.
+  std::vector<std::array<std::uint8_t, kPacketBytes>> storage(
+      ledgrid::kFrameMailboxSlots + 4U);
+  std::vector<std::uint8_t> working(kRgbBytes);
+  ledgrid::ReceiverBuffers buffers;
+  for (std::size_t slot = 0; slot < ledgrid::kFrameMailboxSlots; ++slot) {
+    buffers.mailbox[slot] = storage[slot].data();
+  }
+  buffers.zero_copy_mailbox = true;
+  buffers.working_frame = working.data();
+  buffers.frame_bytes = kPacketBytes;
+  std::vector<std::uint8_t*> ring;
+  for (std::size_t i = ledgrid::kFrameMailboxSlots; i < storage.size(); ++i) {
+    ring.push_back(storage[i].data());
+  }
+
+  StillClock clock;
+  SlowDisplay display;
+  SilentHooks hooks;
+  ledgrid::ReceiverCore core(clock, display, hooks);
+  core.begin(buffers, 2, 4, ledgrid::Crc16Engine::Nibble);
+
+  std::uint8_t seed = 0;
+  // Receives one SET_ALL into the ring's oldest buffer and returns the buffer
+  // handed back in its place. Every buffer must stay owned exactly once.
+  const auto receive = [&]() {
+    std::uint8_t* packet = ring.front();
+    ring.erase(ring.begin());
+    fill_set_all_packet(packet, kRgbBytes, ++seed);
+    bool valid = false;
+    std::uint8_t* returned = core.handle_packet({packet, kPacketBytes, 0}, &valid);
+    TEST_ASSERT_TRUE(valid);
+    ring.push_back(returned);
+    std::vector<const std::uint8_t*> owned(ring.begin(), ring.end());
+    for (std::size_t slot = 0; slot < ledgrid::kFrameMailboxSlots; ++slot) {
+      owned.push_back(core.mailbox_buffer(slot));
+    }
+    for (std::size_t i = 0; i < owned.size(); ++i) {
+      for (std::size_t j = i + 1; j < owned.size(); ++j) {
+        TEST_ASSERT_TRUE(owned[i] != owned[j]);
+      }
+    }
+    return std::make_pair(packet, returned);
+  };
+  const auto show = [&](ledgrid::FrameMetadata* metadata) {
+    const int slot = core.take_frame(metadata);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, slot);
+    TEST_ASSERT_EQUAL(ledgrid::SubmitResult::Queued,
+                      core.submit_frame(slot, *metadata, metadata->dirty_columns));
+    return slot;
+  };
+
+  // The first frame swaps into a free slot, and the slot's own buffer goes to
+  // the ring. The display then holds it for a slow transfer.
+  const auto first = receive();
+  TEST_ASSERT_TRUE(first.second == storage[0].data());
+  ledgrid::FrameMetadata shown{};
+  const int held = show(&shown);
+  TEST_ASSERT_TRUE(display.pixels == first.first + ledgrid::kFramePixelOffset);
+
+  // Two more fill the free slots, then each later frame supersedes the
+  // newest unread one and its buffer is the next to come back.
+  receive();
+  const auto third = receive();
+  const auto fourth = receive();
+  TEST_ASSERT_TRUE(fourth.second == third.first);
+  const auto fifth = receive();
+  TEST_ASSERT_TRUE(fifth.second == fourth.first);
+  TEST_ASSERT_EQUAL_UINT32(2, core.mailbox().counters().superseded);
+  // None of that touched the frame on the wire.
+  TEST_ASSERT_TRUE(core.mailbox_buffer(held) == first.first);
+  for (const std::uint8_t* buffer : ring) TEST_ASSERT_TRUE(buffer != first.first);
+
+  display.completed = true;
+  core.retire_completed_transfers();
+  core.finish_frame(held, shown, true);
+  display.pixels = nullptr;
+
+  // The next read takes the newest frame, in place, and supersedes the other.
+  const int newest = show(&shown);
+  TEST_ASSERT_TRUE(display.pixels == fifth.first + ledgrid::kFramePixelOffset);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(fifth.first + ledgrid::kFramePixelOffset,
+                                core.mailbox_buffer(newest) + ledgrid::kFramePixelOffset,
+                                kRgbBytes);
+  // The released slot is free again, and its buffer finally reaches the ring.
+  const auto sixth = receive();
+  TEST_ASSERT_TRUE(sixth.second == first.first);
+  display.completed = true;
+  core.retire_completed_transfers();
+  core.finish_frame(newest, shown, true);
+
+  const auto counters = core.mailbox().counters();
+  TEST_ASSERT_EQUAL_UINT32(6, counters.accepted);
+  TEST_ASSERT_EQUAL_UINT32(2, counters.displayed);
+  TEST_ASSERT_EQUAL_UINT32(3, counters.superseded);
+  TEST_ASSERT_EQUAL_UINT32(0, counters.publish_drops);
+  TEST_ASSERT_EQUAL_UINT32(5, core.last_displayed_sequence());
+}
+
+#if LEDGRID_MAX_LANES > 8
+void test_sixteen_lane_samples_interleave_two_eight_lane_encodings() {
+  constexpr std::uint16_t kLeds = 3;
+  TEST_ASSERT_EQUAL_UINT8(1, ledgrid::ws2812_sample_bytes(8));
+  TEST_ASSERT_EQUAL_UINT8(2, ledgrid::ws2812_sample_bytes(9));
+  TEST_ASSERT_EQUAL_UINT32(
+      2U * ledgrid::ws2812_encoded_size(kLeds),
+      ledgrid::parallel_encoded_size(16, kLeds));
+
+  for (const std::uint8_t strips : {12, 16}) {
+    std::vector<std::uint8_t> rgb(strips * kLeds * 3U);
+    for (std::size_t i = 0; i < rgb.size(); ++i) {
+      rgb[i] = static_cast<std::uint8_t>(i * 67U + 5U);
+    }
+    std::vector<std::uint8_t> wide(ledgrid::parallel_encoded_size(strips, kLeds));
+    TEST_ASSERT_TRUE(ledgrid::encode_parallel_grb(
+        rgb.data(), rgb.size(), strips, kLeds, 77, wide.data(), wide.size()).ok);
+
+    // Low bytes are lanes 0-7 and high bytes lanes 8 upwards, each exactly as
+    // an eight-lane receiver would encode them.
+    const std::uint8_t high_strips = strips - 8U;
+    const std::size_t narrow_size = ledgrid::ws2812_encoded_size(kLeds);
+    std::vector<std::uint8_t> low(narrow_size);
+    std::vector<std::uint8_t> high(narrow_size);
+    TEST_ASSERT_TRUE(ledgrid::encode_parallel_grb(
+        rgb.data(), 8U * kLeds * 3U, 8, kLeds, 77, low.data(), low.size()).ok);
+    TEST_ASSERT_TRUE(ledgrid::encode_parallel_grb(
+        rgb.data() + 8U * kLeds * 3U, high_strips * kLeds * 3U, high_strips,
+        kLeds, 77, high.data(), high.size()).ok);
+    for (std::size_t sample = 0; sample < narrow_size; ++sample) {
+      TEST_ASSERT_EQUAL_HEX8(low[sample], wide[sample * 2U]);
+      TEST_ASSERT_EQUAL_HEX8(high[sample], wide[sample * 2U + 1U]);
+    }
+  }
 }
+#endif
 
 }  // namespace
 
@@ -191,8 +2156,45 @@ int main(int, char**) {
   RUN_TEST(test_encoder_emits_parallel_grb_waveform);
   RUN_TEST(test_encoder_scales_brightness_before_bit_expansion);
   RUN_TEST(test_optimized_encoder_updates_all_eight_lanes);
+  RUN_TEST(test_span_encoder_matches_full_reencode);
   RUN_TEST(test_encoder_appends_300us_reset_and_rejects_bad_bounds);
   RUN_TEST(test_mailbox_replaces_only_unread_ready_frames);
+  RUN_TEST(test_mailbox_counts_released_frames_when_displayed);
+  RUN_TEST(test_mailbox_merges_dirty_columns_of_superseded_frames);
+  RUN_TEST(test_ordered_mailbox_reads_oldest_first_and_drops_on_overflow);
+  RUN_TEST(test_mailbox_hands_off_lock_free_across_threads);
+  RUN_TEST(test_effect_engine_renders_palette_fields_across_the_wall);
+  RUN_TEST(test_latency_histogram_buckets_by_powers_of_two);
+  RUN_TEST(test_crc_engines_match_reference);
   RUN_TEST(test_status_v2_layout_is_stable);
+  RUN_TEST(test_status_v3_pages_share_a_header_and_truncate);
+  RUN_TEST(test_batch_reader_walks_sixteen_bit_ranges);
+  RUN_TEST(test_batch_validation_rejects_malformed_ops);
+  RUN_TEST(test_rle_frame_decodes_runs_and_literals);
+  RUN_TEST(test_xor_delta_touches_only_changed_columns);
+  RUN_TEST(test_compressed_frames_reject_bad_coverage_without_writing);
+  RUN_TEST(test_frame_assembler_publishes_only_whole_frames);
+  RUN_TEST(test_frame_assembler_recovers_chunks_that_fail_their_crc);
+  RUN_TEST(test_clip_store_holds_clips_or_a_recording);
+  RUN_TEST(test_clip_player_keeps_each_frame_duration);
+  RUN_TEST(test_power_limit_scales_brightness_into_budget);
+  RUN_TEST(test_blend_encoder_matches_encode_of_blended_frame);
+  RUN_TEST(test_transition_weights_reach_target_and_ease);
+  RUN_TEST(test_changed_columns_spans_every_lane);
+  RUN_TEST(test_split_columns_covers_the_span_in_order);
+  RUN_TEST(test_table_encoder_bakes_curves_and_brightness);
+  RUN_TEST(test_specialized_kernels_match_table_encoders);
+  RUN_TEST(test_lane_transpose_matches_expansion);
+  RUN_TEST(test_chunked_encode_concatenates_to_full_frame);
+  RUN_TEST(test_indexed_kernels_match_expanded_rgb);
+  RUN_TEST(test_layout_map_validates_entries);
+  RUN_TEST(test_mapped_encoders_match_remapped_frames);
+  RUN_TEST(test_frame_memory_plan_moves_large_frames_to_psram);
+  RUN_TEST(test_receiver_sim_shows_every_paced_frame);
+  RUN_TEST(test_receiver_sim_supersedes_frames_past_the_display_rate);
+  RUN_TEST(test_zero_copy_set_all_trades_buffers_with_the_mailbox);
+#if LEDGRID_MAX_LANES > 8
+  RUN_TEST(test_sixteen_lane_samples_interleave_two_eight_lane_encodings);
+#endif
   return UNITY_END();
 }
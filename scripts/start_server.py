@@ -56,6 +56,18 @@ def device_count_for_strips(strip_count: int, strips_per_device: int = 8) -> int
     return max(1, (max(1, strip_count) + strips_per_device - 1) // strips_per_device)
 
 
+def parse_stripe_map(value: str):
+    """Parse ``--stripe-map``: one BUS.DEV per device, or '-' for none."""
+    entries = []
+    for part in filter(None, (item.strip() for item in value.split(','))):
+        if part == '-':
+            entries.append(None)
+            continue
+        bus, _, device = part.partition('.')
+        entries.append((int(bus), int(device)))
+    return entries
+
+
 def run_controller_mode(args):
     """Controller process: drives LEDs and writes status/frames to disk."""
     saved_state = None
@@ -69,7 +81,8 @@ def run_controller_mode(args):
     # Multi-device controller expects total strips, single-device expects strips per device
     if hasattr(LEDController, '__name__') and 'Multi' in LEDController.__name__:
         # Multi-device controller - calculate number of devices from strip count
-        strips_per_device = 8  # ESP32-S3 DevKitC has 8 strips
+        # ESP32-S3 DevKitC drives 8 strips, or 16 with LANES=16 firmware
+        strips_per_device = args.strips_per_device
         num_devices = device_count_for_strips(args.strips, strips_per_device)
         controller = LEDController(
             num_devices=num_devices,
@@ -80,6 +93,7 @@ def run_controller_mode(args):
             leds_per_strip=args.leds_per_strip,
             debug=args.controller_debug,
             parallel=True,
+            stripe_map=parse_stripe_map(args.stripe_map),
         )
     else:
         # Single-device or mock controller
@@ -115,6 +129,70 @@ def run_controller_mode(args):
         except Exception as exc:
             print(f"⚠️ Failed to set controller brightness to {args.brightness}: {exc}")
 
+    if args.keyframe_ms > 0 and hasattr(controller, "set_transition"):
+        try:
+            controller.set_transition(args.keyframe_ms, args.keyframe_easing)
+            print(f"  Keyframes  : {args.keyframe_ms} ms ({args.keyframe_easing})")
+        except Exception as exc:
+            print(f"⚠️ Failed to enable keyframe interpolation: {exc}")
+
+    gains = tuple(float(part) for part in args.white_balance.split(','))
+    if (args.gamma != 1.0 or gains != (1.0, 1.0, 1.0)) and hasattr(controller, "set_color_correction"):
+        try:
+            controller.set_color_correction(args.gamma, gains)
+            print(f"  Colour     : gamma {args.gamma}, white balance {gains}")
+        except Exception as exc:
+            print(f"⚠️ Failed to set receiver colour correction: {exc}")
+
+    if (args.power_budget_ma > 0 or args.strip_power_budget_ma > 0) and hasattr(controller, "set_power_budget"):
+        try:
+            controller.set_power_budget(args.power_budget_ma, args.strip_power_budget_ma)
+            print(f"  Power      : {args.power_budget_ma} mA per receiver, {args.strip_power_budget_ma} mA per strip")
+        except Exception as exc:
+            print(f"⚠️ Failed to set the receiver power budget: {exc}")
+
+    if args.chunked_frames and hasattr(controller, "set_chunked_frames"):
+        try:
+            controller.set_chunked_frames(True)
+            print("  Framing    : a CRC per strip; corrupted strips are resent")
+        except Exception as exc:
+            print(f"⚠️ Failed to enable chunked frames: {exc}")
+
+    if args.credit_flow and hasattr(controller, "set_credit_flow"):
+        try:
+            controller.set_credit_flow(True)
+            print("  Flow       : one frame per receiver display slot")
+        except Exception as exc:
+            print(f"⚠️ Failed to enable credit flow: {exc}")
+
+    if args.capture_spi and hasattr(controller, "set_spi_capture"):
+        try:
+            controller.set_spi_capture(args.capture_spi)
+            print(f"  Capture    : SPI transfers to {args.capture_spi}")
+        except Exception as exc:
+            print(f"⚠️ Failed to start the SPI capture: {exc}")
+
+    if args.latch != 'off' and hasattr(controller, "set_latch_mode"):
+        try:
+            controller.set_latch_mode(args.latch)
+            print(f"  Latch      : {args.latch}")
+        except Exception as exc:
+            print(f"⚠️ Failed to enable the receiver frame latch: {exc}")
+
+    if args.paced_fps > 0 and hasattr(controller, "set_pacing"):
+        try:
+            controller.set_pacing(args.paced_fps, args.jitter_frames)
+            print(f"  Pacing     : {args.paced_fps} fps, {args.jitter_frames} frame jitter buffer")
+        except Exception as exc:
+            print(f"⚠️ Failed to enable paced presentation: {exc}")
+
+    if args.latency_histograms and hasattr(controller, "enable_latency_histograms"):
+        try:
+            controller.enable_latency_histograms()
+            print("  Histograms : receiver latency stages")
+        except Exception as exc:
+            print(f"⚠️ Failed to enable receiver latency histograms: {exc}")
+
     channel = FileControlChannel(control_path=args.control_file, status_path=args.status_file)
 
     print("🎛️ Controller mode")
@@ -333,6 +411,41 @@ def main():
                         help=f'Target animation FPS (default: 200; tuned for {DEFAULT_LEDS_PER_STRIP}-pixel WS2812 strips)')
     parser.add_argument('--brightness', type=int, default=50,
                         help='Global hardware brightness 0-255 (default: 50)')
+    parser.add_argument('--strips-per-device', type=int, choices=(8, 16), default=8,
+                        help='Strips driven by each receiver; 16 needs LANES=16 firmware (default: 8)')
+    parser.add_argument('--keyframe-ms', type=int, default=0,
+                        help='Receiver interpolates to each frame over this many ms; pair with a lower --target-fps (default: 0, off)')
+    parser.add_argument('--keyframe-easing', choices=('linear', 'ease-in-out'), default='linear',
+                        help='Easing for --keyframe-ms interpolation (default: linear)')
+    parser.add_argument('--gamma', type=float, default=1.0,
+                        help='Receiver-side output gamma, e.g. 2.2 (default: 1.0, linear)')
+    parser.add_argument('--white-balance', default='1,1,1',
+                        help='Receiver-side R,G,B gains applied after gamma (default: 1,1,1)')
+    parser.add_argument('--power-budget-ma', type=int, default=0,
+                        help='Each receiver dims frames whose estimated draw exceeds this many mA (default: 0, off)')
+    parser.add_argument('--strip-power-budget-ma', type=int, default=0,
+                        help='Each receiver dims frames that would draw more than this many mA on any strip (default: 0, off)')
+    parser.add_argument('--chunked-frames', action='store_true',
+                        help='Send full frames with a CRC per strip, so a bit error on a fast SPI clock '
+                             'costs one strip resend rather than the frame')
+    parser.add_argument('--credit-flow', action='store_true',
+                        help='Render and send each frame for the next receiver display slot, so none '
+                             'is superseded; --target-fps still caps the rate')
+    parser.add_argument('--capture-spi', metavar='PATH', default='',
+                        help='Record every SPI transfer with its timing for the firmware receiver_sim; '
+                             'with several receivers, receiver N records to PATH.N')
+    parser.add_argument('--latch', choices=('off', 'command', 'gpio'), default='off',
+                        help='Stage frames on every receiver and start them together on a broadcast LATCH '
+                             'or the shared latch pin (default: off)')
+    parser.add_argument('--paced-fps', type=int, default=0,
+                        help='Receivers present frames in order at this fixed rate; pair with the same '
+                             '--target-fps (default: 0, show frames as they arrive)')
+    parser.add_argument('--stripe-map', default='',
+                        help="Second SPI link of each DUAL_SPI=1 receiver as BUS.DEV, comma-separated, '-' for none (e.g. 1.0,1.1)")
+    parser.add_argument('--jitter-frames', type=int, choices=(1, 2, 3), default=2,
+                        help='Frames each receiver buffers before --paced-fps presentation starts (default: 2)')
+    parser.add_argument('--latency-histograms', action='store_true',
+                        help='Collect per-stage receiver latency histograms into controller stats')
     parser.add_argument('--animation-speed-scale', type=float, default=DEFAULT_ANIMATION_SPEED_SCALE,
                         help=f'Multiplier applied to animation speed parameters (default: {DEFAULT_ANIMATION_SPEED_SCALE})')
     parser.add_argument('--poll-interval', type=float, default=0.05,
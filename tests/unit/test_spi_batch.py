@@ -0,0 +1,91 @@
+import sys
+import types
+import unittest
+
+
+if "spidev" not in sys.modules:
+    spidev_stub = types.ModuleType("spidev")
+    spidev_stub.SpiDev = object
+    sys.modules["spidev"] = spidev_stub
+
+from drivers.spi_controller import (
+    CMD_BATCH,
+    CMD_SET_PIXEL,
+    CMD_SET_RANGE,
+    CMD_SHOW,
+    LEDController,
+    MAX_SPI_TRANSFER,
+    RECEIVER_CAPABILITY_BATCH,
+)
+
+
+class RecordingController(LEDController):
+    def __init__(self, total_leds=1104, capabilities=RECEIVER_CAPABILITY_BATCH):
+        self.total_leds = total_leds
+        self._receiver_capabilities = capabilities
+        self.packets = []
+
+    def _xfer(self, payload):
+        self.packets.append(bytes(payload))
+
+    def _refresh_configuration(self, force=False):
+        pass
+
+
+def _colors(count):
+    return [(index & 0xFF, (index >> 8) & 0xFF, 7) for index in range(count)]
+
+
+class SpiBatchTests(unittest.TestCase):
+    def test_packs_sparse_ranges_into_one_packet_with_trailing_show(self):
+        controller = RecordingController()
+        colors = _colors(controller.total_leds)
+
+        controller._send_partial_batches(colors, [(10, 11), (300, 600)])
+
+        self.assertEqual(len(controller.packets), 1)
+        packet = controller.packets[0]
+        self.assertEqual(packet[0], CMD_BATCH)
+        self.assertEqual(packet[1:4], bytes((CMD_SET_PIXEL, 0, 10)))
+        self.assertEqual(packet[4:7], bytes((10, 0, 7)))
+        # Range counts are 16-bit, so 300 pixels need a single op.
+        self.assertEqual(packet[7:12], bytes((CMD_SET_RANGE, 0x01, 0x2C, 0x01, 0x2C)))
+        self.assertEqual(len(packet), 12 + 300 * 3 + 1)
+        self.assertEqual(packet[-1], CMD_SHOW)
+
+    def test_splits_packets_at_frame_size_and_shows_only_at_end(self):
+        controller = RecordingController()
+        colors = _colors(controller.total_leds)
+
+        controller._send_partial_batches(colors, [(0, controller.total_leds)])
+
+        payload_limit = 1 + controller.total_leds * 3
+        self.assertEqual(len(controller.packets), 2)
+        for packet in controller.packets:
+            self.assertEqual(packet[0], CMD_BATCH)
+            self.assertLessEqual(len(packet), payload_limit)
+        self.assertNotEqual(controller.packets[0][-1], CMD_SHOW)
+        self.assertEqual(controller.packets[-1][-1], CMD_SHOW)
+
+    def test_sixteen_lane_frames_use_batches_within_the_transfer_limit(self):
+        controller = RecordingController(total_leds=16 * 138)
+        controller._frames_sent = 0
+        controller._last_frame_duration = 0.0
+        controller._total_frame_duration = 0.0
+
+        controller.set_all_pixels(_colors(controller.total_leds))
+
+        self.assertGreater(len(controller.packets), 1)
+        for packet in controller.packets:
+            self.assertEqual(packet[0], CMD_BATCH)
+            self.assertLessEqual(len(packet), MAX_SPI_TRANSFER - 2)
+        self.assertEqual(controller.packets[-1][-1], CMD_SHOW)
+        self.assertEqual(controller._frames_sent, 1)
+
+    def test_requires_advertised_capability(self):
+        self.assertTrue(RecordingController().supports_batch())
+        self.assertFalse(RecordingController(capabilities=0).supports_batch())
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,84 @@
+import os
+import sys
+import tempfile
+import types
+import unittest
+
+
+if "spidev" not in sys.modules:
+    spidev_stub = types.ModuleType("spidev")
+    spidev_stub.SpiDev = object
+    sys.modules["spidev"] = spidev_stub
+
+from drivers.spi_controller import (
+    CMD_SET_BRIGHTNESS,
+    SPI_CAPTURE_LINK_PRIMARY,
+    SPI_CAPTURE_LINK_STRIPE,
+    SPI_CAPTURE_MAGIC,
+    LEDController,
+)
+
+
+class Link:
+    def __init__(self):
+        self.sent = []
+
+    def xfer2(self, data):
+        self.sent.append(bytes(data))
+        return [0] * len(data)
+
+
+class CapturingController(LEDController):
+    def __init__(self):
+        self.debug = False
+        self.spi = Link()
+        self.stripe_spi = Link()
+        self._bytes_sent = 0
+        self._spi_transfers = 0
+        self._stripe_bytes_sent = 0
+        self._errors = 0
+
+    def _update_receiver_status(self, response):
+        pass
+
+
+def read_capture(path):
+    with open(path, "rb") as handle:
+        data = handle.read()
+    assert data[:len(SPI_CAPTURE_MAGIC)] == SPI_CAPTURE_MAGIC
+    records = []
+    offset = len(SPI_CAPTURE_MAGIC)
+    while offset < len(data):
+        start_us = int.from_bytes(data[offset:offset + 4], "big")
+        link = data[offset + 4]
+        length = int.from_bytes(data[offset + 5:offset + 9], "big")
+        offset += 9
+        records.append((start_us, link, data[offset:offset + length]))
+        offset += length
+    return records
+
+
+class SpiCaptureTest(unittest.TestCase):
+    def test_transfers_on_both_links_are_recorded_in_order(self):
+        controller = CapturingController()
+        with tempfile.TemporaryDirectory() as directory:
+            path = os.path.join(directory, "wall.spicap")
+            controller.set_spi_capture(path)
+            controller._xfer_raw(bytearray([CMD_SET_BRIGHTNESS, 40, 0, 0]))
+            controller._xfer_stripe(bytearray([0x17, 1, 2, 3, 0, 0]))
+            controller.set_spi_capture(None)
+            controller._xfer_raw(bytearray([CMD_SET_BRIGHTNESS, 41, 0, 0]))
+
+            records = read_capture(path)
+        self.assertEqual(len(records), 2)
+        self.assertEqual(records[0][1], SPI_CAPTURE_LINK_PRIMARY)
+        self.assertEqual(records[0][2], controller.spi.sent[0])
+        self.assertEqual(records[1][1], SPI_CAPTURE_LINK_STRIPE)
+        # The stripe record carries the CRC filled in just before sending.
+        self.assertEqual(records[1][2], controller.stripe_spi.sent[0])
+        self.assertLessEqual(records[0][0], records[1][0])
+        self.assertEqual(len(controller.spi.sent), 2)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,134 @@
+import sys
+import types
+import unittest
+
+
+if "spidev" not in sys.modules:
+    spidev_stub = types.ModuleType("spidev")
+    spidev_stub.SpiDev = object
+    sys.modules["spidev"] = spidev_stub
+
+from drivers.spi_controller import (
+    CMD_SET_ALL_CHUNKED,
+    FRAME_CHUNK_HEADER_BYTES,
+    RECEIVER_FRAME_FORMAT_CHUNKED,
+    RECEIVER_STATUS_BYTES_V2_CHUNKS,
+    LEDController,
+    _crc16_ccitt,
+)
+
+
+def v2_status(sequence, missing, crc_errors=0, recovered=0):
+    response = bytearray(RECEIVER_STATUS_BYTES_V2_CHUNKS)
+    response[0:4] = b"LGS2"
+    response[4] = 2
+    response[92] = 0xFF
+    response[180:182] = sequence.to_bytes(2, "big")
+    response[182:184] = missing.to_bytes(2, "big")
+    response[184:188] = crc_errors.to_bytes(4, "big")
+    response[188:192] = recovered.to_bytes(4, "big")
+    return response
+
+
+class RecordingController(LEDController):
+    def __init__(self, strips=4, leds_per_strip=20):
+        self.debug = False
+        self.sent = []
+        self.responses = []
+        self.strip_count = strips
+        self.leds_per_strip = leds_per_strip
+        self.total_leds = strips * leds_per_strip
+        self._effect_command = None
+        self._clip_command = None
+        self._compressed_base = None
+        self._receiver_config = {'frame_formats': RECEIVER_FRAME_FORMAT_CHUNKED}
+        self._status_page = 0
+        self._chunked_frames = False
+        self._chunk_sequence = 0
+        self._chunk_frame = None
+        self._receiver_chunks = None
+        self._chunked_frames_sent = 0
+        self._chunks_resent = 0
+        self._frames_sent = 0
+        self._total_frame_duration = 0.0
+        self._latency_histogram_rotation = False
+
+    def _refresh_configuration(self, force=False):
+        pass
+
+    def _xfer_raw(self, buf):
+        self.sent.append(bytes(buf))
+        if self.responses:
+            self._update_receiver_status(self.responses.pop(0))
+
+
+def strips_of(packet, leds_per_strip):
+    """(strip mask, [(rgb, crc ok)]) of a CMD_SET_ALL_CHUNKED packet."""
+    mask = (packet[3] << 8) | packet[4]
+    chunk = leds_per_strip * 3
+    offset = 1 + FRAME_CHUNK_HEADER_BYTES
+    chunks = []
+    for _ in range(bin(mask).count('1')):
+        rgb = packet[offset:offset + chunk]
+        crc = (packet[offset + chunk] << 8) | packet[offset + chunk + 1]
+        chunks.append((rgb, crc == _crc16_ccitt(rgb)))
+        offset += chunk + 2
+    return mask, chunks
+
+
+class ChunkedFrameTest(unittest.TestCase):
+    def test_frames_carry_a_crc_per_strip(self):
+        controller = RecordingController()
+        colors = [(i, i + 1, i + 2) for i in range(controller.total_leds)]
+        controller.set_chunked_frames()
+        controller.set_all_pixels(colors)
+        packet = controller.sent[-1]
+        self.assertEqual(packet[:5], bytes([CMD_SET_ALL_CHUNKED, 0, 1, 0, 0x0F]))
+        header_crc = _crc16_ccitt(packet[1:5])
+        self.assertEqual(packet[5:7], bytes([header_crc >> 8, header_crc & 0xFF]))
+        mask, chunks = strips_of(packet, controller.leds_per_strip)
+        rgb = bytes(channel for pixel in colors for channel in pixel)
+        self.assertEqual(b''.join(chunk for chunk, _ in chunks), rgb)
+        self.assertTrue(all(ok for _, ok in chunks))
+        self.assertEqual(len(packet), 1 + FRAME_CHUNK_HEADER_BYTES + 4 * (60 + 2))
+
+        # Receivers that do not advertise the format keep getting SET_ALL.
+        controller._receiver_config = None
+        self.assertFalse(controller.supports_chunked_frames())
+
+    def test_only_missing_strips_are_resent(self):
+        controller = RecordingController()
+        controller.set_chunked_frames()
+        frame = bytes((i * 3) & 0xFF for i in range(controller.total_leds * 3))
+        controller.set_all_pixels(list(zip(frame[0::3], frame[1::3], frame[2::3])))
+        self.assertEqual(controller.recover_chunked_frame(), 0)
+
+        # A report about an older frame is not acted on.
+        controller._update_receiver_status(v2_status(0, 0x0F))
+        self.assertEqual(controller.recover_chunked_frame(), 0)
+
+        controller._update_receiver_status(v2_status(1, 0x0A, crc_errors=2))
+        self.assertEqual(controller.recover_chunked_frame(), 2)
+        resend = controller.sent[-1]
+        self.assertEqual(resend[:5], bytes([CMD_SET_ALL_CHUNKED, 0, 1, 0, 0x0A]))
+        _, chunks = strips_of(resend, controller.leds_per_strip)
+        lane = controller.leds_per_strip * 3
+        self.assertEqual([chunk for chunk, _ in chunks],
+                         [frame[lane:2 * lane], frame[3 * lane:4 * lane]])
+        # Short resends are padded so the reply carries the chunk tail.
+        self.assertGreaterEqual(len(resend), RECEIVER_STATUS_BYTES_V2_CHUNKS)
+
+        # The same frame again repairs rather than resends, until the receiver
+        # reports it whole.
+        controller.set_all_pixels(list(zip(frame[0::3], frame[1::3], frame[2::3])))
+        self.assertEqual(controller.sent[-1][:5], resend[:5])
+        controller._update_receiver_status(v2_status(1, 0, recovered=1))
+        controller.set_all_pixels(list(zip(frame[0::3], frame[1::3], frame[2::3])))
+        self.assertEqual(controller.sent[-1][:5], bytes([CMD_SET_ALL_CHUNKED, 0, 2, 0, 0x0F]))
+        self.assertEqual(controller._chunks_resent, 4)
+        self.assertEqual(controller._chunked_frames_sent, 2)
+        self.assertEqual(controller._receiver_chunks['frames_recovered'], 1)
+
+
+if __name__ == "__main__":
+    unittest.main()
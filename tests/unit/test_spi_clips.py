@@ -0,0 +1,153 @@
+import sys
+import types
+import unittest
+
+
+if "spidev" not in sys.modules:
+    spidev_stub = types.ModuleType("spidev")
+    spidev_stub.SpiDev = object
+    sys.modules["spidev"] = spidev_stub
+
+from drivers.spi_controller import (
+    CLIP_READBACK_INDEXED,
+    CLIP_READBACK_VALID,
+    CMD_CLIP_FRAME,
+    CMD_CLIP_PLAY,
+    CMD_READ_RECORDER,
+    CMD_SELECT_STATUS_PAGE,
+    CMD_SET_RECORDER,
+    MAX_PIXELS_PER_CLIP_SLICE,
+    RECEIVER_FRAME_FORMAT_CLIPS,
+    STATUS_PAGE_BYTES,
+    STATUS_PAGES,
+    LEDController,
+)
+
+
+CLIPS_PAGE = STATUS_PAGES.index('clips')
+CLIPS_PAGE_BYTES = STATUS_PAGE_BYTES[CLIPS_PAGE]
+
+
+def clips_page(back=0, offset=0, readback=b'', flags=CLIP_READBACK_VALID, sequence=0):
+    response = bytearray(CLIPS_PAGE_BYTES)
+    response[0:4] = b"LGS3"
+    response[4] = 3
+    response[5] = CLIPS_PAGE
+    response[6] = len(STATUS_PAGES)
+    response[12:14] = (CLIPS_PAGE_BYTES - 16).to_bytes(2, "big")
+    response[16:18] = (600).to_bytes(2, "big")
+    response[19] = flags
+    response[46:48] = back.to_bytes(2, "big")
+    response[48:52] = sequence.to_bytes(4, "big")
+    response[56:60] = offset.to_bytes(4, "big")
+    response[60:62] = len(readback).to_bytes(2, "big")
+    response[64:64 + len(readback)] = readback
+    return response
+
+
+class RecordingController(LEDController):
+    def __init__(self, total_leds=4):
+        self.debug = False
+        self.sent = []
+        self.total_leds = total_leds
+        self._effect_command = None
+        self._compressed_base = None
+        self._status_page = 0
+        self._receiver_clips = None
+        self._clip_command = None
+        self._clip_frames = 0
+        self._recorder_enabled = False
+        self._frames_sent = 0
+        self._total_frame_duration = 0.0
+        self.responses = []
+
+    def _refresh_configuration(self, force=False):
+        pass
+
+    def _xfer(self, data):
+        self.sent.append(bytes(data))
+        if self.responses:
+            self._update_receiver_status(self.responses.pop(0))
+
+
+class ClipStoreTest(unittest.TestCase):
+    def test_upload_slices_frames_and_stops_playback_first(self):
+        total = MAX_PIXELS_PER_CLIP_SLICE + 2
+        controller = RecordingController(total_leds=total)
+        controller.play_clip(0, 3)
+        frames = [[(1, 2, 3)] * total, bytes(3)]
+        self.assertEqual(controller.upload_clip(frames, [40, 70000], first_index=5), 2)
+
+        self.assertEqual(controller.sent[1], bytes([CMD_CLIP_PLAY, 0, 0, 0, 0]))
+        first, second, short = controller.sent[2:5]
+        self.assertEqual(first[:7], bytes([CMD_CLIP_FRAME, 0, 5, 0, 40, 0, 0]))
+        self.assertEqual(len(first), 7 + MAX_PIXELS_PER_CLIP_SLICE * 3)
+        start = MAX_PIXELS_PER_CLIP_SLICE
+        self.assertEqual(second[:7], bytes([CMD_CLIP_FRAME, 0, 5, 0, 40, start >> 8, start & 0xFF]))
+        self.assertEqual(second[7:], bytes([1, 2, 3]) * 2)
+        # Durations saturate at the u16 field; short frames are padded black.
+        self.assertEqual(short[:7], bytes([CMD_CLIP_FRAME, 0, 6, 0xFF, 0xFF, 0, 0]))
+        self.assertEqual(short[7:MAX_PIXELS_PER_CLIP_SLICE * 3 + 7], bytes(MAX_PIXELS_PER_CLIP_SLICE * 3))
+        self.assertFalse(controller.clip_playing)
+        with self.assertRaises(ValueError):
+            controller.upload_clip(frames, [40])
+
+    def test_play_defaults_to_the_uploaded_frames_until_a_pixel_write(self):
+        controller = RecordingController()
+        controller.set_effect('plasma')
+        controller.upload_clip([bytes(12)] * 3, 50)
+        controller.play_clip(1, loops=2)
+        self.assertEqual(controller.sent[-1], bytes([CMD_CLIP_PLAY, 0, 1, 0, 2, 0, 2]))
+        self.assertTrue(controller.clip_playing)
+        self.assertFalse(controller.effect_running)
+
+        controller.clear()
+        self.assertFalse(controller.clip_playing)
+        controller.set_flight_recorder(True)
+        self.assertEqual(controller.sent[-1], bytes([CMD_SET_RECORDER, 1]))
+        with self.assertRaises(ValueError):
+            controller.play_clip()
+
+        self.assertFalse(controller.supports_clips())
+        controller._receiver_config = {'frame_formats': RECEIVER_FRAME_FORMAT_CLIPS}
+        self.assertTrue(controller.supports_clips())
+
+    def test_recorded_frame_is_read_a_slice_at_a_time(self):
+        controller = RecordingController(total_leds=300)
+        controller._recorder_enabled = True
+        rgb = bytes(i & 0xFF for i in range(900))
+        controller.responses = [
+            None,
+            None,
+            clips_page(back=9, readback=b'\x01'),
+            clips_page(back=2, offset=0, readback=rgb[:768], sequence=77),
+            clips_page(back=2, offset=0, readback=rgb[:768], sequence=77),
+            clips_page(back=2, offset=768, readback=rgb[768:], sequence=77),
+        ]
+        frame = controller.read_recorded_frame(back=2)
+
+        self.assertEqual(frame['sequence'], 77)
+        self.assertFalse(frame['indexed'])
+        self.assertEqual(frame['data'], rgb)
+        self.assertEqual(controller.sent[0], bytes([CMD_SET_RECORDER, 0]))
+        self.assertEqual(controller.sent[1], bytes([CMD_SELECT_STATUS_PAGE, CLIPS_PAGE]))
+        request = controller.sent[2]
+        self.assertEqual(len(request), CLIPS_PAGE_BYTES - 2)
+        self.assertEqual(request[:5], bytes([CMD_READ_RECORDER, 0, 2, 0, 0]))
+        # The second slice starts at pixel 256, after one stale response.
+        self.assertEqual(controller.sent[4][:5], bytes([CMD_READ_RECORDER, 0, 2, 1, 0]))
+        self.assertEqual(len(controller.sent), 7)
+        self.assertEqual(controller.sent[-1], bytes([CMD_SELECT_STATUS_PAGE, 0]))
+
+        controller.responses = [None, clips_page(back=0, flags=0)]
+        self.assertIsNone(controller.read_recorded_frame())
+        controller.responses = [
+            None,
+            clips_page(back=0, readback=bytes(300),
+                       flags=CLIP_READBACK_VALID | CLIP_READBACK_INDEXED),
+        ]
+        self.assertEqual(controller.read_recorded_frame()['data'], bytes(300))
+
+
+if __name__ == "__main__":
+    unittest.main()
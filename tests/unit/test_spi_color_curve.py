@@ -0,0 +1,82 @@
+import sys
+import types
+import unittest
+
+
+if "spidev" not in sys.modules:
+    spidev_stub = types.ModuleType("spidev")
+    spidev_stub.SpiDev = object
+    sys.modules["spidev"] = spidev_stub
+
+from drivers.spi_controller import (
+    ALL_LANES,
+    CMD_SET_COLOR_CURVE,
+    LEDController,
+    build_color_curve,
+)
+
+
+class RecordingController(LEDController):
+    def __init__(self):
+        self.debug = False
+        self.strip_count = 8
+        self._color_curve_commands = {}
+        self.sent = []
+
+    def _refresh_configuration(self, force=False):
+        pass
+
+    def _xfer(self, data):
+        self.sent.append(bytes(data))
+
+
+class ColorCurveTest(unittest.TestCase):
+    def test_build_color_curve_applies_gamma_and_gain(self):
+        self.assertEqual(build_color_curve(), bytes(range(256)))
+        curve = build_color_curve(2.2, 0.5)
+        self.assertEqual(curve[0], 0)
+        self.assertEqual(curve[255], 128)
+        self.assertEqual(list(curve), sorted(curve))
+        self.assertEqual(build_color_curve(1.0, 2.0)[200], 255)
+
+    def test_uniform_correction_sends_one_packet_for_all_channels(self):
+        controller = RecordingController()
+        controller.set_color_correction(2.2)
+
+        self.assertEqual(len(controller.sent), 1)
+        packet = controller.sent[0]
+        self.assertEqual(packet[:3], bytes([CMD_SET_COLOR_CURVE, ALL_LANES, 0x07]))
+        self.assertEqual(packet[3:], build_color_curve(2.2))
+
+    def test_white_balance_sends_per_channel_curves_for_selected_strips(self):
+        controller = RecordingController()
+        controller.set_color_correction(1.0, (1.0, 0.8, 0.6), strips=[0, 3])
+
+        self.assertEqual([packet[1:3] for packet in controller.sent],
+                         [bytes([0x09, 0x01]), bytes([0x09, 0x02]), bytes([0x09, 0x04])])
+        self.assertEqual(controller.sent[2][3 + 255], 153)
+
+    def test_sixteen_strip_receivers_take_a_two_byte_lane_mask(self):
+        controller = RecordingController()
+        controller.strip_count = 16
+        controller.set_color_curve(build_color_curve(), 0x04, strips=[1, 9])
+        controller.set_color_curve(build_color_curve(), 0x07)
+
+        self.assertEqual(controller.sent[0][:4], bytes([CMD_SET_COLOR_CURVE, 0x02, 0x02, 0x04]))
+        self.assertEqual(controller.sent[1][:4], bytes([CMD_SET_COLOR_CURVE, 0xFF, 0xFF, 0x07]))
+        self.assertEqual(len(controller.sent[1]), 4 + 256)
+
+    def test_full_upload_replaces_replayed_curves(self):
+        controller = RecordingController()
+        controller.set_color_curve(bytes(256), 0x01, strips=[2])
+        controller.set_color_curve(build_color_curve(), 0x07)
+
+        self.assertEqual(list(controller._color_curve_commands), [(ALL_LANES, 0x07)])
+
+    def test_rejects_short_curve(self):
+        with self.assertRaises(ValueError):
+            RecordingController().set_color_curve(bytes(10))
+
+
+if __name__ == "__main__":
+    unittest.main()
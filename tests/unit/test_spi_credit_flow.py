@@ -0,0 +1,151 @@
+import math
+import sys
+import types
+import unittest
+from unittest import mock
+
+
+if "spidev" not in sys.modules:
+    spidev_stub = types.ModuleType("spidev")
+    spidev_stub.SpiDev = object
+    sys.modules["spidev"] = spidev_stub
+
+from drivers import multi_device, spi_controller
+from drivers.multi_device import MultiDeviceLEDController
+from drivers.spi_controller import (
+    CMD_PING,
+    MIN_CREDIT_STATUS_PAYLOAD,
+    RECEIVER_STATUS_BYTES_V2_CREDITS,
+    LEDController,
+)
+
+
+# Receiver time runs this far behind host time, so it wraps mid-test.
+RECEIVER_CLOCK_BEHIND_US = 100_000_000 - 0xFFFFF000
+SLOT_INTERVAL_US = 10_000
+
+
+class FakeClock:
+    def __init__(self, now):
+        self.now = now
+
+    def perf_counter(self):
+        return self.now
+
+    def monotonic(self):
+        return self.now
+
+    def sleep(self, seconds):
+        self.now += max(0.0, seconds)
+
+
+def receiver_us(host_s):
+    return (int(round(host_s * 1e6)) - RECEIVER_CLOCK_BEHIND_US) & 0xFFFFFFFF
+
+
+def credit_status(snapshot_s, next_slot_s, credits=1, room=1):
+    response = bytearray(RECEIVER_STATUS_BYTES_V2_CREDITS)
+    response[0:4] = b"LGS2"
+    response[4] = 2
+    response[92] = 0xFF
+    response[192] = credits
+    response[193] = room
+    response[196:200] = receiver_us(snapshot_s).to_bytes(4, "big")
+    response[200:204] = receiver_us(next_slot_s).to_bytes(4, "big")
+    response[204:208] = SLOT_INTERVAL_US.to_bytes(4, "big")
+    return response
+
+
+class RecordingController(LEDController):
+    def __init__(self, clock):
+        self.debug = False
+        self.sent = []
+        self.clock = clock
+        self.receiver = None
+        self._receiver_status_version = 0
+        self._last_frame_duration = 0.001
+
+    def _refresh_configuration(self, force=False):
+        pass
+
+    def _xfer(self, data):
+        self.sent.append(bytes(data))
+        if self.receiver is not None:
+            self._update_receiver_status(self.receiver(self.clock.now))
+
+
+def display_every_slot(first_slot_s):
+    """A receiver whose display takes a frame every SLOT_INTERVAL_US."""
+    def status(now):
+        interval = SLOT_INTERVAL_US / 1e6
+        slots = max(0, math.ceil((now - first_slot_s) / interval))
+        return credit_status(now, first_slot_s + slots * interval)
+    return status
+
+
+class CreditFlowTest(unittest.TestCase):
+    def setUp(self):
+        self.clock = FakeClock(100.0)
+        for module in (spi_controller, multi_device):
+            patcher = mock.patch.object(module, 'time', self.clock)
+            patcher.start()
+            self.addCleanup(patcher.stop)
+
+    def test_credit_tail_maps_receiver_time_to_host_time(self):
+        controller = RecordingController(self.clock)
+        self.assertFalse(controller.supports_display_credits())
+        controller._update_receiver_status(credit_status(99.998, 100.004, credits=1, room=3))
+        self.assertTrue(controller.supports_display_credits())
+        credits = controller._receiver_credits
+        self.assertEqual((credits['credits'], credits['room']), (1, 3))
+        self.assertEqual(credits['slot_interval_us'], SLOT_INTERVAL_US)
+
+        # The fresher of two snapshots sets the offset; a staler one does not
+        # move it back.
+        controller._update_receiver_status(credit_status(99.9995, 100.004))
+        controller._update_receiver_status(credit_status(99.990, 100.004))
+        self.assertAlmostEqual(
+            controller._receiver_time(receiver_us(100.004), self.clock.now), 100.0045, places=5)
+
+    def test_frames_are_started_to_land_just_before_each_slot(self):
+        controller = RecordingController(self.clock)
+        controller.receiver = display_every_slot(100.010)
+        controller.set_credit_flow()
+
+        # Without credits the status is read first, with a PING padded to
+        # reach the credit tail.
+        self.assertTrue(controller.wait_for_display_slot(lead_s=0.002))
+        self.assertEqual(controller.sent[0], bytes([CMD_PING]) + bytes(MIN_CREDIT_STATUS_PAYLOAD - 1))
+        # Render lead, last send time and margin before the slot at 100.010.
+        self.assertAlmostEqual(self.clock.now, 100.0065, places=5)
+
+        # A frame the status has not seen yet holds the next one back a slot,
+        # and status is read again before it goes.
+        controller._spend_display_credit()
+        polls = controller._credit_polls
+        self.assertTrue(controller.wait_for_display_slot(lead_s=0.002))
+        self.assertAlmostEqual(self.clock.now, 100.0165, places=5)
+        self.assertGreater(controller._credit_polls, polls)
+        self.assertEqual(controller._credit_waits, 2)
+
+    def test_waiting_gives_up_without_credits(self):
+        controller = RecordingController(self.clock)
+        controller.set_credit_flow()
+        self.assertFalse(controller.wait_for_display_slot(timeout=0.01))
+        self.assertAlmostEqual(self.clock.now, 100.01, places=3)
+        self.assertTrue(all(packet[0] == CMD_PING for packet in controller.sent))
+
+    def test_multi_device_waits_for_every_receiver(self):
+        devices = [RecordingController(self.clock), RecordingController(self.clock)]
+        devices[0].receiver = display_every_slot(100.010)
+        devices[1].receiver = display_every_slot(100.012)
+        controller = MultiDeviceLEDController.__new__(MultiDeviceLEDController)
+        controller.devices = devices
+        controller.set_credit_flow()
+        self.assertTrue(controller.credit_flow)
+        self.assertTrue(controller.wait_for_display_slot())
+        self.assertAlmostEqual(self.clock.now, 100.0105, places=5)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,124 @@
+import sys
+import types
+import unittest
+from concurrent.futures import Future
+
+
+if "spidev" not in sys.modules:
+    spidev_stub = types.ModuleType("spidev")
+    spidev_stub.SpiDev = object
+    sys.modules["spidev"] = spidev_stub
+
+from drivers.spi_controller import (
+    CMD_SET_ALL,
+    CMD_SET_ALL_PART,
+    RECEIVER_FRAME_FORMAT_INDEXED,
+    RECEIVER_FRAME_FORMAT_STRIPED,
+    STATUS_PAGE_BYTES,
+    STATUS_PAGES,
+    LEDController,
+    _crc16_ccitt,
+)
+
+
+class StripeLink:
+    def __init__(self):
+        self.sent = []
+
+    def xfer2(self, data):
+        self.sent.append(bytes(data))
+        return [0] * len(data)
+
+
+class InlineExecutor:
+    def submit(self, fn, *args):
+        future = Future()
+        future.set_result(fn(*args))
+        return future
+
+
+class RecordingController(LEDController):
+    def __init__(self, strips=4, leds_per_strip=2, stripe=True):
+        self.debug = False
+        self.sent = []
+        self.strip_count = strips
+        self.leds_per_strip = leds_per_strip
+        self.total_leds = strips * leds_per_strip
+        self.stripe_spi = StripeLink() if stripe else None
+        self._stripe_executor = InlineExecutor()
+        self._frame_packet = bytearray(1 + self.total_leds * 3 + 2)
+        self._effect_command = None
+        self._compressed_base = None
+        self._receiver_capabilities = 0
+        self._receiver_config = None
+        self._stripe_sequence = 0
+        self._striped_frames_sent = 0
+        self._stripe_bytes_sent = 0
+        self._frames_sent = 0
+        self._total_frame_duration = 0.0
+        self._errors = 0
+
+    def _refresh_configuration(self, force=False):
+        pass
+
+    def _xfer_packet(self, buf, payload_length):
+        self.sent.append(bytes(buf[:payload_length]))
+
+
+class DualLinkTest(unittest.TestCase):
+    def test_frames_are_striped_by_strip_across_both_links(self):
+        controller = RecordingController()
+        colors = [(i, i + 1, i + 2) for i in range(8)]
+        controller.set_all_pixels(colors)
+        controller.set_all_pixels(colors)
+
+        rgb = bytes(channel for pixel in colors for channel in pixel)
+        self.assertEqual(controller.sent[0], bytes([CMD_SET_ALL_PART, 0, 1, 0, 2]) + rgb[:12])
+        stripe = controller.stripe_spi.sent[0]
+        self.assertEqual(stripe[:-2], bytes([CMD_SET_ALL_PART, 0, 1, 2, 2]) + rgb[12:])
+        crc = _crc16_ccitt(stripe[:-2])
+        self.assertEqual(stripe[-2:], bytes([crc >> 8, crc & 0xFF]))
+        self.assertEqual(controller.sent[1][:3], bytes([CMD_SET_ALL_PART, 0, 2]))
+        self.assertEqual(controller._striped_frames_sent, 2)
+        self.assertEqual(controller._frames_sent, 2)
+
+    def test_receivers_without_a_second_link_get_whole_frames(self):
+        controller = RecordingController()
+        controller._receiver_config = {'frame_formats': RECEIVER_FRAME_FORMAT_INDEXED}
+        self.assertFalse(controller.supports_striped_frames())
+        controller.set_all_pixels([(1, 2, 3)] * 8)
+        self.assertEqual(controller.sent[0][0], CMD_SET_ALL)
+        self.assertEqual(controller.stripe_spi.sent, [])
+
+        controller._receiver_config['frame_formats'] |= RECEIVER_FRAME_FORMAT_STRIPED
+        self.assertTrue(controller.supports_striped_frames())
+        self.assertFalse(RecordingController(stripe=False).supports_striped_frames())
+        self.assertFalse(RecordingController(strips=1).supports_striped_frames())
+
+    def test_links_page_reports_each_link(self):
+        controller = RecordingController()
+        size = STATUS_PAGE_BYTES[STATUS_PAGES.index('links')]
+        response = bytearray(size)
+        response[0:4] = b"LGS3"
+        response[4] = 3
+        response[5] = STATUS_PAGES.index('links')
+        response[6] = len(STATUS_PAGES)
+        response[12:14] = (size - 16).to_bytes(2, "big")
+        response[16] = 2
+        response[24:28] = (9).to_bytes(4, "big")
+        response[44 + 24 + 8:44 + 24 + 12] = (5).to_bytes(4, "big")
+        response[44 + 23] = 1
+        response[44 + 24 + 20] = 2
+
+        controller._update_receiver_status(response)
+        links = controller._receiver_links
+        self.assertEqual(links['frames_assembled'], 9)
+        self.assertEqual(len(links['links']), 2)
+        self.assertTrue(links['links'][0]['has_miso'])
+        self.assertEqual(links['links'][1]['crc_errors'], 5)
+        self.assertEqual(links['links'][1]['host'], 2)
+        self.assertFalse(links['links'][1]['has_miso'])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,93 @@
+import sys
+import types
+import unittest
+
+
+if "spidev" not in sys.modules:
+    spidev_stub = types.ModuleType("spidev")
+    spidev_stub.SpiDev = object
+    sys.modules["spidev"] = spidev_stub
+
+from drivers.multi_device import MultiDeviceLEDController
+from drivers.spi_controller import (
+    CMD_SET_EFFECT,
+    CMD_SET_EFFECT_PALETTE,
+    LEDController,
+)
+
+
+class RecordingController(LEDController):
+    def __init__(self):
+        self.debug = False
+        self.sent = []
+        self._effect_command = None
+        self._compressed_base = None
+
+    def _refresh_configuration(self, force=False):
+        pass
+
+    def _xfer(self, data):
+        self.sent.append(bytes(data))
+
+
+class EffectDevice:
+    def __init__(self):
+        self.effects = []
+
+    def set_effect(self, kind, **params):
+        self.effects.append((kind, params))
+
+
+class ReceiverEffectsTest(unittest.TestCase):
+    def test_set_effect_sends_fixed_point_parameters(self):
+        controller = RecordingController()
+        controller.set_effect('palette-field', wall_width=16, x_origin=8)
+
+        self.assertEqual(controller.sent, [bytes([
+            CMD_SET_EFFECT, 1,
+            0x00, 100,
+            0x00, 16,
+            0x00, 8,
+            0x0D, 0x00, 0x03, 0xB3, 0x11, 0x00, 0x00, 0x38, 0x85, 0x1F,
+        ])])
+        self.assertTrue(controller.effect_running)
+        with self.assertRaises(ValueError):
+            controller.set_effect('fireworks')
+
+    def test_pixel_writes_hand_the_wall_back_to_the_host(self):
+        controller = RecordingController()
+        controller.set_effect('plasma')
+        controller.clear()
+        self.assertFalse(controller.effect_running)
+
+        controller.set_effect('gradient')
+        controller.set_effect('off')
+        self.assertEqual(controller.sent[-1], bytes([CMD_SET_EFFECT, 0]))
+        self.assertFalse(controller.effect_running)
+
+    def test_palette_must_have_256_entries(self):
+        controller = RecordingController()
+        controller.set_effect_palette([(i, 255 - i, 0) for i in range(256)])
+        packet = controller.sent[0]
+        self.assertEqual(packet[0], CMD_SET_EFFECT_PALETTE)
+        self.assertEqual(len(packet), 1 + 768)
+        self.assertEqual(packet[1 + 3 * 200:4 + 3 * 200], bytes([200, 55, 0]))
+        with self.assertRaises(ValueError):
+            controller.set_effect_palette([(0, 0, 0)] * 16)
+
+    def test_multi_device_effect_spans_the_wall(self):
+        devices = [EffectDevice(), EffectDevice()]
+        controller = MultiDeviceLEDController.__new__(MultiDeviceLEDController)
+        controller.devices = devices
+        controller.num_devices = 2
+        controller.strips_per_device = 8
+        controller.set_effect('plasma', ticks_per_second=50)
+
+        self.assertEqual(devices[1].effects, [
+            ('plasma', {'wall_width': 16, 'x_origin': 8, 'ticks_per_second': 50}),
+        ])
+        self.assertEqual(devices[0].effects[0][1]['x_origin'], 0)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,112 @@
+import sys
+import types
+import unittest
+
+
+if "spidev" not in sys.modules:
+    spidev_stub = types.ModuleType("spidev")
+    spidev_stub.SpiDev = object
+    sys.modules["spidev"] = spidev_stub
+
+from drivers.spi_controller import (
+    CMD_SET_ALL_DELTA,
+    CMD_SET_ALL_RLE,
+    FRAME_TOKEN_RUN_FLAG,
+    LEDController,
+    MIN_STATUS_PAYLOAD,
+    RECEIVER_CAPABILITY_COMPRESSED_FRAMES,
+    RECEIVER_FLAG_DELTA_REJECTED,
+    _encode_frame_tokens,
+)
+
+
+def _decode_tokens(tokens, pixel_count):
+    """Reference decoder mirroring ledgrid::visit_frame_tokens."""
+    frame = bytearray()
+    offset = 0
+    while offset < len(tokens):
+        header = tokens[offset]
+        offset += 1
+        count = (header & ~FRAME_TOKEN_RUN_FLAG) + 1
+        if header & FRAME_TOKEN_RUN_FLAG:
+            frame += bytes(tokens[offset:offset + 3]) * count
+            offset += 3
+        else:
+            frame += tokens[offset:offset + count * 3]
+            offset += count * 3
+    assert len(frame) == pixel_count * 3
+    return bytes(frame)
+
+
+class RecordingController(LEDController):
+    def __init__(self):
+        self.total_leds = 300
+        self._receiver_capabilities = RECEIVER_CAPABILITY_COMPRESSED_FRAMES
+        self._receiver_flags = 0
+        self._receiver_crc_errors = 0
+        self._compressed_base = None
+        self._compressed_tag = 0
+        self._compressed_crc_errors = 0
+        self._frames_since_keyframe = 0
+        self._compressed_frames_sent = 0
+        self.packets = []
+
+    def _xfer(self, payload):
+        self.packets.append(bytes(payload))
+
+
+def _gradient(count, offset=0):
+    return bytes((index + offset) & 0xFF for index in range(count * 3))
+
+
+class FrameTokenTests(unittest.TestCase):
+    def test_round_trips_runs_and_literals(self):
+        rgb = bytes(300 * 3) + _gradient(5) + bytes((9, 9, 9)) * 2 + _gradient(200)
+        tokens = _encode_frame_tokens(rgb)
+        self.assertEqual(_decode_tokens(tokens, len(rgb) // 3), rgb)
+        # 300 black pixels take three run tokens of at most 128 pixels.
+        self.assertEqual(tokens[:4], bytes((0xFF, 0, 0, 0)))
+
+    def test_abandons_frames_that_do_not_compress(self):
+        rgb = _gradient(300)
+        self.assertIsNone(_encode_frame_tokens(rgb, len(rgb)))
+
+
+class CompressedFrameTests(unittest.TestCase):
+    def test_sends_keyframe_then_padded_xor_delta(self):
+        controller = RecordingController()
+        first = bytearray(300 * 3)
+        second = bytearray(first)
+        second[30:33] = b"\x10\x20\x30"
+
+        self.assertTrue(controller._send_compressed_frame(first))
+        self.assertTrue(controller._send_compressed_frame(second))
+
+        keyframe, delta = controller.packets
+        self.assertEqual(keyframe[:2], bytes((CMD_SET_ALL_RLE, 1)))
+        self.assertEqual(delta[:3], bytes((CMD_SET_ALL_DELTA, 1, 2)))
+        self.assertEqual(len(delta), MIN_STATUS_PAYLOAD)
+        token_bytes = (delta[3] << 8) | delta[4]
+        xor = _decode_tokens(delta[5:5 + token_bytes], 300)
+        self.assertEqual(bytes(a ^ b for a, b in zip(first, xor)), bytes(second))
+
+    def test_rejected_delta_forces_keyframe(self):
+        controller = RecordingController()
+        frame = bytearray(300 * 3)
+        controller._send_compressed_frame(frame)
+        controller._receiver_flags = RECEIVER_FLAG_DELTA_REJECTED
+
+        controller._send_compressed_frame(frame)
+
+        self.assertEqual(controller.packets[-1][0], CMD_SET_ALL_RLE)
+
+    def test_incompressible_frame_falls_back_and_drops_base(self):
+        controller = RecordingController()
+        controller._send_compressed_frame(bytearray(300 * 3))
+
+        self.assertFalse(controller._send_compressed_frame(_gradient(300)))
+        self.assertIsNone(controller._compressed_base)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,133 @@
+import sys
+import types
+import unittest
+
+
+if "spidev" not in sys.modules:
+    spidev_stub = types.ModuleType("spidev")
+    spidev_stub.SpiDev = object
+    sys.modules["spidev"] = spidev_stub
+
+from drivers.multi_device import MultiDeviceLEDController
+from drivers.spi_controller import (
+    CMD_LATCH,
+    CMD_SET_LATCH,
+    RECEIVER_CAPABILITY_FRAME_LATCH,
+    RECEIVER_STATUS_BYTES_V2_LATCH,
+    LEDController,
+)
+
+
+def status_response(length, capabilities=RECEIVER_CAPABILITY_FRAME_LATCH):
+    response = bytearray(length)
+    response[0:4] = b"LGS2"
+    response[4] = 2
+    response[7] = capabilities
+    if length >= RECEIVER_STATUS_BYTES_V2_LATCH:
+        response[64] = 1
+        response[66:68] = (42).to_bytes(2, "big")
+        response[68:72] = (7).to_bytes(4, "big")
+        response[72:76] = (2).to_bytes(4, "big")
+        response[76:80] = (99).to_bytes(4, "big")
+    return response
+
+
+class RecordingController(LEDController):
+    def __init__(self):
+        self.debug = False
+        self.sent = []
+        self._receiver_status_version = 0
+        self._latch_command = None
+
+    def _refresh_configuration(self, force=False):
+        pass
+
+    def _xfer(self, data):
+        self.sent.append(bytes(data))
+
+
+class LatchDevice:
+    def __init__(self, latch_us):
+        self.latch_us = latch_us
+        self.modes = []
+        self.latched = 0
+
+    def set_latch_mode(self, mode):
+        self.modes.append(mode)
+
+    def latch(self):
+        self.latched += 1
+
+    def get_stats(self):
+        return {
+            'receiver_latches': self.latched,
+            'receiver_latch_misses': 1,
+            'receiver_last_latch_us': self.latch_us,
+        }
+
+
+def multi_device(devices):
+    controller = MultiDeviceLEDController.__new__(MultiDeviceLEDController)
+    controller.devices = devices
+    controller.num_devices = len(devices)
+    controller.device_map = [(0, index) for index in range(len(devices))]
+    controller._devices_by_bus = {0: list(range(len(devices)))}
+    controller._logical_frames_sent = 0
+    controller._latch_mode = 'off'
+    controller._latches_sent = 0
+    controller._latch_send_offsets_us = []
+    controller.debug = False
+    return controller
+
+
+class FrameLatchTest(unittest.TestCase):
+    def test_latch_mode_and_latch_commands(self):
+        controller = RecordingController()
+        controller.set_latch_mode('command')
+        controller.latch()
+        controller.set_latch_mode('off')
+
+        self.assertEqual(controller.sent, [
+            bytes([CMD_SET_LATCH, 1]),
+            bytes([CMD_LATCH]),
+            bytes([CMD_SET_LATCH, 0]),
+        ])
+        self.assertFalse(controller.latch_enabled)
+        with self.assertRaises(KeyError):
+            controller.set_latch_mode('sometimes')
+
+    def test_latch_telemetry_needs_the_extended_status(self):
+        controller = RecordingController()
+        controller._update_receiver_status(status_response(64))
+        self.assertTrue(controller.supports_frame_latch())
+        self.assertFalse(hasattr(controller, '_receiver_latches'))
+
+        controller._update_receiver_status(status_response(RECEIVER_STATUS_BYTES_V2_LATCH))
+        self.assertEqual(controller._receiver_latch_mode, 1)
+        self.assertEqual(controller._receiver_last_latch_us, 42)
+        self.assertEqual(controller._receiver_latches, 7)
+        self.assertEqual(controller._receiver_latch_misses, 2)
+        self.assertEqual(controller._receiver_last_latch_sequence, 99)
+
+    def test_multi_device_latch_reports_skew(self):
+        devices = [LatchDevice(10), LatchDevice(500)]
+        controller = multi_device(devices)
+        controller.set_latch_mode('command')
+        controller.latch()
+
+        self.assertEqual([device.modes for device in devices], [['command'], ['command']])
+        self.assertEqual([device.latched for device in devices], [1, 1])
+        aggregate = controller.get_stats()['aggregate']
+        offsets = controller._latch_send_offsets_us
+        self.assertEqual(aggregate['latches_sent'], 1)
+        self.assertEqual(aggregate['receiver_latch_misses'], 2)
+        self.assertAlmostEqual(
+            aggregate['latch_skew_us'], abs(offsets[1] + 500 - offsets[0] - 10))
+
+    def test_skew_is_unknown_before_a_latch(self):
+        aggregate = multi_device([LatchDevice(10), LatchDevice(20)]).get_stats()['aggregate']
+        self.assertIsNone(aggregate['latch_skew_us'])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,69 @@
+import sys
+import types
+import unittest
+
+
+if "spidev" not in sys.modules:
+    spidev_stub = types.ModuleType("spidev")
+    spidev_stub.SpiDev = object
+    sys.modules["spidev"] = spidev_stub
+
+from drivers.spi_controller import (
+    CMD_SET_ALL_INDEXED,
+    CMD_SET_PALETTE,
+    RECEIVER_FRAME_FORMAT_INDEXED,
+    LEDController,
+)
+
+
+class RecordingController(LEDController):
+    def __init__(self, total_leds=6):
+        self.debug = False
+        self.sent = []
+        self.total_leds = total_leds
+        self._effect_command = None
+        self._compressed_base = None
+        self._frames_sent = 0
+        self._total_frame_duration = 0.0
+
+    def _refresh_configuration(self, force=False):
+        pass
+
+    def _xfer(self, data):
+        self.sent.append(bytes(data))
+
+
+class IndexedFramesTest(unittest.TestCase):
+    def test_palette_must_have_256_entries(self):
+        controller = RecordingController()
+        controller.set_palette([(i, 0, 255 - i) for i in range(256)])
+        packet = controller.sent[0]
+        self.assertEqual(packet[0], CMD_SET_PALETTE)
+        self.assertEqual(len(packet), 1 + 768)
+        self.assertEqual(packet[1 + 3 * 10:4 + 3 * 10], bytes([10, 0, 245]))
+        with self.assertRaises(ValueError):
+            controller.set_palette(bytes(767))
+
+    def test_indexed_frame_is_padded_to_the_wall_and_stops_effects(self):
+        controller = RecordingController()
+        controller.set_effect('plasma')
+        controller._compressed_base = b'\x00' * 18
+
+        controller.set_indexed_frame([1, 2, 300])
+        self.assertEqual(controller.sent[-1], bytes([CMD_SET_ALL_INDEXED, 1, 2, 44, 0, 0, 0]))
+        controller.set_indexed_frame(bytes(range(9)))
+        self.assertEqual(controller.sent[-1], bytes([CMD_SET_ALL_INDEXED, 0, 1, 2, 3, 4, 5]))
+
+        self.assertFalse(controller.effect_running)
+        self.assertIsNone(controller._compressed_base)
+        self.assertEqual(controller._frames_sent, 2)
+
+    def test_support_comes_from_the_config_page(self):
+        controller = RecordingController()
+        self.assertFalse(controller.supports_indexed_frames())
+        controller._receiver_config = {'frame_formats': RECEIVER_FRAME_FORMAT_INDEXED}
+        self.assertTrue(controller.supports_indexed_frames())
+
+
+if __name__ == "__main__":
+    unittest.main()
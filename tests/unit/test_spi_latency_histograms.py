@@ -0,0 +1,88 @@
+import sys
+import types
+import unittest
+
+
+if "spidev" not in sys.modules:
+    spidev_stub = types.ModuleType("spidev")
+    spidev_stub.SpiDev = object
+    sys.modules["spidev"] = spidev_stub
+
+from drivers.spi_controller import (
+    CMD_RESET_HISTOGRAMS,
+    CMD_SELECT_HISTOGRAM,
+    HISTOGRAM_ROTATE_FRAMES,
+    LATENCY_STAGES,
+    RECEIVER_STATUS_BYTES_V2_HISTOGRAM,
+    LEDController,
+    histogram_percentile,
+)
+
+
+class RecordingController(LEDController):
+    def __init__(self):
+        self.debug = False
+        self.sent = []
+        self._receiver_status_version = 0
+        self._receiver_latency_histograms = {}
+        self._frames_sent = 0
+
+    def _xfer(self, data):
+        self.sent.append(bytes(data))
+
+
+def histogram_response(stage, buckets, max_us):
+    response = bytearray(RECEIVER_STATUS_BYTES_V2_HISTOGRAM)
+    response[0:4] = b"LGS2"
+    response[92] = stage
+    response[93] = len(buckets)
+    response[96:100] = max_us.to_bytes(4, "big")
+    for index, count in enumerate(buckets):
+        response[100 + index * 4:104 + index * 4] = count.to_bytes(4, "big")
+    return response
+
+
+class LatencyHistogramTest(unittest.TestCase):
+    def test_percentile_reports_bucket_upper_bound(self):
+        buckets = [0] * 20
+        buckets[3] = 98
+        buckets[12] = 2
+        self.assertEqual(histogram_percentile(buckets, 0.5), 7)
+        self.assertEqual(histogram_percentile(buckets, 0.99), 4095)
+        self.assertIsNone(histogram_percentile([0] * 20, 0.5))
+        buckets[19] = 100
+        self.assertIsNone(histogram_percentile(buckets, 0.99))
+
+    def test_status_tail_is_filed_under_its_stage(self):
+        controller = RecordingController()
+        buckets = [0] * 20
+        buckets[1] = 4
+        controller._update_receiver_status(
+            histogram_response(LATENCY_STAGES.index('end-to-end'), buckets, 9000))
+        controller._update_receiver_status(histogram_response(0xFF, buckets, 1))
+
+        histograms = controller._receiver_latency_histograms
+        self.assertEqual(list(histograms), ['end-to-end'])
+        self.assertEqual(histograms['end-to-end']['max_us'], 9000)
+        self.assertEqual(histograms['end-to-end']['samples'], 4)
+        self.assertEqual(histograms['end-to-end']['p50_us'], 1)
+
+    def test_rotation_walks_every_stage_and_reset_clears(self):
+        controller = RecordingController()
+        controller.enable_latency_histograms()
+        for _ in range(HISTOGRAM_ROTATE_FRAMES * len(LATENCY_STAGES)):
+            controller._frames_sent += 1
+            controller._rotate_latency_histogram()
+
+        selections = [packet[1] for packet in controller.sent]
+        self.assertEqual(selections, list(range(len(LATENCY_STAGES))) + [0])
+        self.assertTrue(all(packet[0] == CMD_SELECT_HISTOGRAM for packet in controller.sent))
+
+        controller._receiver_latency_histograms = {'crc': {}}
+        controller.reset_latency_histograms()
+        self.assertEqual(controller.sent[-1], bytes([CMD_RESET_HISTOGRAMS]))
+        self.assertEqual(controller._receiver_latency_histograms, {})
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,130 @@
+import sys
+import types
+import unittest
+
+
+if "spidev" not in sys.modules:
+    spidev_stub = types.ModuleType("spidev")
+    spidev_stub.SpiDev = object
+    sys.modules["spidev"] = spidev_stub
+
+from drivers.led_layout import serpentine_layout
+from drivers.spi_controller import (
+    CMD_COMMIT_LAYOUT,
+    CMD_SET_LAYOUT,
+    LAYOUT_UNMAPPED,
+    MAX_LAYOUT_ENTRIES_PER_SLICE,
+    RECEIVER_FRAME_FORMAT_LAYOUT,
+    RECEIVER_STATUS_V3_HEADER_BYTES,
+    STATUS_PAGES,
+    LEDController,
+    _crc16_ccitt,
+)
+
+
+CONFIG_PAGE = STATUS_PAGES.index('config')
+
+
+class RecordingController(LEDController):
+    def __init__(self, strips=8, leds_per_strip=20):
+        self.debug = False
+        self.sent = []
+        self.strip_count = strips
+        self.leds_per_strip = leds_per_strip
+        self.total_leds = strips * leds_per_strip
+        self._status_page = 0
+        self._receiver_config = None
+
+    def _refresh_configuration(self, force=False):
+        pass
+
+    def _xfer(self, data):
+        self.sent.append(bytes(data))
+
+
+def entries_of(packets):
+    """(first entry, entries) of each CMD_SET_LAYOUT packet."""
+    slices = []
+    for packet in packets:
+        entries = [(packet[i] << 8) | packet[i + 1] for i in range(3, len(packet), 2)]
+        slices.append(((packet[1] << 8) | packet[2], entries))
+    return slices
+
+
+class LayoutMapTest(unittest.TestCase):
+    def test_serpentine_layout_reverses_every_other_strip(self):
+        self.assertEqual(serpentine_layout(3, 4), [0, 1, 2, 3, 7, 6, 5, 4, 8, 9, 10, 11])
+
+    def test_upload_sends_slices_then_commits(self):
+        controller = RecordingController(strips=8, leds_per_strip=300)
+        layout = serpentine_layout(8, 300)
+        layout[5] = None
+        version = controller.upload_layout(layout, version=0x01020304)
+        self.assertEqual(version, 0x01020304)
+
+        slices = entries_of(packet for packet in controller.sent if packet[0] == CMD_SET_LAYOUT)
+        self.assertEqual([first for first, _ in slices],
+                         list(range(0, 2400, MAX_LAYOUT_ENTRIES_PER_SLICE)))
+        entries = [entry for _, chunk in slices for entry in chunk]
+        self.assertEqual(entries[5], LAYOUT_UNMAPPED)
+        self.assertEqual(entries[300], 599)
+        self.assertEqual(len(entries), 2400)
+
+        commit = controller.sent[-1]
+        self.assertEqual(commit[0], CMD_COMMIT_LAYOUT)
+        data = b''.join(entry.to_bytes(2, "big") for entry in entries)
+        crc = _crc16_ccitt(data)
+        self.assertEqual(commit, bytes([
+            CMD_COMMIT_LAYOUT, 1, 2, 3, 4, 8, 0x01, 0x2C, crc >> 8, crc & 0xFF]))
+
+        # The default version is derived from the map and never 0.
+        controller.sent = []
+        first = controller.upload_layout(layout)
+        self.assertNotEqual(first, 0)
+        self.assertEqual(controller.upload_layout(layout), first)
+        self.assertNotEqual(controller.upload_layout(serpentine_layout(8, 300)), first)
+
+        controller.clear_layout()
+        self.assertEqual(controller.sent[-1], bytes([CMD_COMMIT_LAYOUT] + [0] * 9))
+
+    def test_upload_rejects_maps_that_do_not_fit(self):
+        controller = RecordingController(strips=2, leds_per_strip=3)
+        with self.assertRaises(ValueError):
+            controller.upload_layout([0, 1, 2, 3, 4])
+        with self.assertRaises(ValueError):
+            controller.upload_layout([0, 1, 2, 3, 4, 6])
+        with self.assertRaises(ValueError):
+            controller.upload_layout(range(6), version=0)
+        self.assertEqual(controller.sent, [])
+
+    def test_config_page_reports_the_stored_layout(self):
+        controller = RecordingController()
+        self.assertFalse(controller.supports_layout())
+        response = bytearray(56)
+        response[0:4] = b"LGS3"
+        response[4] = 3
+        response[5] = CONFIG_PAGE
+        response[6] = len(STATUS_PAGES)
+        response[12:14] = (56 - RECEIVER_STATUS_V3_HEADER_BYTES).to_bytes(2, "big")
+        response[37] = RECEIVER_FRAME_FORMAT_LAYOUT
+        response[46] = 2
+        response[48:52] = (0x01020304).to_bytes(4, "big")
+        response[52:54] = (0xBEEF).to_bytes(2, "big")
+        response[54:56] = (3).to_bytes(2, "big")
+
+        controller._update_receiver_status(response)
+        config = controller._receiver_config
+        self.assertTrue(controller.supports_layout())
+        self.assertEqual(config['layout_state'], 'inactive')
+        self.assertEqual(config['layout_crc'], 0xBEEF)
+        self.assertEqual(config['layout_rejected'], 3)
+        self.assertTrue(controller.layout_matches(0x01020304))
+        self.assertFalse(controller.layout_matches(0x01020305))
+
+        response[46] = 0
+        controller._update_receiver_status(response)
+        self.assertFalse(controller.layout_matches(0x01020304))
+
+
+if __name__ == "__main__":
+    unittest.main()
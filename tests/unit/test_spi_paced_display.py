@@ -0,0 +1,84 @@
+import sys
+import types
+import unittest
+
+
+if "spidev" not in sys.modules:
+    spidev_stub = types.ModuleType("spidev")
+    spidev_stub.SpiDev = object
+    sys.modules["spidev"] = spidev_stub
+
+from drivers.spi_controller import (
+    CMD_SET_PACING,
+    MIN_PACING_STATUS_PAYLOAD,
+    RECEIVER_CAPABILITY_COMPRESSED_FRAMES,
+    RECEIVER_STATUS_BYTES_V2_PACING,
+    LEDController,
+)
+
+
+class RecordingController(LEDController):
+    def __init__(self):
+        self.debug = False
+        self.sent = []
+        self._receiver_status_version = 0
+        self._receiver_capabilities = 0
+        self._latch_command = None
+        self._pacing_command = None
+
+    def _refresh_configuration(self, force=False):
+        pass
+
+    def _xfer(self, data):
+        self.sent.append(bytes(data))
+
+
+class PacedDisplayTest(unittest.TestCase):
+    def test_pacing_command_is_clamped_and_replaces_latch_mode(self):
+        controller = RecordingController()
+        controller.set_latch_mode('command')
+        controller.set_pacing(5000, jitter_frames=9)
+        controller.set_pacing(30, jitter_frames=0)
+
+        self.assertEqual(controller.sent[1], bytes([CMD_SET_PACING, 0x03, 0xE8, 3]))
+        self.assertEqual(controller.sent[2], bytes([CMD_SET_PACING, 0x00, 30, 1]))
+        self.assertFalse(controller.latch_enabled)
+        self.assertEqual(controller._pacing_command, [CMD_SET_PACING, 0, 30, 1])
+
+        controller.set_pacing(0)
+        self.assertIsNone(controller._pacing_command)
+
+    def test_pacing_counters_need_the_extended_status(self):
+        controller = RecordingController()
+        response = bytearray(RECEIVER_STATUS_BYTES_V2_PACING)
+        response[0:4] = b"LGS2"
+        response[80:82] = (60).to_bytes(2, "big")
+        response[82] = 2
+        response[84:88] = (5).to_bytes(4, "big")
+        response[88:92] = (6).to_bytes(4, "big")
+
+        controller._update_receiver_status(response[:80])
+        self.assertFalse(hasattr(controller, '_receiver_frames_late'))
+        controller._update_receiver_status(response)
+        self.assertEqual(controller._receiver_paced_fps, 60)
+        self.assertEqual(controller._receiver_pacing_depth, 2)
+        self.assertEqual(controller._receiver_frames_late, 5)
+        self.assertEqual(controller._receiver_queue_drops, 6)
+
+    def test_compressed_frames_are_padded_to_carry_pacing_counters(self):
+        controller = RecordingController()
+        controller._receiver_capabilities = RECEIVER_CAPABILITY_COMPRESSED_FRAMES
+        controller._receiver_flags = 0
+        controller._receiver_crc_errors = 0
+        controller._compressed_base = None
+        controller._compressed_tag = 0
+        controller._compressed_frames_sent = 0
+        controller._frames_since_keyframe = 0
+        controller.set_pacing(60)
+
+        self.assertTrue(controller._send_compressed_frame(bytes(300)))
+        self.assertEqual(len(controller.sent[-1]), MIN_PACING_STATUS_PAYLOAD)
+
+
+if __name__ == "__main__":
+    unittest.main()
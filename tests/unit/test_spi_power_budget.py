@@ -0,0 +1,101 @@
+import sys
+import types
+import unittest
+
+
+if "spidev" not in sys.modules:
+    spidev_stub = types.ModuleType("spidev")
+    spidev_stub.SpiDev = object
+    sys.modules["spidev"] = spidev_stub
+
+from drivers.spi_controller import (
+    CMD_CONFIG,
+    CMD_SET_POWER_BUDGET,
+    RECEIVER_FRAME_FORMAT_POWER_LIMIT,
+    STATUS_PAGE_BYTES,
+    STATUS_PAGES,
+    LEDController,
+)
+
+
+POWER_PAGE = STATUS_PAGES.index('power')
+POWER_PAGE_BYTES = STATUS_PAGE_BYTES[POWER_PAGE]
+
+
+class RecordingController(LEDController):
+    def __init__(self):
+        self.debug = False
+        self.sent = []
+        self.strip_count = 8
+        self.leds_per_strip = 140
+        self._last_sent_config = None
+        self._last_config_refresh = 0
+        self._config_refresh_interval = 5.0
+        self._color_curve_commands = {}
+        self._status_page = 0
+        self._receiver_config = None
+        self._receiver_power = None
+        self._power_command = None
+
+    def _xfer(self, data):
+        self.sent.append(bytes(data))
+
+
+class PowerBudgetTest(unittest.TestCase):
+    def test_budget_and_model_are_sent_and_replayed(self):
+        controller = RecordingController()
+        controller.set_power_budget(3000, 700)
+        self.assertEqual(controller.sent[0][0], CMD_CONFIG)
+        self.assertEqual(controller.sent[-1], bytes([CMD_SET_POWER_BUDGET, 0x0B, 0xB8, 0x02, 0xBC]))
+
+        controller.set_power_budget(70000, 0, channel_ma=(16, 11.5, 15), idle_ma=0.6)
+        self.assertEqual(controller.sent[-1], bytes([
+            CMD_SET_POWER_BUDGET, 0xFF, 0xFF, 0, 0,
+            0x3E, 0x80, 0x2C, 0xEC, 0x3A, 0x98, 0x02, 0x58,
+        ]))
+        with self.assertRaises(ValueError):
+            controller.set_power_budget(1000, channel_ma=(16, 11, 15))
+
+        # A rebooted receiver gets the budget back with its configuration.
+        controller.sent = []
+        controller._refresh_configuration(force=True)
+        self.assertEqual(controller.sent[0][0], CMD_CONFIG)
+        self.assertEqual(controller.sent[1][0], CMD_SET_POWER_BUDGET)
+
+        self.assertFalse(controller.supports_power_limit())
+        controller._receiver_config = {'frame_formats': RECEIVER_FRAME_FORMAT_POWER_LIMIT}
+        self.assertTrue(controller.supports_power_limit())
+
+    def test_power_page_reports_the_estimate(self):
+        controller = RecordingController()
+        response = bytearray(POWER_PAGE_BYTES)
+        response[0:4] = b"LGS3"
+        response[4] = 3
+        response[5] = POWER_PAGE
+        response[6] = len(STATUS_PAGES)
+        response[12:14] = (POWER_PAGE_BYTES - 16).to_bytes(2, "big")
+        response[16:18] = (3000).to_bytes(2, "big")
+        response[22:24] = (11000).to_bytes(2, "big")
+        response[28] = 200
+        response[29] = 150
+        response[30] = 2
+        response[31] = 1
+        response[32:36] = (4100).to_bytes(4, "big")
+        response[36:40] = (2995).to_bytes(4, "big")
+        response[40:44] = (7).to_bytes(4, "big")
+        response[52:56] = (1800).to_bytes(4, "big")
+
+        controller._update_receiver_status(response)
+        power = controller._receiver_power
+        self.assertEqual(power['budget_total_ma'], 3000)
+        self.assertEqual(power['channel_ua'], (0, 11000, 0))
+        self.assertEqual(power['applied_brightness'], 150)
+        self.assertEqual(power['demand_ma'], 4100)
+        self.assertEqual(power['total_ma'], 2995)
+        self.assertEqual(power['limited_frames'], 7)
+        self.assertEqual(power['busiest_strip'], 1)
+        self.assertEqual(power['strip_ma'], [0, 1800])
+
+
+if __name__ == "__main__":
+    unittest.main()
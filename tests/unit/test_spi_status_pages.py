@@ -0,0 +1,145 @@
+import sys
+import types
+import unittest
+
+
+if "spidev" not in sys.modules:
+    spidev_stub = types.ModuleType("spidev")
+    spidev_stub.SpiDev = object
+    sys.modules["spidev"] = spidev_stub
+
+from drivers.spi_controller import (
+    CMD_SELECT_STATUS_PAGE,
+    LATENCY_STAGES,
+    RECEIVER_CAPABILITY_STATUS_PAGES,
+    STATUS_PAGE_BYTES,
+    STATUS_PAGE_TRUNCATED,
+    STATUS_PAGES,
+    LEDController,
+)
+
+
+def page_response(page, length=None, flags=0):
+    size = STATUS_PAGE_BYTES[STATUS_PAGES.index(page)]
+    response = bytearray(length or size)
+    response[0:4] = b"LGS3"
+    response[4] = 3
+    response[5] = STATUS_PAGES.index(page)
+    response[6] = len(STATUS_PAGES)
+    response[7] = flags
+    response[8:12] = (77).to_bytes(4, "big")
+    if not flags & STATUS_PAGE_TRUNCATED:
+        response[12:14] = (size - 16).to_bytes(2, "big")
+    response[14] = RECEIVER_CAPABILITY_STATUS_PAGES
+    return response
+
+
+class RecordingController(LEDController):
+    def __init__(self):
+        self.debug = False
+        self.sent = []
+        self._receiver_status_version = 2
+        self._receiver_latency_histograms = {}
+
+    def _refresh_configuration(self, force=False):
+        pass
+
+    def _xfer(self, data):
+        self.sent.append(bytes(data))
+
+
+class StatusPagesTest(unittest.TestCase):
+    def test_select_status_page_sends_its_index(self):
+        controller = RecordingController()
+        controller.select_status_page('memory')
+        controller.select_status_page('v2')
+        self.assertEqual(controller.sent, [
+            bytes([CMD_SELECT_STATUS_PAGE, 3]),
+            bytes([CMD_SELECT_STATUS_PAGE, 0]),
+        ])
+        with self.assertRaises(ValueError):
+            controller.select_status_page('everything')
+
+    def test_core_page_updates_the_v2_counters(self):
+        controller = RecordingController()
+        response = page_response('core')
+        response[20:24] = (41).to_bytes(4, "big")
+        response[60:64] = (42).to_bytes(4, "big")
+        response[72] = 8
+        response[96:100] = (43).to_bytes(4, "big")
+
+        controller._update_receiver_status(response)
+        self.assertTrue(controller.supports_status_pages())
+        self.assertEqual(controller._receiver_status_generation, 77)
+        self.assertEqual(controller._receiver_packets, 41)
+        self.assertEqual(controller._receiver_last_displayed_sequence, 42)
+        self.assertEqual(controller._receiver_active_strips, 8)
+        self.assertEqual(controller._receiver_queue_drops, 43)
+
+    def test_histogram_page_fills_every_stage(self):
+        controller = RecordingController()
+        response = page_response('histograms')
+        response[16] = len(LATENCY_STAGES)
+        response[17] = 20
+        end_to_end = 20 + 6 * 84
+        response[end_to_end:end_to_end + 4] = (900).to_bytes(4, "big")
+        response[end_to_end + 44:end_to_end + 48] = (5).to_bytes(4, "big")
+
+        controller._update_receiver_status(response)
+        histograms = controller._receiver_latency_histograms
+        self.assertEqual(set(histograms), set(LATENCY_STAGES))
+        self.assertEqual(histograms['end-to-end']['max_us'], 900)
+        self.assertEqual(histograms['end-to-end']['samples'], 5)
+        self.assertEqual(histograms['end-to-end']['p99_us'], 1023)
+
+    def test_truncated_page_is_counted_not_parsed(self):
+        controller = RecordingController()
+        controller._update_receiver_status(
+            page_response('memory', length=64, flags=STATUS_PAGE_TRUNCATED))
+        self.assertEqual(controller._receiver_truncated_pages, 1)
+        self.assertFalse(hasattr(controller, '_receiver_memory'))
+
+        response = page_response('memory')
+        response[16:18] = (600).to_bytes(2, "big")
+        response[20] = 1
+        controller._update_receiver_status(response)
+        self.assertEqual(controller._receiver_memory['led_capacity'], 600)
+        self.assertTrue(controller._receiver_memory['zero_copy_mailbox'])
+
+    def test_config_page_reports_the_encode_cores_when_present(self):
+        controller = RecordingController()
+        response = page_response('config')
+        response[31] = 1
+        controller._update_receiver_status(response)
+        self.assertEqual(controller._receiver_config['encoder_kernel'], 1)
+        self.assertNotIn('encode_cores', controller._receiver_config)
+
+        response = page_response('config', length=48)
+        response[12:14] = (48 - 16).to_bytes(2, "big")
+        response[44] = 2
+        response[45] = 47
+        controller._update_receiver_status(response)
+        self.assertEqual(controller._receiver_config['encode_cores'], 2)
+        self.assertEqual(controller._receiver_config['encode_helper_share'], 47)
+
+    def test_transport_page_reports_the_armed_slots(self):
+        controller = RecordingController()
+        response = page_response('transport')
+        response[16] = 4
+        response[17] = 4
+        response[20:24] = (3).to_bytes(4, "big")
+        response[32 + 3 * 8:36 + 3 * 8] = (48).to_bytes(4, "big")
+        response[36 + 3 * 8:38 + 3 * 8] = (49).to_bytes(2, "big")
+        response[38 + 3 * 8:40 + 3 * 8] = (2).to_bytes(2, "big")
+
+        controller._update_receiver_status(response)
+        transport = controller._receiver_transport
+        self.assertEqual(transport['ring_depth'], 4)
+        self.assertEqual(transport['ring_drained'], 3)
+        self.assertEqual(len(transport['slots']), 4)
+        self.assertEqual(transport['slots'][3],
+                         {'completions': 48, 'max_service_us': 49, 'requeue_failures': 2})
+
+
+if __name__ == "__main__":
+    unittest.main()
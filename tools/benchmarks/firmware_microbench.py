@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""Compare receiver firmware micro-benchmark results against a baseline.
+
+Results are the JSON lines printed by the ``bench_native`` and
+``bench-esp32-s3`` PlatformIO environments. Other lines, such as PlatformIO or
+serial monitor chatter, are ignored, so output can be captured as-is::
+
+    pio run -e bench_native -t exec | tee results.jsonl
+    python tools/benchmarks/firmware_microbench.py results.jsonl --write-baseline base.jsonl
+    python tools/benchmarks/firmware_microbench.py results.jsonl --baseline base.jsonl
+"""
+
+from __future__ import annotations
+
+import argparse
+import json
+import sys
+
+SUITE = "ledgrid-pipeline"
+# Everything else in a record identifies the case.
+MEASUREMENT_KEYS = ("iterations", "ns_per_op", "cycles_per_op")
+
+
+def load_results(lines):
+    results = {}
+    for line in lines:
+        line = line.strip()
+        if not line.startswith("{"):
+            continue
+        try:
+            record = json.loads(line)
+        except ValueError:
+            continue
+        if record.get("suite") != SUITE or "ns_per_op" not in record:
+            continue
+        results[case_key(record)] = record
+    return results
+
+
+def case_key(record):
+    return tuple(sorted(
+        (key, value) for key, value in record.items() if key not in MEASUREMENT_KEYS
+    ))
+
+
+def case_label(key):
+    fields = dict(key)
+    label = f"{fields.pop('platform', '?')}/{fields.pop('case', '?')}"
+    fields.pop("suite", None)
+    extras = " ".join(f"{name}={value}" for name, value in sorted(fields.items()))
+    return f"{label} {extras}".rstrip()
+
+
+def compare(results, baseline, tolerance):
+    """Return (rows, regressions) for every case present in both runs."""
+    rows = []
+    regressions = []
+    for key in sorted(set(results) & set(baseline)):
+        before = float(baseline[key]["ns_per_op"])
+        after = float(results[key]["ns_per_op"])
+        change = (after - before) / before if before > 0 else 0.0
+        row = (case_label(key), before, after, change)
+        rows.append(row)
+        if change > tolerance:
+            regressions.append(row)
+    return rows, regressions
+
+
+def _read(path):
+    if path == "-":
+        return sys.stdin.readlines()
+    with open(path, encoding="utf-8") as handle:
+        return handle.readlines()
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("results", help="captured benchmark output, or - for stdin")
+    parser.add_argument("--baseline", help="earlier results to compare against")
+    parser.add_argument("--write-baseline", metavar="PATH",
+                        help="store the parsed results as a baseline")
+    parser.add_argument("--tolerance", type=float, default=0.15,
+                        help="allowed slowdown before a case fails (default 0.15)")
+    args = parser.parse_args(argv)
+
+    results = load_results(_read(args.results))
+    if not results:
+        print("no benchmark results found", file=sys.stderr)
+        return 2
+
+    if args.write_baseline:
+        with open(args.write_baseline, "w", encoding="utf-8") as handle:
+            for record in results.values():
+                handle.write(json.dumps(record, sort_keys=True) + "\n")
+        print(f"wrote {len(results)} cases to {args.write_baseline}")
+
+    if not args.baseline:
+        return 0
+
+    baseline = load_results(_read(args.baseline))
+    rows, regressions = compare(results, baseline, args.tolerance)
+    for label, before, after, change in rows:
+        marker = "  REGRESSED" if change > args.tolerance else ""
+        print(f"{label:60s} {before:12.1f} -> {after:12.1f} ns {change:+7.1%}{marker}")
+    missing = len(set(baseline) - set(results))
+    if missing:
+        print(f"{missing} baseline cases were not run")
+    print(json.dumps({
+        "cases": len(rows),
+        "regressions": len(regressions),
+        "tolerance": args.tolerance,
+        "passed": not regressions,
+    }))
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""Compare receiver simulator results against a baseline.
+
+Results are the JSON lines printed by the firmware's ``receiver_sim``
+PlatformIO environment, one per replayed capture or synthetic run. Other lines
+are ignored, so output can be captured as-is::
+
+    python scripts/start_server.py --capture-spi wall.spicap ...
+    .pio/build/receiver_sim/program --capture wall.spicap --label wall | tee results.jsonl
+    python tools/benchmarks/receiver_sim.py results.jsonl --write-baseline base.jsonl
+    python tools/benchmarks/receiver_sim.py results.jsonl --baseline base.jsonl
+
+A case regresses when its displayed frame rate falls, or its end-to-end p99
+latency grows, by more than the tolerance, or when it drops packets the
+baseline did not.
+"""
+
+from __future__ import annotations
+
+import argparse
+import json
+import sys
+
+SUITE = "ledgrid-receiver-sim"
+# Fields that identify a case; everything else is a measurement.
+CASE_KEYS = ("platform", "case", "strips", "leds", "zero_copy", "cpu_scale")
+
+
+def load_results(lines):
+    results = {}
+    for line in lines:
+        line = line.strip()
+        if not line.startswith("{"):
+            continue
+        try:
+            record = json.loads(line)
+        except ValueError:
+            continue
+        if record.get("suite") != SUITE or "displayed_fps" not in record:
+            continue
+        results[case_key(record)] = record
+    return results
+
+
+def case_key(record):
+    return tuple((key, record.get(key)) for key in CASE_KEYS)
+
+
+def case_label(key):
+    fields = dict(key)
+    label = f"{fields.pop('platform', '?')}/{fields.pop('case', '?')}"
+    extras = " ".join(f"{name}={value}" for name, value in fields.items())
+    return f"{label} {extras}".rstrip()
+
+
+def _relative(before, after):
+    return (after - before) / before if before > 0 else 0.0
+
+
+def compare(results, baseline, tolerance):
+    """Return (rows, regressions) for every case present in both runs."""
+    rows = []
+    regressions = []
+    for key in sorted(set(results) & set(baseline), key=str):
+        before, after = baseline[key], results[key]
+        fps_change = _relative(float(before["displayed_fps"]), float(after["displayed_fps"]))
+        p99_change = _relative(float(before.get("end_to_end_p99_us", 0)),
+                               float(after.get("end_to_end_p99_us", 0)))
+        lost = int(after.get("ring_overruns", 0)) - int(before.get("ring_overruns", 0))
+        row = (case_label(key), before, after, fps_change, p99_change, lost)
+        rows.append(row)
+        if fps_change < -tolerance or p99_change > tolerance or lost > 0:
+            regressions.append(row)
+    return rows, regressions
+
+
+def _read(path):
+    if path == "-":
+        return sys.stdin.readlines()
+    with open(path, encoding="utf-8") as handle:
+        return handle.readlines()
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("results", help="captured simulator output, or - for stdin")
+    parser.add_argument("--baseline", help="earlier results to compare against")
+    parser.add_argument("--write-baseline", metavar="PATH",
+                        help="store the parsed results as a baseline")
+    parser.add_argument("--tolerance", type=float, default=0.05,
+                        help="allowed frame rate loss or p99 growth before a case fails "
+                             "(default 0.05)")
+    args = parser.parse_args(argv)
+
+    results = load_results(_read(args.results))
+    if not results:
+        print("no simulator results found", file=sys.stderr)
+        return 2
+
+    if args.write_baseline:
+        with open(args.write_baseline, "w", encoding="utf-8") as handle:
+            for record in results.values():
+                handle.write(json.dumps(record, sort_keys=True) + "\n")
+        print(f"wrote {len(results)} cases to {args.write_baseline}")
+
+    if not args.baseline:
+        return 0
+
+    baseline = load_results(_read(args.baseline))
+    rows, regressions = compare(results, baseline, args.tolerance)
+    failed = {row[0] for row in regressions}
+    for label, before, after, fps_change, p99_change, lost in rows:
+        marker = "  REGRESSED" if label in failed else ""
+        print(f"{label:60s} {before['displayed_fps']:8.1f} -> {after['displayed_fps']:8.1f} fps "
+              f"{fps_change:+7.1%}  p99 {p99_change:+7.1%}  overruns {lost:+d}{marker}")
+    missing = len(set(baseline) - set(results))
+    if missing:
+        print(f"{missing} baseline cases were not run")
+    print(json.dumps({
+        "cases": len(rows),
+        "regressions": len(regressions),
+        "tolerance": args.tolerance,
+        "passed": not regressions,
+    }))
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())